@@ -52,6 +52,13 @@
 #define UDP_SERVER_PORT	5678
 
 #define SEND_INTERVAL		  (60 * CLOCK_SECOND)
+
+/* The node ID of the TSCH coordinator and RPL root in Cooja or on Z1 */
+#ifdef APP_CONF_COORDINATOR_ID
+#define APP_COORDINATOR_ID APP_CONF_COORDINATOR_ID
+#else
+#define APP_COORDINATOR_ID 1
+#endif
 /*---------------------------------------------------------------------------*/
 static struct simple_udp_connection client_conn, server_conn;
 
@@ -94,8 +101,8 @@ PROCESS_THREAD(node_process, ev, data)
 
   is_coordinator = 0;
 
-#if CONTIKI_TARGET_COOJA
-  is_coordinator = (node_id == 1);
+#if CONTIKI_TARGET_COOJA || CONTIKI_TARGET_Z1
+  is_coordinator = (node_id == APP_COORDINATOR_ID);
 #endif
 
   if(is_coordinator) {
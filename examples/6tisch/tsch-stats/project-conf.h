@@ -76,6 +76,8 @@
 /* Reduce the TSCH stat "decay to normal" period to get printouts more often */
 #define TSCH_STATS_CONF_DECAY_INTERVAL (60 * CLOCK_SECOND)
 
+#define TSCH_STATS_CONF_SLOT_TIMING 1
+
 /*******************************************************/
 /************* Other system configuration **************/
 /*******************************************************/
@@ -103,7 +103,7 @@ tcpip_handler(void)
        */
       PRINTF("At %lu: Trickle inconsistency. Scheduled TX for %lu\n",
              (unsigned long)clock_time(),
-             (unsigned long)ctimer_expiration_time(&tt.ct));
+             (unsigned long)TRICKLE_TIMER_NEXT_EXPIRATION(&tt));
     }
   }
   return;
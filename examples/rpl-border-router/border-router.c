@@ -31,6 +31,9 @@
  */
 
 #include "contiki.h"
+#if BORDER_ROUTER_CONF_TOPOLOGY_EXPORT
+#include "sr-topology.h"
+#endif /* BORDER_ROUTER_CONF_TOPOLOGY_EXPORT */
 
 /* Log configuration */
 #include "sys/log.h"
@@ -51,6 +54,10 @@ PROCESS_THREAD(contiki_ng_br, ev, data)
   process_start(&webserver_nogui_process, NULL);
 #endif /* BORDER_ROUTER_CONF_WEBSERVER */
 
+#if BORDER_ROUTER_CONF_TOPOLOGY_EXPORT
+  sr_topology_init();
+#endif /* BORDER_ROUTER_CONF_TOPOLOGY_EXPORT */
+
   LOG_INFO("Contiki-NG Border Router started\n");
 
   PROCESS_END();
@@ -50,4 +50,10 @@
 #define UIP_CONF_TCP 1
 #endif
 
+#if BORDER_ROUTER_CONF_TOPOLOGY_EXPORT
+#ifndef UIP_SR_CONF_CHANGE_LOG_SIZE
+#define UIP_SR_CONF_CHANGE_LOG_SIZE 32
+#endif
+#endif
+
 #endif /* PROJECT_CONF_H_ */
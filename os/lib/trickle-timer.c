@@ -68,11 +68,18 @@
 /*---------------------------------------------------------------------------*/
 /* Declarations of variables of local interest */
 /*---------------------------------------------------------------------------*/
-static struct trickle_timer *loctt;   /* Pointer to a struct for local use */
-static clock_time_t loc_clock; /* A local, general-purpose placeholder */
+/*
+ * All trickle timers share a single ctimer. Pending timers are kept in a
+ * pairing heap ordered by expiration time, threaded through the timers
+ * themselves, and the ctimer is always scheduled for the heap's root.
+ */
+static struct trickle_timer *heap_root;
+static struct ctimer sched_ct;
+static clock_time_t sched_expiration;
+static uint8_t in_run;
 
-static void fire(void *ptr);
-static void double_interval(void *ptr);
+static void fire(struct trickle_timer *tt);
+static void double_interval(struct trickle_timer *tt);
 /*---------------------------------------------------------------------------*/
 /* Local utilities and functions to be used as ctimer callbacks */
 /*---------------------------------------------------------------------------*/
@@ -165,118 +172,276 @@ get_t(clock_time_t i_cur)
   return i_cur + (tt_rand() % i_cur);
 }
 /*---------------------------------------------------------------------------*/
+/*---------------------------------------------------------------------------*/
+/* Shared scheduler */
+/*---------------------------------------------------------------------------*/
+/* Returns non-zero if absolute time a is before absolute time b */
+static int
+time_before(clock_time_t a, clock_time_t b)
+{
+  return (clock_time_t)(a - b) > (TRICKLE_TIMER_CLOCK_MAX >> 1);
+}
+/*---------------------------------------------------------------------------*/
+/* Melds two heaps, returns the new root. Roots must have no siblings */
+static struct trickle_timer *
+heap_meld(struct trickle_timer *a, struct trickle_timer *b)
+{
+  struct trickle_timer *tmp;
+
+  if(a == NULL) {
+    return b;
+  }
+  if(b == NULL) {
+    return a;
+  }
+  if(time_before(b->expiration, a->expiration)) {
+    tmp = a;
+    a = b;
+    b = tmp;
+  }
+
+  /* b becomes the first child of a */
+  b->prev = a;
+  b->sibling = a->child;
+  if(a->child != NULL) {
+    a->child->prev = b;
+  }
+  a->child = b;
+  return a;
+}
+/*---------------------------------------------------------------------------*/
+/* Standard two-pass pairing of a list of siblings into a single heap */
+static struct trickle_timer *
+heap_merge_pairs(struct trickle_timer *first)
+{
+  struct trickle_timer *a;
+  struct trickle_timer *b;
+  struct trickle_timer *next;
+  struct trickle_timer *pairs = NULL;
+
+  /* Left to right: meld pairs, stacking the results */
+  while(first != NULL) {
+    a = first;
+    b = a->sibling;
+    next = b != NULL ? b->sibling : NULL;
+    a->sibling = NULL;
+    if(b != NULL) {
+      b->sibling = NULL;
+    }
+    a = heap_meld(a, b);
+    a->sibling = pairs;
+    pairs = a;
+    first = next;
+  }
+
+  /* Right to left: meld the stacked pairs into one heap */
+  while(pairs != NULL) {
+    next = pairs->sibling;
+    pairs->sibling = NULL;
+    first = heap_meld(first, pairs);
+    pairs = next;
+  }
+
+  if(first != NULL) {
+    first->prev = NULL;
+  }
+  return first;
+}
+/*---------------------------------------------------------------------------*/
 static void
-schedule_for_end(struct trickle_timer *tt)
+heap_remove(struct trickle_timer *tt)
 {
-  /* Reset our ctimer, schedule interval_end to run at time I */
-  clock_time_t now = clock_time();
+  if(tt == heap_root) {
+    heap_root = heap_merge_pairs(tt->child);
+  } else {
+    /* Unlink tt from its parent or left sibling */
+    if(tt->prev->child == tt) {
+      tt->prev->child = tt->sibling;
+    } else {
+      tt->prev->sibling = tt->sibling;
+    }
+    if(tt->sibling != NULL) {
+      tt->sibling->prev = tt->prev;
+    }
+    tt->sibling = NULL;
+    heap_root = heap_meld(heap_root, heap_merge_pairs(tt->child));
+  }
+
+  tt->child = NULL;
+  tt->sibling = NULL;
+  tt->prev = NULL;
+  tt->event = TRICKLE_TIMER_EVENT_NONE;
+}
+/*---------------------------------------------------------------------------*/
+static void run(void *ptr);
+
+/* Make sure the shared ctimer expires when the heap's root is due */
+static void
+rearm(void)
+{
+  clock_time_t now;
 
-  loc_clock = TRICKLE_TIMER_INTERVAL_END(tt) - now;
+  if(in_run) {
+    /* run() will rearm once it has processed all due timers */
+    return;
+  }
 
-  PRINTF("trickle_timer sched for end: at %lu, end in %ld\n",
-         (unsigned long)clock_time(), (signed long)loc_clock);
+  if(heap_root == NULL) {
+    ctimer_stop(&sched_ct);
+    return;
+  }
+
+  if(!ctimer_expired(&sched_ct) &&
+     sched_expiration == heap_root->expiration) {
+    return;
+  }
 
-  /* Interval's end will happen in loc_clock ticks. Make sure this isn't in
-   * the past... */
-  if(loc_clock > (TRICKLE_TIMER_CLOCK_MAX >> 1)) {
-    loc_clock = 0; /* Interval ended in the past, schedule for in 0 */
-    PRINTF("trickle_timer doubling: Was in the past. Compensating\n");
+  now = clock_time();
+  sched_expiration = heap_root->expiration;
+  if(time_before(sched_expiration, now)) {
+    ctimer_set(&sched_ct, 0, run, NULL);
+  } else {
+    ctimer_set(&sched_ct, sched_expiration - now, run, NULL);
   }
+}
+/*---------------------------------------------------------------------------*/
+/* (Re)schedule a timer's next event at absolute time 'when' */
+static void
+schedule(struct trickle_timer *tt, uint8_t event, clock_time_t when)
+{
+  if(tt->event != TRICKLE_TIMER_EVENT_NONE) {
+    heap_remove(tt);
+  }
+
+  tt->expiration = when;
+  tt->event = event;
+  heap_root = heap_meld(heap_root, tt);
 
-  ctimer_set(&tt->ct, loc_clock, double_interval, tt);
+  rearm();
 }
 /*---------------------------------------------------------------------------*/
-/* This is used as a ctimer callback, thus its argument must be void *. ptr is
- * a pointer to the struct trickle_timer that fired */
+/* Callback of the shared ctimer: process all timers that are due */
 static void
-double_interval(void *ptr)
+run(void *ptr)
 {
-  clock_time_t last_end;
+  struct trickle_timer *tt;
+  uint8_t event;
+
+  in_run = 1;
+  while(heap_root != NULL &&
+        !time_before(clock_time(), heap_root->expiration)) {
+    tt = heap_root;
+    event = tt->event;
+    heap_remove(tt);
+
+    if(event == TRICKLE_TIMER_EVENT_FIRE) {
+      fire(tt);
+    } else {
+      double_interval(tt);
+    }
+  }
+  in_run = 0;
+
+  rearm();
+}
+/*---------------------------------------------------------------------------*/
+/* Trickle algorithm */
+/*---------------------------------------------------------------------------*/
+static void
+schedule_for_end(struct trickle_timer *tt)
+{
+  PRINTF("trickle_timer sched for end: at %lu, end at %lu\n",
+         (unsigned long)clock_time(),
+         (unsigned long)TRICKLE_TIMER_INTERVAL_END(tt));
 
-  /* 'cast' ptr to a struct trickle_timer */
-  loctt = (struct trickle_timer *)ptr;
+  /* If the interval ended in the past, this will be handled straight away */
+  schedule(tt, TRICKLE_TIMER_EVENT_DOUBLE, TRICKLE_TIMER_INTERVAL_END(tt));
+}
+/*---------------------------------------------------------------------------*/
+/* Called by the scheduler at the end of the current interval */
+/* Tells the protocol that a new interval has started, if it asked for it */
+static void
+interval_started(struct trickle_timer *tt)
+{
+  if(tt->interval_cb != NULL) {
+    tt->interval_cb(tt->cb_arg);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+double_interval(struct trickle_timer *tt)
+{
+  clock_time_t last_end;
+  clock_time_t t;
 
-  loctt->c = 0;
+  tt->c = 0;
 
   PRINTF("trickle_timer doubling: at %lu, (was for %lu), ",
          (unsigned long)clock_time(),
-         (unsigned long)TRICKLE_TIMER_INTERVAL_END(loctt));
+         (unsigned long)TRICKLE_TIMER_INTERVAL_END(tt));
 
   /* Remember the previous interval's end (absolute time), before we double */
-  last_end = TRICKLE_TIMER_INTERVAL_END(loctt);
+  last_end = TRICKLE_TIMER_INTERVAL_END(tt);
 
   /* Double the interval if we have to */
-  if(loctt->i_cur <= TRICKLE_TIMER_INTERVAL_MAX(loctt) >> 1) {
+  if(tt->i_cur <= TRICKLE_TIMER_INTERVAL_MAX(tt) >> 1) {
     /* If I <= Imax/2, we double */
-    loctt->i_cur <<= 1;
-    PRINTF("I << 1 = %lu\n", (unsigned long)loctt->i_cur);
+    tt->i_cur <<= 1;
+    PRINTF("I << 1 = %lu\n", (unsigned long)tt->i_cur);
   } else {
     /* We may have I > Imax/2 but I <> Imax, in which case we set to Imax
      * This will happen when I didn't start as Imin (before the first reset) */
-    loctt->i_cur = TRICKLE_TIMER_INTERVAL_MAX(loctt);
-    PRINTF("I = Imax = %lu\n", (unsigned long)loctt->i_cur);
+    tt->i_cur = TRICKLE_TIMER_INTERVAL_MAX(tt);
+    PRINTF("I = Imax = %lu\n", (unsigned long)tt->i_cur);
   }
 
   /* Random t in [I/2, I) */
-  loc_clock = get_t(loctt->i_cur);
+  t = get_t(tt->i_cur);
 
-  PRINTF("trickle_timer doubling: t=%lu\n", (unsigned long)loc_clock);
+  PRINTF("trickle_timer doubling: t=%lu\n", (unsigned long)t);
 
 #if TRICKLE_TIMER_COMPENSATE_DRIFT
   /* Schedule for t ticks after the previous interval's end, not after now. If
-   * that is in the past, schedule in 0 */
-  loc_clock = (last_end + loc_clock) - clock_time();
-  PRINTF("trickle_timer doubling: at %lu, in %ld ticks\n",
-         (unsigned long)clock_time(), (signed long)loc_clock);
-  if(loc_clock > (TRICKLE_TIMER_CLOCK_MAX >> 1)) {
-    /* Oops, that's in the past */
-    loc_clock = 0;
-    PRINTF("trickle_timer doubling: Was in the past. Compensating\n");
-  }
-  ctimer_set(&loctt->ct, loc_clock, fire, loctt);
-
-  /* Store the actual interval start (absolute time), we need it later.
-   * We pretend that it started at the same time when the last one ended */
-  loctt->i_start = last_end;
+   * that is in the past, the scheduler will handle it straight away. We
+   * pretend that the new interval started when the last one ended */
+  tt->i_start = last_end;
 #else
-  /* Assumed that the previous interval's end is 'now' and schedule in t ticks
+  /* Assume that the previous interval's end is 'now' and schedule in t ticks
    * after 'now', ignoring potential offsets */
-  ctimer_set(&loctt->ct, loc_clock, fire, loctt);
-  /* Store the actual interval start (absolute time), we need it later */
-  loctt->i_start = ctimer_start_time(&loctt->ct);
+  tt->i_start = clock_time();
 #endif
+  schedule(tt, TRICKLE_TIMER_EVENT_FIRE, tt->i_start + t);
 
   PRINTF("trickle_timer doubling: Last end %lu, new end %lu, for %lu, I=%lu\n",
          (unsigned long)last_end,
-         (unsigned long)TRICKLE_TIMER_INTERVAL_END(loctt),
-         (unsigned long)ctimer_expiration_time(&loctt->ct),
-         (unsigned long)(loctt->i_cur));
+         (unsigned long)TRICKLE_TIMER_INTERVAL_END(tt),
+         (unsigned long)tt->expiration,
+         (unsigned long)(tt->i_cur));
+
+  interval_started(tt);
 }
 /*---------------------------------------------------------------------------*/
-/* Called by the ctimer module at time t within the current interval. ptr is
- * a pointer to the struct trickle_timer of interest */
+/* Called by the scheduler at time t within the current interval */
 static void
-fire(void *ptr)
+fire(struct trickle_timer *tt)
 {
-  /* 'cast' c to a struct trickle_timer */
-  loctt = (struct trickle_timer *)ptr;
-
   PRINTF("trickle_timer fire: at %lu (was for %lu)\n",
-         (unsigned long)clock_time(),
-         (unsigned long)ctimer_expiration_time(&loctt->ct));
+         (unsigned long)clock_time(), (unsigned long)tt->expiration);
 
-  if(loctt->cb) {
+  if(tt->cb) {
     /*
      * Call the protocol's TX callback, with the suppression status as an
      * argument.
      */
     PRINTF("trickle_timer fire: Suppression Status %u (%u < %u)\n",
-           TRICKLE_TIMER_PROTO_TX_ALLOW(loctt), loctt->c, loctt->k);
-    loctt->cb(loctt->cb_arg, TRICKLE_TIMER_PROTO_TX_ALLOW(loctt));
+           TRICKLE_TIMER_PROTO_TX_ALLOW(tt), tt->c, tt->k);
+    tt->cb(tt->cb_arg, TRICKLE_TIMER_PROTO_TX_ALLOW(tt));
   }
 
-  if(trickle_timer_is_running(loctt)) {
-    schedule_for_end(loctt);
+  /* The callback may have stopped the timer or started a new interval */
+  if(trickle_timer_is_running(tt) &&
+     tt->event == TRICKLE_TIMER_EVENT_NONE) {
+    schedule_for_end(tt);
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -285,19 +450,23 @@ fire(void *ptr)
 static void
 new_interval(struct trickle_timer *tt)
 {
+  clock_time_t t;
+
   tt->c = 0;
 
   /* Random t in [I/2, I) */
-  loc_clock = get_t(tt->i_cur);
-
-  ctimer_set(&tt->ct, loc_clock, fire, tt);
+  t = get_t(tt->i_cur);
 
   /* Store the actual interval start (absolute time), we need it later */
-  tt->i_start = ctimer_start_time(&tt->ct);
+  tt->i_start = clock_time();
+  schedule(tt, TRICKLE_TIMER_EVENT_FIRE, tt->i_start + t);
+
   PRINTF("trickle_timer new interval: at %lu, ends %lu, ",
-         (unsigned long)clock_time(),
+         (unsigned long)tt->i_start,
          (unsigned long)TRICKLE_TIMER_INTERVAL_END(tt));
-  PRINTF("t=%lu, I=%lu\n", (unsigned long)loc_clock, (unsigned long)tt->i_cur);
+  PRINTF("t=%lu, I=%lu\n", (unsigned long)t, (unsigned long)tt->i_cur);
+
+  interval_started(tt);
 }
 /*---------------------------------------------------------------------------*/
 /* Functions to be called by the protocol implementation */
@@ -330,6 +499,16 @@ trickle_timer_inconsistency(struct trickle_timer *tt)
   }
 }
 /*---------------------------------------------------------------------------*/
+void
+trickle_timer_stop(struct trickle_timer *tt)
+{
+  if(tt->event != TRICKLE_TIMER_EVENT_NONE) {
+    heap_remove(tt);
+    rearm();
+  }
+  tt->i_cur = TRICKLE_TIMER_IS_STOPPED;
+}
+/*---------------------------------------------------------------------------*/
 uint8_t
 trickle_timer_config(struct trickle_timer *tt, clock_time_t i_min,
                      uint8_t i_max, uint8_t k)
@@ -345,7 +524,9 @@ trickle_timer_config(struct trickle_timer *tt, clock_time_t i_min,
     return TRICKLE_TIMER_ERROR;
   }
 
-  if(tt == NULL || i_max == 0 || k == 0) {
+  /* Imax == 0 (no doublings) and k == TRICKLE_TIMER_INFINITE_REDUNDANCY are
+   * both valid */
+  if(tt == NULL) {
     PRINTF("trickle_timer config: Bad arguments\n");
     return TRICKLE_TIMER_ERROR;
   }
@@ -366,12 +547,18 @@ trickle_timer_config(struct trickle_timer *tt, clock_time_t i_min,
   }
 #endif
 
+  /* Re-configuring a running timer stops it */
+  if(tt->event != TRICKLE_TIMER_EVENT_NONE) {
+    trickle_timer_stop(tt);
+  }
+
   tt->i_min = i_min;
   tt->i_max = i_max;
   tt->i_max_abs = i_min << i_max;
   tt->k = k;
   tt->i_cur = TRICKLE_TIMER_IS_STOPPED;
   tt->cb = NULL;
+  tt->interval_cb = NULL;
 
   PRINTF("trickle_timer config: Imin=%lu, Imax=%u, k=%u\n",
          (unsigned long)tt->i_min, tt->i_max, tt->k);
@@ -379,6 +566,13 @@ trickle_timer_config(struct trickle_timer *tt, clock_time_t i_min,
   return TRICKLE_TIMER_SUCCESS;
 }
 /*---------------------------------------------------------------------------*/
+void
+trickle_timer_set_interval_callback(struct trickle_timer *tt,
+                                    trickle_timer_interval_cb_t interval_cb)
+{
+  tt->interval_cb = interval_cb;
+}
+/*---------------------------------------------------------------------------*/
 uint8_t
 trickle_timer_set(struct trickle_timer *tt, trickle_timer_cb_t proto_cb,
                   void *ptr)
@@ -407,10 +601,31 @@ trickle_timer_set(struct trickle_timer *tt, trickle_timer_cb_t proto_cb,
   PRINTF("trickle_timer set: at %lu, ends %lu, t=%lu in [%lu , %lu)\n",
          (unsigned long)tt->i_start,
          (unsigned long)TRICKLE_TIMER_INTERVAL_END(tt),
-         (unsigned long)tt->ct.etimer.timer.interval,
+         (unsigned long)(tt->expiration - tt->i_start),
          (unsigned long)tt->i_cur >> 1, (unsigned long)tt->i_cur);
 
   return TRICKLE_TIMER_SUCCESS;
 }
 /*---------------------------------------------------------------------------*/
+uint8_t
+trickle_timer_set_at_imin(struct trickle_timer *tt,
+                          trickle_timer_cb_t proto_cb, void *ptr)
+{
+#if TRICKLE_TIMER_ERROR_CHECKING
+  /* Sanity checks */
+  if(tt == NULL || proto_cb == NULL) {
+    PRINTF("trickle_timer set at Imin: Bad arguments\n");
+    return TRICKLE_TIMER_ERROR;
+  }
+#endif
+
+  tt->cb = proto_cb;
+  tt->cb_arg = ptr;
+  tt->i_cur = tt->i_min;
+
+  new_interval(tt);
+
+  return TRICKLE_TIMER_SUCCESS;
+}
+/*---------------------------------------------------------------------------*/
 /** @} */
@@ -65,6 +65,12 @@
  * 'consistent' or 'inconsistent' message and when an 'external event' occurs
  * (in this context, those terms have the exact same meaning as in the RFC).
  *
+ * All trickle timers are multiplexed onto a single \ref ctimer. Pending timers
+ * are kept in a pairing heap ordered by their next expiration, so that a node
+ * running many trickle instances (e.g. MPL with many buffered messages) pays
+ * O(log n) amortised per timer update and keeps only one ctimer registered
+ * with the system.
+ *
  * It is \e not safe to manipulate trickle timers within an interrupt context.
  * @{
  */
@@ -122,6 +128,14 @@
  * timer.
  */
 #define TRICKLE_TIMER_IS_STOPPED              0
+
+/**
+ * \brief Values of the internal event field of a ::trickle_timer, stating
+ * what happens when the timer next expires
+ */
+#define TRICKLE_TIMER_EVENT_NONE              0 /**< Not scheduled */
+#define TRICKLE_TIMER_EVENT_FIRE              1 /**< Time t in the interval */
+#define TRICKLE_TIMER_EVENT_DOUBLE            2 /**< End of the interval */
 /** @} */
 /*---------------------------------------------------------------------------*/
 /**
@@ -281,6 +295,17 @@
  */
 #define TRICKLE_TIMER_INTERVAL_END(tt) ((tt)->i_start + (tt)->i_cur)
 
+/**
+ * \brief Returns the absolute time of the timer's next scheduled event, either
+ *        time t or the end of the current interval
+ *
+ * \param tt A pointer to a ::trickle_timer structure
+ *
+ * \return The absolute number of clock ticks when the timer will next expire.
+ *         Only meaningful while the timer is running
+ */
+#define TRICKLE_TIMER_NEXT_EXPIRATION(tt) ((tt)->expiration)
+
 /**
  * \brief Checks whether an Imin value is suitable considering the various
  * restrictions imposed by our platform's clock as well as by the library itself
@@ -347,6 +372,16 @@
  */
 typedef void (* trickle_timer_cb_t)(void *ptr, uint8_t suppress);
 
+/**
+ * \brief Optional protocol callback, invoked at the start of each interval
+ * \param ptr The same opaque pointer that is passed to the ::trickle_timer_cb_t
+ *
+ * This is called once the library has set the new interval's I, i.e. when
+ * the timer gets set, reset or after an inconsistency and each time the
+ * interval doubles. The protocol can read I from the timer's i_cur field.
+ */
+typedef void (* trickle_timer_interval_cb_t)(void *ptr);
+
 /**
  * \struct trickle_timer
  *
@@ -370,14 +405,22 @@ struct trickle_timer {
                                Imin << Imax used internally, so that we can
                                have direct access to the maximum interval size
                                without having to calculate it all the time */
-  struct ctimer ct;       /**< A \ref ctimer used internally */
+  clock_time_t expiration; /**< Absolute time of the next event */
+  struct trickle_timer *child;   /**< Scheduler heap: first child */
+  struct trickle_timer *sibling; /**< Scheduler heap: next sibling */
+  struct trickle_timer *prev;    /**< Scheduler heap: parent or previous
+                                      sibling */
   trickle_timer_cb_t cb;  /**< Protocol's own callback, invoked at time t
                                within the current interval */
   void *cb_arg;           /**< Opaque pointer to be used as the argument of the
                                protocol's callback */
+  trickle_timer_interval_cb_t interval_cb; /**< Optional callback, invoked
+                                                at the start of each
+                                                interval */
   uint8_t i_max;          /**< Imax: Max number of doublings */
   uint8_t k;              /**< k: Redundancy Constant */
   uint8_t c;              /**< c: Consistency Counter */
+  uint8_t event;          /**< Next scheduled event, used internally */
 };
 /** @} */
 /*---------------------------------------------------------------------------*/
@@ -405,6 +448,9 @@ struct trickle_timer {
  * A trickle timer MUST be configured before the protocol calls
  * trickle_timer_set().
  *
+ * Configuring a running timer stops it. The structure must either be zeroed
+ * or have been configured before, as its scheduler state is inspected.
+ *
  * If Imin<<Imax would exceed the platform's clock_time_t boundaries, this
  * function adjusts Imax to the maximum permitted value for the provided Imin.
  * This means that in a network with heterogenous hardware, 'we' are likely to
@@ -414,6 +460,19 @@ struct trickle_timer {
 uint8_t trickle_timer_config(struct trickle_timer *tt, clock_time_t i_min,
                              uint8_t i_max, uint8_t k);
 
+/**
+ * \brief             Ask to be told when each trickle interval starts
+ * \param tt          A pointer to a ::trickle_timer structure
+ * \param interval_cb The callback, or NULL to stop being told
+ *
+ * The callback gets the same opaque pointer as the protocol's
+ * ::trickle_timer_cb_t. Configuring the timer clears it, so call this after
+ * trickle_timer_config() and before starting the timer, so that the callback
+ * also sees the first interval.
+ */
+void trickle_timer_set_interval_callback(struct trickle_timer *tt,
+                                         trickle_timer_interval_cb_t interval_cb);
+
 /**
  * \brief           Start a previously configured trickle timer
  * \param tt        A pointer to a ::trickle_timer structure
@@ -434,12 +493,30 @@ uint8_t trickle_timer_config(struct trickle_timer *tt, clock_time_t i_min,
 uint8_t trickle_timer_set(struct trickle_timer *tt,
                           trickle_timer_cb_t proto_cb, void *ptr);
 
+/**
+ * \brief           Start a previously configured trickle timer with I = Imin
+ * \param tt        A pointer to a ::trickle_timer structure
+ * \param proto_cb  A pointer to a callback function, which will be invoked at
+ *                  at time t within the current trickle interval
+ * \param ptr       An opaque pointer which will be passed as the argument to
+ *                  proto_cb when the timer fires.
+ * \retval 0        Error (tt or proto_cb was null)
+ * \retval non-zero Success.
+ *
+ * Same as trickle_timer_set(), but the first interval is Imin instead of a
+ * random value in [Imin, Imax]. This suits protocols which, like RPL, start
+ * advertising as fast as possible after joining a network. If the timer is
+ * already running, it starts over with a new Imin interval.
+ */
+uint8_t trickle_timer_set_at_imin(struct trickle_timer *tt,
+                                  trickle_timer_cb_t proto_cb, void *ptr);
+
 /**
  * \brief      Stop a running trickle timer.
  * \param tt   A pointer to a ::trickle_timer structure
  *
  * This function stops a running trickle timer that was previously started with
- * trickle_timer_start(). After this function has been called, the trickle
+ * trickle_timer_set(). After this function has been called, the trickle
  * timer will no longer call the protocol's callback and its interval will not
  * double any more. In order to resume the trickle timer, the user application
  * must call trickle_timer_set().
@@ -448,10 +525,7 @@ uint8_t trickle_timer_set(struct trickle_timer *tt,
  * to reset a timer manually. Instead, in response to events or inconsistencies,
  * the corresponding functions must be used
  */
-#define trickle_timer_stop(tt) do { \
-  ctimer_stop(&((tt)->ct)); \
-  (tt)->i_cur = TRICKLE_TIMER_IS_STOPPED; \
-} while(0)
+void trickle_timer_stop(struct trickle_timer *tt);
 
 /**
  * \brief      To be called by the protocol when it hears a consistent
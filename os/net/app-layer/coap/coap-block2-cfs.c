@@ -0,0 +1,247 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden AB
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Block2 transfers served from CFS files
+ */
+
+/**
+ * \addtogroup coap-block2-cfs
+ * @{
+ */
+
+#include "contiki.h"
+#include "coap.h"
+#include "coap-block2-cfs.h"
+#include "cfs/cfs.h"
+#include <string.h>
+#include <inttypes.h>
+
+/* Log configuration */
+#include "coap-log.h"
+#define LOG_MODULE "coap"
+#define LOG_LEVEL  LOG_LEVEL_COAP
+
+#if COAP_WITH_BLOCK2_CFS
+
+typedef struct {
+  char name[COAP_BLOCK2_CFS_NAME_LEN];
+  int fd;
+  cfs_offset_t pos;
+  cfs_offset_t size;
+  uint32_t etag;
+  uint16_t last_used;
+} open_file_t;
+
+static open_file_t files[COAP_BLOCK2_CFS_FDS];
+static uint16_t use_count;
+/* changes the ETags of rewritten files */
+static uint16_t generation;
+static uint8_t initialized;
+/*---------------------------------------------------------------------------*/
+static void
+close_file(open_file_t *f)
+{
+  if(f->fd >= 0) {
+    cfs_close(f->fd);
+    f->fd = -1;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+init(void)
+{
+  int i;
+
+  for(i = 0; i < COAP_BLOCK2_CFS_FDS; i++) {
+    files[i].fd = -1;
+  }
+  initialized = 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+open_file(open_file_t *f, const char *filename)
+{
+  const char *c;
+  uint32_t hash = 2166136261UL ^ generation;
+
+  f->fd = cfs_open(filename, CFS_READ);
+  if(f->fd < 0) {
+    return 0;
+  }
+  f->size = cfs_seek(f->fd, 0, CFS_SEEK_END);
+  if(f->size < 0) {
+    close_file(f);
+    return 0;
+  }
+  f->pos = f->size;
+
+  for(c = filename; *c != '\0'; c++) {
+    hash = (hash ^ (uint8_t)*c) * 16777619UL;
+  }
+  f->etag = hash ^ (uint32_t)f->size;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Returns the open file for a name, or NULL if it cannot be opened */
+static open_file_t *
+get_file(const char *filename, open_file_t *uncached)
+{
+  open_file_t *f;
+  open_file_t *lru = NULL;
+  int i;
+
+  if(strlen(filename) >= COAP_BLOCK2_CFS_NAME_LEN) {
+    /* opened and closed for this block only */
+    uncached->name[0] = '\0';
+    return open_file(uncached, filename) ? uncached : NULL;
+  }
+
+  for(i = 0; i < COAP_BLOCK2_CFS_FDS; i++) {
+    f = &files[i];
+    if(f->fd >= 0 && strcmp(f->name, filename) == 0) {
+      f->last_used = ++use_count;
+      return f;
+    }
+    if(lru == NULL || f->fd < 0
+       || (lru->fd >= 0
+           && (uint16_t)(use_count - f->last_used) >
+           (uint16_t)(use_count - lru->last_used))) {
+      lru = f;
+    }
+  }
+
+  if(lru->fd >= 0) {
+    LOG_DBG("Block2: closing %s for %s\n", lru->name, filename);
+    close_file(lru);
+  }
+  if(!open_file(lru, filename)) {
+    return NULL;
+  }
+  strcpy(lru->name, filename);
+  lru->last_used = ++use_count;
+  return lru;
+}
+/*---------------------------------------------------------------------------*/
+int
+coap_block2_cfs_handler(coap_message_t *request, coap_message_t *response,
+                        uint8_t *buffer, uint16_t preferred_size,
+                        int32_t *offset, const char *filename)
+{
+  open_file_t uncached;
+  open_file_t *f;
+  uint8_t etag[4];
+  int len;
+
+  if(!initialized) {
+    init();
+  }
+
+  f = get_file(filename, &uncached);
+  if(f == NULL) {
+    LOG_WARN("Block2: cannot open %s\n", filename);
+    coap_set_status_code(response, NOT_FOUND_4_04);
+    return -1;
+  }
+
+  etag[0] = f->etag >> 24;
+  etag[1] = f->etag >> 16;
+  etag[2] = f->etag >> 8;
+  etag[3] = f->etag;
+
+  if(*offset > f->size || (*offset == f->size && f->size > 0)) {
+    coap_set_status_code(response, BAD_OPTION_4_02);
+    coap_set_payload(response, "BlockOutOfScope", 15);
+    close_file(f);
+    return -1;
+  }
+
+  coap_set_header_etag(response, etag, sizeof(etag));
+  if(*offset == 0 || coap_is_option(request, COAP_OPTION_SIZE2)) {
+    coap_set_header_size2(response, f->size);
+  }
+
+  if(*offset == 0 && !coap_is_option(request, COAP_OPTION_BLOCK2)
+     && request->etag_len == sizeof(etag)
+     && memcmp(request->etag, etag, sizeof(etag)) == 0) {
+    /* the client has the current version */
+    coap_set_status_code(response, VALID_2_03);
+    close_file(f);
+    return 0;
+  }
+
+  /* successive blocks continue where the previous read ended */
+  if(f->pos != *offset) {
+    f->pos = cfs_seek(f->fd, *offset, CFS_SEEK_SET);
+  }
+  len = f->pos == *offset ? cfs_read(f->fd, buffer, preferred_size) : -1;
+  if(len < 0) {
+    LOG_WARN("Block2: cannot read %s at %"PRId32"\n", filename, *offset);
+    coap_set_status_code(response, INTERNAL_SERVER_ERROR_5_00);
+    close_file(f);
+    return -1;
+  }
+  f->pos += len;
+
+  coap_set_payload(response, buffer, len);
+  *offset += len;
+  if(*offset >= f->size) {
+    /* the last block */
+    *offset = -1;
+    close_file(f);
+  } else if(f == &uncached) {
+    close_file(f);
+  }
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+void
+coap_block2_cfs_changed(const char *filename)
+{
+  int i;
+
+  if(!initialized) {
+    init();
+  }
+
+  for(i = 0; i < COAP_BLOCK2_CFS_FDS; i++) {
+    if(filename == NULL || strcmp(files[i].name, filename) == 0) {
+      close_file(&files[i]);
+    }
+  }
+  generation++;
+}
+#endif /* COAP_WITH_BLOCK2_CFS */
+/*---------------------------------------------------------------------------*/
+/** @} */
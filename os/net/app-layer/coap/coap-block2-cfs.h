@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden AB
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Block2 transfers served from CFS files
+ */
+
+/**
+ * \addtogroup coap
+ * @{
+ *
+ * \defgroup coap-block2-cfs CoAP Block2 from CFS files
+ * @{
+ *
+ * Serves a file in the Contiki File System (Coffee, or the POSIX backend
+ * on native) block by block (RFC 7959) from a resource handler:
+ *
+ * \code
+ * static void
+ * res_get_handler(coap_message_t *request, coap_message_t *response,
+ *                 uint8_t *buffer, uint16_t preferred_size,
+ *                 int32_t *offset)
+ * {
+ *   coap_set_header_content_format(response, APPLICATION_OCTET_STREAM);
+ *   coap_block2_cfs_handler(request, response, buffer, preferred_size,
+ *                           offset, "firmware.bin");
+ * }
+ * \endcode
+ *
+ * Each block is read with cfs_seek() and cfs_read() straight into the
+ * response buffer, so the file is never held in RAM. Files stay open
+ * between the blocks of a transfer, and a block that continues where the
+ * previous one ended needs no seek. Up to COAP_BLOCK2_CFS_FDS files are
+ * kept open and are closed when their last block has been served, or
+ * when the slot is needed for another file.
+ *
+ * The first block carries Size2 with the file size, and all blocks carry
+ * an ETag derived from the file name and size, so clients notice when the
+ * file changes during a transfer. Applications that rewrite a file must
+ * call coap_block2_cfs_changed() before doing so; this closes the file
+ * and gives it a new ETag.
+ */
+
+#ifndef COAP_BLOCK2_CFS_H_
+#define COAP_BLOCK2_CFS_H_
+
+#include "coap.h"
+
+/**
+ * \brief                Serve the block of a file that a request asks for.
+ * \param request        The request passed to the resource handler.
+ * \param response       The response passed to the resource handler.
+ * \param buffer         The buffer passed to the resource handler.
+ * \param preferred_size The block size passed to the resource handler.
+ * \param offset         The block offset passed to the resource handler.
+ * \param filename       The CFS file to serve.
+ * \return               The number of payload bytes, or -1 if the file
+ *                       could not be read or the offset is beyond its end,
+ *                       in which case the response carries an error code.
+ */
+int coap_block2_cfs_handler(coap_message_t *request, coap_message_t *response,
+                            uint8_t *buffer, uint16_t preferred_size,
+                            int32_t *offset, const char *filename);
+
+/**
+ * \brief          Tell the helper that a file is about to change.
+ * \param filename The file, or NULL for all files.
+ */
+void coap_block2_cfs_changed(const char *filename);
+
+#endif /* COAP_BLOCK2_CFS_H_ */
+/** @} */
+/** @} */
@@ -44,6 +44,9 @@
 #include "coap-engine.h"
 #include "coap-blocking-api.h"
 #include "sys/cc.h"
+#if COAP_WITH_TCP
+#include "coap-tcp.h"
+#endif /* COAP_WITH_TCP */
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -95,6 +98,13 @@ PT_THREAD(coap_blocking_request
         coap_set_header_block2(request, state->block_num, 0,
                                COAP_MAX_CHUNK_SIZE);
       }
+#if COAP_WITH_BERT
+      if(coap_tcp_has_bert(remote_ep)) {
+        /* ask for BERT blocks, also for the first one */
+        coap_set_header_block2(request, state->block_num, 0,
+                               COAP_BERT_BLOCK_SIZE);
+      }
+#endif /* COAP_WITH_BERT */
       state->transaction->message_len = coap_serialize_message(request,
                                                               state->
                                                               transaction->
@@ -124,7 +134,7 @@ PT_THREAD(coap_blocking_request
 
       if(state->res_block == state->block_num) {
         request_callback(state->response);
-        ++(state->block_num);
+        state->block_num += coap_get_block2_count(state->response);
       } else {
         LOG_WARN("WRONG BLOCK %"PRIu32"/%"PRIu32"\n",
                  state->res_block, state->block_num);
@@ -0,0 +1,417 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden AB
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         CoAP response cache
+ */
+
+/**
+ * \addtogroup coap-cache
+ * @{
+ */
+
+#include "contiki.h"
+#include "coap.h"
+#include "coap-cache.h"
+#include "coap-timer.h"
+#include "lib/heapmem.h"
+#include "lib/list.h"
+#include <string.h>
+
+/* Log configuration */
+#include "coap-log.h"
+#define LOG_MODULE "coap-cache"
+#define LOG_LEVEL  LOG_LEVEL_COAP
+
+#if COAP_WITH_CACHE
+
+#ifndef HEAPMEM_CONF_ARENA_SIZE
+#error "The CoAP cache requires HEAPMEM_CONF_ARENA_SIZE"
+#endif
+
+#define NO_ACCEPT 0xffff
+
+typedef struct coap_cache_entry {
+  struct coap_cache_entry *next;
+  uint64_t expires;
+  uint16_t size;
+  uint16_t key_len;
+  uint16_t accept;
+  uint16_t content_format;
+  uint16_t payload_len;
+  uint8_t secure;
+  uint8_t etag_len;
+  uint8_t etag[COAP_ETAG_LEN];
+  /* the key followed by the payload */
+  uint8_t data[];
+} coap_cache_entry_t;
+
+/* most recently used first */
+LIST(cache_list);
+
+static coap_cache_stats_t stats;
+static char key[COAP_CACHE_KEY_LEN];
+/*---------------------------------------------------------------------------*/
+static int
+append(int n, const char *s, size_t len)
+{
+  if(n < 0 || n + len > sizeof(key)) {
+    return -1;
+  }
+  memcpy(&key[n], s, len);
+  return n + len;
+}
+/*---------------------------------------------------------------------------*/
+/* Builds the key of a cacheable request, returns its length or -1 */
+static int
+make_key(const coap_message_t *request)
+{
+  int n = 0;
+
+  if(request->code != COAP_GET
+     || coap_is_option(request, COAP_OPTION_OBSERVE)
+     || coap_is_option(request, COAP_OPTION_BLOCK1)
+     || coap_is_option(request, COAP_OPTION_BLOCK2)) {
+    return -1;
+  }
+
+  if(coap_is_option(request, COAP_OPTION_PROXY_URI)) {
+    return append(0, request->proxy_uri, request->proxy_uri_len);
+  }
+
+  if(coap_is_option(request, COAP_OPTION_URI_HOST)) {
+    n = append(n, "//", 2);
+    n = append(n, request->uri_host, request->uri_host_len);
+  }
+  n = append(n, "/", 1);
+  n = append(n, request->uri_path, request->uri_path_len);
+  if(coap_is_option(request, COAP_OPTION_URI_QUERY)) {
+    n = append(n, "?", 1);
+    n = append(n, request->uri_query, request->uri_query_len);
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+/* Locate the "/path" part of a key, after any scheme and authority */
+static const char *
+resource_path(const coap_cache_entry_t *e, const char **end)
+{
+  const char *path = (const char *)e->data;
+  const char *limit = path + e->key_len;
+  const char *p;
+
+  for(*end = path; *end < limit && **end != '?'; (*end)++);
+  for(p = path; p + 2 < *end && *p != '/'; p++);
+  if(p + 2 < *end && p[1] == '/') {
+    /* skip "//authority" */
+    for(p += 2; p < *end && *p != '/'; p++);
+  }
+  return p < *end && *p == '/' ? p : NULL;
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+get_accept(const coap_message_t *request)
+{
+  return coap_is_option(request, COAP_OPTION_ACCEPT) ?
+    request->accept : NO_ACCEPT;
+}
+/*---------------------------------------------------------------------------*/
+/* Secure and plain requests never share entries */
+static uint8_t
+get_secure(const coap_message_t *request)
+{
+  const coap_endpoint_t *ep = coap_get_src_endpoint(request);
+
+  return ep != NULL && coap_endpoint_is_secure(ep);
+}
+/*---------------------------------------------------------------------------*/
+static coap_cache_entry_t *
+lookup(int key_len, const coap_message_t *request)
+{
+  coap_cache_entry_t *e;
+  uint16_t accept = get_accept(request);
+  uint8_t secure = get_secure(request);
+
+  for(e = list_head(cache_list); e != NULL; e = e->next) {
+    if(e->key_len == key_len && e->accept == accept && e->secure == secure
+       && memcmp(e->data, key, key_len) == 0) {
+      return e;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+free_entry(coap_cache_entry_t *e)
+{
+  stats.entries--;
+  stats.bytes -= e->size;
+  heapmem_free(e);
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_entry(coap_cache_entry_t *e)
+{
+  list_remove(cache_list, e);
+  free_entry(e);
+}
+/*---------------------------------------------------------------------------*/
+static void
+evict_one(void)
+{
+  /* the least recently used entry */
+  coap_cache_entry_t *e = list_chop(cache_list);
+
+  if(e != NULL) {
+    free_entry(e);
+    stats.evictions++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static uint32_t
+remaining_max_age(const coap_cache_entry_t *e, uint64_t now)
+{
+  return e->expires > now ? (e->expires - now + 999) / 1000 : 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+etag_matches(const coap_message_t *request, const coap_cache_entry_t *e)
+{
+  return coap_is_option(request, COAP_OPTION_ETAG)
+    && request->etag_len == e->etag_len
+    && memcmp(request->etag, e->etag, e->etag_len) == 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_valid(coap_message_t *response, const coap_cache_entry_t *e,
+          uint32_t max_age)
+{
+  coap_set_status_code(response, VALID_2_03);
+  coap_set_header_etag(response, e->etag, e->etag_len);
+  coap_set_header_max_age(response, max_age);
+  coap_set_payload(response, NULL, 0);
+}
+/*---------------------------------------------------------------------------*/
+/* An ETag for responses without one, from the representation itself */
+static void
+make_etag(coap_cache_entry_t *e, const uint8_t *payload)
+{
+  uint32_t hash = 2166136261UL ^ e->content_format;
+  uint16_t i;
+
+  for(i = 0; i < e->payload_len; i++) {
+    hash = (hash ^ payload[i]) * 16777619UL;
+  }
+  e->etag_len = 4;
+  e->etag[0] = hash >> 24;
+  e->etag[1] = hash >> 16;
+  e->etag[2] = hash >> 8;
+  e->etag[3] = hash;
+}
+/*---------------------------------------------------------------------------*/
+int
+coap_cache_respond(const coap_message_t *request, coap_message_t *response)
+{
+  coap_cache_entry_t *e;
+  uint64_t now;
+  int key_len;
+
+  key_len = make_key(request);
+  if(key_len < 0) {
+    return 0;
+  }
+
+  now = coap_timer_uptime();
+  e = lookup(key_len, request);
+  if(e == NULL || e->expires <= now) {
+    stats.misses++;
+    return 0;
+  }
+  stats.hits++;
+
+  list_remove(cache_list, e);
+  list_push(cache_list, e);
+
+  if(etag_matches(request, e)) {
+    LOG_DBG("valid: %.*s\n", key_len, key);
+    stats.revalidations++;
+    set_valid(response, e, remaining_max_age(e, now));
+    return 1;
+  }
+
+  LOG_DBG("hit: %.*s\n", key_len, key);
+  coap_set_status_code(response, CONTENT_2_05);
+  if(e->content_format != NO_ACCEPT) {
+    coap_set_header_content_format(response, e->content_format);
+  }
+  coap_set_header_etag(response, e->etag, e->etag_len);
+  coap_set_header_max_age(response, remaining_max_age(e, now));
+  coap_set_payload(response, e->data + e->key_len, e->payload_len);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+coap_cache_store(const coap_message_t *request, coap_message_t *response)
+{
+  coap_cache_entry_t *e;
+  uint32_t max_age;
+  uint16_t size;
+  int key_len;
+
+  if(request->code != COAP_GET) {
+    /* unsafe methods invalidate the target (RFC 7252, Section 5.9) */
+    if(response->code == CREATED_2_01 || response->code == DELETED_2_02
+       || response->code == CHANGED_2_04) {
+      coap_cache_invalidate(request->uri_path, request->uri_path_len);
+    }
+    return;
+  }
+
+  key_len = make_key(request);
+  if(key_len < 0 || !coap_is_option(response, COAP_OPTION_MAX_AGE)
+     || coap_is_option(response, COAP_OPTION_BLOCK2)) {
+    return;
+  }
+  coap_get_header_max_age(response, &max_age);
+  e = lookup(key_len, request);
+
+  if(response->code == VALID_2_03) {
+    /* the upstream server confirmed the cached representation */
+    if(e != NULL && response->etag_len == e->etag_len
+       && memcmp(response->etag, e->etag, e->etag_len) == 0) {
+      e->expires = coap_timer_uptime() + max_age * 1000ULL;
+      stats.revalidations++;
+    }
+    return;
+  }
+
+  if(response->code != CONTENT_2_05 || max_age == 0) {
+    return;
+  }
+
+  if(e != NULL) {
+    remove_entry(e);
+  }
+
+  size = sizeof(coap_cache_entry_t) + key_len + response->payload_len;
+  if(size > COAP_CACHE_SIZE) {
+    return;
+  }
+  while(stats.bytes + size > COAP_CACHE_SIZE) {
+    evict_one();
+  }
+  while((e = heapmem_alloc(size)) == NULL && list_head(cache_list) != NULL) {
+    evict_one();
+  }
+  if(e == NULL) {
+    return;
+  }
+
+  e->size = size;
+  e->key_len = key_len;
+  e->accept = get_accept(request);
+  e->secure = get_secure(request);
+  e->content_format = coap_is_option(response, COAP_OPTION_CONTENT_FORMAT) ?
+    response->content_format : NO_ACCEPT;
+  e->payload_len = response->payload_len;
+  e->expires = coap_timer_uptime() + max_age * 1000ULL;
+  memcpy(e->data, key, key_len);
+  memcpy(e->data + key_len, response->payload, response->payload_len);
+
+  if(coap_is_option(response, COAP_OPTION_ETAG)) {
+    e->etag_len = response->etag_len;
+    memcpy(e->etag, response->etag, response->etag_len);
+  } else {
+    make_etag(e, response->payload);
+    coap_set_header_etag(response, e->etag, e->etag_len);
+  }
+
+  list_push(cache_list, e);
+  stats.entries++;
+  stats.bytes += size;
+  stats.stores++;
+  LOG_DBG("stored %u bytes for %lu s: %.*s\n", e->payload_len,
+          (unsigned long)max_age, key_len, key);
+
+  if(etag_matches(request, e)) {
+    /* the requester already has this representation */
+    set_valid(response, e, max_age);
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+coap_cache_add_validator(coap_message_t *request)
+{
+  coap_cache_entry_t *e;
+  int key_len;
+
+  key_len = make_key(request);
+  if(key_len < 0 || coap_is_option(request, COAP_OPTION_ETAG)) {
+    return 0;
+  }
+  e = lookup(key_len, request);
+  if(e == NULL) {
+    return 0;
+  }
+  coap_set_header_etag(request, e->etag, e->etag_len);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+coap_cache_invalidate(const char *uri_path, size_t len)
+{
+  coap_cache_entry_t *e;
+  coap_cache_entry_t *next;
+  const char *path;
+  const char *end;
+
+  for(e = list_head(cache_list); e != NULL; e = next) {
+    next = e->next;
+    path = resource_path(e, &end);
+    if(path != NULL && end - path == len + 1
+       && memcmp(path + 1, uri_path, len) == 0) {
+      LOG_DBG("invalidated %.*s\n", e->key_len, (char *)e->data);
+      remove_entry(e);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+coap_cache_stats(coap_cache_stats_t *s)
+{
+  *s = stats;
+}
+#endif /* COAP_WITH_CACHE */
+/*---------------------------------------------------------------------------*/
+/** @} */
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden AB
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         CoAP response cache
+ */
+
+/**
+ * \addtogroup coap
+ * @{
+ *
+ * \defgroup coap-cache CoAP response cache
+ * @{
+ *
+ * Keeps complete 2.05 representations keyed by their URI, query, Accept
+ * option and whether the request came over a secure endpoint, for as long as their Max-Age allows (RFC 7252, Section
+ * 5.6). The engine answers fresh GET requests from the cache without
+ * calling the resource, and answers requests that carry the ETag of the
+ * current representation with 2.03 Valid. Only responses with an explicit
+ * Max-Age are cached, so resources opt in by setting one. Unsafe requests
+ * and notifications invalidate the entries of their resource.
+ *
+ * A forward proxy uses the same functions for upstream exchanges: answer
+ * with coap_cache_respond(), add the validator of a stale entry with
+ * coap_cache_add_validator() before forwarding, and pass the upstream
+ * response to coap_cache_store(), which also refreshes entries on 2.03.
+ *
+ * Entries are allocated with heapmem, so HEAPMEM_CONF_ARENA_SIZE must be
+ * set, and are bounded by COAP_CACHE_SIZE bytes with the least recently
+ * used entries evicted first.
+ */
+
+#ifndef COAP_CACHE_H_
+#define COAP_CACHE_H_
+
+#include "coap.h"
+
+typedef struct {
+  uint32_t hits;
+  uint32_t misses;
+  uint32_t revalidations;
+  uint32_t stores;
+  uint32_t evictions;
+  uint16_t entries;
+  uint16_t bytes;
+} coap_cache_stats_t;
+
+/**
+ * \brief          Answer a request from a fresh cache entry.
+ * \param request  The request.
+ * \param response The response to fill in, its payload points into the
+ *                 cache until the next cache operation.
+ * \return         Returns true if the response was filled in and false
+ *                 otherwise.
+ */
+int coap_cache_respond(const coap_message_t *request,
+                       coap_message_t *response);
+
+/**
+ * \brief          Store the response to a request, or refresh the cached
+ *                 representation on 2.03 Valid.
+ * \param request  The request.
+ * \param response The response. It is stored if it is a 2.05 response
+ *                 with Max-Age and without Block2.
+ */
+void coap_cache_store(const coap_message_t *request,
+                      coap_message_t *response);
+
+/**
+ * \brief          Add the ETag of a cached representation to a request so
+ *                 that it can be revalidated.
+ * \param request  The request to forward.
+ * \return         Returns true if an ETag was added and false otherwise.
+ */
+int coap_cache_add_validator(coap_message_t *request);
+
+/**
+ * \brief          Drop all cached representations of a resource.
+ * \param uri_path The Uri-Path of the resource, without a leading slash.
+ * \param len      The length of the path.
+ */
+void coap_cache_invalidate(const char *uri_path, size_t len);
+
+/**
+ * \brief          Get the cache counters.
+ * \param stats    A pointer to the structure to fill in.
+ */
+void coap_cache_stats(coap_cache_stats_t *stats);
+
+#endif /* COAP_CACHE_H_ */
+/** @} */
+/** @} */
@@ -46,6 +46,9 @@
 #include "coap-callback-api.h"
 #include "coap-transactions.h"
 #include "sys/cc.h"
+#if COAP_WITH_TCP
+#include "coap-tcp.h"
+#endif /* COAP_WITH_TCP */
 #include <stdlib.h>
 #include <string.h>
 #include <inttypes.h>
@@ -73,6 +76,13 @@ progress_request(coap_callback_request_state_t *callback_state) {
       coap_set_header_block2(request, state->block_num, 0,
                              COAP_MAX_CHUNK_SIZE);
     }
+#if COAP_WITH_BERT
+    if(coap_tcp_has_bert(state->remote_endpoint)) {
+      /* ask for BERT blocks, also for the first one */
+      coap_set_header_block2(request, state->block_num, 0,
+                             COAP_BERT_BLOCK_SIZE);
+    }
+#endif /* COAP_WITH_BERT */
     state->transaction->message_len =
       coap_serialize_message(request, state->transaction->message);
 
@@ -121,7 +131,7 @@ coap_request_callback(void *callback_data, coap_message_t *response)
     }
     callback_state->callback(callback_state);
     /* this is only for counting BLOCK2 blocks.*/
-    ++(state->block_num);
+    state->block_num += coap_get_block2_count(state->response);
   } else {
     LOG_WARN("WRONG BLOCK %"PRIu32"/%"PRIu32"\n", state->res_block, state->block_num);
     ++(state->block_error);
@@ -62,6 +62,11 @@ struct coap_callback_request_state {
 
 /**
  * \brief Send a CoAP request to a remote endpoint.
+ *
+ * A state handles one request at a time. Requests with different states
+ * may be outstanding at the same time, also towards the same endpoint, in
+ * which case COAP_NSTART limits how many of them are sent at once.
+ *
  * \param callback_state The callback state to handle the CoAP request.
  * \param endpoint The destination endpoint.
  * \param request The request to be sent.
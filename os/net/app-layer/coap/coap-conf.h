@@ -83,6 +83,131 @@
 #define COAP_MAX_OPEN_TRANSACTIONS     4
 #endif /* COAP_MAX_OPEN_TRANSACTIONS */
 
+/* Number of MID hash buckets for transaction lookup, a power of two */
+#ifndef COAP_TRANSACTION_HASH_SIZE
+#define COAP_TRANSACTION_HASH_SIZE     4
+#endif /* COAP_TRANSACTION_HASH_SIZE */
+
+/*
+ * Number of confirmable messages that may be outstanding towards one
+ * endpoint (NSTART, RFC 7252, Section 4.7). Further messages are queued
+ * until an earlier one is acknowledged or times out. 0 means no limit,
+ * which is the default to keep the behavior of existing applications;
+ * RFC 7252 suggests 1.
+ *
+ * Each request state of the callback and blocking APIs carries one
+ * request at a time, so a client sends requests in parallel by using one
+ * coap_callback_request_state_t per outstanding request.
+ */
+#ifdef COAP_CONF_NSTART
+#define COAP_NSTART COAP_CONF_NSTART
+#else
+#define COAP_NSTART 0
+#endif /* COAP_CONF_NSTART */
+
+/* Adaptive per-endpoint retransmission timeouts (CoCoA) */
+#ifdef COAP_CONF_WITH_COCOA
+#define COAP_WITH_COCOA COAP_CONF_WITH_COCOA
+#else
+#define COAP_WITH_COCOA 0
+#endif /* COAP_CONF_WITH_COCOA */
+
+/* Number of endpoints for which NSTART and CoCoA state is kept */
+#ifdef COAP_CONF_MAX_PEERS
+#define COAP_MAX_PEERS COAP_CONF_MAX_PEERS
+#else
+#define COAP_MAX_PEERS 4
+#endif /* COAP_CONF_MAX_PEERS */
+
+/*
+ * CoAP over TCP (RFC 8323), adds coap+tcp:// endpoints and requires
+ * UIP_CONF_TCP. COAP_CONF_WITH_WEBSOCKET adds coap+ws:// client endpoints
+ * and requires the http-socket module.
+ */
+#ifdef COAP_CONF_WITH_TCP
+#define COAP_WITH_TCP COAP_CONF_WITH_TCP
+#else
+#define COAP_WITH_TCP 0
+#endif /* COAP_CONF_WITH_TCP */
+
+#ifdef COAP_CONF_WITH_WEBSOCKET
+#define COAP_WITH_WEBSOCKET COAP_CONF_WITH_WEBSOCKET
+#else
+#define COAP_WITH_WEBSOCKET 0
+#endif /* COAP_CONF_WITH_WEBSOCKET */
+
+/* Number of TCP and WebSocket connections, incoming and outgoing */
+#ifdef COAP_TCP_CONF_MAX_CONNECTIONS
+#define COAP_TCP_MAX_CONNECTIONS COAP_TCP_CONF_MAX_CONNECTIONS
+#else
+#define COAP_TCP_MAX_CONNECTIONS 2
+#endif /* COAP_TCP_CONF_MAX_CONNECTIONS */
+
+/* How many of the connections accept incoming connections on COAP_SERVER_PORT */
+#ifdef COAP_TCP_CONF_LISTEN_CONNECTIONS
+#define COAP_TCP_LISTEN_CONNECTIONS COAP_TCP_CONF_LISTEN_CONNECTIONS
+#else
+#define COAP_TCP_LISTEN_CONNECTIONS 1
+#endif /* COAP_TCP_CONF_LISTEN_CONNECTIONS */
+
+/*
+ * Block-wise Extension for Reliable Transport: over TCP, Block2 transfers
+ * with SZX 7 carry as many 1024 byte units as fit in COAP_MAX_CHUNK_SIZE.
+ */
+#define COAP_MAX_BERT_SIZE (COAP_MAX_CHUNK_SIZE & ~(1024 - 1))
+#define COAP_WITH_BERT (COAP_WITH_TCP && COAP_MAX_BERT_SIZE > 1024)
+
+#if COAP_WITH_BERT && !defined(COAP_MAX_BLOCK_SIZE)
+/* Regular blocks must not use SZX 7, which is reserved over UDP */
+#define COAP_MAX_BLOCK_SIZE 1024
+#endif
+
+/*
+ * Response cache for GET requests, see coap-cache.h. COAP_CACHE_SIZE bounds
+ * the heapmem used for entries, and requests with a longer URI than
+ * COAP_CACHE_KEY_LEN bypass the cache.
+ */
+#ifdef COAP_CONF_WITH_CACHE
+#define COAP_WITH_CACHE COAP_CONF_WITH_CACHE
+#else
+#define COAP_WITH_CACHE 0
+#endif /* COAP_CONF_WITH_CACHE */
+
+#ifdef COAP_CACHE_CONF_SIZE
+#define COAP_CACHE_SIZE COAP_CACHE_CONF_SIZE
+#else
+#define COAP_CACHE_SIZE 1024
+#endif /* COAP_CACHE_CONF_SIZE */
+
+#ifdef COAP_CACHE_CONF_KEY_LEN
+#define COAP_CACHE_KEY_LEN COAP_CACHE_CONF_KEY_LEN
+#else
+#define COAP_CACHE_KEY_LEN 64
+#endif /* COAP_CACHE_CONF_KEY_LEN */
+
+/*
+ * Block2 transfers served from CFS files, see coap-block2-cfs.h. Up to
+ * COAP_BLOCK2_CFS_FDS files are kept open between blocks; files with
+ * longer names than COAP_BLOCK2_CFS_NAME_LEN are reopened for each block.
+ */
+#ifdef COAP_CONF_WITH_BLOCK2_CFS
+#define COAP_WITH_BLOCK2_CFS COAP_CONF_WITH_BLOCK2_CFS
+#else
+#define COAP_WITH_BLOCK2_CFS 0
+#endif /* COAP_CONF_WITH_BLOCK2_CFS */
+
+#ifdef COAP_BLOCK2_CFS_CONF_FDS
+#define COAP_BLOCK2_CFS_FDS COAP_BLOCK2_CFS_CONF_FDS
+#else
+#define COAP_BLOCK2_CFS_FDS 2
+#endif /* COAP_BLOCK2_CFS_CONF_FDS */
+
+#ifdef COAP_BLOCK2_CFS_CONF_NAME_LEN
+#define COAP_BLOCK2_CFS_NAME_LEN COAP_BLOCK2_CFS_CONF_NAME_LEN
+#else
+#define COAP_BLOCK2_CFS_NAME_LEN 16
+#endif /* COAP_BLOCK2_CFS_CONF_NAME_LEN */
+
 /* Maximum number of failed request attempts before action */
 #ifndef COAP_MAX_ATTEMPTS
 #define COAP_MAX_ATTEMPTS              4
@@ -93,11 +218,30 @@
 #define COAP_MAX_HEADER_SIZE           (4 + COAP_TOKEN_LEN + 3 + 1 + COAP_ETAG_LEN + 4 + 4 + 30)  /* 65 */
 #endif /* COAP_MAX_HEADER_SIZE */
 
-/* Number of observer slots (each takes abot xxx bytes) */
+/*
+ * Number of path segments in the resource dispatch trie that are not the
+ * last segment of an activated resource, e.g. "sen" and "sen/acc" for a
+ * resource at "sen/acc/x". The last segment is kept in the resource
+ * itself. coap_activate_resource() fails when a path needs more.
+ */
+#ifndef COAP_MAX_RESOURCE_NODES
+#define COAP_MAX_RESOURCE_NODES 16
+#endif /* COAP_MAX_RESOURCE_NODES */
+
+/* Number of observer slots (notifications do not use transaction buffers) */
 #ifndef COAP_MAX_OBSERVERS
-#define COAP_MAX_OBSERVERS    COAP_MAX_OPEN_TRANSACTIONS - 1
+#define COAP_MAX_OBSERVERS    3
 #endif /* COAP_MAX_OBSERVERS */
 
+/*
+ * Number of notification representations that can be kept at the same
+ * time. A notification is rendered once per content-format and shared by
+ * all its observers; it is kept until its confirmable copies are ACKed.
+ */
+#ifndef COAP_MAX_OBSERVE_RENDERS
+#define COAP_MAX_OBSERVE_RENDERS 2
+#endif /* COAP_MAX_OBSERVE_RENDERS */
+
 /* Interval in notifies in which NON notifies are changed to CON notifies to check client. */
 #ifdef COAP_CONF_OBSERVE_REFRESH_INTERVAL
 #define COAP_OBSERVE_REFRESH_INTERVAL COAP_CONF_OBSERVE_REFRESH_INTERVAL
@@ -66,6 +66,12 @@
 #define COAP_HEADER_OPTION_DELTA_MASK        0xF0
 #define COAP_HEADER_OPTION_SHORT_LENGTH_MASK 0x0F
 
+/* Block size that encodes SZX 7, which means BERT on reliable transports */
+#define COAP_BERT_BLOCK_SIZE                 2048
+#define COAP_BERT_UNIT                       1024
+
+#define COAP_WS_PATH                         "/.well-known/coap"
+
 /* CoAP message types */
 typedef enum {
   COAP_TYPE_CON,                /* confirmables */
@@ -120,6 +126,19 @@ typedef enum {
   PING_RESPONSE
 } coap_status_t;
 
+/* CoAP signaling codes for reliable transports (RFC 8323) */
+typedef enum {
+  COAP_SIGNAL_CSM = 225,        /* 7.01 */
+  COAP_SIGNAL_PING = 226,       /* 7.02 */
+  COAP_SIGNAL_PONG = 227,       /* 7.03 */
+  COAP_SIGNAL_RELEASE = 228,    /* 7.04 */
+  COAP_SIGNAL_ABORT = 229       /* 7.05 */
+} coap_signal_code_t;
+
+/* CSM option numbers */
+#define COAP_SIGNAL_OPTION_MAX_MESSAGE_SIZE     2
+#define COAP_SIGNAL_OPTION_BLOCK_WISE_TRANSFER  4
+
 /* CoAP header option numbers */
 typedef enum {
   COAP_OPTION_IF_MATCH = 1,     /* 0-8 B */
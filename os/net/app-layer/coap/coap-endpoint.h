@@ -44,16 +44,27 @@
 #define COAP_ENDPOINT_H_
 
 #include "contiki.h"
+#include "coap-conf.h"
 #include <stdlib.h>
 #include <stdbool.h>
 
 #ifndef COAP_ENDPOINT_CUSTOM
 #include "net/ipv6/uip.h"
 
+/* Transports for CoAP endpoints */
+enum {
+  COAP_TRANSPORT_UDP,
+  COAP_TRANSPORT_TCP,
+  COAP_TRANSPORT_WS
+};
+
 typedef struct {
   uip_ipaddr_t ipaddr;
   uint16_t port;
   bool secure;
+#if COAP_WITH_TCP
+  uint8_t transport;
+#endif /* COAP_WITH_TCP */
 } coap_endpoint_t;
 #endif /* COAP_ENDPOINT_CUSTOM */
 
@@ -121,6 +132,15 @@ int coap_endpoint_parse(const char *text, size_t size, coap_endpoint_t *ep);
  */
 int coap_endpoint_is_secure(const coap_endpoint_t *ep);
 
+/**
+ * \brief      Check if a CoAP endpoint uses a reliable transport, in which
+ *             case messages are neither acknowledged nor retransmitted.
+ *
+ * \param ep   A pointer to a CoAP endpoint.
+ * \return     Returns true if the endpoint is reliable and false otherwise.
+ */
+int coap_endpoint_is_reliable(const coap_endpoint_t *ep);
+
 /**
  * \brief      Check if a CoAP endpoint is connected.
  *
@@ -44,6 +44,10 @@
 #include "coap-engine.h"
 #include "sys/cc.h"
 #include "lib/list.h"
+#include "lib/memb.h"
+#if COAP_WITH_CACHE
+#include "coap-cache.h"
+#endif /* COAP_WITH_CACHE */
 #include <stdio.h>
 #include <stdlib.h>
 #include <inttypes.h>
@@ -72,6 +76,15 @@ LIST(coap_handlers);
 LIST(coap_resource_services);
 static uint8_t is_initialized = 0;
 
+/*
+ * Path-segment trie over the activated resources. Segments point into the
+ * resource URLs, which must stay valid as long as the resource is active.
+ * Each resource brings the node of its last segment, the pool only holds
+ * the segments above it that have no resource of their own.
+ */
+MEMB(resource_nodes_memb, coap_resource_node_t, COAP_MAX_RESOURCE_NODES);
+static coap_resource_node_t resource_root;
+
 /*---------------------------------------------------------------------------*/
 /*- CoAP service handlers---------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
@@ -111,23 +124,50 @@ coap_call_handlers(coap_message_t *request, coap_message_t *response,
   return COAP_HANDLER_STATUS_CONTINUE;
 }
 /*---------------------------------------------------------------------------*/
+/* Block numbers follow from the offset, the block size may have been reduced */
+static void
+set_response_block2(coap_message_t *response, uint32_t offset, uint8_t more,
+                    uint16_t block_size)
+{
+#if COAP_WITH_BERT
+  if(block_size > COAP_BERT_UNIT) {
+    coap_set_header_block2(response, offset / COAP_BERT_UNIT, more,
+                           COAP_BERT_BLOCK_SIZE);
+    return;
+  }
+#endif /* COAP_WITH_BERT */
+  coap_set_header_block2(response, offset / block_size, more, block_size);
+}
+/*---------------------------------------------------------------------------*/
 static inline coap_handler_status_t
 call_service(coap_message_t *request, coap_message_t *response,
              uint8_t *buffer, uint16_t buffer_size, int32_t *offset)
 {
   coap_handler_status_t status;
+
+#if COAP_WITH_CACHE
+  if(coap_cache_respond(request, response)) {
+    return COAP_HANDLER_STATUS_PROCESSED;
+  }
+#endif /* COAP_WITH_CACHE */
+
   status = coap_call_handlers(request, response, buffer, buffer_size, offset);
-  if(status != COAP_HANDLER_STATUS_CONTINUE) {
-    return status;
+  if(status == COAP_HANDLER_STATUS_CONTINUE) {
+    status = invoke_coap_resource_service(request, response, buffer,
+                                          buffer_size, offset);
   }
-  status = invoke_coap_resource_service(request, response, buffer, buffer_size, offset);
-  if(status != COAP_HANDLER_STATUS_CONTINUE) {
-    return status;
+  if(status == COAP_HANDLER_STATUS_CONTINUE) {
+    coap_set_status_code(response, NOT_FOUND_4_04);
+    return COAP_HANDLER_STATUS_CONTINUE;
   }
 
-  coap_set_status_code(response, NOT_FOUND_4_04);
-
-  return COAP_HANDLER_STATUS_CONTINUE;
+#if COAP_WITH_CACHE
+  if(*offset == 0) {
+    /* complete representations only, not chunks of blockwise resources */
+    coap_cache_store(request, response);
+  }
+#endif /* COAP_WITH_CACHE */
+  return status;
 }
 
 /*---------------------------------------------------------------------------*/
@@ -198,6 +238,13 @@ coap_receive(const coap_endpoint_t *src,
           LOG_DBG("Blockwise: block request %"PRIu32" (%u/%u) @ %"PRIu32" bytes\n",
                   block_num, block_size, COAP_MAX_BLOCK_SIZE, block_offset);
           block_size = MIN(block_size, COAP_MAX_BLOCK_SIZE);
+#if COAP_WITH_BERT
+          if(message->block2_size == COAP_BERT_BLOCK_SIZE
+             && coap_endpoint_is_reliable(src)) {
+            /* BERT: as many 1024 byte units as fit in a chunk */
+            block_size = COAP_MAX_BERT_SIZE;
+          }
+#endif /* COAP_WITH_BERT */
           new_offset = block_offset;
         }
 
@@ -245,10 +292,10 @@ coap_receive(const coap_endpoint_t *src,
                     response->code = BAD_OPTION_4_02;
                     coap_set_payload(response, "BlockOutOfScope", 15); /* a const char str[] and sizeof(str) produces larger code size */
                   } else {
-                    coap_set_header_block2(response, block_num,
-                                           response->payload_len -
-                                           block_offset > block_size,
-                                           block_size);
+                    set_response_block2(response, block_offset,
+                                        response->payload_len -
+                                        block_offset > block_size,
+                                        block_size);
                     coap_set_payload(response,
                                      response->payload + block_offset,
                                      MIN(response->payload_len -
@@ -259,10 +306,10 @@ coap_receive(const coap_endpoint_t *src,
                 } else {
                   LOG_DBG("Blockwise: blockwise resource, new offset %"PRId32"\n",
                           new_offset);
-                  coap_set_header_block2(response, block_num,
-                                         new_offset != -1
-                                         || response->payload_len >
-                                         block_size, block_size);
+                  set_response_block2(response, block_offset,
+                                      new_offset != -1
+                                      || response->payload_len >
+                                      block_size, block_size);
 
                   if(response->payload_len > block_size) {
                     coap_set_payload(response, response->payload,
@@ -309,17 +356,19 @@ coap_receive(const coap_endpoint_t *src,
       } else if(message->type == COAP_TYPE_ACK) {
         /* transactions are closed through lookup below */
         LOG_DBG("Received ACK\n");
+        coap_observe_handle_ack(src, message->mid);
       } else if(message->type == COAP_TYPE_RST) {
         LOG_INFO("Received RST\n");
         /* cancel possible subscriptions */
         coap_remove_observer_by_mid(src, message->mid);
       }
 
-      if((transaction = coap_get_transaction_by_mid(message->mid))) {
+      if((transaction = coap_get_transaction(message->mid, src))) {
         /* free transaction memory before callback, as it may create a new transaction */
         coap_resource_response_handler_t callback = transaction->callback;
         void *callback_data = transaction->callback_data;
 
+        coap_transaction_acknowledged(transaction);
         coap_clear_transaction(transaction);
 
         /* check if someone registered for the response */
@@ -393,6 +442,8 @@ coap_engine_init(void)
 
   list_init(coap_handlers);
   list_init(coap_resource_services);
+  memb_init(&resource_nodes_memb);
+  resource_root.children = NULL;
 
 #if COAP_WELL_KNOWN_RESOURCE_ENABLED
   coap_activate_resource(&res_well_known_core, ".well-known/core");
@@ -402,6 +453,96 @@ coap_engine_init(void)
   coap_init_connection();
 }
 /*---------------------------------------------------------------------------*/
+static int
+segment_end(const char *url, int url_len, int pos)
+{
+  while(pos < url_len && url[pos] != '/') {
+    pos++;
+  }
+  return pos;
+}
+/*---------------------------------------------------------------------------*/
+static coap_resource_node_t *
+find_child(const coap_resource_node_t *node, const char *segment, int len)
+{
+  coap_resource_node_t *child;
+
+  for(child = node->children; child != NULL; child = child->next) {
+    if(child->segment_len == len && memcmp(child->segment, segment, len) == 0) {
+      return child;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static int
+trie_add(coap_resource_t *resource)
+{
+  coap_resource_node_t *node = &resource_root;
+  coap_resource_node_t *child;
+  int url_len = strlen(resource->url);
+  int pos = 0;
+  int end;
+
+  for(;;) {
+    end = segment_end(resource->url, url_len, pos);
+    child = find_child(node, &resource->url[pos], end - pos);
+    if(child == NULL) {
+      if(end == url_len && resource->node.segment == NULL) {
+        child = &resource->node;
+      } else {
+        child = memb_alloc(&resource_nodes_memb);
+      }
+      if(child == NULL) {
+        return 0;
+      }
+      child->segment = &resource->url[pos];
+      child->segment_len = end - pos;
+      child->children = NULL;
+      child->resource = NULL;
+      child->next = node->children;
+      node->children = child;
+    }
+    node = child;
+
+    if(end == url_len) {
+      /* as with the list, the first resource activated for a URL wins */
+      if(node->resource == NULL) {
+        node->resource = resource;
+      }
+      return 1;
+    }
+    pos = end + 1;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static coap_resource_t *
+trie_lookup(const char *url, int url_len)
+{
+  const coap_resource_node_t *node = &resource_root;
+  coap_resource_t *parent = NULL;
+  int pos = 0;
+  int end;
+
+  for(;;) {
+    end = segment_end(url, url_len, pos);
+    node = find_child(node, &url[pos], end - pos);
+    if(node == NULL) {
+      /* deepest parent resource, if the path continues below one */
+      return parent;
+    }
+    if(end == url_len) {
+      return node->resource != NULL ? node->resource : parent;
+    }
+    if(node->resource != NULL
+       && (node->resource->flags & HAS_SUB_RESOURCES)) {
+      parent = node->resource;
+    }
+    pos = end + 1;
+  }
+}
+/*---------------------------------------------------------------------------*/
+
 /**
  * \brief Makes a resource available under the given URI path
  *
@@ -409,11 +550,15 @@ coap_engine_init(void)
  * extern keyword. The build system takes care of compiling every
  * *.c file in the ./resources/ sub-directory (see example Makefile).
  */
-void
+int
 coap_activate_resource(coap_resource_t *resource, const char *path)
 {
   coap_periodic_resource_t *periodic;
   resource->url = path;
+  if(!trie_add(resource)) {
+    LOG_ERR("Cannot activate %s, increase COAP_MAX_RESOURCE_NODES\n", path);
+    return 0;
+  }
   list_add(coap_resource_services, resource);
 
   LOG_INFO("Activating: %s\n", resource->url);
@@ -428,6 +573,7 @@ coap_activate_resource(coap_resource_t *resource, const char *path)
     coap_timer_set_user_data(&periodic->periodic_timer, resource);
     coap_timer_set(&periodic->periodic_timer, periodic->period);
   }
+  return 1;
 }
 /*---------------------------------------------------------------------------*/
 
@@ -456,44 +602,34 @@ invoke_coap_resource_service(coap_message_t *request, coap_message_t *response,
 
   coap_resource_t *resource = NULL;
   const char *url = NULL;
-  int url_len, res_url_len;
+  int url_len;
 
   url_len = coap_get_header_uri_path(request, &url);
-  for(resource = list_head(coap_resource_services);
-      resource; resource = resource->next) {
-
-    /* if the web service handles that kind of requests and urls matches */
-    res_url_len = strlen(resource->url);
-    if((url_len == res_url_len
-        || (url_len > res_url_len
-            && (resource->flags & HAS_SUB_RESOURCES)
-            && url[res_url_len] == '/'))
-       && strncmp(resource->url, url, res_url_len) == 0) {
-      coap_resource_flags_t method = coap_get_method_type(request);
-      found = 1;
-
-      LOG_INFO("/%s, method %u, resource->flags %u\n", resource->url,
-               (uint16_t)method, resource->flags);
-
-      if((method & METHOD_GET) && resource->get_handler != NULL) {
-        /* call handler function */
-        resource->get_handler(request, response, buffer, buffer_size, offset);
-      } else if((method & METHOD_POST) && resource->post_handler != NULL) {
-        /* call handler function */
-        resource->post_handler(request, response, buffer, buffer_size,
+  resource = trie_lookup(url, url_len);
+  if(resource != NULL) {
+    coap_resource_flags_t method = coap_get_method_type(request);
+    found = 1;
+
+    LOG_INFO("/%s, method %u, resource->flags %u\n", resource->url,
+             (uint16_t)method, resource->flags);
+
+    if((method & METHOD_GET) && resource->get_handler != NULL) {
+      /* call handler function */
+      resource->get_handler(request, response, buffer, buffer_size, offset);
+    } else if((method & METHOD_POST) && resource->post_handler != NULL) {
+      /* call handler function */
+      resource->post_handler(request, response, buffer, buffer_size,
+                             offset);
+    } else if((method & METHOD_PUT) && resource->put_handler != NULL) {
+      /* call handler function */
+      resource->put_handler(request, response, buffer, buffer_size, offset);
+    } else if((method & METHOD_DELETE) && resource->delete_handler != NULL) {
+      /* call handler function */
+      resource->delete_handler(request, response, buffer, buffer_size,
                                offset);
-      } else if((method & METHOD_PUT) && resource->put_handler != NULL) {
-        /* call handler function */
-        resource->put_handler(request, response, buffer, buffer_size, offset);
-      } else if((method & METHOD_DELETE) && resource->delete_handler != NULL) {
-        /* call handler function */
-        resource->delete_handler(request, response, buffer, buffer_size,
-                                 offset);
-      } else {
-        allowed = 0;
-        coap_set_status_code(response, METHOD_NOT_ALLOWED_4_05);
-      }
-      break;
+    } else {
+      allowed = 0;
+      coap_set_status_code(response, METHOD_NOT_ALLOWED_4_05);
     }
   }
   if(!found) {
@@ -96,6 +96,17 @@ typedef void (* coap_resource_response_handler_t)(void *data,
                                                   coap_message_t *response);
 typedef void (* coap_resource_trigger_handler_t)(void);
 
+/* node of the resource dispatch trie, one per path segment */
+typedef struct coap_resource_node coap_resource_node_t;
+
+struct coap_resource_node {
+  coap_resource_node_t *next;       /* next sibling */
+  coap_resource_node_t *children;
+  const char *segment;              /* points into the resource URL */
+  uint16_t segment_len;
+  coap_resource_t *resource;
+};
+
 /* data structure representing a resource in CoAP */
 struct coap_resource_s {
   coap_resource_t *next;            /* for LIST, points to next resource defined */
@@ -111,6 +122,8 @@ struct coap_resource_s {
     coap_resource_trigger_handler_t trigger;
     coap_resource_trigger_handler_t resume;
   };
+  struct coap_observer *observers;  /* observers of this resource */
+  coap_resource_node_t node;        /* trie node of the last path segment */
 };
 
 struct coap_periodic_resource_s {
@@ -152,8 +165,10 @@ struct coap_periodic_resource_s {
  *             A CoAP resource defined through the RESOURCE macros.
  * \param path
  *             The local URI path where to provide the resource.
+ * \return     1 if the resource was activated, 0 if its path needs more
+ *             than the remaining COAP_MAX_RESOURCE_NODES trie nodes.
  */
-void coap_activate_resource(coap_resource_t *resource, const char *path);
+int coap_activate_resource(coap_resource_t *resource, const char *path);
 /*---------------------------------------------------------------------------*/
 /**
  * \brief      Returns the first of the registered CoAP resources.
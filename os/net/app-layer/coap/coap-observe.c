@@ -47,22 +47,113 @@
 #include "coap-engine.h"
 #include "lib/memb.h"
 #include "lib/list.h"
+#include "lib/random.h"
+#if COAP_WITH_CACHE
+#include "coap-cache.h"
+#endif /* COAP_WITH_CACHE */
 
 /* Log configuration */
 #include "coap-log.h"
 #define LOG_MODULE "coap"
 #define LOG_LEVEL  LOG_LEVEL_COAP
 
+/*
+ * A notification as produced by the resource handler, without token, MID
+ * and Observe option. It is rendered once per content-format and shared by
+ * all observers notified with it. Observers with an unacknowledged
+ * confirmable notification keep a reference, so that retransmissions can
+ * be serialized again from the same representation.
+ */
+typedef struct coap_observe_render {
+  coap_message_t message;
+  int32_t accept;
+  uint16_t refs;
+  uint8_t payload[COAP_MAX_CHUNK_SIZE + 1]; /* +1 for snprintf(buf, len + 1) */
+} coap_observe_render_t;
+
 /*---------------------------------------------------------------------------*/
 MEMB(observers_memb, coap_observer_t, COAP_MAX_OBSERVERS);
 LIST(observers_list);
+MEMB(renders_memb, coap_observe_render_t, COAP_MAX_OBSERVE_RENDERS);
+
+/* Observers registered through a handler rather than a resource */
+static coap_observer_t *unbound_observers;
+
+/* Used when all shared renders are held by confirmable notifications */
+static coap_observe_render_t scratch_render;
+
+/* Notifications are kept in rendered form and serialized on transmission */
+static uint8_t notification_buffer[COAP_MAX_PACKET_SIZE + 1];
 /*---------------------------------------------------------------------------*/
 /*- Internal API ------------------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
+static void
+release_render(coap_observe_render_t *r)
+{
+  if(r != NULL && --r->refs == 0) {
+    memb_free(&renders_memb, r);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static coap_observer_t **
+resource_observers(coap_resource_t *resource)
+{
+  return resource != NULL ? &resource->observers : &unbound_observers;
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_notification(coap_observer_t *obs, coap_observe_render_t *r,
+                  coap_message_type_t type)
+{
+  /* static declaration reduces stack peaks */
+  static coap_message_t notification[1];
+  size_t len;
+
+  memcpy(notification, &r->message, sizeof(coap_message_t));
+  notification->type = type;
+  notification->mid = obs->last_mid;
+  if(notification->code < BAD_REQUEST_4_00) {
+    /* the counter was advanced when the notification was issued */
+    coap_set_header_observe(notification, (obs->obs_counter - 1) & 0xffffff);
+  }
+  coap_set_token(notification, obs->token, obs->token_len);
+
+  len = coap_serialize_message(notification, notification_buffer);
+  if(len > 0) {
+    coap_sendto(&obs->endpoint, notification_buffer, len);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+retransmit_notification(coap_timer_t *timer)
+{
+  coap_observer_t *obs = coap_timer_get_user_data(timer);
+
+  if(obs == NULL || obs->render == NULL) {
+    return;
+  }
+
+  if(++(obs->retrans_counter) > COAP_MAX_RETRANSMIT) {
+    LOG_DBG("Notification timeout for /%s\n", obs->url);
+    /* the client is gone, drop all its observe relationships */
+    coap_remove_observer_by_client(&obs->endpoint);
+    return;
+  }
+
+  LOG_DBG("Retransmitting notification %u (%u)\n", obs->last_mid,
+          obs->retrans_counter);
+  send_notification(obs, obs->render, COAP_TYPE_CON);
+  obs->retrans_interval <<= 1;
+  coap_timer_set(&obs->retrans_timer, obs->retrans_interval);
+}
+/*---------------------------------------------------------------------------*/
 static coap_observer_t *
-add_observer(const coap_endpoint_t *endpoint, const uint8_t *token,
-             size_t token_len, const char *uri, int uri_len)
+add_observer(coap_resource_t *resource, const coap_endpoint_t *endpoint,
+             const uint8_t *token, size_t token_len,
+             const char *uri, int uri_len, int32_t accept)
 {
+  coap_observer_t **head;
+
   /* Remove existing observe relationship, if any. */
   coap_remove_observer_by_uri(endpoint, uri);
 
@@ -79,11 +170,22 @@ add_observer(const coap_endpoint_t *endpoint, const uint8_t *token,
     o->token_len = token_len;
     memcpy(o->token, token, token_len);
     o->last_mid = 0;
+    o->accept = accept;
+    o->render = NULL;
+    o->retrans_counter = 0;
+    coap_timer_set_callback(&o->retrans_timer, retransmit_notification);
+    coap_timer_set_user_data(&o->retrans_timer, o);
 
     LOG_INFO("Adding observer (%u/%u) for /%s [0x%02X%02X]\n",
              list_length(observers_list) + 1, COAP_MAX_OBSERVERS,
              o->url, o->token[0], o->token[1]);
     list_add(observers_list, o);
+
+    /* index by resource, so that notifications only visit its observers */
+    head = resource_observers(resource);
+    o->resource = resource;
+    o->resource_next = *head;
+    *head = o;
   }
 
   return o;
@@ -94,11 +196,27 @@ add_observer(const coap_endpoint_t *endpoint, const uint8_t *token,
 void
 coap_remove_observer(coap_observer_t *o)
 {
+  coap_observer_t **p;
+
   LOG_INFO("Removing observer for /%s [0x%02X%02X]\n", o->url, o->token[0],
            o->token[1]);
 
-  memb_free(&observers_memb, o);
+  if(o->render != NULL) {
+    coap_timer_stop(&o->retrans_timer);
+    release_render(o->render);
+    o->render = NULL;
+  }
+
+  for(p = resource_observers(o->resource); *p != NULL;
+      p = &(*p)->resource_next) {
+    if(*p == o) {
+      *p = o->resource_next;
+      break;
+    }
+  }
+
   list_remove(observers_list, o);
+  memb_free(&observers_memb, o);
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -106,12 +224,14 @@ coap_remove_observer_by_client(const coap_endpoint_t *endpoint)
 {
   int removed = 0;
   coap_observer_t *obs = NULL;
+  coap_observer_t *next;
 
   LOG_DBG("Remove check client ");
   LOG_DBG_COAP_EP(endpoint);
   LOG_DBG_("\n");
   for(obs = (coap_observer_t *)list_head(observers_list); obs;
-      obs = obs->next) {
+      obs = next) {
+    next = obs->next;
     if(coap_endpoint_cmp(&obs->endpoint, endpoint)) {
       coap_remove_observer(obs);
       removed++;
@@ -126,9 +246,11 @@ coap_remove_observer_by_token(const coap_endpoint_t *endpoint,
 {
   int removed = 0;
   coap_observer_t *obs = NULL;
+  coap_observer_t *next;
 
   for(obs = (coap_observer_t *)list_head(observers_list); obs;
-      obs = obs->next) {
+      obs = next) {
+    next = obs->next;
     LOG_DBG("Remove check Token 0x%02X%02X\n", token[0], token[1]);
     if(coap_endpoint_cmp(&obs->endpoint, endpoint)
        && obs->token_len == token_len
@@ -146,9 +268,11 @@ coap_remove_observer_by_uri(const coap_endpoint_t *endpoint,
 {
   int removed = 0;
   coap_observer_t *obs = NULL;
+  coap_observer_t *next;
 
   for(obs = (coap_observer_t *)list_head(observers_list); obs;
-      obs = obs->next) {
+      obs = next) {
+    next = obs->next;
     LOG_DBG("Remove check URL %p\n", uri);
     if((endpoint == NULL
         || (coap_endpoint_cmp(&obs->endpoint, endpoint)))
@@ -165,9 +289,11 @@ coap_remove_observer_by_mid(const coap_endpoint_t *endpoint, uint16_t mid)
 {
   int removed = 0;
   coap_observer_t *obs = NULL;
+  coap_observer_t *next;
 
   for(obs = (coap_observer_t *)list_head(observers_list); obs;
-      obs = obs->next) {
+      obs = next) {
+    next = obs->next;
     LOG_DBG("Remove check MID %u\n", mid);
     if(coap_endpoint_cmp(&obs->endpoint, endpoint)
        && obs->last_mid == mid) {
@@ -178,8 +304,129 @@ coap_remove_observer_by_mid(const coap_endpoint_t *endpoint, uint16_t mid)
   return removed;
 }
 /*---------------------------------------------------------------------------*/
+void
+coap_observe_handle_ack(const coap_endpoint_t *endpoint, uint16_t mid)
+{
+  coap_observer_t *obs = NULL;
+
+  for(obs = (coap_observer_t *)list_head(observers_list); obs;
+      obs = obs->next) {
+    if(obs->render != NULL && obs->last_mid == mid
+       && coap_endpoint_cmp(&obs->endpoint, endpoint)) {
+      LOG_DBG("Notification %u acknowledged\n", mid);
+      coap_timer_stop(&obs->retrans_timer);
+      release_render(obs->render);
+      obs->render = NULL;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
 /*- Notification ------------------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
+static void
+render_notification(coap_observe_render_t *r, coap_resource_t *resource,
+                    const char *url, int32_t accept)
+{
+  coap_message_t request[1]; /* this way the message can be treated as pointer as usual */
+  coap_message_t *notification = &r->message;
+  int32_t new_offset = 0;
+  uint16_t len;
+
+  r->accept = accept;
+
+  /* create a "fake" request for the URI */
+  coap_init_message(request, COAP_TYPE_CON, COAP_GET, 0);
+  coap_set_header_uri_path(request, url);
+  if(accept >= 0) {
+    coap_set_header_accept(request, accept);
+  }
+
+  coap_init_message(notification, COAP_TYPE_NON, CONTENT_2_05, 0);
+
+  /* Either old style get_handler or the full handler */
+  if(coap_call_handlers(request, notification, r->payload,
+                        COAP_MAX_CHUNK_SIZE, &new_offset) > 0) {
+    LOG_DBG("Notification on new handlers\n");
+  } else {
+    if(resource != NULL) {
+      resource->get_handler(request, notification, r->payload,
+                            COAP_MAX_CHUNK_SIZE, &new_offset);
+    } else {
+      /* What to do here? */
+      notification->code = BAD_REQUEST_4_00;
+    }
+  }
+
+  if(new_offset != 0) {
+    coap_set_header_block2(notification,
+                           0,
+                           new_offset != -1,
+                           COAP_MAX_BLOCK_SIZE);
+    coap_set_payload(notification,
+                     notification->payload,
+                     MIN(notification->payload_len,
+                         COAP_MAX_BLOCK_SIZE));
+  }
+
+  /* the payload must outlive the handler for retransmissions */
+  if(notification->payload_len > 0 && notification->payload != r->payload) {
+    len = MIN(notification->payload_len, COAP_MAX_CHUNK_SIZE);
+    memmove(r->payload, notification->payload, len);
+    coap_set_payload(notification, r->payload, len);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+notify_observer(coap_observer_t *obs, coap_observe_render_t *r)
+{
+  uint8_t shared = r != &scratch_render;
+  uint8_t confirmable;
+
+  /* if COAP_OBSERVE_REFRESH_INTERVAL is zero, never send observations as confirmable messages */
+  confirmable = COAP_OBSERVE_REFRESH_INTERVAL != 0
+    && (obs->obs_counter % COAP_OBSERVE_REFRESH_INTERVAL == 0);
+  /* reliable transports neither acknowledge nor need to check the client */
+  if(coap_endpoint_is_reliable(&obs->endpoint)) {
+    confirmable = 0;
+  }
+
+  if(r->message.code < BAD_REQUEST_4_00) {
+    /* mask out to keep the CoAP observe option length <= 3 bytes */
+    obs->obs_counter = (obs->obs_counter + 1) & 0xffffff;
+  }
+
+  /* update last MID for RST matching */
+  obs->last_mid = coap_get_mid();
+
+  LOG_DBG("           Observer ");
+  LOG_DBG_COAP_EP(&obs->endpoint);
+  LOG_DBG_("\n");
+
+  if(obs->render != NULL && shared) {
+    /*
+     * A confirmable notification is still in flight: replace it with the
+     * new state, which goes out with the next retransmission (RFC 7641,
+     * Section 4.5.2).
+     */
+    LOG_DBG("           Replacing unacknowledged notification\n");
+    release_render(obs->render);
+    obs->render = r;
+    r->refs++;
+  } else if(confirmable && shared && obs->render == NULL) {
+    LOG_DBG("           Force Confirmable for\n");
+    obs->render = r;
+    r->refs++;
+    obs->retrans_counter = 0;
+    obs->retrans_interval =
+      COAP_RESPONSE_TIMEOUT_TICKS + (random_rand() %
+                                     COAP_RESPONSE_TIMEOUT_BACKOFF_MASK);
+    coap_timer_set(&obs->retrans_timer, obs->retrans_interval);
+    send_notification(obs, r, COAP_TYPE_CON);
+  } else {
+    send_notification(obs, r, COAP_TYPE_NON);
+  }
+}
+/*---------------------------------------------------------------------------*/
 void
 coap_notify_observers(coap_resource_t *resource)
 {
@@ -190,13 +437,15 @@ coap_notify_observers(coap_resource_t *resource)
 void
 coap_notify_observers_sub(coap_resource_t *resource, const char *subpath)
 {
-  /* build notification */
-  coap_message_t notification[1]; /* this way the message can be treated as pointer as usual */
-  coap_message_t request[1]; /* this way the message can be treated as pointer as usual */
+  coap_observe_render_t *renders[COAP_MAX_OBSERVE_RENDERS];
+  coap_observe_render_t *r;
   coap_observer_t *obs = NULL;
   int url_len, obs_url_len;
   char url[COAP_OBSERVER_URL_LEN];
   uint8_t sub_ok = 0;
+  uint8_t scratch_ok = 0;
+  int rendered = 0;
+  int i;
 
   if(resource != NULL) {
     url_len = strlen(resource->url);
@@ -216,102 +465,68 @@ coap_notify_observers_sub(coap_resource_t *resource, const char *subpath)
   /* url now contains the notify URL that needs to match the observer */
   LOG_INFO("Notification from %s\n", url);
 
-  coap_init_message(notification, COAP_TYPE_NON, CONTENT_2_05, 0);
-  /* create a "fake" request for the URI */
-  coap_init_message(request, COAP_TYPE_CON, COAP_GET, 0);
-  coap_set_header_uri_path(request, url);
-
-  /* iterate over observers */
+  /* iterate over the observers of the resource */
   url_len = strlen(url);
+#if COAP_WITH_CACHE
+  /* the cached representations are outdated */
+  coap_cache_invalidate(url, url_len);
+#endif /* COAP_WITH_CACHE */
   /* Assumes lazy evaluation... */
   sub_ok = (resource == NULL) || (resource->flags & HAS_SUB_RESOURCES);
-  for(obs = (coap_observer_t *)list_head(observers_list); obs;
-      obs = obs->next) {
+  for(obs = *resource_observers(resource); obs; obs = obs->resource_next) {
     obs_url_len = strlen(obs->url);
 
     /* Do a match based on the parent/sub-resource match so that it is
        possible to do parent-node observe */
-
-    /***** TODO fix here so that we handle the notofication correctly ******/
-    /* All the new-style ... is assuming that the URL might be within */
     if((obs_url_len == url_len
         || (obs_url_len > url_len
             && sub_ok
             && obs->url[url_len] == '/'))
        && strncmp(url, obs->url, url_len) == 0) {
-      coap_transaction_t *transaction = NULL;
 
-      /*TODO implement special transaction for CON, sharing the same buffer to allow for more observers */
-
-      if((transaction = coap_new_transaction(coap_get_mid(), &obs->endpoint))) {
-        /* if COAP_OBSERVE_REFRESH_INTERVAL is zero, never send observations as confirmable messages */
-        if(COAP_OBSERVE_REFRESH_INTERVAL != 0
-            && (obs->obs_counter % COAP_OBSERVE_REFRESH_INTERVAL == 0)) {
-          LOG_DBG("           Force Confirmable for\n");
-          notification->type = COAP_TYPE_CON;
+      /* the handler runs once per content-format, not once per observer */
+      r = NULL;
+      for(i = 0; i < rendered; i++) {
+        if(renders[i]->accept == obs->accept) {
+          r = renders[i];
+          break;
         }
-
-        LOG_DBG("           Observer ");
-        LOG_DBG_COAP_EP(&obs->endpoint);
-        LOG_DBG_("\n");
-
-        /* update last MID for RST matching */
-        obs->last_mid = transaction->mid;
-
-        /* prepare response */
-        notification->mid = transaction->mid;
-
-	int32_t new_offset = 0;
-
-        /* Either old style get_handler or the full handler */
-        if(coap_call_handlers(request, notification, transaction->message +
-                              COAP_MAX_HEADER_SIZE, COAP_MAX_CHUNK_SIZE,
-                              &new_offset) > 0) {
-          LOG_DBG("Notification on new handlers\n");
+      }
+      if(r == NULL && scratch_ok && scratch_render.accept == obs->accept) {
+        r = &scratch_render;
+      }
+      if(r == NULL) {
+        r = memb_alloc(&renders_memb);
+        if(r != NULL) {
+          r->refs = 0;
+          renders[rendered++] = r;
         } else {
-          if(resource != NULL) {
-            resource->get_handler(request, notification,
-                                  transaction->message + COAP_MAX_HEADER_SIZE,
-                                  COAP_MAX_CHUNK_SIZE, &new_offset);
-          } else {
-            /* What to do here? */
-            notification->code = BAD_REQUEST_4_00;
-          }
+          LOG_WARN("No free notification render, confirmable notifications deferred\n");
+          r = &scratch_render;
+          scratch_ok = 1;
         }
-
-        if(notification->code < BAD_REQUEST_4_00) {
-          coap_set_header_observe(notification, (obs->obs_counter)++);
-          /* mask out to keep the CoAP observe option length <= 3 bytes */
-          obs->obs_counter &= 0xffffff;
-        }
-        coap_set_token(notification, obs->token, obs->token_len);
-
-	if(new_offset != 0) {
-	  coap_set_header_block2(notification,
-				 0,
-				 new_offset != -1,
-				 COAP_MAX_BLOCK_SIZE);
-	  coap_set_payload(notification,
-			   notification->payload,
-			   MIN(notification->payload_len,
-			       COAP_MAX_BLOCK_SIZE));
-	}
-
-        transaction->message_len =
-          coap_serialize_message(notification, transaction->message);
-
-        coap_send_transaction(transaction);
+        render_notification(r, resource, url, obs->accept);
       }
+
+      notify_observer(obs, r);
+    }
+  }
+
+  /* renders not held by any confirmable notification are done */
+  for(i = 0; i < rendered; i++) {
+    if(renders[i]->refs == 0) {
+      memb_free(&renders_memb, renders[i]);
     }
   }
 }
 /*---------------------------------------------------------------------------*/
 void
-coap_observe_handler(const coap_resource_t *resource, coap_message_t *coap_req,
+coap_observe_handler(coap_resource_t *resource, coap_message_t *coap_req,
                      coap_message_t *coap_res)
 {
   const coap_endpoint_t *src_ep;
   coap_observer_t *obs;
+  unsigned int accept;
 
   LOG_DBG("CoAP observer handler rsc: %d\n", resource != NULL);
 
@@ -321,9 +536,11 @@ coap_observe_handler(const coap_resource_t *resource, coap_message_t *coap_req,
       if(src_ep == NULL) {
         /* No source endpoint, can not add */
       } else if(coap_req->observe == 0) {
-        obs = add_observer(src_ep,
+        obs = add_observer(resource, src_ep,
                            coap_req->token, coap_req->token_len,
-                           coap_req->uri_path, coap_req->uri_path_len);
+                           coap_req->uri_path, coap_req->uri_path_len,
+                           coap_get_header_accept(coap_req, &accept) ?
+                           (int32_t)accept : -1);
         if(obs) {
           coap_set_header_observe(coap_res, (obs->obs_counter)++);
           /* mask out to keep the CoAP observe option length <= 3 bytes */
@@ -48,6 +48,8 @@
 #include "coap-transactions.h"
 #include "coap-engine.h"
 
+struct coap_observe_render;
+
 typedef struct coap_observer {
   struct coap_observer *next;   /* for LIST */
 
@@ -56,10 +58,17 @@ typedef struct coap_observer {
   uint8_t token_len;
   uint8_t token[COAP_TOKEN_LEN];
   uint16_t last_mid;
+  int32_t accept;               /* -1 if registered without Accept option */
+
+  coap_resource_t *resource;    /* NULL if registered through a handler */
+  struct coap_observer *resource_next;
 
   int32_t obs_counter;
 
+  /* confirmable notification waiting for an ACK, if any */
+  struct coap_observe_render *render;
   coap_timer_t retrans_timer;
+  uint32_t retrans_interval;
   uint8_t retrans_counter;
 } coap_observer_t;
 
@@ -72,10 +81,12 @@ int coap_remove_observer_by_uri(const coap_endpoint_t *ep,
 int coap_remove_observer_by_mid(const coap_endpoint_t *ep,
                                 uint16_t mid);
 
+void coap_observe_handle_ack(const coap_endpoint_t *ep, uint16_t mid);
+
 void coap_notify_observers(coap_resource_t *resource);
 void coap_notify_observers_sub(coap_resource_t *resource, const char *subpath);
 
-void coap_observe_handler(const coap_resource_t *resource,
+void coap_observe_handler(coap_resource_t *resource,
                           coap_message_t *request,
                           coap_message_t *response);
 
@@ -0,0 +1,763 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden AB
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         CoAP over TCP and WebSockets (RFC 8323)
+ */
+
+/**
+ * \addtogroup coap-tcp
+ * @{
+ */
+
+#include "contiki.h"
+#include "coap.h"
+#include "coap-engine.h"
+#include "coap-observe.h"
+#include "coap-tcp.h"
+#include "lib/random.h"
+#include "net/ipv6/tcp-socket.h"
+#include "net/ipv6/uiplib.h"
+#include <stdio.h>
+#include <string.h>
+
+#if COAP_WITH_WEBSOCKET
+#include "websocket.h"
+#endif /* COAP_WITH_WEBSOCKET */
+
+/* Log configuration */
+#include "coap-log.h"
+#define LOG_MODULE "coap-tcp"
+#define LOG_LEVEL  LOG_LEVEL_COAP
+
+#if COAP_WITH_TCP
+
+#if !UIP_TCP
+#error "CoAP over TCP requires UIP_CONF_TCP"
+#endif
+
+/* Length/TKL byte, up to four bytes of extended length, and the code */
+#define FRAME_HEADER_MAX   6
+#define FRAME_SIZE         (COAP_MAX_PACKET_SIZE + FRAME_HEADER_MAX)
+
+/*
+ * Received frames are stored after this many bytes, which leaves room to
+ * rebuild the UDP header in front of the token.
+ */
+#define RX_OFFSET          COAP_HEADER_LEN
+
+#define TCP_INPUT_SIZE     128
+
+/* Max-Message-Size assumed until the peer has sent its CSM */
+#define DEFAULT_MAX_MESSAGE_SIZE 1152
+
+#define NO_TOKEN           0xff
+
+enum {
+  CONN_CLOSED,
+  CONN_LISTENING,
+  CONN_CONNECTING,
+  CONN_OPEN
+};
+
+#define CONN_PEER_CSM      0x01
+#define CONN_PEER_BERT     0x02
+#define CONN_LISTEN        0x04
+
+/* Requests sent over a connection, to map responses back to their MID */
+typedef struct {
+  uint16_t mid;
+  uint8_t token_len;
+  uint8_t token[COAP_TOKEN_LEN];
+} pending_request_t;
+
+typedef struct {
+  coap_endpoint_t endpoint;
+  struct tcp_socket socket;
+#if COAP_WITH_WEBSOCKET
+  struct websocket ws;
+#endif /* COAP_WITH_WEBSOCKET */
+  uint32_t peer_max_message_size;
+  uint32_t rx_expected;
+  uint16_t rx_len;
+  uint16_t next_mid;
+  uint8_t state;
+  uint8_t flags;
+  uint8_t next_pending;
+  pending_request_t pending[COAP_MAX_OPEN_TRANSACTIONS];
+  uint8_t input[TCP_INPUT_SIZE];
+  uint8_t output[FRAME_SIZE];
+  uint8_t rx[RX_OFFSET + FRAME_SIZE];
+} coap_tcp_conn_t;
+
+static coap_tcp_conn_t conns[COAP_TCP_MAX_CONNECTIONS];
+
+#if COAP_WITH_WEBSOCKET
+static uint8_t ws_buffer[FRAME_SIZE];
+#endif /* COAP_WITH_WEBSOCKET */
+/*---------------------------------------------------------------------------*/
+static coap_tcp_conn_t *
+find_conn(const coap_endpoint_t *ep)
+{
+  int i;
+
+  for(i = 0; i < COAP_TCP_MAX_CONNECTIONS; i++) {
+    if((conns[i].state == CONN_CONNECTING || conns[i].state == CONN_OPEN)
+       && coap_endpoint_cmp(&conns[i].endpoint, ep)) {
+      return &conns[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+/* Returns the header length including the code, or 0 if incomplete */
+static int
+parse_frame_header(const uint8_t *frame, uint16_t len, uint32_t *body_len)
+{
+  uint8_t nibble;
+
+  if(len < 1) {
+    return 0;
+  }
+  nibble = frame[0] >> 4;
+  if(nibble < 13) {
+    if(len < 2) {
+      return 0;
+    }
+    *body_len = nibble;
+    return 2;
+  } else if(nibble == 13) {
+    if(len < 3) {
+      return 0;
+    }
+    *body_len = frame[1] + 13;
+    return 3;
+  } else if(nibble == 14) {
+    if(len < 4) {
+      return 0;
+    }
+    *body_len = ((frame[1] << 8) | frame[2]) + 269;
+    return 4;
+  }
+  if(len < 6) {
+    return 0;
+  }
+  *body_len = ((uint32_t)frame[1] << 24) | ((uint32_t)frame[2] << 16) |
+    ((uint32_t)frame[3] << 8) | frame[4];
+  /* saturate rather than wrap, no such frame fits in our buffer anyway */
+  *body_len = *body_len > UINT32_MAX - 65805 ? UINT32_MAX : *body_len + 65805;
+  return 6;
+}
+/*---------------------------------------------------------------------------*/
+/* Writes the header for options and payload of body_len bytes */
+static int
+write_frame_header(uint8_t *header, uint8_t token_len, uint8_t code,
+                   uint32_t body_len)
+{
+  int n;
+
+  if(body_len < 13) {
+    header[0] = (body_len << 4) | token_len;
+    n = 1;
+  } else if(body_len < 269) {
+    header[0] = (13 << 4) | token_len;
+    header[1] = body_len - 13;
+    n = 2;
+  } else if(body_len < 65805) {
+    header[0] = (14 << 4) | token_len;
+    header[1] = (body_len - 269) >> 8;
+    header[2] = (body_len - 269) & 0xff;
+    n = 3;
+  } else {
+    header[0] = (15 << 4) | token_len;
+    header[1] = (body_len - 65805) >> 24;
+    header[2] = ((body_len - 65805) >> 16) & 0xff;
+    header[3] = ((body_len - 65805) >> 8) & 0xff;
+    header[4] = (body_len - 65805) & 0xff;
+    n = 5;
+  }
+  header[n++] = code;
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+/* Sends a message, data holds the token followed by options and payload */
+static int
+send_frame(coap_tcp_conn_t *c, uint8_t token_len, uint8_t code,
+           const uint8_t *data, uint16_t len)
+{
+  uint8_t header[FRAME_HEADER_MAX];
+  int header_len;
+
+  if(len + FRAME_HEADER_MAX > c->peer_max_message_size) {
+    LOG_WARN("message of %u bytes exceeds peer Max-Message-Size %lu\n",
+             len, (unsigned long)c->peer_max_message_size);
+    return -1;
+  }
+
+#if COAP_WITH_WEBSOCKET
+  if(c->endpoint.transport == COAP_TRANSPORT_WS) {
+    /* one message per WebSocket frame, without a length */
+    if(len + 2 > sizeof(ws_buffer)) {
+      return -1;
+    }
+    ws_buffer[0] = token_len;
+    ws_buffer[1] = code;
+    memcpy(&ws_buffer[2], data, len);
+    return websocket_send(&c->ws, ws_buffer, len + 2) < 0 ? -1 : len + 2;
+  }
+#endif /* COAP_WITH_WEBSOCKET */
+
+  header_len = write_frame_header(header, token_len, code, len - token_len);
+  if(tcp_socket_max_sendlen(&c->socket) < header_len + len) {
+    LOG_WARN("output buffer full, dropping message\n");
+    return -1;
+  }
+  tcp_socket_send(&c->socket, header, header_len);
+  tcp_socket_send(&c->socket, data, len);
+  return header_len + len;
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_csm(coap_tcp_conn_t *c)
+{
+  uint8_t options[5];
+  int n = 0;
+
+  /* Max-Message-Size, two bytes */
+  options[n++] = (COAP_SIGNAL_OPTION_MAX_MESSAGE_SIZE << 4) | 2;
+  options[n++] = FRAME_SIZE >> 8;
+  options[n++] = FRAME_SIZE & 0xff;
+#if COAP_WITH_BERT
+  /* Block-Wise-Transfer, empty */
+  options[n++] = (COAP_SIGNAL_OPTION_BLOCK_WISE_TRANSFER -
+                  COAP_SIGNAL_OPTION_MAX_MESSAGE_SIZE) << 4;
+#endif /* COAP_WITH_BERT */
+
+  send_frame(c, 0, COAP_SIGNAL_CSM, options, n);
+}
+/*---------------------------------------------------------------------------*/
+static void
+open_conn(coap_tcp_conn_t *c)
+{
+  LOG_INFO("connected to ");
+  LOG_INFO_COAP_EP(&c->endpoint);
+  LOG_INFO_("\n");
+
+  c->state = CONN_OPEN;
+  c->flags &= CONN_LISTEN;
+  c->peer_max_message_size = DEFAULT_MAX_MESSAGE_SIZE;
+  c->rx_len = 0;
+  c->rx_expected = 0;
+  c->next_mid = random_rand();
+  memset(c->pending, NO_TOKEN, sizeof(c->pending));
+
+  /* the CSM is the first message in both directions */
+  send_csm(c);
+}
+/*---------------------------------------------------------------------------*/
+static void
+conn_closed(coap_tcp_conn_t *c)
+{
+  if(c->state == CONN_OPEN) {
+    LOG_INFO("disconnected from ");
+    LOG_INFO_COAP_EP(&c->endpoint);
+    LOG_INFO_("\n");
+    /* observations end with the connection */
+    coap_remove_observer_by_client(&c->endpoint);
+  }
+  /* tcp-socket goes back to listening by itself */
+  c->state = (c->flags & CONN_LISTEN) ? CONN_LISTENING : CONN_CLOSED;
+  c->flags &= CONN_LISTEN;
+}
+/*---------------------------------------------------------------------------*/
+static void
+close_conn(coap_tcp_conn_t *c)
+{
+#if COAP_WITH_WEBSOCKET
+  if(c->endpoint.transport == COAP_TRANSPORT_WS) {
+    websocket_close(&c->ws);
+    conn_closed(c);
+    return;
+  }
+#endif /* COAP_WITH_WEBSOCKET */
+  tcp_socket_close(&c->socket);
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_csm(coap_tcp_conn_t *c, const uint8_t *option, const uint8_t *end)
+{
+  uint16_t number = 0;
+  uint16_t delta;
+  uint16_t len;
+  uint32_t value;
+  int ext;
+
+  while(option < end && *option != 0xff) {
+    delta = *option >> 4;
+    len = *option & 0x0f;
+    /* bytes of extended delta and length that follow */
+    ext = (delta == 13) + 2 * (delta == 14) + (len == 13) + 2 * (len == 14);
+    if(delta == 15 || len == 15 || end - option < 1 + ext) {
+      LOG_WARN("malformed CSM\n");
+      break;
+    }
+    option++;
+    if(delta == 13) {
+      delta = *option++ + 13;
+    } else if(delta == 14) {
+      delta = ((option[0] << 8) | option[1]) + 269;
+      option += 2;
+    }
+    if(len == 13) {
+      len = *option++ + 13;
+    } else if(len == 14) {
+      len = ((option[0] << 8) | option[1]) + 269;
+      option += 2;
+    }
+    if(len > end - option) {
+      LOG_WARN("malformed CSM\n");
+      break;
+    }
+    number += delta;
+
+    if(number == COAP_SIGNAL_OPTION_MAX_MESSAGE_SIZE) {
+      for(value = 0; len > 0; len--) {
+        value = (value << 8) | *option++;
+      }
+      c->peer_max_message_size = value;
+    } else if(number == COAP_SIGNAL_OPTION_BLOCK_WISE_TRANSFER) {
+      c->flags |= CONN_PEER_BERT;
+    }
+    option += len;
+  }
+
+  c->flags |= CONN_PEER_CSM;
+  LOG_DBG("CSM: Max-Message-Size %lu%s\n",
+          (unsigned long)c->peer_max_message_size,
+          (c->flags & CONN_PEER_BERT) ? ", BERT" : "");
+}
+/*---------------------------------------------------------------------------*/
+static pending_request_t *
+find_pending(coap_tcp_conn_t *c, const uint8_t *token, uint8_t token_len)
+{
+  int i;
+
+  for(i = 0; i < COAP_MAX_OPEN_TRANSACTIONS; i++) {
+    if(c->pending[i].token_len == token_len
+       && memcmp(c->pending[i].token, token, token_len) == 0) {
+      return &c->pending[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+/* Handles a message, token points at the token and is preceded by at least
+   COAP_HEADER_LEN bytes that can be overwritten */
+static void
+handle_message(coap_tcp_conn_t *c, uint8_t *token, uint8_t token_len,
+               uint8_t code, uint16_t len)
+{
+  uint8_t *message = token - COAP_HEADER_LEN;
+  pending_request_t *p;
+  uint8_t type;
+  uint16_t mid;
+
+  if(code >= COAP_SIGNAL_CSM) {
+    switch(code) {
+    case COAP_SIGNAL_CSM:
+      handle_csm(c, token + token_len, token + token_len + len);
+      break;
+    case COAP_SIGNAL_PING:
+      send_frame(c, token_len, COAP_SIGNAL_PONG, token, token_len);
+      break;
+    case COAP_SIGNAL_RELEASE:
+    case COAP_SIGNAL_ABORT:
+      LOG_INFO("peer released the connection\n");
+      close_conn(c);
+      break;
+    default:
+      break;
+    }
+    return;
+  }
+
+  if(code == 0) {
+    /* empty messages are ignored */
+    return;
+  }
+
+  if(!(c->flags & CONN_PEER_CSM)) {
+    LOG_WARN("message before CSM\n");
+  }
+
+  /* map the message onto the UDP layout for the engine */
+  if(code >= COAP_GET && code <= COAP_DELETE) {
+    /* requests are answered with piggybacked responses */
+    type = COAP_TYPE_CON;
+    mid = c->next_mid++;
+  } else if((p = find_pending(c, token, token_len)) != NULL) {
+    /* a response closes the transaction of its request */
+    type = COAP_TYPE_ACK;
+    mid = p->mid;
+    p->token_len = NO_TOKEN;
+  } else {
+    /* notifications and other responses without a request */
+    type = COAP_TYPE_NON;
+    mid = c->next_mid++;
+  }
+
+  message[0] = (1 << COAP_HEADER_VERSION_POSITION)
+    | (type << COAP_HEADER_TYPE_POSITION) | token_len;
+  message[1] = code;
+  message[2] = mid >> 8;
+  message[3] = mid & 0xff;
+
+  coap_receive(&c->endpoint, message, COAP_HEADER_LEN + token_len + len);
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_frame(coap_tcp_conn_t *c)
+{
+  uint8_t *frame = &c->rx[RX_OFFSET];
+  uint32_t body_len;
+  int header_len;
+
+  header_len = parse_frame_header(frame, c->rx_len, &body_len);
+  handle_message(c, &frame[header_len], frame[0] & 0x0f,
+                 frame[header_len - 1], body_len);
+}
+/*---------------------------------------------------------------------------*/
+static void
+input_bytes(coap_tcp_conn_t *c, const uint8_t *data, int len)
+{
+  uint8_t *frame = &c->rx[RX_OFFSET];
+  uint32_t body_len;
+  int header_len;
+  int n;
+
+  while(len > 0 && c->state == CONN_OPEN) {
+    if(c->rx_expected == 0) {
+      /* the header is collected byte by byte */
+      frame[c->rx_len++] = *data++;
+      len--;
+      header_len = parse_frame_header(frame, c->rx_len, &body_len);
+      if(header_len > 0) {
+        /* checked before adding up, so that the sum cannot wrap */
+        if((frame[0] & 0x0f) > COAP_TOKEN_LEN
+           || body_len > FRAME_SIZE - header_len - (frame[0] & 0x0f)) {
+          LOG_WARN("frame with %lu bytes body too large, aborting\n",
+                   (unsigned long)body_len);
+          send_frame(c, 0, COAP_SIGNAL_ABORT, NULL, 0);
+          close_conn(c);
+          return;
+        }
+        c->rx_expected = header_len + (frame[0] & 0x0f) + body_len;
+      }
+    }
+
+    if(c->rx_expected > 0) {
+      n = MIN(len, c->rx_expected - c->rx_len);
+      memcpy(&frame[c->rx_len], data, n);
+      c->rx_len += n;
+      data += n;
+      len -= n;
+      if(c->rx_len == c->rx_expected) {
+        handle_frame(c);
+        c->rx_len = 0;
+        c->rx_expected = 0;
+      }
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+tcp_input(struct tcp_socket *s, void *ptr, const uint8_t *data, int len)
+{
+  input_bytes(ptr, data, len);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+tcp_event(struct tcp_socket *s, void *ptr, tcp_socket_event_t event)
+{
+  coap_tcp_conn_t *c = ptr;
+
+  switch(event) {
+  case TCP_SOCKET_CONNECTED:
+    if(c->flags & CONN_LISTEN) {
+      /* incoming connection */
+      memset(&c->endpoint, 0, sizeof(c->endpoint));
+      uip_ipaddr_copy(&c->endpoint.ipaddr, &uip_conn->ripaddr);
+      c->endpoint.port = uip_conn->rport;
+      c->endpoint.transport = COAP_TRANSPORT_TCP;
+    }
+    open_conn(c);
+    break;
+  case TCP_SOCKET_CLOSED:
+  case TCP_SOCKET_TIMEDOUT:
+  case TCP_SOCKET_ABORTED:
+    conn_closed(c);
+    break;
+  default:
+    break;
+  }
+}
+/*---------------------------------------------------------------------------*/
+#if COAP_WITH_WEBSOCKET
+static void
+ws_event(struct websocket *s, websocket_result_t result,
+         const uint8_t *data, uint16_t len)
+{
+  coap_tcp_conn_t *c;
+  uint8_t *frame;
+  int i;
+
+  for(i = 0; i < COAP_TCP_MAX_CONNECTIONS; i++) {
+    if(&conns[i].ws == s) {
+      break;
+    }
+  }
+  if(i == COAP_TCP_MAX_CONNECTIONS) {
+    return;
+  }
+  c = &conns[i];
+  frame = &c->rx[RX_OFFSET];
+
+  switch(result) {
+  case WEBSOCKET_CONNECTED:
+    open_conn(c);
+    break;
+  case WEBSOCKET_DATA:
+    if(c->rx_len + len > FRAME_SIZE) {
+      /* remember the overflow until the end of the message */
+      c->rx_expected = 1;
+    } else {
+      memcpy(&frame[c->rx_len], data, len);
+      c->rx_len += len;
+    }
+    break;
+  case WEBSOCKET_DATA_RECEIVED:
+    /* one message per frame, the length nibble is always zero */
+    if(c->rx_expected || c->rx_len < 2 || (frame[0] >> 4) != 0
+       || (frame[0] & 0x0f) > COAP_TOKEN_LEN
+       || c->rx_len < 2 + (frame[0] & 0x0f)) {
+      LOG_WARN("dropping malformed WebSocket message\n");
+    } else {
+      handle_message(c, &frame[2], frame[0] & 0x0f, frame[1],
+                     c->rx_len - 2 - (frame[0] & 0x0f));
+    }
+    c->rx_len = 0;
+    c->rx_expected = 0;
+    break;
+  case WEBSOCKET_RESET:
+  case WEBSOCKET_TIMEDOUT:
+  case WEBSOCKET_CLOSED:
+  case WEBSOCKET_HOSTNAME_NOT_FOUND:
+    conn_closed(c);
+    break;
+  default:
+    break;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+ws_connect(coap_tcp_conn_t *c)
+{
+  char url[sizeof("ws://[]:65535") + UIPLIB_IPV6_MAX_STR_LEN +
+           sizeof(COAP_WS_PATH)];
+  int n;
+
+  n = snprintf(url, sizeof(url), "ws://[");
+  n += uiplib_ipaddr_snprint(&url[n], sizeof(url) - n,
+                             &c->endpoint.ipaddr);
+  snprintf(&url[n], sizeof(url) - n, "]:%u%s",
+           uip_ntohs(c->endpoint.port), COAP_WS_PATH);
+
+  websocket_init(&c->ws);
+  if(websocket_open(&c->ws, url, "coap", NULL, ws_event) == WEBSOCKET_ERR) {
+    return 0;
+  }
+  return 1;
+}
+#endif /* COAP_WITH_WEBSOCKET */
+/*---------------------------------------------------------------------------*/
+int
+coap_tcp_connect(const coap_endpoint_t *ep)
+{
+  coap_tcp_conn_t *c;
+  int i;
+
+  if(find_conn(ep) != NULL) {
+    return 1;
+  }
+  if(ep->secure) {
+    LOG_WARN("TLS is not supported\n");
+    return 0;
+  }
+
+  for(i = 0; i < COAP_TCP_MAX_CONNECTIONS; i++) {
+    if(conns[i].state == CONN_CLOSED) {
+      break;
+    }
+  }
+  if(i == COAP_TCP_MAX_CONNECTIONS) {
+    LOG_WARN("no free connection\n");
+    return 0;
+  }
+  c = &conns[i];
+  coap_endpoint_copy(&c->endpoint, ep);
+
+  LOG_DBG("connect to ");
+  LOG_DBG_COAP_EP(ep);
+  LOG_DBG_("\n");
+
+  if(ep->transport == COAP_TRANSPORT_WS) {
+#if COAP_WITH_WEBSOCKET
+    if(!ws_connect(c)) {
+      return 0;
+    }
+#else /* COAP_WITH_WEBSOCKET */
+    LOG_WARN("WebSocket support is not enabled\n");
+    return 0;
+#endif /* COAP_WITH_WEBSOCKET */
+  } else if(tcp_socket_connect(&c->socket, &ep->ipaddr,
+                               uip_ntohs(ep->port)) < 0) {
+    return 0;
+  }
+  c->state = CONN_CONNECTING;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+coap_tcp_disconnect(const coap_endpoint_t *ep)
+{
+  coap_tcp_conn_t *c = find_conn(ep);
+
+  if(c != NULL) {
+    if(c->state == CONN_OPEN) {
+      send_frame(c, 0, COAP_SIGNAL_RELEASE, NULL, 0);
+    }
+    close_conn(c);
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+coap_tcp_is_connected(const coap_endpoint_t *ep)
+{
+  coap_tcp_conn_t *c = find_conn(ep);
+
+  return c != NULL && c->state == CONN_OPEN && (c->flags & CONN_PEER_CSM);
+}
+/*---------------------------------------------------------------------------*/
+int
+coap_tcp_has_bert(const coap_endpoint_t *ep)
+{
+  coap_tcp_conn_t *c = find_conn(ep);
+
+  return COAP_WITH_BERT && c != NULL && (c->flags & CONN_PEER_BERT);
+}
+/*---------------------------------------------------------------------------*/
+int
+coap_tcp_sendto(const coap_endpoint_t *ep, const uint8_t *data,
+                uint16_t length)
+{
+  coap_tcp_conn_t *c = find_conn(ep);
+  pending_request_t *p;
+  uint8_t token_len;
+  uint8_t code;
+
+  if(c == NULL || c->state != CONN_OPEN) {
+    LOG_WARN("not connected to ");
+    LOG_WARN_COAP_EP(ep);
+    LOG_WARN_(" - dropping message\n");
+    return -1;
+  }
+  if(length < COAP_HEADER_LEN) {
+    return -1;
+  }
+
+  token_len = data[0] & COAP_HEADER_TOKEN_LEN_MASK;
+  code = data[1];
+
+  if(code == 0) {
+    /* no empty ACKs or RSTs over reliable transports */
+    return length;
+  }
+
+  if(code >= COAP_GET && code <= COAP_DELETE) {
+    /* remember the MID to hand the response to the right transaction */
+    p = find_pending(c, &data[COAP_HEADER_LEN], token_len);
+    if(p == NULL) {
+      p = &c->pending[c->next_pending];
+      c->next_pending = (c->next_pending + 1) % COAP_MAX_OPEN_TRANSACTIONS;
+    }
+    p->mid = (data[2] << 8) | data[3];
+    p->token_len = token_len;
+    memcpy(p->token, &data[COAP_HEADER_LEN], token_len);
+  }
+
+  if(send_frame(c, token_len, code, &data[COAP_HEADER_LEN],
+                length - COAP_HEADER_LEN) < 0) {
+    return -1;
+  }
+
+  LOG_INFO("sent to ");
+  LOG_INFO_COAP_EP(ep);
+  LOG_INFO_(" %u bytes\n", length);
+  return length;
+}
+/*---------------------------------------------------------------------------*/
+void
+coap_tcp_init(void)
+{
+  int i;
+
+  for(i = 0; i < COAP_TCP_MAX_CONNECTIONS; i++) {
+    conns[i].state = CONN_CLOSED;
+    conns[i].flags = 0;
+    tcp_socket_register(&conns[i].socket, &conns[i],
+                        conns[i].input, sizeof(conns[i].input),
+                        conns[i].output, sizeof(conns[i].output),
+                        tcp_input, tcp_event);
+    if(i < COAP_TCP_LISTEN_CONNECTIONS) {
+      conns[i].flags = CONN_LISTEN;
+      conns[i].state = CONN_LISTENING;
+      tcp_socket_listen(&conns[i].socket, COAP_SERVER_PORT);
+    }
+  }
+  LOG_INFO("Listening on TCP port %u\n", COAP_SERVER_PORT);
+}
+#endif /* COAP_WITH_TCP */
+/*---------------------------------------------------------------------------*/
+/** @} */
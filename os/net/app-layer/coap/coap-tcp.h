@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden AB
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         CoAP over TCP and WebSockets (RFC 8323)
+ */
+
+/**
+ * \addtogroup coap-transport
+ * @{
+ *
+ * \defgroup coap-tcp CoAP over reliable transports
+ * @{
+ *
+ * Connections for coap+tcp:// and coap+ws:// endpoints. Messages are
+ * converted between the RFC 8323 framing and the UDP message layout so
+ * that the CoAP engine handles them like any other message. This API is
+ * used by the CoAP transport and is normally not called by applications,
+ * which use the coap_endpoint_connect() family of functions instead.
+ */
+
+#ifndef COAP_TCP_H_
+#define COAP_TCP_H_
+
+#include "coap-endpoint.h"
+
+/**
+ * \brief      Initialize the connections and start listening for
+ *             incoming TCP connections.
+ */
+void coap_tcp_init(void);
+
+/**
+ * \brief      Open a connection to a reliable endpoint.
+ * \param ep   A pointer to a CoAP endpoint.
+ * \return     Returns zero if an error occurred and non-zero otherwise.
+ */
+int coap_tcp_connect(const coap_endpoint_t *ep);
+
+/**
+ * \brief      Close the connection to a reliable endpoint.
+ * \param ep   A pointer to a CoAP endpoint.
+ */
+void coap_tcp_disconnect(const coap_endpoint_t *ep);
+
+/**
+ * \brief      Check if the connection to an endpoint is established and
+ *             its Capabilities and Settings Message has been received.
+ * \param ep   A pointer to a CoAP endpoint.
+ * \return     Returns true if connected and false otherwise.
+ */
+int coap_tcp_is_connected(const coap_endpoint_t *ep);
+
+/**
+ * \brief      Check if the peer accepts BERT blocks.
+ * \param ep   A pointer to a CoAP endpoint.
+ * \return     Returns true if BERT can be used and false otherwise.
+ */
+int coap_tcp_has_bert(const coap_endpoint_t *ep);
+
+/**
+ * \brief      Send a message over the connection to an endpoint.
+ * \param ep   A pointer to a CoAP endpoint.
+ * \param data A serialized CoAP message in the UDP message layout.
+ * \param len  The length of the message.
+ * \return     The number of bytes sent or negative if an error occurred.
+ */
+int coap_tcp_sendto(const coap_endpoint_t *ep, const uint8_t *data,
+                    uint16_t len);
+
+#endif /* COAP_TCP_H_ */
+/** @} */
+/** @} */
@@ -55,7 +55,7 @@ static uint8_t is_initialized;
 static void
 add_timer(coap_timer_t *timer)
 {
-  coap_timer_t *n, *l, *p;
+  coap_timer_t *n, *l, *p, *t;
 
   if(!is_initialized) {
     /* The coap_timer system has not yet been initialized */
@@ -69,6 +69,7 @@ add_timer(coap_timer_t *timer)
 
   /* Make sure the timer is not already added to the timer list */
   list_remove(timer_list, timer);
+  t = timer;
 
   for(l = NULL, n = list_head(timer_list); n != NULL; l = n, n = n->next) {
     if(timer->expiration_time < n->expiration_time) {
@@ -82,8 +83,11 @@ add_timer(coap_timer_t *timer)
     list_insert(timer_list, l, timer);
   }
 
-  if(p != list_head(timer_list)) {
-    /* The next timer to expire has changed so we need to notify the driver */
+  if(p != list_head(timer_list) || p == t) {
+    /*
+     * The next timer to expire has changed, or has been moved to a new
+     * expiration time, so we need to notify the driver
+     */
     COAP_TIMER_DRIVER.update();
   }
 }
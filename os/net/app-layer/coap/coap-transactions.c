@@ -48,28 +48,270 @@
 #include "lib/list.h"
 #include "lib/random.h"
 #include <stdlib.h>
+#include <string.h>
 
 /* Log configuration */
 #include "coap-log.h"
 #define LOG_MODULE "coap"
 #define LOG_LEVEL  LOG_LEVEL_COAP
 
+#if (COAP_TRANSACTION_HASH_SIZE & (COAP_TRANSACTION_HASH_SIZE - 1)) != 0
+#error COAP_TRANSACTION_HASH_SIZE must be a power of two
+#endif
+
+#define WITH_PEER_STATE (COAP_NSTART > 0 || COAP_WITH_COCOA)
+
+/* CoCoA bounds and thresholds, in milliseconds */
+#define COCOA_MAX_RTO       60000
+#define COCOA_SMALL_RTO      1000
+#define COCOA_LARGE_RTO      3000
+
 /*---------------------------------------------------------------------------*/
 MEMB(transactions_memb, coap_transaction_t, COAP_MAX_OPEN_TRANSACTIONS);
 LIST(transactions_list);
 
+/* transactions by MID, for matching ACKs and RSTs */
+static coap_transaction_t *transactions_hash[COAP_TRANSACTION_HASH_SIZE];
+
+/* transactions waiting for retransmission, driven by a single timer */
+static coap_transaction_t *retrans_queue;
+static coap_timer_t retrans_timer;
+
+static void coap_retransmit_transactions(coap_timer_t *nt);
+
+#if WITH_PEER_STATE
+/* Congestion state of a remote endpoint */
+typedef struct coap_peer {
+  struct coap_peer *next;
+  coap_endpoint_t endpoint;
+  uint32_t last_used;
+  uint8_t in_flight;
+#if COAP_WITH_COCOA
+  uint32_t rto;
+  uint32_t strong_srtt;
+  uint32_t strong_rttvar;
+  uint32_t weak_srtt;
+  uint32_t weak_rttvar;
+#endif /* COAP_WITH_COCOA */
+} coap_peer_t;
+
+MEMB(peers_memb, coap_peer_t, COAP_MAX_PEERS);
+LIST(peers_list);
+#endif /* WITH_PEER_STATE */
+
+/*---------------------------------------------------------------------------*/
+static uint32_t
+now_ms(void)
+{
+  return (uint32_t)coap_timer_uptime();
+}
+/*---------------------------------------------------------------------------*/
+#if WITH_PEER_STATE
+static coap_peer_t *
+get_peer(const coap_endpoint_t *endpoint, int create)
+{
+  coap_peer_t *p;
+  coap_peer_t *idle = NULL;
+
+  for(p = list_head(peers_list); p != NULL; p = p->next) {
+    if(coap_endpoint_cmp(&p->endpoint, endpoint)) {
+      return p;
+    }
+    if(p->in_flight == 0
+       && (idle == NULL || (int32_t)(p->last_used - idle->last_used) < 0)) {
+      idle = p;
+    }
+  }
+
+  if(!create) {
+    return NULL;
+  }
+
+  p = memb_alloc(&peers_memb);
+  if(p == NULL) {
+    if(idle == NULL) {
+      return NULL;
+    }
+    /* recycle the least recently used peer without pending messages */
+    list_remove(peers_list, idle);
+    p = idle;
+  }
+
+  memset(p, 0, sizeof(coap_peer_t));
+  coap_endpoint_copy(&p->endpoint, endpoint);
+  p->last_used = now_ms();
+#if COAP_WITH_COCOA
+  p->rto = COAP_RESPONSE_TIMEOUT_TICKS;
+#endif /* COAP_WITH_COCOA */
+  list_add(peers_list, p);
+  return p;
+}
+#endif /* WITH_PEER_STATE */
+/*---------------------------------------------------------------------------*/
+#if COAP_WITH_COCOA
+/* RFC 6298 estimator, returns SRTT + k * RTTVAR */
+static uint32_t
+estimate_rto(uint32_t *srtt, uint32_t *rttvar, uint32_t rtt, uint8_t k)
+{
+  uint32_t delta;
+
+  if(*srtt == 0) {
+    *srtt = rtt > 0 ? rtt : 1;
+    *rttvar = rtt / 2;
+  } else {
+    delta = *srtt > rtt ? *srtt - rtt : rtt - *srtt;
+    *rttvar = (3 * *rttvar + delta) / 4;
+    *srtt = (7 * *srtt + rtt) / 8;
+  }
+  return *srtt + k * *rttvar;
+}
+/*---------------------------------------------------------------------------*/
+static void
+age_rto(coap_peer_t *p, uint32_t now)
+{
+  uint32_t idle = now - p->last_used;
+
+  /* estimates that have not been refreshed in a while drift back */
+  if(p->rto < COCOA_SMALL_RTO && idle > 16 * p->rto) {
+    p->rto *= 2;
+  } else if(p->rto > COCOA_LARGE_RTO && idle > 4 * p->rto) {
+    p->rto = (COAP_RESPONSE_TIMEOUT_TICKS + p->rto) / 2;
+  }
+}
+#endif /* COAP_WITH_COCOA */
+/*---------------------------------------------------------------------------*/
+/* Returns 0 if the transaction has to wait for a free NSTART slot */
+static int
+start_transaction(coap_transaction_t *t)
+{
+  uint32_t now = now_ms();
+#if WITH_PEER_STATE
+  coap_peer_t *p;
+
+  if(!(t->state & COAP_TRANSACTION_IN_FLIGHT)
+     && (p = get_peer(&t->endpoint, 1)) != NULL) {
+#if COAP_NSTART > 0
+    if(p->in_flight >= COAP_NSTART) {
+      LOG_DBG("NSTART reached, queueing transaction %u\n", t->mid);
+      t->state |= COAP_TRANSACTION_QUEUED;
+      return 0;
+    }
+#endif /* COAP_NSTART > 0 */
+    t->state = COAP_TRANSACTION_IN_FLIGHT;
+    p->in_flight++;
+#if COAP_WITH_COCOA
+    age_rto(p, now);
+#endif /* COAP_WITH_COCOA */
+    p->last_used = now;
+  }
+#endif /* WITH_PEER_STATE */
+  t->start_time = now;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static uint32_t
+initial_interval(coap_transaction_t *t)
+{
+#if COAP_WITH_COCOA
+  coap_peer_t *p = get_peer(&t->endpoint, 0);
+
+  if(p != NULL) {
+    /* variable backoff factor, keeps retransmissions within a sane range */
+    if(p->rto < COCOA_SMALL_RTO) {
+      t->backoff = 6;
+    } else if(p->rto > COCOA_LARGE_RTO) {
+      t->backoff = 3;
+    } else {
+      t->backoff = 4;
+    }
+    return p->rto + (random_rand() % (p->rto / 2 + 1));
+  }
+#endif /* COAP_WITH_COCOA */
+  t->backoff = 4;
+  return COAP_RESPONSE_TIMEOUT_TICKS + (random_rand() %
+                                        COAP_RESPONSE_TIMEOUT_BACKOFF_MASK);
+}
+
+/*---------------------------------------------------------------------------*/
+static unsigned
+mid_hash(uint16_t mid)
+{
+  return (mid ^ (mid >> 8)) & (COAP_TRANSACTION_HASH_SIZE - 1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+update_retrans_timer(void)
+{
+  uint64_t now;
+
+  if(retrans_queue == NULL) {
+    coap_timer_stop(&retrans_timer);
+    return;
+  }
+
+  now = coap_timer_uptime();
+  coap_timer_set_callback(&retrans_timer, coap_retransmit_transactions);
+  coap_timer_set(&retrans_timer, retrans_queue->retrans_time > now ?
+                 retrans_queue->retrans_time - now : 0);
+}
 /*---------------------------------------------------------------------------*/
 static void
-coap_retransmit_transaction(coap_timer_t *nt)
+unschedule_transaction(coap_transaction_t *t)
 {
-  coap_transaction_t *t = coap_timer_get_user_data(nt);
-  if(t == NULL) {
-    LOG_DBG("No retransmission data in coap_timer!\n");
+  coap_transaction_t **p;
+
+  if(!(t->state & COAP_TRANSACTION_SCHEDULED)) {
     return;
   }
-  ++(t->retrans_counter);
-  LOG_DBG("Retransmitting %u (%u)\n", t->mid, t->retrans_counter);
-  coap_send_transaction(t);
+  t->state &= ~COAP_TRANSACTION_SCHEDULED;
+
+  for(p = &retrans_queue; *p != NULL; p = &(*p)->retrans_next) {
+    if(*p == t) {
+      *p = t->retrans_next;
+      if(p == &retrans_queue) {
+        update_retrans_timer();
+      }
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+schedule_transaction(coap_transaction_t *t, uint32_t interval)
+{
+  coap_transaction_t **p;
+
+  unschedule_transaction(t);
+  t->retrans_time = coap_timer_uptime() + interval;
+
+  /* keep the queue ordered by retransmission time, FIFO for equal times */
+  for(p = &retrans_queue;
+      *p != NULL && (*p)->retrans_time <= t->retrans_time;
+      p = &(*p)->retrans_next);
+  t->retrans_next = *p;
+  *p = t;
+  t->state |= COAP_TRANSACTION_SCHEDULED;
+
+  if(retrans_queue == t) {
+    update_retrans_timer();
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+coap_retransmit_transactions(coap_timer_t *nt)
+{
+  coap_transaction_t *t;
+  uint64_t now = coap_timer_uptime();
+
+  while((t = retrans_queue) != NULL && t->retrans_time <= now) {
+    retrans_queue = t->retrans_next;
+    t->state &= ~COAP_TRANSACTION_SCHEDULED;
+    ++(t->retrans_counter);
+    LOG_DBG("Retransmitting %u (%u)\n", t->mid, t->retrans_counter);
+    /* may clear this transaction or schedule others */
+    coap_send_transaction(t);
+  }
+  update_retrans_timer();
 }
 /*---------------------------------------------------------------------------*/
 
@@ -84,11 +326,15 @@ coap_new_transaction(uint16_t mid, const coap_endpoint_t *endpoint)
   if(t) {
     t->mid = mid;
     t->retrans_counter = 0;
+    t->state = 0;
+    t->retrans_next = NULL;
 
     /* save client address */
     coap_endpoint_copy(&t->endpoint, endpoint);
 
     list_add(transactions_list, t); /* list itself makes sure same element is not added twice */
+    t->hash_next = transactions_hash[mid_hash(mid)];
+    transactions_hash[mid_hash(mid)] = t;
   }
 
   return t;
@@ -100,28 +346,36 @@ coap_send_transaction(coap_transaction_t *t)
   LOG_DBG("Sending transaction %u\n", t->mid);
 
   if(COAP_TYPE_CON ==
-     ((COAP_HEADER_TYPE_MASK & t->message[0]) >> COAP_HEADER_TYPE_POSITION)) {
+     ((COAP_HEADER_TYPE_MASK & t->message[0]) >> COAP_HEADER_TYPE_POSITION)
+     && !(coap_endpoint_is_reliable(&t->endpoint)
+          && (t->message[1] < COAP_GET || t->message[1] > COAP_DELETE))) {
     if(t->retrans_counter <= COAP_MAX_RETRANSMIT) {
+      if(t->retrans_counter == 0 && !start_transaction(t)) {
+        /* sent when an earlier message to the endpoint completes */
+        return;
+      }
+
       /* not timed out yet */
       coap_sendto(&t->endpoint, t->message, t->message_len);
       LOG_DBG("Keeping transaction %u\n", t->mid);
 
-      if(t->retrans_counter == 0) {
-        coap_timer_set_callback(&t->retrans_timer, coap_retransmit_transaction);
-        coap_timer_set_user_data(&t->retrans_timer, t);
-        t->retrans_interval =
-          COAP_RESPONSE_TIMEOUT_TICKS + (random_rand() %
-                                         COAP_RESPONSE_TIMEOUT_BACKOFF_MASK);
+      if(coap_endpoint_is_reliable(&t->endpoint)) {
+        /* no retransmissions, only wait as long as an exchange over UDP */
+        t->retrans_counter = COAP_MAX_RETRANSMIT;
+        t->retrans_interval = COAP_RESPONSE_TIMEOUT_TICKS *
+          ((2 << COAP_MAX_RETRANSMIT) - 1);
+      } else if(t->retrans_counter == 0) {
+        t->retrans_interval = initial_interval(t);
         LOG_DBG("Initial interval %lu msec\n",
                 (unsigned long)t->retrans_interval);
       } else {
-        t->retrans_interval <<= 1;  /* double */
-        LOG_DBG("Doubled (%u) interval %lu s\n", t->retrans_counter,
+        t->retrans_interval = t->retrans_interval * t->backoff / 2;
+        LOG_DBG("Backed off (%u) interval %lu s\n", t->retrans_counter,
                 (unsigned long)(t->retrans_interval / 1000));
       }
 
       /* interval updated above */
-      coap_timer_set(&t->retrans_timer, t->retrans_interval);
+      schedule_transaction(t, t->retrans_interval);
     } else {
       /* timed out */
       LOG_DBG("Timeout\n");
@@ -138,6 +392,7 @@ coap_send_transaction(coap_transaction_t *t)
       }
     }
   } else {
+    /* also confirmable responses over reliable transports, nothing ACKs them */
     coap_sendto(&t->endpoint, t->message, t->message_len);
     coap_clear_transaction(t);
   }
@@ -146,21 +401,103 @@ coap_send_transaction(coap_transaction_t *t)
 void
 coap_clear_transaction(coap_transaction_t *t)
 {
+  coap_transaction_t **bucket;
+#if WITH_PEER_STATE
+  coap_peer_t *p = NULL;
+  coap_transaction_t *next;
+#endif /* WITH_PEER_STATE */
+
   if(t) {
     LOG_DBG("Freeing transaction %u: %p\n", t->mid, t);
 
-    coap_timer_stop(&t->retrans_timer);
+    unschedule_transaction(t);
     list_remove(transactions_list, t);
+    for(bucket = &transactions_hash[mid_hash(t->mid)]; *bucket != NULL;
+        bucket = &(*bucket)->hash_next) {
+      if(*bucket == t) {
+        *bucket = t->hash_next;
+        break;
+      }
+    }
+#if WITH_PEER_STATE
+    if(t->state & COAP_TRANSACTION_IN_FLIGHT) {
+      p = get_peer(&t->endpoint, 0);
+    }
+#endif /* WITH_PEER_STATE */
     memb_free(&transactions_memb, t);
+
+#if WITH_PEER_STATE
+    if(p != NULL) {
+      p->in_flight--;
+      /* start the oldest message waiting for this endpoint */
+      for(next = list_head(transactions_list); next; next = next->next) {
+        if((next->state & COAP_TRANSACTION_QUEUED)
+           && coap_endpoint_cmp(&next->endpoint, &p->endpoint)) {
+          coap_send_transaction(next);
+          break;
+        }
+      }
+    }
+#endif /* WITH_PEER_STATE */
   }
 }
 /*---------------------------------------------------------------------------*/
+void
+coap_transaction_acknowledged(coap_transaction_t *t)
+{
+#if COAP_WITH_COCOA
+  coap_peer_t *p;
+  uint32_t now;
+  uint32_t rtt;
+
+  /* CoCoA only takes samples from messages retransmitted at most twice */
+  if(!(t->state & COAP_TRANSACTION_IN_FLIGHT) || t->retrans_counter > 2
+     || (p = get_peer(&t->endpoint, 0)) == NULL) {
+    return;
+  }
+
+  now = now_ms();
+  rtt = now - t->start_time;
+  if(t->retrans_counter == 0) {
+    /* strong estimator */
+    p->rto = (estimate_rto(&p->strong_srtt, &p->strong_rttvar, rtt, 4)
+              + p->rto) / 2;
+  } else {
+    /* weak estimator, the RTT might include retransmissions */
+    p->rto = (estimate_rto(&p->weak_srtt, &p->weak_rttvar, rtt, 1)
+              + 3 * p->rto) / 4;
+  }
+  if(p->rto > COCOA_MAX_RTO) {
+    p->rto = COCOA_MAX_RTO;
+  } else if(p->rto == 0) {
+    p->rto = 1;
+  }
+  p->last_used = now;
+
+  LOG_DBG("RTT %lu ms (%u retransmissions), RTO %lu ms\n",
+          (unsigned long)rtt, t->retrans_counter, (unsigned long)p->rto);
+#endif /* COAP_WITH_COCOA */
+}
+/*---------------------------------------------------------------------------*/
+uint32_t
+coap_get_peer_rto(const coap_endpoint_t *endpoint)
+{
+#if COAP_WITH_COCOA
+  coap_peer_t *p = get_peer(endpoint, 0);
+
+  if(p != NULL) {
+    return p->rto;
+  }
+#endif /* COAP_WITH_COCOA */
+  return COAP_RESPONSE_TIMEOUT_TICKS;
+}
+/*---------------------------------------------------------------------------*/
 coap_transaction_t *
 coap_get_transaction_by_mid(uint16_t mid)
 {
-  coap_transaction_t *t = NULL;
+  coap_transaction_t *t;
 
-  for(t = (coap_transaction_t *)list_head(transactions_list); t; t = t->next) {
+  for(t = transactions_hash[mid_hash(mid)]; t; t = t->hash_next) {
     if(t->mid == mid) {
       LOG_DBG("Found transaction for MID %u: %p\n", t->mid, t);
       return t;
@@ -169,4 +506,18 @@ coap_get_transaction_by_mid(uint16_t mid)
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
+coap_transaction_t *
+coap_get_transaction(uint16_t mid, const coap_endpoint_t *endpoint)
+{
+  coap_transaction_t *t;
+
+  for(t = transactions_hash[mid_hash(mid)]; t; t = t->hash_next) {
+    if(t->mid == mid && coap_endpoint_cmp(&t->endpoint, endpoint)) {
+      LOG_DBG("Found transaction for MID %u: %p\n", t->mid, t);
+      return t;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
 /** @} */
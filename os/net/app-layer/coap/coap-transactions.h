@@ -59,10 +59,16 @@
 typedef struct coap_transaction {
   struct coap_transaction *next;        /* for LIST */
 
+  struct coap_transaction *hash_next;    /* MID hash bucket */
+  struct coap_transaction *retrans_next; /* retransmission queue */
+
   uint16_t mid;
-  coap_timer_t retrans_timer;
+  uint64_t retrans_time;
   uint32_t retrans_interval;
   uint8_t retrans_counter;
+  uint8_t backoff;      /* retransmission backoff factor, in halves */
+  uint8_t state;        /* COAP_TRANSACTION_* flags */
+  uint32_t start_time;  /* initial transmission, for RTT samples */
 
   coap_endpoint_t endpoint;
 
@@ -74,10 +80,18 @@ typedef struct coap_transaction {
                                                  * Use snprintf(buf, len+1, "", ...) to completely fill payload */
 } coap_transaction_t;
 
+#define COAP_TRANSACTION_QUEUED    0x01
+#define COAP_TRANSACTION_IN_FLIGHT 0x02
+#define COAP_TRANSACTION_SCHEDULED 0x04
+
 coap_transaction_t *coap_new_transaction(uint16_t mid, const coap_endpoint_t *ep);
 void coap_send_transaction(coap_transaction_t *t);
 void coap_clear_transaction(coap_transaction_t *t);
 coap_transaction_t *coap_get_transaction_by_mid(uint16_t mid);
+coap_transaction_t *coap_get_transaction(uint16_t mid,
+                                         const coap_endpoint_t *ep);
+void coap_transaction_acknowledged(coap_transaction_t *t);
+uint32_t coap_get_peer_rto(const coap_endpoint_t *ep);
 
 #endif /* COAP_TRANSACTIONS_H_ */
 /** @} */
@@ -58,6 +58,9 @@
 #include "coap-constants.h"
 #include "coap-keystore.h"
 #include "coap-keystore-simple.h"
+#if COAP_WITH_TCP
+#include "coap-tcp.h"
+#endif /* COAP_WITH_TCP */
 
 /* Log configuration */
 #include "coap-log.h"
@@ -69,7 +72,12 @@
 #endif /* WITH_DTLS */
 
 /* sanity check for configured values */
-#if COAP_MAX_PACKET_SIZE > (UIP_BUFSIZE - UIP_IPH_LEN - UIP_UDPH_LEN)
+#if COAP_WITH_BERT
+/* larger messages only go over TCP, UDP peers get regular blocks */
+#if COAP_MAX_HEADER_SIZE + COAP_MAX_BLOCK_SIZE > (UIP_BUFSIZE - UIP_IPH_LEN - UIP_UDPH_LEN)
+#error "UIP_CONF_BUFFER_SIZE too small for COAP_MAX_BLOCK_SIZE"
+#endif
+#elif COAP_MAX_PACKET_SIZE > (UIP_BUFSIZE - UIP_IPH_LEN - UIP_UDPH_LEN)
 #error "UIP_CONF_BUFFER_SIZE too small for COAP_MAX_CHUNK_SIZE"
 #endif
 
@@ -94,6 +102,20 @@ PROCESS(coap_engine, "CoAP Engine");
 
 static struct uip_udp_conn *udp_conn = NULL;
 
+/*---------------------------------------------------------------------------*/
+static const char *
+get_scheme(const coap_endpoint_t *ep)
+{
+#if COAP_WITH_TCP
+  if(ep->transport == COAP_TRANSPORT_TCP) {
+    return ep->secure ? "coaps+tcp://[" : "coap+tcp://[";
+  }
+  if(ep->transport == COAP_TRANSPORT_WS) {
+    return ep->secure ? "coaps+ws://[" : "coap+ws://[";
+  }
+#endif /* COAP_WITH_TCP */
+  return ep->secure ? "coaps://[" : "coap://[";
+}
 /*---------------------------------------------------------------------------*/
 void
 coap_endpoint_log(const coap_endpoint_t *ep)
@@ -102,11 +124,7 @@ coap_endpoint_log(const coap_endpoint_t *ep)
     LOG_OUTPUT("(NULL EP)");
     return;
   }
-  if(ep->secure) {
-    LOG_OUTPUT("coaps://[");
-  } else {
-    LOG_OUTPUT("coap://[");
-  }
+  LOG_OUTPUT("%s", get_scheme(ep));
   log_6addr(&ep->ipaddr);
   LOG_OUTPUT("]:%u", uip_ntohs(ep->port));
 }
@@ -118,11 +136,7 @@ coap_endpoint_print(const coap_endpoint_t *ep)
     printf("(NULL EP)");
     return;
   }
-  if(ep->secure) {
-    printf("coaps://[");
-  } else {
-    printf("coap://[");
-  }
+  printf("%s", get_scheme(ep));
   uiplib_ipaddr_print(&ep->ipaddr);
   printf("]:%u", uip_ntohs(ep->port));
 }
@@ -137,11 +151,7 @@ coap_endpoint_snprint(char *buf, size_t size, const coap_endpoint_t *ep)
   if(ep == NULL) {
     n = snprintf(buf, size - 1, "(NULL EP)");
   } else {
-    if(ep->secure) {
-      n = snprintf(buf, size - 1, "coaps://[");
-    } else {
-      n = snprintf(buf, size - 1, "coap://[");
-    }
+    n = snprintf(buf, size - 1, "%s", get_scheme(ep));
     if(n < size - 1) {
       n += uiplib_ipaddr_snprint(&buf[n], size - n - 1, &ep->ipaddr);
     }
@@ -162,6 +172,9 @@ coap_endpoint_copy(coap_endpoint_t *destination,
   uip_ipaddr_copy(&destination->ipaddr, &from->ipaddr);
   destination->port = from->port;
   destination->secure = from->secure;
+#if COAP_WITH_TCP
+  destination->transport = from->transport;
+#endif /* COAP_WITH_TCP */
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -170,6 +183,11 @@ coap_endpoint_cmp(const coap_endpoint_t *e1, const coap_endpoint_t *e2)
   if(!uip_ipaddr_cmp(&e1->ipaddr, &e2->ipaddr)) {
     return 0;
   }
+#if COAP_WITH_TCP
+  if(e1->transport != e2->transport) {
+    return 0;
+  }
+#endif /* COAP_WITH_TCP */
   return e1->port == e2->port && e1->secure == e2->secure;
 }
 /*---------------------------------------------------------------------------*/
@@ -210,12 +228,26 @@ coap_endpoint_parse(const char *text, size_t size, coap_endpoint_t *ep)
   int end = index_of(text, start, size, ']');
   uint32_t port;
 
-  ep->secure = strncmp(text, "coaps:", 6) == 0;
+  ep->secure = strncmp(text, "coaps", 5) == 0;
+#if COAP_WITH_TCP
+  ep->transport = COAP_TRANSPORT_UDP;
+  if(size > 4 + ep->secure && strncmp(text, "coap", 4) == 0) {
+    if(strncmp(&text[4 + ep->secure], "+tcp:", 5) == 0) {
+      ep->transport = COAP_TRANSPORT_TCP;
+    } else if(strncmp(&text[4 + ep->secure], "+ws:", 4) == 0) {
+      ep->transport = COAP_TRANSPORT_WS;
+    }
+  }
+#endif /* COAP_WITH_TCP */
   if(start >= 0 && end > start &&
      uiplib_ipaddrconv(&text[start], &ep->ipaddr)) {
     if(text[end + 1] == ':' &&
        get_port(text + end + 2, size - end - 2, &port)) {
       ep->port = UIP_HTONS(port);
+#if COAP_WITH_TCP
+    } else if(ep->transport == COAP_TRANSPORT_WS) {
+      ep->port = UIP_HTONS(ep->secure ? 443 : 80);
+#endif /* COAP_WITH_TCP */
     } else if(ep->secure) {
       /* Use secure CoAP port by default for secure endpoints. */
       ep->port = SERVER_LISTEN_SECURE_PORT;
@@ -242,6 +274,9 @@ get_src_endpoint(uint8_t secure)
   uip_ipaddr_copy(&src.ipaddr, &UIP_IP_BUF->srcipaddr);
   src.port = UIP_UDP_BUF->srcport;
   src.secure = secure;
+#if COAP_WITH_TCP
+  src.transport = COAP_TRANSPORT_UDP;
+#endif /* COAP_WITH_TCP */
   return &src;
 }
 /*---------------------------------------------------------------------------*/
@@ -252,8 +287,24 @@ coap_endpoint_is_secure(const coap_endpoint_t *ep)
 }
 /*---------------------------------------------------------------------------*/
 int
+coap_endpoint_is_reliable(const coap_endpoint_t *ep)
+{
+#if COAP_WITH_TCP
+  return ep->transport != COAP_TRANSPORT_UDP;
+#else /* COAP_WITH_TCP */
+  return 0;
+#endif /* COAP_WITH_TCP */
+}
+/*---------------------------------------------------------------------------*/
+int
 coap_endpoint_is_connected(const coap_endpoint_t *ep)
 {
+#if COAP_WITH_TCP
+  if(coap_endpoint_is_reliable(ep)) {
+    return coap_tcp_is_connected(ep);
+  }
+#endif /* COAP_WITH_TCP */
+
 #ifndef CONTIKI_TARGET_NATIVE
   if(!uip_is_addr_linklocal(&ep->ipaddr)
      && NETSTACK_ROUTING.node_is_reachable() == 0) {
@@ -294,6 +345,12 @@ coap_endpoint_connect(coap_endpoint_t *ep)
 #endif /* COAP_DTLS_CONF_WITH_CLIENT */
 #endif /* WITH_DTLS */
 
+#if COAP_WITH_TCP
+  if(coap_endpoint_is_reliable(ep)) {
+    return coap_tcp_connect(ep);
+  }
+#endif /* COAP_WITH_TCP */
+
   if(!ep->secure) {
     LOG_DBG("connect to ");
     LOG_DBG_COAP_EP(ep);
@@ -358,6 +415,12 @@ coap_secure_server_setup(void)
 void
 coap_endpoint_disconnect(coap_endpoint_t *ep)
 {
+#if COAP_WITH_TCP
+  if(coap_endpoint_is_reliable(ep)) {
+    coap_tcp_disconnect(ep);
+    return;
+  }
+#endif /* COAP_WITH_TCP */
 #ifdef WITH_DTLS
   coap_ep_dtls_disconnect(ep);
 #endif /* WITH_DTLS */
@@ -373,6 +436,9 @@ void
 coap_transport_init(void)
 {
   process_start(&coap_engine, NULL);
+#if COAP_WITH_TCP
+  coap_tcp_init();
+#endif /* COAP_WITH_TCP */
 #ifdef WITH_DTLS
   coap_dtls_init();
 
@@ -427,6 +493,12 @@ coap_sendto(const coap_endpoint_t *ep, const uint8_t *data, uint16_t length)
     return -1;
   }
 
+#if COAP_WITH_TCP
+  if(coap_endpoint_is_reliable(ep)) {
+    return coap_tcp_sendto(ep, data, length);
+  }
+#endif /* COAP_WITH_TCP */
+
 #ifdef WITH_DTLS
   if(coap_endpoint_is_secure(ep)) {
     int ret;
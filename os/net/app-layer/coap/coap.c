@@ -675,6 +675,10 @@ coap_parse_message(coap_message_t *coap_pkt, uint8_t *data, uint16_t data_len)
       coap_pkt->block2_size = 16 << (coap_pkt->block2_num & 0x07);
       coap_pkt->block2_offset = (coap_pkt->block2_num & ~0x0000000F)
         << (coap_pkt->block2_num & 0x07);
+      if((coap_pkt->block2_num & 0x07) == 7) {
+        /* BERT block numbers count 1024 byte units */
+        coap_pkt->block2_offset >>= 1;
+      }
       coap_pkt->block2_num >>= 4;
       LOG_DBG_("Block2 [%lu%s (%u B/blk)]\n",
                (unsigned long)coap_pkt->block2_num,
@@ -687,6 +691,10 @@ coap_parse_message(coap_message_t *coap_pkt, uint8_t *data, uint16_t data_len)
       coap_pkt->block1_size = 16 << (coap_pkt->block1_num & 0x07);
       coap_pkt->block1_offset = (coap_pkt->block1_num & ~0x0000000F)
         << (coap_pkt->block1_num & 0x07);
+      if((coap_pkt->block1_num & 0x07) == 7) {
+        /* BERT block numbers count 1024 byte units */
+        coap_pkt->block1_offset >>= 1;
+      }
       coap_pkt->block1_num >>= 4;
       LOG_DBG_("Block1 [%lu%s (%u B/blk)]\n",
                (unsigned long)coap_pkt->block1_num,
@@ -1069,6 +1077,18 @@ coap_set_header_block2(coap_message_t *coap_pkt, uint32_t num, uint8_t more,
   return 1;
 }
 /*---------------------------------------------------------------------------*/
+uint32_t
+coap_get_block2_count(const coap_message_t *coap_pkt)
+{
+  /* a BERT block carries several 1024 byte units, each with its number */
+  if(coap_is_option(coap_pkt, COAP_OPTION_BLOCK2)
+     && coap_pkt->block2_size == COAP_BERT_BLOCK_SIZE
+     && coap_pkt->payload_len > COAP_BERT_UNIT) {
+    return coap_pkt->payload_len / COAP_BERT_UNIT;
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
 int
 coap_get_header_block1(const coap_message_t *coap_pkt, uint32_t *num,
                        uint8_t *more, uint16_t *size, uint32_t *offset)
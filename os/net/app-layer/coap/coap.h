@@ -293,6 +293,8 @@ int coap_get_header_block2(const coap_message_t *message, uint32_t *num,
                            uint8_t *more, uint16_t *size, uint32_t *offset);
 int coap_set_header_block2(coap_message_t *message, uint32_t num, uint8_t more,
                            uint16_t size);
+/* Number of block numbers covered by a Block2 response, more than one for BERT */
+uint32_t coap_get_block2_count(const coap_message_t *message);
 
 int coap_get_header_block1(const coap_message_t *message, uint32_t *num,
                            uint8_t *more, uint16_t *size, uint32_t *offset);
@@ -79,6 +79,7 @@ parse_url(const char *url, char *host, uint16_t *portptr, char *path)
   int i;
   const char *file;
   uint16_t port;
+  uint8_t in_brackets;
 
   if(url == NULL) {
     return 0;
@@ -98,12 +99,18 @@ parse_url(const char *url, char *host, uint16_t *portptr, char *path)
     urlptr = url;
   }
 
-  /* Find host part of the URL. */
+  /* Find host part of the URL, IPv6 addresses are within brackets. */
+  in_brackets = 0;
   for(i = 0; i < MAX_HOSTLEN; ++i) {
+    if(*urlptr == '[') {
+      in_brackets = 1;
+    } else if(*urlptr == ']') {
+      in_brackets = 0;
+    }
     if(*urlptr == 0 ||
        *urlptr == '/' ||
        *urlptr == ' ' ||
-       *urlptr == ':') {
+       (*urlptr == ':' && !in_brackets)) {
       if(host != NULL) {
 	host[i] = 0;
       }
@@ -335,12 +335,8 @@ decode_prop_fixed_len_int(struct mqtt_connection *conn,
 
   data_out = (uint32_t *)data;
 
-  for(i = 0; i < 4; i++) {
-    *data_out = *data_out << 8;
-
-    if(i < len) {
-      *data_out += buf_in[i];
-    }
+  for(i = 0; i < len; i++) {
+    *data_out = (*data_out << 8) | buf_in[i];
   }
 
   return len;
@@ -503,6 +499,8 @@ mqtt_get_next_in_prop(struct mqtt_connection *conn,
     return 0;
   }
 
+  /* The decoder adds to the destination */
+  prop_id_decode = 0;
   prop_id_len_bytes =
     mqtt_decode_var_byte_int(conn->in_packet.curr_props_pos,
                              conn->in_packet.properties_len - (conn->in_packet.curr_props_pos - conn->in_packet.props_start),
@@ -562,9 +560,17 @@ mqtt_prop_parse_connack_props(struct mqtt_connection *conn)
       }
       break;
     }
+    case MQTT_VHDR_PROP_RECEIVE_MAX: {
+      memcpy(&val_int, data, sizeof(val_int));
+      /* A Receive Maximum of 0 is a protocol error, ignore it */
+      if(val_int > 0 && val_int < conn->inflight_max) {
+        conn->inflight_max = val_int;
+      }
+      break;
+    }
     default:
-      DBG("MQTT - Error, unexpected CONNACK property '%i'", prop_id);
-      return;
+      DBG("MQTT - Ignoring CONNACK property '%i'\n", prop_id);
+      break;
     }
 
     prop_id = 0;
@@ -108,6 +108,9 @@ void mqtt_prop_parse_auth_props(struct mqtt_connection *conn, struct mqtt_prop_a
 
 void mqtt_prop_decode_input_props(struct mqtt_connection *conn);
 
+uint32_t mqtt_get_next_in_prop(struct mqtt_connection *conn,
+                               mqtt_vhdr_prop_t *prop_id, uint8_t *data);
+
 /* Switch argument order to avoid undefined behavior from having a type
    that undergoes argument promotion immediately before ", ...". */
 #if MQTT_PROP_USE_MEMB
@@ -0,0 +1,338 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden AB
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*---------------------------------------------------------------------------*/
+/**
+ * \addtogroup mqtt-engine
+ * @{
+ *
+ * \file
+ *    Topic filter registry of the MQTT engine
+ */
+/*---------------------------------------------------------------------------*/
+#include "contiki.h"
+#include "lib/memb.h"
+
+#include "mqtt.h"
+#include "mqtt-sub.h"
+#if MQTT_5
+#include "mqtt-prop.h"
+#endif
+
+#include <string.h>
+/*---------------------------------------------------------------------------*/
+MEMB(nodes_mem, struct mqtt_sub_node, MQTT_SUB_MAX_NODES);
+/*---------------------------------------------------------------------------*/
+static const char *
+node_label(struct mqtt_sub_node *node)
+{
+  return node->owner->filter + node->offset;
+}
+/*---------------------------------------------------------------------------*/
+static int
+node_is_wildcard(struct mqtt_sub_node *node, char wildcard)
+{
+  return node->len == 1 && node_label(node)[0] == wildcard;
+}
+/*---------------------------------------------------------------------------*/
+static int
+filter_is_valid(const char *filter)
+{
+  const char *level;
+  size_t len;
+
+  if(filter[0] == '\0' || strlen(filter) > MQTT_TOPIC_MAX_LENGTH) {
+    return 0;
+  }
+
+  for(level = filter;; level += len + 1) {
+    len = strcspn(level, "/");
+    /* Wildcards occupy an entire level and # must be the last one */
+    if(memchr(level, '+', len) != NULL && len != 1) {
+      return 0;
+    }
+    if(memchr(level, '#', len) != NULL && (len != 1 || level[len] != '\0')) {
+      return 0;
+    }
+    if(level[len] == '\0') {
+      return 1;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Frees the unused nodes from node upwards and returns the first used one */
+static struct mqtt_sub_node *
+prune(struct mqtt_connection *conn, struct mqtt_sub_node *node)
+{
+  struct mqtt_sub_node *parent;
+  struct mqtt_sub_node **np;
+
+  while(node != NULL && node->subs == NULL && node->children == NULL) {
+    parent = node->parent;
+    for(np = parent ? &parent->children : &conn->sub_root; *np != node;
+        np = &(*np)->next);
+    *np = node->next;
+    memb_free(&nodes_mem, node);
+    node = parent;
+  }
+  return node;
+}
+/*---------------------------------------------------------------------------*/
+mqtt_status_t
+mqtt_sub_add(struct mqtt_connection *conn, struct mqtt_sub *sub,
+             const char *filter, mqtt_topic_callback_t callback)
+{
+  struct mqtt_sub_node **children;
+  struct mqtt_sub_node *parent;
+  struct mqtt_sub_node *node;
+  const char *level;
+  size_t len;
+  int slot;
+  int i;
+
+  if(sub == NULL || filter == NULL || callback == NULL ||
+     !filter_is_valid(filter)) {
+    return MQTT_STATUS_INVALID_ARGS_ERROR;
+  }
+
+  slot = -1;
+  for(i = MQTT_MAX_SUBSCRIPTIONS - 1; i >= 0; i--) {
+    if(conn->subs[i] == sub) {
+      return MQTT_STATUS_INVALID_ARGS_ERROR;
+    }
+    if(conn->subs[i] == NULL) {
+      slot = i;
+    }
+  }
+  if(slot < 0) {
+    DBG("MQTT - No free subscription slot for '%s'\n", filter);
+    return MQTT_STATUS_ERROR;
+  }
+
+  sub->filter = filter;
+  sub->callback = callback;
+
+  /* Walk down one level at a time, adding the levels that are missing */
+  parent = NULL;
+  children = &conn->sub_root;
+  for(level = filter;; level += len + 1) {
+    len = strcspn(level, "/");
+    for(node = *children; node != NULL; node = node->next) {
+      if(node->len == len && memcmp(node_label(node), level, len) == 0) {
+        break;
+      }
+    }
+    if(node == NULL) {
+      node = memb_alloc(&nodes_mem);
+      if(node == NULL) {
+        DBG("MQTT - Out of topic filter nodes for '%s'\n", filter);
+        prune(conn, parent);
+        return MQTT_STATUS_ERROR;
+      }
+      memset(node, 0, sizeof(*node));
+      node->parent = parent;
+      node->owner = sub;
+      node->offset = level - filter;
+      node->len = len;
+      node->next = *children;
+      *children = node;
+    }
+    if(level[len] == '\0') {
+      break;
+    }
+    parent = node;
+    children = &node->children;
+  }
+
+  sub->next = node->subs;
+  sub->next_match = NULL;
+  sub->node = node;
+  node->subs = sub;
+
+  sub->id = slot + 1;
+  conn->subs[slot] = sub;
+
+  return MQTT_STATUS_OK;
+}
+/*---------------------------------------------------------------------------*/
+void
+mqtt_sub_remove(struct mqtt_connection *conn, struct mqtt_sub *sub)
+{
+  struct mqtt_sub_node *node;
+  struct mqtt_sub_node *n;
+  struct mqtt_sub **sp;
+
+  if(sub == NULL || sub->id < 1 || sub->id > MQTT_MAX_SUBSCRIPTIONS ||
+     conn->subs[sub->id - 1] != sub) {
+    return;
+  }
+  conn->subs[sub->id - 1] = NULL;
+
+  node = sub->node;
+  for(sp = &node->subs; *sp != sub; sp = &(*sp)->next);
+  *sp = sub->next;
+
+  for(sp = &conn->sub_matches; *sp != NULL; sp = &(*sp)->next_match) {
+    if(*sp == sub) {
+      *sp = sub->next_match;
+      break;
+    }
+  }
+
+  /*
+   * Levels shared with other filters may be stored in this one. Any
+   * filter further down has the same levels at the same offsets.
+   */
+  for(node = prune(conn, node); node != NULL; node = node->parent) {
+    if(node->owner == sub) {
+      for(n = node; n->subs == NULL; n = n->children);
+      node->owner = n->subs;
+    }
+  }
+
+  sub->node = NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_match(struct mqtt_connection *conn, struct mqtt_sub *sub)
+{
+  struct mqtt_sub **sp;
+
+  /* A message is passed once to each filter, even if it matches twice */
+  for(sp = &conn->sub_matches; *sp != NULL; sp = &(*sp)->next_match) {
+    if(*sp == sub) {
+      return;
+    }
+  }
+  sub->next_match = NULL;
+  *sp = sub;
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_node_matches(struct mqtt_connection *conn, struct mqtt_sub_node *node)
+{
+  struct mqtt_sub *sub;
+
+  for(sub = node->subs; sub != NULL; sub = sub->next) {
+    add_match(conn, sub);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+match_level(struct mqtt_connection *conn, struct mqtt_sub_node *node,
+            const char *level, int first)
+{
+  struct mqtt_sub_node *child;
+  size_t len;
+  int wildcards;
+
+  len = strcspn(level, "/");
+  /* Wildcards in the first level do not match topics starting with $ */
+  wildcards = !first || level[0] != '$';
+
+  for(; node != NULL; node = node->next) {
+    if(node_is_wildcard(node, '#')) {
+      if(wildcards) {
+        add_node_matches(conn, node);
+      }
+    } else if((wildcards && node_is_wildcard(node, '+')) ||
+              (node->len == len && memcmp(node_label(node), level, len) == 0)) {
+      if(level[len] != '\0') {
+        match_level(conn, node->children, level + len + 1, 0);
+      } else {
+        add_node_matches(conn, node);
+        /* A trailing # also matches the level above it */
+        for(child = node->children; child != NULL; child = child->next) {
+          if(node_is_wildcard(child, '#')) {
+            add_node_matches(conn, child);
+          }
+        }
+      }
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+#if MQTT_5
+static void
+match_sub_ids(struct mqtt_connection *conn)
+{
+  uint8_t data[MQTT_PROP_MAX_PROP_LENGTH];
+  mqtt_vhdr_prop_t prop_id;
+  uint8_t *props_pos;
+  uint16_t id;
+
+  /* Leave the properties unread for the application */
+  props_pos = conn->in_packet.curr_props_pos;
+  while(mqtt_get_next_in_prop(conn, &prop_id, data) > 0) {
+    if(prop_id != MQTT_VHDR_PROP_SUB_ID) {
+      continue;
+    }
+    memcpy(&id, data, sizeof(id));
+    if(id >= 1 && id <= MQTT_MAX_SUBSCRIPTIONS && conn->subs[id - 1] != NULL) {
+      add_match(conn, conn->subs[id - 1]);
+    }
+  }
+  conn->in_packet.curr_props_pos = props_pos;
+}
+#else
+#define match_sub_ids(conn)
+#endif
+/*---------------------------------------------------------------------------*/
+int
+mqtt_sub_dispatch(struct mqtt_connection *conn, struct mqtt_message *msg)
+{
+  struct mqtt_sub *sub;
+  struct mqtt_sub *next;
+  int count;
+
+  if(msg->first_chunk) {
+    conn->sub_matches = NULL;
+    /*
+     * The broker leaves out identifiers for subscriptions that were made
+     * without one, e.g. in an earlier session, so the trie is walked as
+     * well. add_match() drops the duplicates.
+     */
+    match_sub_ids(conn);
+    match_level(conn, conn->sub_root, msg->topic, 1);
+  }
+
+  count = 0;
+  for(sub = conn->sub_matches; sub != NULL; sub = next) {
+    next = sub->next_match;
+    sub->callback(conn, msg);
+    count++;
+  }
+
+  return count;
+}
+/*---------------------------------------------------------------------------*/
+/** @} */
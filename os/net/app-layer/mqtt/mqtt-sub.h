@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden AB
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/*---------------------------------------------------------------------------*/
+/**
+ * \addtogroup mqtt-engine
+ * @{
+ *
+ * \file
+ *    Registry of topic filters that routes incoming PUBLISH messages to
+ *    per-filter callbacks.
+ *
+ * The filters of a connection are kept in a trie with one node per topic
+ * level, so the cost of routing a message depends on the depth of its topic
+ * rather than on the number of subscriptions. In MQTT v5, a message that
+ * carries Subscription Identifiers is passed to those subscriptions and to
+ * any other filter it matches in the trie. Each filter is called at most
+ * once per message.
+ */
+/*---------------------------------------------------------------------------*/
+#ifndef MQTT_SUB_H_
+#define MQTT_SUB_H_
+/*---------------------------------------------------------------------------*/
+#include "mqtt.h"
+/*---------------------------------------------------------------------------*/
+/* Number of trie nodes (topic levels), shared by all connections */
+#ifdef MQTT_SUB_CONF_MAX_NODES
+#define MQTT_SUB_MAX_NODES MQTT_SUB_CONF_MAX_NODES
+#else
+#define MQTT_SUB_MAX_NODES (4 * MQTT_MAX_SUBSCRIPTIONS)
+#endif
+/*---------------------------------------------------------------------------*/
+/* One topic level of a filter */
+struct mqtt_sub_node {
+  /* Next node on the same level */
+  struct mqtt_sub_node *next;
+  struct mqtt_sub_node *parent;
+  struct mqtt_sub_node *children;
+  /* Subscriptions whose filter ends at this node */
+  struct mqtt_sub *subs;
+  /* The level is stored as a range of the filter of a subscription below */
+  struct mqtt_sub *owner;
+  uint8_t offset;
+  uint8_t len;
+};
+
+/* A topic filter and its callback. Owned by the application. */
+struct mqtt_sub {
+  /* Next subscription with the same filter */
+  struct mqtt_sub *next;
+  /* Next subscription matching the PUBLISH being received */
+  struct mqtt_sub *next_match;
+  struct mqtt_sub_node *node;
+  const char *filter;
+  mqtt_topic_callback_t callback;
+  /* Subscription Identifier, 1 to MQTT_MAX_SUBSCRIPTIONS */
+  uint8_t id;
+};
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief Registers a topic filter with a callback.
+ * \param conn A pointer to the MQTT connection.
+ * \param sub A pointer to the subscription to register.
+ * \param filter The topic filter, which may contain the + and # wildcards.
+ *        It must remain valid until the subscription is removed.
+ * \param callback The function to call with matching PUBLISH messages.
+ * \return MQTT_STATUS_OK, MQTT_STATUS_INVALID_ARGS_ERROR for an invalid
+ *         filter or MQTT_STATUS_ERROR when out of slots or trie nodes
+ *
+ * This only updates the local registry, the application still subscribes
+ * to the filter with mqtt_subscribe(). In MQTT v5 it can add the
+ * MQTT_VHDR_PROP_SUB_ID property with the value sub->id to the SUBSCRIBE, so
+ * that the broker tells which subscriptions a message matched. Then either
+ * all registered filters or none should be subscribed with their identifier.
+ *
+ * Incoming PUBLISH messages that match at least one registered filter are
+ * passed to the callbacks of all matching filters, other messages still
+ * generate MQTT_EVENT_PUBLISH. Call this after mqtt_register().
+ */
+mqtt_status_t mqtt_sub_add(struct mqtt_connection *conn,
+                           struct mqtt_sub *sub,
+                           const char *filter,
+                           mqtt_topic_callback_t callback);
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief Removes a topic filter from the registry.
+ * \param conn A pointer to the MQTT connection.
+ * \param sub A pointer to the subscription to remove.
+ *
+ * The application still unsubscribes with mqtt_unsubscribe().
+ */
+void mqtt_sub_remove(struct mqtt_connection *conn, struct mqtt_sub *sub);
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief Passes a chunk of an incoming PUBLISH to the matching filters.
+ * \param conn A pointer to the MQTT connection.
+ * \param msg The incoming message.
+ * \return The number of callbacks called
+ *
+ * The matching filters are looked up with the first chunk of the message
+ * and reused for the following chunks. Called by the MQTT engine.
+ */
+int mqtt_sub_dispatch(struct mqtt_connection *conn, struct mqtt_message *msg);
+/*---------------------------------------------------------------------------*/
+#endif /* MQTT_SUB_H_ */
+/*---------------------------------------------------------------------------*/
+/** @} */
@@ -42,6 +42,7 @@
 /*---------------------------------------------------------------------------*/
 #include "mqtt.h"
 #include "mqtt-prop.h"
+#include "mqtt-sub.h"
 #include "contiki.h"
 #include "contiki-net.h"
 #include "contiki-lib.h"
@@ -58,6 +59,9 @@
 #include "lib/assert.h"
 #include "lib/list.h"
 #include "sys/cc.h"
+#if MQTT_WITH_CFS
+#include "cfs/cfs.h"
+#endif
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -249,12 +253,12 @@ call_event(struct mqtt_connection *conn,
 static void
 reset_defaults(struct mqtt_connection *conn)
 {
-  conn->mid_counter = 1;
   PT_INIT(&conn->out_proto_thread);
   conn->waiting_for_pingresp = 0;
 
   reset_packet(&conn->in_packet);
   conn->out_buffer_sent = 0;
+  conn->out_pending_event = PROCESS_EVENT_NONE;
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -262,9 +266,13 @@ abort_connection(struct mqtt_connection *conn)
 {
   conn->out_buffer_ptr = conn->out_buffer;
   conn->out_queue_full = 0;
+  conn->out_pending_event = PROCESS_EVENT_NONE;
 
   /* Reset outgoing packet */
   memset(&conn->out_packet, 0, sizeof(conn->out_packet));
+#if !MQTT_5
+  ctimer_stop(&conn->inflight_timer);
+#endif
 
   tcp_socket_close(&conn->socket);
   tcp_socket_unregister(&conn->socket);
@@ -350,7 +358,7 @@ write_byte(struct mqtt_connection *conn, uint8_t data)
 }
 /*---------------------------------------------------------------------------*/
 static int
-write_bytes(struct mqtt_connection *conn, uint8_t *data, uint16_t len)
+write_bytes(struct mqtt_connection *conn, uint8_t *data, uint32_t len)
 {
   uint16_t write_bytes;
   write_bytes =
@@ -373,6 +381,26 @@ write_bytes(struct mqtt_connection *conn, uint8_t *data, uint16_t len)
   }
 }
 /*---------------------------------------------------------------------------*/
+/* Reads as much of a streamed payload as fits in the output buffer */
+static int
+read_payload(struct mqtt_connection *conn, struct mqtt_inflight_msg *msg)
+{
+  int len;
+  int read_len;
+
+  len = MIN(&conn->out_buffer[MQTT_TCP_OUTPUT_BUFF_SIZE] - conn->out_buffer_ptr,
+            msg->payload_size - conn->out_write_pos);
+  read_len = msg->reader(conn, msg->reader_ptr, conn->out_write_pos,
+                         conn->out_buffer_ptr, len);
+  if(read_len <= 0 || read_len > len) {
+    return 0;
+  }
+
+  conn->out_write_pos += read_len;
+  conn->out_buffer_ptr += read_len;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
 uint8_t
 mqtt_decode_var_byte_int(const uint8_t *input_data_ptr,
                          int input_data_len,
@@ -461,6 +489,173 @@ reset_packet(struct mqtt_in_packet *packet)
   memset(packet, 0, sizeof(struct mqtt_in_packet));
 }
 /*---------------------------------------------------------------------------*/
+static struct mqtt_inflight_msg *
+inflight_find_free(struct mqtt_connection *conn, mqtt_qos_level_t qos)
+{
+  struct mqtt_inflight_msg *free_msg = NULL;
+  uint16_t pending = 0;
+  int i;
+
+  for(i = 0; i < MQTT_MAX_INFLIGHT; i++) {
+    if(conn->inflight[i].state == MQTT_INFLIGHT_FREE) {
+      if(free_msg == NULL) {
+        free_msg = &conn->inflight[i];
+      }
+    } else if(conn->inflight[i].qos > MQTT_QOS_LEVEL_0) {
+      pending++;
+    }
+  }
+
+  /* Only QoS 1 and 2 messages count against the Receive Maximum */
+  if(qos > MQTT_QOS_LEVEL_0 && pending >= conn->inflight_max) {
+    return NULL;
+  }
+  return free_msg;
+}
+/*---------------------------------------------------------------------------*/
+static void
+update_inflight(struct mqtt_connection *conn)
+{
+  conn->inflight_full = inflight_find_free(conn, MQTT_QOS_LEVEL_1) == NULL;
+}
+/*---------------------------------------------------------------------------*/
+static struct mqtt_inflight_msg *
+inflight_lookup(struct mqtt_connection *conn, uint16_t mid,
+                mqtt_inflight_state_t state)
+{
+  int i;
+
+  for(i = 0; i < MQTT_MAX_INFLIGHT; i++) {
+    if(conn->inflight[i].state == state && conn->inflight[i].mid == mid) {
+      return &conn->inflight[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+inflight_enqueue(struct mqtt_connection *conn, struct mqtt_inflight_msg *msg,
+                 mqtt_inflight_state_t state)
+{
+  msg->state = state;
+  list_add(conn->inflight_queue, msg);
+  process_post(&mqtt_process, mqtt_do_publish_event, conn);
+}
+/*---------------------------------------------------------------------------*/
+static void
+inflight_release(struct mqtt_connection *conn, struct mqtt_inflight_msg *msg)
+{
+  list_remove(conn->inflight_queue, msg);
+  msg->state = MQTT_INFLIGHT_FREE;
+  update_inflight(conn);
+}
+/*---------------------------------------------------------------------------*/
+#if !MQTT_5
+/*
+ * MQTT v3.1 and v3.1.1 let a client retransmit unacknowledged messages with
+ * the DUP flag set. MQTT v5 only allows that when a session is resumed.
+ */
+static void
+inflight_timer_callback(void *ptr)
+{
+  struct mqtt_connection *conn = ptr;
+  struct mqtt_inflight_msg *msg;
+  clock_time_t next = 0;
+  clock_time_t remaining;
+  int i;
+
+  for(i = 0; i < MQTT_MAX_INFLIGHT; i++) {
+    msg = &conn->inflight[i];
+    if(msg->state < MQTT_INFLIGHT_WAIT_PUBACK) {
+      continue;
+    }
+    if(timer_expired(&msg->t)) {
+      DBG("MQTT - Retransmitting mid %u\n", msg->mid);
+      if(msg->state == MQTT_INFLIGHT_WAIT_PUBCOMP) {
+        inflight_enqueue(conn, msg, MQTT_INFLIGHT_SEND_PUBREL);
+      } else {
+        msg->dup = 1;
+        inflight_enqueue(conn, msg, MQTT_INFLIGHT_SEND_PUBLISH);
+      }
+      continue;
+    }
+    remaining = timer_remaining(&msg->t);
+    if(next == 0 || remaining < next) {
+      next = remaining;
+    }
+  }
+
+  if(next > 0) {
+    ctimer_set(&conn->inflight_timer, next, inflight_timer_callback, conn);
+  }
+}
+#endif
+/*---------------------------------------------------------------------------*/
+static void
+inflight_wait_ack(struct mqtt_connection *conn, struct mqtt_inflight_msg *msg,
+                  mqtt_inflight_state_t state)
+{
+  msg->state = state;
+  timer_set(&msg->t, RESPONSE_WAIT_TIMEOUT);
+#if !MQTT_5
+  if(ctimer_expired(&conn->inflight_timer)) {
+    ctimer_set(&conn->inflight_timer, RESPONSE_WAIT_TIMEOUT,
+               inflight_timer_callback, conn);
+  }
+#endif
+}
+/*---------------------------------------------------------------------------*/
+static struct mqtt_inflight_msg *
+inflight_youngest_sent(struct mqtt_connection *conn)
+{
+  struct mqtt_inflight_msg *youngest = NULL;
+  int i;
+
+  /* Message IDs are handed out in increasing order from mid_counter */
+  for(i = 0; i < MQTT_MAX_INFLIGHT; i++) {
+    if(conn->inflight[i].state >= MQTT_INFLIGHT_WAIT_PUBACK &&
+       (youngest == NULL ||
+        (uint16_t)(conn->mid_counter - conn->inflight[i].mid) <
+        (uint16_t)(conn->mid_counter - youngest->mid))) {
+      youngest = &conn->inflight[i];
+    }
+  }
+  return youngest;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Called on CONNACK. Messages that were sent but not acknowledged go first,
+ * oldest first, followed by the messages that were never sent. Without a
+ * session the broker has forgotten them, so they are sent as new messages,
+ * except for QoS 2 messages that got a PUBREC, which the broker already owns.
+ */
+static void
+inflight_resume(struct mqtt_connection *conn, uint8_t session_present)
+{
+  struct mqtt_inflight_msg *msg;
+  uint16_t mid;
+
+  while((msg = inflight_youngest_sent(conn)) != NULL) {
+    if(msg->state != MQTT_INFLIGHT_WAIT_PUBCOMP) {
+      msg->dup = session_present;
+      msg->state = MQTT_INFLIGHT_SEND_PUBLISH;
+      list_push(conn->inflight_queue, msg);
+    } else if(session_present) {
+      msg->state = MQTT_INFLIGHT_SEND_PUBREL;
+      list_push(conn->inflight_queue, msg);
+    } else {
+      mid = msg->mid;
+      inflight_release(conn, msg);
+      call_event(conn, MQTT_EVENT_PUBACK, &mid);
+    }
+  }
+
+  update_inflight(conn);
+  if(list_head(conn->inflight_queue) != NULL) {
+    process_post(&mqtt_process, mqtt_do_publish_event, conn);
+  }
+}
+/*---------------------------------------------------------------------------*/
 #if MQTT_5
 static
 PT_THREAD(write_out_props(struct pt *pt, struct mqtt_connection *conn,
@@ -691,7 +886,7 @@ PT_THREAD(subscribe_pt(struct pt *pt, struct mqtt_connection *conn))
 
 #if MQTT_5
   conn->out_packet.remaining_length +=
-    conn->out_props ? (conn->out_props->properties_len + conn->out_props->properties_len_enc_bytes)
+    conn->out_packet.props ? (conn->out_packet.props->properties_len + conn->out_packet.props->properties_len_enc_bytes)
     : 1;
 #endif
 
@@ -715,7 +910,7 @@ PT_THREAD(subscribe_pt(struct pt *pt, struct mqtt_connection *conn))
 
 #if MQTT_5
   /* Write Properties */
-  write_out_props(pt, conn, conn->out_props);
+  write_out_props(pt, conn, conn->out_packet.props);
 #endif
 
   /* Write Payload */
@@ -772,7 +967,7 @@ PT_THREAD(unsubscribe_pt(struct pt *pt, struct mqtt_connection *conn))
 
 #if MQTT_5
   conn->out_packet.remaining_length +=
-    conn->out_props ? (conn->out_props->properties_len + conn->out_props->properties_len_enc_bytes)
+    conn->out_packet.props ? (conn->out_packet.props->properties_len + conn->out_packet.props->properties_len_enc_bytes)
     : 1;
 #endif
 
@@ -795,7 +990,7 @@ PT_THREAD(unsubscribe_pt(struct pt *pt, struct mqtt_connection *conn))
   PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.mid & 0x00FF));
 #if MQTT_5
   /* Write Properties */
-  write_out_props(pt, conn, conn->out_props);
+  write_out_props(pt, conn, conn->out_packet.props);
 #endif
 
   /* Write Payload */
@@ -828,32 +1023,35 @@ PT_THREAD(unsubscribe_pt(struct pt *pt, struct mqtt_connection *conn))
 }
 /*---------------------------------------------------------------------------*/
 static
-PT_THREAD(publish_pt(struct pt *pt, struct mqtt_connection *conn))
+PT_THREAD(publish_pt(struct pt *pt, struct mqtt_connection *conn,
+                     struct mqtt_inflight_msg *msg))
 {
   PT_BEGIN(pt);
 
   DBG("MQTT - Sending publish message! topic %s topic_length %i\n",
-      conn->out_packet.topic,
-      conn->out_packet.topic_length);
+      msg->topic, msg->topic_length);
   DBG("MQTT - Buffer space is %i \n",
       &conn->out_buffer[MQTT_TCP_OUTPUT_BUFF_SIZE] - conn->out_buffer_ptr);
 
   /* Set up FHDR */
-  conn->out_packet.fhdr = MQTT_FHDR_MSG_TYPE_PUBLISH |
-    conn->out_packet.qos << 1;
-  if(conn->out_packet.retain == MQTT_RETAIN_ON) {
+  conn->out_packet.fhdr = MQTT_FHDR_MSG_TYPE_PUBLISH | msg->qos << 1;
+  if(msg->retain == MQTT_RETAIN_ON) {
     conn->out_packet.fhdr |= MQTT_FHDR_RETAIN_FLAG;
   }
+  /* The DUP flag MUST be set to 0 for all QoS 0 messages */
+  if(msg->dup && msg->qos > MQTT_QOS_LEVEL_0) {
+    conn->out_packet.fhdr |= MQTT_FHDR_DUP_FLAG;
+  }
   conn->out_packet.remaining_length = MQTT_STRING_LEN_SIZE +
-    conn->out_packet.topic_length +
-    conn->out_packet.payload_size;
-  if(conn->out_packet.qos > MQTT_QOS_LEVEL_0) {
+    msg->topic_length + msg->payload_size;
+  if(msg->qos > MQTT_QOS_LEVEL_0) {
     conn->out_packet.remaining_length += MQTT_MID_SIZE;
   }
 
 #if MQTT_5
+  conn->out_packet.topic_alias = msg->topic_alias;
   conn->out_packet.remaining_length +=
-    conn->out_props ? (conn->out_props->properties_len + conn->out_props->properties_len_enc_bytes)
+    msg->props ? (msg->props->properties_len + msg->props->properties_len_enc_bytes)
     : 1;
 #endif
 
@@ -863,72 +1061,85 @@ PT_THREAD(publish_pt(struct pt *pt, struct mqtt_connection *conn))
   if(conn->out_packet.remaining_length_enc_bytes > 4) {
     call_event(conn, MQTT_EVENT_PROTOCOL_ERROR, NULL);
     PRINTF("MQTT - Error, remaining length > 4 bytes\n");
+    msg->state = MQTT_INFLIGHT_FREE;
     PT_EXIT(pt);
   }
 
-  /* The DUP flag MUST be set to 0 for all QoS 0 messages */
-  if(conn->out_packet.qos == MQTT_QOS_LEVEL_0) {
-    conn->out_packet.fhdr &= ~MQTT_FHDR_DUP_FLAG;
-  }
-
   /* Write Fixed Header */
   PT_MQTT_WRITE_BYTE(conn, conn->out_packet.fhdr);
   PT_MQTT_WRITE_BYTES(conn, (uint8_t *)conn->out_packet.remaining_length_enc,
                       conn->out_packet.remaining_length_enc_bytes);
   /* Write Variable Header */
-  PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.topic_length >> 8));
-  PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.topic_length & 0x00FF));
-  PT_MQTT_WRITE_BYTES(conn, (uint8_t *)conn->out_packet.topic,
-                      conn->out_packet.topic_length);
-  if(conn->out_packet.qos > MQTT_QOS_LEVEL_0) {
-    PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.mid >> 8));
-    PT_MQTT_WRITE_BYTE(conn, (conn->out_packet.mid & 0x00FF));
+  PT_MQTT_WRITE_BYTE(conn, (msg->topic_length >> 8));
+  PT_MQTT_WRITE_BYTE(conn, (msg->topic_length & 0x00FF));
+  PT_MQTT_WRITE_BYTES(conn, (uint8_t *)msg->topic, msg->topic_length);
+  if(msg->qos > MQTT_QOS_LEVEL_0) {
+    PT_MQTT_WRITE_BYTE(conn, (msg->mid >> 8));
+    PT_MQTT_WRITE_BYTE(conn, (msg->mid & 0x00FF));
   }
 
 #if MQTT_5
   /* Write Properties */
-  write_out_props(pt, conn, conn->out_props);
+  write_out_props(pt, conn, msg->props);
 #endif
 
   /* Write Payload */
-  PT_MQTT_WRITE_BYTES(conn,
-                      conn->out_packet.payload,
-                      conn->out_packet.payload_size);
-
-  send_out_buffer(conn);
-  timer_set(&conn->t, RESPONSE_WAIT_TIMEOUT);
+  if(msg->reader == NULL) {
+    PT_MQTT_WRITE_BYTES(conn, msg->payload, msg->payload_size);
+  } else {
+    /* The reader fills the output buffer, which is sent whenever it is full */
+    conn->out_write_pos = 0;
+    while(conn->out_write_pos < msg->payload_size) {
+      if(conn->out_buffer_ptr == &conn->out_buffer[MQTT_TCP_OUTPUT_BUFF_SIZE]) {
+        send_out_buffer(conn);
+        PT_WAIT_UNTIL(pt, conn->out_buffer_sent);
+      }
+      if(!read_payload(conn, msg)) {
+        PRINTF("MQTT - Error reading the payload at offset %lu\n",
+               (unsigned long)conn->out_write_pos);
+        msg->state = MQTT_INFLIGHT_FREE;
+        call_event(conn, MQTT_EVENT_ERROR, NULL);
+        abort_connection(conn);
+        PT_EXIT(pt);
+      }
+    }
+  }
 
   /*
-   * If QoS is zero then wait until the message has been sent, since there is
-   * no ACK to wait for.
-   *
-   * Also notify the app will not be notified via PUBACK or PUBCOMP
+   * The message is sent together with the rest of the queue. A QoS 0 message
+   * is done, so notify the app that it can publish again. QoS 1 and 2
+   * messages stay in flight until PUBACK or PUBCOMP.
    */
-  if(conn->out_packet.qos == 0) {
+  if(msg->qos == MQTT_QOS_LEVEL_0) {
+    msg->state = MQTT_INFLIGHT_FREE;
     process_post(conn->app_process, mqtt_update_event, NULL);
-  } else if(conn->out_packet.qos == 1) {
-    /* Wait for PUBACK */
-    reset_packet(&conn->in_packet);
-    PT_WAIT_UNTIL(pt, conn->out_packet.qos_state == MQTT_QOS_STATE_GOT_ACK ||
-                  timer_expired(&conn->t));
-    if(timer_expired(&conn->t)) {
-      DBG("Timeout waiting for PUBACK\n");
-    }
-    if(conn->in_packet.mid != conn->out_packet.mid) {
-      DBG("MQTT - Warning, got PUBACK with none matching MID. Currently there "
-          "is no support for several concurrent PUBLISH messages.\n");
-    }
-  } else if(conn->out_packet.qos == 2) {
-    DBG("MQTT - QoS not implemented yet.\n");
-    /* Should wait for PUBREC, send PUBREL and then wait for PUBCOMP */
+  } else if(msg->qos == MQTT_QOS_LEVEL_1) {
+    inflight_wait_ack(conn, msg, MQTT_INFLIGHT_WAIT_PUBACK);
+  } else {
+    inflight_wait_ack(conn, msg, MQTT_INFLIGHT_WAIT_PUBREC);
   }
 
-  reset_packet(&conn->in_packet);
+  DBG("MQTT - Publish Enqueued\n");
 
-  /* This is clear after the entire transaction is complete */
-  conn->out_queue_full = 0;
+  PT_END(pt);
+}
+/*---------------------------------------------------------------------------*/
+static
+PT_THREAD(pubrel_pt(struct pt *pt, struct mqtt_connection *conn,
+                    struct mqtt_inflight_msg *msg))
+{
+  PT_BEGIN(pt);
 
-  DBG("MQTT - Publish Enqueued\n");
+  DBG("MQTT - Sending PUBREL for mid %u\n", msg->mid);
+
+  /* Write Fixed Header, PUBREL has the reserved flags 0010 */
+  PT_MQTT_WRITE_BYTE(conn, MQTT_FHDR_MSG_TYPE_PUBREL | MQTT_FHDR_QOS_LEVEL_1);
+  PT_MQTT_WRITE_BYTE(conn, MQTT_MID_SIZE);
+  /* Write Variable Header */
+  PT_MQTT_WRITE_BYTE(conn, (msg->mid >> 8));
+  PT_MQTT_WRITE_BYTE(conn, (msg->mid & 0x00FF));
+
+  inflight_wait_ack(conn, msg, MQTT_INFLIGHT_WAIT_PUBCOMP);
 
   PT_END(pt);
 }
@@ -1006,6 +1217,7 @@ static void
 handle_connack(struct mqtt_connection *conn)
 {
   struct mqtt_connack_event connack_event;
+  uint8_t session_present;
 
   DBG("MQTT - Got CONNACK\n");
 
@@ -1035,8 +1247,13 @@ handle_connack(struct mqtt_connection *conn)
 
 #if MQTT_PROTOCOL_VERSION >= MQTT_PROTOCOL_VERSION_3_1_1
   connack_event.session_present = conn->in_packet.payload[0] & MQTT_VHDR_CONNACK_SESSION_PRESENT;
+  session_present = connack_event.session_present;
+#else
+  session_present = !(conn->connect_vhdr_flags & MQTT_VHDR_CLEAN_SESSION_FLAG);
 #endif
 
+  conn->inflight_max = MQTT_MAX_INFLIGHT;
+
 #if MQTT_PROTOCOL_VERSION >= MQTT_PROTOCOL_VERSION_5
   /* The CONNACK VHDR must contain:
    * 0: Connect Acknowledge Flags
@@ -1060,6 +1277,7 @@ handle_connack(struct mqtt_connection *conn)
 
   /* Always reset packet before callback since it might be used directly */
   conn->state = MQTT_CONN_STATE_CONNECTED_TO_BROKER;
+  inflight_resume(conn, session_present);
   call_event(conn, MQTT_EVENT_CONNECTED, &connack_event);
 }
 /*---------------------------------------------------------------------------*/
@@ -1144,10 +1362,56 @@ handle_unsuback(struct mqtt_connection *conn)
 static void
 handle_puback(struct mqtt_connection *conn)
 {
+  struct mqtt_inflight_msg *msg;
+
   DBG("MQTT - Got PUBACK\n");
 
-  conn->out_packet.qos_state = MQTT_QOS_STATE_GOT_ACK;
+  msg = inflight_lookup(conn, conn->in_packet.mid, MQTT_INFLIGHT_WAIT_PUBACK);
+  if(msg == NULL) {
+    DBG("MQTT - Warning, got PUBACK for unknown MID %u\n",
+        conn->in_packet.mid);
+    return;
+  }
+
+  inflight_release(conn, msg);
+  call_event(conn, MQTT_EVENT_PUBACK, &conn->in_packet.mid);
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_pubrec(struct mqtt_connection *conn)
+{
+  struct mqtt_inflight_msg *msg;
+
+  DBG("MQTT - Got PUBREC\n");
+
+  msg = inflight_lookup(conn, conn->in_packet.mid, MQTT_INFLIGHT_WAIT_PUBREC);
+  if(msg == NULL) {
+    DBG("MQTT - Warning, got PUBREC for unknown MID %u\n",
+        conn->in_packet.mid);
+    return;
+  }
+
+  /* The broker owns the message now, the payload is no longer needed */
+  msg->payload = NULL;
+  msg->payload_size = 0;
+  inflight_enqueue(conn, msg, MQTT_INFLIGHT_SEND_PUBREL);
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_pubcomp(struct mqtt_connection *conn)
+{
+  struct mqtt_inflight_msg *msg;
 
+  DBG("MQTT - Got PUBCOMP\n");
+
+  msg = inflight_lookup(conn, conn->in_packet.mid, MQTT_INFLIGHT_WAIT_PUBCOMP);
+  if(msg == NULL) {
+    DBG("MQTT - Warning, got PUBCOMP for unknown MID %u\n",
+        conn->in_packet.mid);
+    return;
+  }
+
+  inflight_release(conn, msg);
   call_event(conn, MQTT_EVENT_PUBACK, &conn->in_packet.mid);
 }
 /*---------------------------------------------------------------------------*/
@@ -1175,7 +1439,10 @@ handle_publish(struct mqtt_connection *conn)
     PRINTF("MQTT - Error, got incoming PUBLISH with QoS > 0, not supported atm!\n");
   }
 
-  call_event(conn, MQTT_EVENT_PUBLISH, &conn->in_publish_msg);
+  /* Messages that match no registered topic filter go to the event callback */
+  if(mqtt_sub_dispatch(conn, &conn->in_publish_msg) == 0) {
+    call_event(conn, MQTT_EVENT_PUBLISH, &conn->in_publish_msg);
+  }
 
   if(conn->in_publish_msg.first_chunk == 1) {
     conn->in_publish_msg.first_chunk = 0;
@@ -1295,6 +1562,8 @@ parse_vhdr(struct mqtt_connection *conn)
   /* Some message types include a packet identifier */
   switch(conn->in_packet.fhdr & 0xF0) {
   case MQTT_FHDR_MSG_TYPE_PUBACK:
+  case MQTT_FHDR_MSG_TYPE_PUBREC:
+  case MQTT_FHDR_MSG_TYPE_PUBCOMP:
   case MQTT_FHDR_MSG_TYPE_SUBACK:
   case MQTT_FHDR_MSG_TYPE_UNSUBACK:
     conn->in_packet.mid = (conn->in_packet.payload[0] << 8) |
@@ -1302,6 +1571,13 @@ parse_vhdr(struct mqtt_connection *conn)
     conn->in_packet.payload_start += 2;
     break;
 
+#if MQTT_5
+  /* The Connect Acknowledge Flags come before the Reason Code */
+  case MQTT_FHDR_MSG_TYPE_CONNACK:
+    conn->in_packet.payload_start += 1;
+    break;
+#endif
+
   /* Other message types have a 0-length VHDR */
   /* PUBLISH has a VHDR for QoS > 0, which is currently unsupported */
   default:
@@ -1337,22 +1613,20 @@ parse_vhdr(struct mqtt_connection *conn)
 #endif
 }
 /*---------------------------------------------------------------------------*/
-static int
-tcp_input(struct tcp_socket *s,
-          void *ptr,
-          const uint8_t *input_data_ptr,
-          int input_data_len)
+/*
+ * Reads at most one packet from the input and returns the number of bytes
+ * consumed, which is all of them if the packet continues in the next segment.
+ */
+static uint32_t
+read_packet(struct mqtt_connection *conn,
+            const uint8_t *input_data_ptr,
+            uint32_t input_data_len)
 {
-  struct mqtt_connection *conn = ptr;
   uint32_t pos = 0;
   uint32_t copy_bytes = 0;
   mqtt_pub_status_t pub_status;
   uint8_t remaining_length_bytes;
 
-  if(input_data_len == 0) {
-    return 0;
-  }
-
   if(conn->in_packet.packet_received) {
     reset_packet(&conn->in_packet);
   }
@@ -1367,20 +1641,23 @@ tcp_input(struct tcp_socket *s,
     DBG("MQTT - Read VHDR '%02X'\n", conn->in_packet.fhdr);
 
     if(pos >= input_data_len) {
-      return 0;
+      return pos;
     }
   }
 
-  /* Read the Remaining Length field, if we do not have it */
+  /*
+   * Read the Remaining Length field, if we do not have it. It is not counted,
+   * so the packet ends when the byte counter reaches
+   * MQTT_FHDR_SIZE + remaining_length.
+   */
   if(!conn->in_packet.has_remaining_length) {
     remaining_length_bytes =
       mqtt_decode_var_byte_int(input_data_ptr, input_data_len, &pos,
-                               &conn->in_packet.byte_counter,
-                               &conn->in_packet.remaining_length);
+                               NULL, &conn->in_packet.remaining_length);
 
     if(remaining_length_bytes == 0) {
       call_event(conn, MQTT_EVENT_ERROR, NULL);
-      return 0;
+      return input_data_len;
     }
 
     DBG("MQTT - Finished reading remaining length byte\n");
@@ -1398,12 +1675,15 @@ tcp_input(struct tcp_socket *s,
 
     PRINTF("MQTT - Error, unsupported payload size for non-PUBLISH message\n");
 
-    conn->in_packet.byte_counter += input_data_len;
+    copy_bytes = MIN(input_data_len - pos,
+                     MQTT_FHDR_SIZE + conn->in_packet.remaining_length -
+                     conn->in_packet.byte_counter);
+    conn->in_packet.byte_counter += copy_bytes;
     if(conn->in_packet.byte_counter >=
        (MQTT_FHDR_SIZE + conn->in_packet.remaining_length)) {
       conn->in_packet.packet_received = 1;
     }
-    return 0;
+    return pos + copy_bytes;
   }
 
   /*
@@ -1420,9 +1700,12 @@ tcp_input(struct tcp_socket *s,
       parse_publish_vhdr(conn, &pos, input_data_ptr, input_data_len);
     }
 
-    /* Read in as much as we can into the packet payload */
+    /* Read in as much of this packet as we can into the packet payload */
     copy_bytes = MIN(input_data_len - pos,
                      MQTT_INPUT_BUFF_SIZE - conn->in_packet.payload_pos);
+    copy_bytes = MIN(copy_bytes,
+                     MQTT_FHDR_SIZE + conn->in_packet.remaining_length -
+                     conn->in_packet.byte_counter);
     DBG("- Copied %i payload bytes\n", copy_bytes);
     memcpy(&conn->in_packet.payload[conn->in_packet.payload_pos],
            &input_data_ptr[pos],
@@ -1448,6 +1731,8 @@ tcp_input(struct tcp_socket *s,
 
 #if MQTT_5
       if(!conn->in_packet.has_props) {
+        /* The properties follow the topic, parse_vhdr() has not run yet */
+        conn->in_packet.payload_start = conn->in_packet.payload;
         mqtt_prop_decode_input_props(conn);
       }
 
@@ -1467,13 +1752,13 @@ tcp_input(struct tcp_socket *s,
       conn->in_packet.payload_pos = 0;
 
       if(pub_status != MQTT_PUBLISH_OK) {
-        return 0;
+        return input_data_len;
       }
     }
 
     if(pos >= input_data_len &&
        (conn->in_packet.byte_counter < (MQTT_FHDR_SIZE + conn->in_packet.remaining_length))) {
-      return 0;
+      return pos;
     }
   }
 
@@ -1496,7 +1781,7 @@ tcp_input(struct tcp_socket *s,
                MQTT_EVENT_ERROR,
                NULL);
     abort_connection(conn);
-    return 0;
+    return input_data_len;
   }
 #endif
 
@@ -1536,10 +1821,15 @@ tcp_input(struct tcp_socket *s,
     handle_pingresp(conn);
     break;
 
-  /* QoS 2 not implemented yet */
   case MQTT_FHDR_MSG_TYPE_PUBREC:
-  case MQTT_FHDR_MSG_TYPE_PUBREL:
+    handle_pubrec(conn);
+    break;
   case MQTT_FHDR_MSG_TYPE_PUBCOMP:
+    handle_pubcomp(conn);
+    break;
+
+  /* QoS 2 not implemented yet for incoming messages */
+  case MQTT_FHDR_MSG_TYPE_PUBREL:
     call_event(conn, MQTT_EVENT_NOT_IMPLEMENTED_ERROR, NULL);
     PRINTF("MQTT - Got unhandled MQTT Message Type '%i'",
            (conn->in_packet.fhdr & 0xF0));
@@ -1563,6 +1853,24 @@ tcp_input(struct tcp_socket *s,
 
   conn->in_packet.packet_received = 1;
 
+  return pos;
+}
+/*---------------------------------------------------------------------------*/
+static int
+tcp_input(struct tcp_socket *s,
+          void *ptr,
+          const uint8_t *input_data_ptr,
+          int input_data_len)
+{
+  struct mqtt_connection *conn = ptr;
+  uint32_t pos = 0;
+
+  /* A segment can hold several packets, e.g. acknowledgements in a row */
+  while(pos < input_data_len &&
+        conn->state > MQTT_CONN_STATE_NOT_CONNECTED) {
+    pos += read_packet(conn, &input_data_ptr[pos], input_data_len - pos);
+  }
+
   return 0;
 }
 /*---------------------------------------------------------------------------*/
@@ -1589,9 +1897,9 @@ tcp_event(struct tcp_socket *s, void *ptr, tcp_socket_event_t event)
     call_event(conn, MQTT_EVENT_DISCONNECTED, &event);
     abort_connection(conn);
 
-    /* If connecting retry */
+    /* If connecting retry, once the abort event has been handled */
     if(conn->auto_reconnect == 1) {
-      connect_tcp(conn);
+      process_post(&mqtt_process, mqtt_do_connect_tcp_event, conn);
     }
     break;
   }
@@ -1608,6 +1916,18 @@ tcp_event(struct tcp_socket *s, void *ptr, tcp_socket_event_t event)
     if(conn->socket.output_data_len == 0) {
       conn->out_buffer_sent = 1;
       conn->out_buffer_ptr = conn->out_buffer;
+
+      /*
+       * Send what was queued while the buffer was in flight. If the queue is
+       * being written, mqtt_process carries on by itself.
+       */
+      if(conn->out_pending_event != PROCESS_EVENT_NONE) {
+        process_post(&mqtt_process, conn->out_pending_event, conn);
+        conn->out_pending_event = PROCESS_EVENT_NONE;
+      }
+      if(!conn->inflight_writing && list_head(conn->inflight_queue) != NULL) {
+        process_post(&mqtt_process, mqtt_do_publish_event, conn);
+      }
     }
 
     ctimer_restart(&conn->keep_alive_timer);
@@ -1624,6 +1944,7 @@ tcp_event(struct tcp_socket *s, void *ptr, tcp_socket_event_t event)
 PROCESS_THREAD(mqtt_process, ev, data)
 {
   static struct mqtt_connection *conn;
+  static struct mqtt_inflight_msg *msg;
 
   PROCESS_BEGIN();
 
@@ -1698,6 +2019,9 @@ PROCESS_THREAD(mqtt_process, ev, data)
               subscribe_pt(&conn->out_proto_thread, conn) < PT_EXITED) {
           PT_MQTT_WAIT_SEND();
         }
+      } else if(conn->state == MQTT_CONN_STATE_CONNECTED_TO_BROKER) {
+        /* Publish messages are in flight, go on once they are sent */
+        conn->out_pending_event = ev;
       }
     }
     if(ev == mqtt_do_unsubscribe_event) {
@@ -1711,6 +2035,9 @@ PROCESS_THREAD(mqtt_process, ev, data)
               unsubscribe_pt(&conn->out_proto_thread, conn) < PT_EXITED) {
           PT_MQTT_WAIT_SEND();
         }
+      } else if(conn->state == MQTT_CONN_STATE_CONNECTED_TO_BROKER) {
+        /* Publish messages are in flight, go on once they are sent */
+        conn->out_pending_event = ev;
       }
     }
     if(ev == mqtt_do_publish_event) {
@@ -1719,10 +2046,32 @@ PROCESS_THREAD(mqtt_process, ev, data)
 
       if(conn->out_buffer_sent == 1 &&
          conn->state == MQTT_CONN_STATE_CONNECTED_TO_BROKER) {
-        PT_INIT(&conn->out_proto_thread);
+        /* Write the whole queue back to back and send it in one go */
+        conn->inflight_writing = 1;
         while(conn->state == MQTT_CONN_STATE_CONNECTED_TO_BROKER &&
-              publish_pt(&conn->out_proto_thread, conn) < PT_EXITED) {
-          PT_MQTT_WAIT_SEND();
+              (msg = list_head(conn->inflight_queue)) != NULL) {
+          PT_INIT(&conn->out_proto_thread);
+          if(msg->state == MQTT_INFLIGHT_SEND_PUBREL) {
+            while(conn->state == MQTT_CONN_STATE_CONNECTED_TO_BROKER &&
+                  pubrel_pt(&conn->out_proto_thread, conn, msg) < PT_EXITED) {
+              PT_MQTT_WAIT_SEND();
+            }
+          } else {
+            while(conn->state == MQTT_CONN_STATE_CONNECTED_TO_BROKER &&
+                  publish_pt(&conn->out_proto_thread, conn, msg) < PT_EXITED) {
+              PT_MQTT_WAIT_SEND();
+            }
+          }
+          /* Keep a partly written message queued if the connection broke */
+          if(msg->state != MQTT_INFLIGHT_SEND_PUBLISH &&
+             msg->state != MQTT_INFLIGHT_SEND_PUBREL) {
+            list_remove(conn->inflight_queue, msg);
+            update_inflight(conn);
+          }
+        }
+        conn->inflight_writing = 0;
+        if(conn->state == MQTT_CONN_STATE_CONNECTED_TO_BROKER) {
+          send_out_buffer(conn);
         }
       }
     }
@@ -1739,7 +2088,9 @@ PROCESS_THREAD(mqtt_process, ev, data)
       }
     }
     /* clear output properties; the next message sent should overwrite them */
-    conn->out_props = NULL;
+    if(conn != NULL) {
+      conn->out_props = NULL;
+    }
 #endif
   }
   PROCESS_END();
@@ -1795,6 +2146,9 @@ mqtt_register(struct mqtt_connection *conn, struct process *app_process,
   conn->app_process = app_process;
   conn->auto_reconnect = 1;
   conn->max_segment_size = max_segment_size;
+  conn->mid_counter = 1;
+  LIST_STRUCT_INIT(conn, inflight_queue);
+  conn->inflight_max = MQTT_MAX_INFLIGHT;
 
   reset_defaults(conn);
 
@@ -1929,7 +2283,7 @@ mqtt_subscribe(struct mqtt_connection *conn, uint16_t *mid, char *topic,
 #endif
 
 #if MQTT_5
-  conn->out_props = prop_list;
+  conn->out_packet.props = prop_list;
 #endif
 
   process_post(&mqtt_process, mqtt_do_subscribe_event, conn);
@@ -1968,7 +2322,7 @@ mqtt_unsubscribe(struct mqtt_connection *conn, uint16_t *mid,
   }
 
 #if MQTT_5
-  conn->out_props = prop_list;
+  conn->out_packet.props = prop_list;
 #endif
 
   process_post(&mqtt_process, mqtt_do_unsubscribe_event, conn);
@@ -1987,56 +2341,106 @@ mqtt_publish(struct mqtt_connection *conn, uint16_t *mid, char *topic,
              mqtt_retain_t retain)
 #endif
 {
+  struct mqtt_inflight_msg *msg;
+
   if(conn->state != MQTT_CONN_STATE_CONNECTED_TO_BROKER) {
     return MQTT_STATUS_NOT_CONNECTED_ERROR;
   }
 
   DBG("MQTT - Call to mqtt_publish...\n");
 
-  /* Currently don't have a queue, so only one item at a time */
-  if(conn->out_queue_full) {
+  msg = inflight_find_free(conn, qos_level);
+  if(msg == NULL) {
     DBG("MQTT - Not accepted!\n");
     return MQTT_STATUS_OUT_QUEUE_FULL;
   }
-  conn->out_queue_full = 1;
   DBG("MQTT - Accepted!\n");
 
-  conn->out_packet.mid = INCREMENT_MID(conn);
-  conn->out_packet.retain = retain;
+  msg->mid = INCREMENT_MID(conn);
+  msg->retain = retain;
 #if MQTT_5
   if(topic_alias_en == MQTT_TOPIC_ALIAS_ON) {
-    conn->out_packet.topic = "";
-    conn->out_packet.topic_length = 0;
-    conn->out_packet.topic_alias = topic_alias;
+    msg->topic = "";
+    msg->topic_length = 0;
+    msg->topic_alias = topic_alias;
     if(topic_alias == 0) {
       DBG("MQTT - Error, a topic alias of 0 is not permitted! It won't be sent.\n");
     }
   } else {
-    conn->out_packet.topic = topic;
-    conn->out_packet.topic_length = strlen(topic);
-    conn->out_packet.topic_alias = 0;
+    msg->topic = topic;
+    msg->topic_length = strlen(topic);
+    msg->topic_alias = 0;
   }
+  msg->props = prop_list;
 #else
-  conn->out_packet.topic = topic;
-  conn->out_packet.topic_length = strlen(topic);
+  msg->topic = topic;
+  msg->topic_length = strlen(topic);
 #endif
-  conn->out_packet.payload = payload;
-  conn->out_packet.payload_size = payload_size;
-  conn->out_packet.qos = qos_level;
-  conn->out_packet.qos_state = MQTT_QOS_STATE_NO_ACK;
+  msg->payload = payload;
+  msg->reader = NULL;
+  msg->payload_size = payload_size;
+  msg->qos = qos_level;
+  msg->dup = 0;
 
   if(mid) {
-    *mid = conn->out_packet.mid;
+    *mid = msg->mid;
   }
 
+  inflight_enqueue(conn, msg, MQTT_INFLIGHT_SEND_PUBLISH);
+  update_inflight(conn);
+  return MQTT_STATUS_OK;
+}
+/*----------------------------------------------------------------------------*/
+mqtt_status_t
+mqtt_publish_stream(struct mqtt_connection *conn, uint16_t *mid, char *topic,
+                    mqtt_payload_reader_t reader, void *reader_ptr,
+                    uint32_t payload_size, mqtt_qos_level_t qos_level,
 #if MQTT_5
-  conn->out_props = prop_list;
+                    mqtt_retain_t retain,
+                    uint8_t topic_alias, mqtt_topic_alias_en_t topic_alias_en,
+                    struct mqtt_prop_list *prop_list)
+#else
+                    mqtt_retain_t retain)
 #endif
+{
+  struct mqtt_inflight_msg *msg;
+  mqtt_status_t status;
 
-  process_post(&mqtt_process, mqtt_do_publish_event, conn);
-  return MQTT_STATUS_OK;
+  if(reader == NULL) {
+    return MQTT_STATUS_INVALID_ARGS_ERROR;
+  }
+
+#if MQTT_5
+  status = mqtt_publish(conn, mid, topic, NULL, payload_size, qos_level,
+                        retain, topic_alias, topic_alias_en, prop_list);
+#else
+  status = mqtt_publish(conn, mid, topic, NULL, payload_size, qos_level,
+                        retain);
+#endif
+
+  if(status == MQTT_STATUS_OK) {
+    /* Queued last, the process writes it once this function has returned */
+    msg = list_tail(conn->inflight_queue);
+    msg->reader = reader;
+    msg->reader_ptr = reader_ptr;
+  }
+  return status;
 }
 /*----------------------------------------------------------------------------*/
+#if MQTT_WITH_CFS
+int
+mqtt_cfs_reader(struct mqtt_connection *m, void *ptr, uint32_t offset,
+                uint8_t *buf, uint16_t len)
+{
+  int fd = *(int *)ptr;
+
+  if(cfs_seek(fd, offset, CFS_SEEK_SET) != (cfs_offset_t)offset) {
+    return -1;
+  }
+  return cfs_read(fd, buf, len);
+}
+#endif
+/*----------------------------------------------------------------------------*/
 void
 mqtt_set_username_password(struct mqtt_connection *conn, char *username,
                            char *password)
@@ -35,7 +35,9 @@
  * \defgroup mqtt-engine An implementation of MQTT v3.1
  * @{
  *
- * This application is an engine for MQTT v3.1. It supports QoS Levels 0 and 1.
+ * This application is an engine for MQTT v3.1. It supports QoS Levels 0 and 1
+ * for incoming messages and 0, 1 and 2 for outgoing messages, with up to
+ * MQTT_MAX_INFLIGHT outgoing messages in flight.
  *
  * MQTT is a Client Server publish/subscribe messaging transport protocol.
  * It is light weight, open, simple, and designed so as to be easy to implement.
@@ -61,7 +63,7 @@
  *  -- "Exactly once" (2), where message are assured to arrive exactly once.
  *  This level could be used, for example, with billing systems where duplicate
  *  or lost messages could lead to incorrect charges being applied. This QoS
- *  level is currently not supported in this implementation.
+ *  level is currently only supported for outgoing messages.
  *
  * - A small transport overhead and protocol exchanges minimized to reduce
  *   network traffic.
@@ -123,7 +125,18 @@
 
 /* Size of the underlying TCP buffers */
 #define MQTT_TCP_INPUT_BUFF_SIZE 512
+
+/*
+ * Outgoing packets are written to this buffer and sent from it, one segment
+ * of at most this size per round trip. Payloads streamed with
+ * mqtt_publish_stream() are read straight into it, so a buffer of a full
+ * TCP segment speeds up large publishes.
+ */
+#ifdef MQTT_CONF_TCP_OUTPUT_BUFF_SIZE
+#define MQTT_TCP_OUTPUT_BUFF_SIZE MQTT_CONF_TCP_OUTPUT_BUFF_SIZE
+#else
 #define MQTT_TCP_OUTPUT_BUFF_SIZE 512
+#endif
 
 #define MQTT_INPUT_BUFF_SIZE 512
 #define MQTT_MAX_TOPIC_LENGTH 64
@@ -139,6 +152,37 @@
 
 #define MQTT_TOPIC_MAX_LENGTH 128
 
+/*
+ * Number of PUBLISH messages that can be queued or await acknowledgement at
+ * the same time. With more than one, QoS 1 and 2 messages are pipelined, and
+ * the topic, payload and properties passed to mqtt_publish() must remain
+ * valid until the message is acknowledged with MQTT_EVENT_PUBACK. In MQTT
+ * v5 the window is also limited by the Receive Maximum of the broker.
+ */
+#ifdef MQTT_CONF_MAX_INFLIGHT
+#define MQTT_MAX_INFLIGHT MQTT_CONF_MAX_INFLIGHT
+#else
+#define MQTT_MAX_INFLIGHT 1
+#endif
+
+/*
+ * Number of topic filters that can be registered per connection with
+ * mqtt_sub_add(). The slot number is also the MQTT v5 Subscription
+ * Identifier of the filter.
+ */
+#ifdef MQTT_CONF_MAX_SUBSCRIPTIONS
+#define MQTT_MAX_SUBSCRIPTIONS MQTT_CONF_MAX_SUBSCRIPTIONS
+#else
+#define MQTT_MAX_SUBSCRIPTIONS 4
+#endif
+
+/* Provide mqtt_cfs_reader() to stream payloads from CFS files */
+#ifdef MQTT_CONF_WITH_CFS
+#define MQTT_WITH_CFS MQTT_CONF_WITH_CFS
+#else
+#define MQTT_WITH_CFS 0
+#endif
+
 #if MQTT_PROTOCOL_VERSION >= MQTT_PROTOCOL_VERSION_3_1_1
 #ifdef MQTT_CONF_SUPPORTS_EMPTY_CLIENT_ID
 #define MQTT_SRV_SUPPORTS_EMPTY_CLIENT_ID MQTT_CONF_SUPPORTS_EMPTY_CLIENT_ID
@@ -201,6 +245,9 @@ extern process_event_t mqtt_update_event;
 struct mqtt_connection;
 /* Only defined in MQTTv5 */
 struct mqtt_prop_list;
+/* Defined in mqtt-sub.h */
+struct mqtt_sub;
+struct mqtt_sub_node;
 
 typedef enum {
   MQTT_RETAIN_OFF,
@@ -264,6 +311,17 @@ typedef enum {
   MQTT_PUBLISH_OK,
   MQTT_PUBLISH_ERR,
 } mqtt_pub_status_t;
+
+typedef enum {
+  MQTT_INFLIGHT_FREE,
+  /* Queued for sending */
+  MQTT_INFLIGHT_SEND_PUBLISH,
+  MQTT_INFLIGHT_SEND_PUBREL,
+  /* Sent, waiting for the broker */
+  MQTT_INFLIGHT_WAIT_PUBACK,
+  MQTT_INFLIGHT_WAIT_PUBREC,
+  MQTT_INFLIGHT_WAIT_PUBCOMP,
+} mqtt_inflight_state_t;
 /*---------------------------------------------------------------------------*/
 /*
  * This is the state of the connection itself.
@@ -483,6 +541,50 @@ struct mqtt_out_packet {
   uint8_t sub_options;
   /* Continue Auth or Re-auth */
   uint8_t auth_reason_code;
+  /* Properties of a SUBSCRIBE or UNSUBSCRIBE, kept until it is sent */
+  struct mqtt_prop_list *props;
+#endif
+};
+
+/**
+ * \brief           Payload reader for mqtt_publish_stream()
+ * \param m         A pointer to a MQTT connection
+ * \param ptr       The pointer passed to mqtt_publish_stream()
+ * \param offset    Offset in the payload of the first byte to read
+ * \param buf       Where to put the bytes, in the TCP output buffer
+ * \param len       The number of bytes to read
+ * \return          The number of bytes read, at least 1, or -1 on error
+ *
+ * The payload is read in order, but a QoS 1 or 2 message is read again
+ * from the start when it has to be resent.
+ */
+typedef int (*mqtt_payload_reader_t)(struct mqtt_connection *m,
+                                     void *ptr,
+                                     uint32_t offset,
+                                     uint8_t *buf,
+                                     uint16_t len);
+
+/* An outgoing PUBLISH, from mqtt_publish() until it has been acknowledged. */
+struct mqtt_inflight_msg {
+  /* Used by the list interface, must be first in the struct. */
+  struct mqtt_inflight_msg *next;
+  /* Retransmission timer (MQTT v3.1 and v3.1.1) */
+  struct timer t;
+  char *topic;
+  uint8_t *payload;
+  /* Streamed payload, see mqtt_publish_stream() */
+  mqtt_payload_reader_t reader;
+  void *reader_ptr;
+  uint32_t payload_size;
+  uint16_t mid;
+  uint16_t topic_length;
+  uint8_t qos;
+  uint8_t retain;
+  uint8_t state;
+  uint8_t dup;
+#if MQTT_5
+  uint8_t topic_alias;
+  struct mqtt_prop_list *props;
 #endif
 };
 /*---------------------------------------------------------------------------*/
@@ -500,6 +602,14 @@ typedef void (*mqtt_event_callback_t)(struct mqtt_connection *m,
                                       mqtt_event_t event,
                                       void *data);
 
+/**
+ * \brief           MQTT topic callback function
+ * \param m         A pointer to a MQTT connection
+ * \param msg       The incoming PUBLISH message
+ *
+ * The topic callback function gets called for each payload chunk of an
+ * incoming PUBLISH that matches a topic filter registered with mqtt_sub_add().
+ */
 typedef void (*mqtt_topic_callback_t)(struct mqtt_connection *m,
                                       struct mqtt_message *msg);
 /*---------------------------------------------------------------------------*/
@@ -548,16 +658,34 @@ struct mqtt_connection {
   uint8_t *out_buffer_ptr;
   uint8_t out_buffer[MQTT_TCP_OUTPUT_BUFF_SIZE];
   uint8_t out_buffer_sent;
+  /* The (un)subscribe event deferred until the buffer in flight is sent */
+  process_event_t out_pending_event;
   struct mqtt_out_packet out_packet;
   struct pt out_proto_thread;
   uint32_t out_write_pos;
   uint16_t max_segment_size;
 
+  /* PUBLISH messages, queued ones in order of sending */
+  struct mqtt_inflight_msg inflight[MQTT_MAX_INFLIGHT];
+  LIST_STRUCT(inflight_queue);
+  uint16_t inflight_max;
+  uint8_t inflight_full;
+  /* Set while mqtt_process writes the queue */
+  uint8_t inflight_writing;
+#if !MQTT_5
+  struct ctimer inflight_timer;
+#endif
+
   /* Incoming data related */
   uint8_t in_buffer[MQTT_TCP_INPUT_BUFF_SIZE];
   struct mqtt_in_packet in_packet;
   struct mqtt_message in_publish_msg;
 
+  /* Registered topic filters, see mqtt-sub.h */
+  struct mqtt_sub_node *sub_root;
+  struct mqtt_sub *subs[MQTT_MAX_SUBSCRIPTIONS];
+  struct mqtt_sub *sub_matches;
+
   /* TCP related information */
   char *server_host;
   uip_ipaddr_t server_ip;
@@ -686,7 +814,7 @@ mqtt_status_t mqtt_unsubscribe(struct mqtt_connection *conn,
  * \param topic A pointer to the topic to subscribe to.
  * \param payload A pointer to the topic payload.
  * \param payload_size Payload size.
- * \param qos_level Quality Of Service level to use. Currently supports 0, 1.
+ * \param qos_level Quality Of Service level to use: 0, 1 or 2.
  * \param retain If the RETAIN flag is set to 1, in a PUBLISH Packet sent by a
  *        Client to a Server, the Server MUST store the Application Message
  *        and its QoS, so that it can be delivered to future subscribers whose
@@ -697,7 +825,11 @@ mqtt_status_t mqtt_unsubscribe(struct mqtt_connection *conn,
  * \param prop_list Output properties (MQTTv5-only).
  * \return MQTT_STATUS_OK or some error status
  *
- * This function publishes to a topic on a MQTT broker.
+ * This function publishes to a topic on a MQTT broker. The message is queued
+ * and MQTT_STATUS_OUT_QUEUE_FULL is returned when MQTT_MAX_INFLIGHT messages
+ * are already queued or unacknowledged. MQTT_EVENT_PUBACK reports the
+ * message ID when a QoS 1 message gets its PUBACK or a QoS 2 message gets
+ * its PUBCOMP, in whatever order the broker sends them.
  */
 mqtt_status_t mqtt_publish(struct mqtt_connection *conn,
                            uint16_t *mid,
@@ -714,6 +846,63 @@ mqtt_status_t mqtt_publish(struct mqtt_connection *conn,
                            mqtt_retain_t retain);
 #endif
 /*---------------------------------------------------------------------------*/
+/**
+ * \brief Publish a payload that is read while it is being sent.
+ * \param conn A pointer to the MQTT connection.
+ * \param mid A pointer to message ID.
+ * \param topic A pointer to the topic to publish to.
+ * \param reader The function that reads the payload.
+ * \param reader_ptr A user-defined pointer that is passed to the reader.
+ * \param payload_size Payload size, up to 268435455 bytes minus headers.
+ * \param qos_level Quality Of Service level to use: 0, 1 or 2.
+ * \param retain The RETAIN flag, see mqtt_publish().
+ * \param topic_alias Topic alias to send (MQTTv5-only).
+ * \param topic_alias_en Control whether or not to discard topic and only send
+ *        topic alias s(MQTTv5-only).
+ * \param prop_list Output properties (MQTTv5-only).
+ * \return MQTT_STATUS_OK or some error status
+ *
+ * This function works like mqtt_publish(), but the payload does not have to
+ * be in memory. The reader is called to fill the free space of the TCP
+ * output buffer, which is sent when it is full, so the payload is not copied
+ * on its way to the socket. The reader must be able to provide the payload
+ * until the message is acknowledged. If the reader fails, the connection is
+ * aborted with MQTT_EVENT_ERROR, since the packet cannot be completed.
+ */
+mqtt_status_t mqtt_publish_stream(struct mqtt_connection *conn,
+                                  uint16_t *mid,
+                                  char *topic,
+                                  mqtt_payload_reader_t reader,
+                                  void *reader_ptr,
+                                  uint32_t payload_size,
+                                  mqtt_qos_level_t qos_level,
+#if MQTT_5
+                                  mqtt_retain_t retain,
+                                  uint8_t topic_alias,
+                                  mqtt_topic_alias_en_t topic_alias_en,
+                                  struct mqtt_prop_list *prop_list);
+#else
+                                  mqtt_retain_t retain);
+#endif
+/*---------------------------------------------------------------------------*/
+#if MQTT_WITH_CFS
+/**
+ * \brief Payload reader for CFS files.
+ * \param m A pointer to the MQTT connection.
+ * \param ptr A pointer to the int file descriptor, opened for reading.
+ * \param offset Offset in the file.
+ * \param buf Where to put the bytes.
+ * \param len The number of bytes to read.
+ * \return The number of bytes read or -1 on error
+ *
+ * Pass this to mqtt_publish_stream() to publish the contents of a file. The
+ * file must stay open until the message has been sent, or acknowledged with
+ * QoS 1 and 2.
+ */
+int mqtt_cfs_reader(struct mqtt_connection *m, void *ptr, uint32_t offset,
+                    uint8_t *buf, uint16_t len);
+#endif
+/*---------------------------------------------------------------------------*/
 /**
  * \brief Set the user name and password for a MQTT client.
  * \param conn A pointer to the MQTT connection.
@@ -759,7 +948,7 @@ void mqtt_set_last_will(struct mqtt_connection *conn,
   ((conn)->state == MQTT_CONN_STATE_CONNECTED_TO_BROKER ? 1 : 0)
 
 #define mqtt_ready(conn) \
-  (!(conn)->out_queue_full && mqtt_connected((conn)))
+  (!(conn)->out_queue_full && !(conn)->inflight_full && mqtt_connected((conn)))
 /*---------------------------------------------------------------------------*/
 void mqtt_encode_var_byte_int(uint8_t *vbi_out,
                               uint8_t *vbi_bytes,
@@ -184,6 +184,8 @@ icmp_output()
 static void
 icmp_input()
 {
+  uip_mcast6_route_t *route;
+
 #if UIP_CONF_IPV6_CHECKS
   if(UIP_ICMP_BUF->icode != ESMRF_ICMP_CODE) {
     PRINTF("ESMRF: ICMPv6 In, bad ICMP code\n");
@@ -245,10 +247,16 @@ icmp_input()
   UIP_UDP_BUF->udpchksum = 0;
   /* If we have an entry in the multicast routing table, something with
    * a higher RPL rank (somewhere down the tree) is a group member */
-  if(uip_mcast6_route_lookup(&UIP_IP_BUF->destipaddr)) {
-    PRINTF("ESMRF: Forward this packet\n");
-    /* If we enter here, we will definitely forward */
-    tcpip_ipv6_output();
+  route = uip_mcast6_route_lookup(&UIP_IP_BUF->destipaddr);
+  if(route != NULL) {
+    UIP_MCAST6_ROUTE_STATS_ADD(route, in);
+    if(uip_mcast6_route_rate_allow(route)) {
+      PRINTF("ESMRF: Forward this packet\n");
+      UIP_MCAST6_ROUTE_STATS_ADD(route, fwd);
+      tcpip_ipv6_output();
+    } else {
+      PRINTF("ESMRF: Group over its rate limit, not forwarding\n");
+    }
   }
   uipbuf_clear();
 }
@@ -269,6 +277,7 @@ in()
   rpl_dag_t *d;                 /* Our DODAG */
   uip_ipaddr_t *parent_ipaddr;  /* Our pref. parent's IPv6 address */
   const uip_lladdr_t *parent_lladdr;  /* Our pref. parent's LL address */
+  uip_mcast6_route_t *route;   /* Route to the destination group */
 
   /*
    * Fetch a pointer to the LL address of our preferred parent
@@ -317,9 +326,15 @@ in()
 
   /* If we have an entry in the mcast routing table, something with
    * a higher RPL rank (somewhere down the tree) is a group member */
-  if(uip_mcast6_route_lookup(&UIP_IP_BUF->destipaddr)) {
+  route = uip_mcast6_route_lookup(&UIP_IP_BUF->destipaddr);
+  if(route != NULL) {
+    UIP_MCAST6_ROUTE_STATS_ADD(route, in);
+  }
+
+  if(route != NULL && uip_mcast6_route_rate_allow(route)) {
     /* If we enter here, we will definitely forward */
     UIP_MCAST6_STATS_ADD(mcast_fwd);
+    UIP_MCAST6_ROUTE_STATS_ADD(route, fwd);
 
     /*
      * Add a delay (D) of at least ESMRF_FWD_DELAY() to compensate for how
@@ -356,6 +371,8 @@ in()
     }
     PRINTF("ESMRF: %u bytes: fwd in %u [%u]\n",
            uip_len, fwd_delay, fwd_spread);
+  } else if(route != NULL) {
+    PRINTF("ESMRF: Group over its rate limit, not forwarding\n");
   } else {
     PRINTF("ESMRF: Group unknown, dropping\n");
   }
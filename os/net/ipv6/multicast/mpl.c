@@ -151,6 +151,8 @@ typedef struct seed_id_s {
  */
 struct mpl_msg {
   struct mpl_msg *next; /* Next message in the set, or NULL if this is largest */
+  struct mpl_msg *lru_prev; /* Previous (older) message in reception order */
+  struct mpl_msg *lru_next; /* Next (newer) message in reception order */
   struct mpl_seed *seed; /* The seed set this message belongs to */
   struct trickle_timer tt; /* The trickle timer associated with this msg */
   uip_ip6addr_t srcipaddr; /* The original ip this message was sent from */
@@ -202,10 +204,12 @@ struct mpl_msg {
 /*---------------------------------------------------------------------------*/
 /* Seed Set */
 struct mpl_seed {
+  struct mpl_seed *hash_next; /* Next seed in the same hash bucket */
   seed_id_t seed_id;
   uint8_t min_seqno; /* Used when the seed set is empty */
   uint8_t lifetime; /* Decrements by one every minute */
-  uint8_t count; /* Only used for determining largest msg set during reclaim */
+  uint8_t count; /* Number of buffered messages */
+  uint8_t seq_map[32]; /* Bit per sequence number: is this msg buffered? */
   LIST_STRUCT(min_seq); /* Pointer to the first msg in this seed's set */
   struct mpl_domain *domain; /* The domain this seed belongs to */
 };
@@ -219,9 +223,18 @@ struct mpl_seed {
  * h: pointer to the message set entry
  */
 #define SEED_SET_CLEAR_USED(h) ((h)->domain = NULL)
+/**
+ * \brief Check whether a seed has a message with sequence number q buffered
+ * h: pointer to the seed set entry
+ * q: sequence number
+ */
+#define SEED_SET_HAS_SEQ(h, q) (((h)->seq_map[(q) >> 3] & (1 << ((q) & 7))) != 0)
+#define SEED_SET_ADD_SEQ(h, q) ((h)->seq_map[(q) >> 3] |= (1 << ((q) & 7)))
+#define SEED_SET_REMOVE_SEQ(h, q) ((h)->seq_map[(q) >> 3] &= ~(1 << ((q) & 7)))
 /*---------------------------------------------------------------------------*/
 /* Domain Set */
 struct mpl_domain {
+  struct mpl_domain *hash_next; /* Next domain in the same hash bucket */
   uip_ip6addr_t data_addr; /* Data address for this MPL domain */
   uip_ip6addr_t ctrl_addr; /* Link-local scoped version of data address */
   struct trickle_timer tt;
@@ -399,6 +412,11 @@ static struct mpl_stats stats;
 static struct mpl_msg buffered_message_set[MPL_BUFFERED_MESSAGE_SET_SIZE];
 static struct mpl_seed seed_set[MPL_SEED_SET_SIZE];
 static struct mpl_domain domain_set[MPL_DOMAIN_SET_SIZE];
+static struct mpl_seed *seed_hash[MPL_SEED_SET_HASH_SIZE];
+static struct mpl_domain *domain_hash[MPL_DOMAIN_SET_HASH_SIZE];
+/* Buffered messages, oldest first, for reclaiming */
+static struct mpl_msg *lru_head;
+static struct mpl_msg *lru_tail;
 static uint16_t last_seq;
 static seed_id_t local_seed_id;
 #if MPL_SUB_TO_ALL_FORWARDERS
@@ -466,6 +484,38 @@ extern uint16_t uip_slen;
 static void icmp_in(void);
 UIP_ICMP6_HANDLER(mpl_icmp_handler, ICMP6_MPL, 0, icmp_in);
 
+static void
+lru_append(struct mpl_msg *msg)
+{
+  msg->lru_next = NULL;
+  msg->lru_prev = lru_tail;
+  if(lru_tail != NULL) {
+    lru_tail->lru_next = msg;
+  } else {
+    lru_head = msg;
+  }
+  lru_tail = msg;
+}
+static void
+lru_remove(struct mpl_msg *msg)
+{
+  if(msg->lru_prev == NULL && lru_head != msg) {
+    /* Not linked */
+    return;
+  }
+  if(msg->lru_prev != NULL) {
+    msg->lru_prev->lru_next = msg->lru_next;
+  } else {
+    lru_head = msg->lru_next;
+  }
+  if(msg->lru_next != NULL) {
+    msg->lru_next->lru_prev = msg->lru_prev;
+  } else {
+    lru_tail = msg->lru_prev;
+  }
+  msg->lru_prev = NULL;
+  msg->lru_next = NULL;
+}
 static struct mpl_msg *
 buffer_allocate(void)
 {
@@ -483,23 +533,25 @@ buffer_free(struct mpl_msg *msg)
   if(trickle_timer_is_running(&msg->tt)) {
     trickle_timer_stop(&msg->tt);
   }
+  lru_remove(msg);
   MSG_SET_CLEAR_USED(msg);
 }
 static struct mpl_msg *
 buffer_reclaim(void)
 {
-  static struct mpl_seed *ssptr; /* Can't use locssptr since it's used by calling function */
-  static struct mpl_seed *largest;
+  static struct mpl_seed *victim;
   static struct mpl_msg *reclaim;
 
-  /* Reclaim the message with min_seq in the largest seed set */
-  largest = NULL;
-  reclaim = NULL;
-  for(ssptr = &seed_set[MPL_SEED_SET_SIZE]; ssptr >= seed_set; ssptr--) {
-    if(SEED_SET_IS_USED(ssptr) && (largest == NULL || ssptr->count > largest->count)) {
-      largest = ssptr;
-    }
+  /*
+   * Reclaim the message with min_seq in the seed set which owns the oldest
+   * buffered message. Taking the oldest message itself could leave a hole
+   * above min_seqno, and we would accept that message again if we heard it.
+   */
+  if(lru_head == NULL) {
+    return NULL;
   }
+  victim = lru_head->seed;
+
   /**
    * To reclaim this, we need to increment the min seq number to
    *   the next largest sequence number in the set.
@@ -508,16 +560,86 @@ buffer_reclaim(void)
    *   order messages are sent.
    * We've already worked out what this new value is.
    */
-  if(largest != NULL) {
-    reclaim = list_pop(largest->min_seq);
-    largest->min_seqno = list_item_next(reclaim) == NULL ? reclaim->seq : ((struct mpl_msg *)list_item_next(reclaim))->seq;
-    largest->count--;
-    trickle_timer_stop(&reclaim->tt);
-    mpl_trickle_timer_reset(reclaim->seed->domain);
-    memset(reclaim, 0, sizeof(struct mpl_msg));
-  }
+  reclaim = list_pop(victim->min_seq);
+  victim->min_seqno = list_item_next(reclaim) == NULL ? reclaim->seq : ((struct mpl_msg *)list_item_next(reclaim))->seq;
+  victim->count--;
+  SEED_SET_REMOVE_SEQ(victim, reclaim->seq);
+  lru_remove(reclaim);
+  trickle_timer_stop(&reclaim->tt);
+  mpl_trickle_timer_reset(reclaim->seed->domain);
+  memset(reclaim, 0, sizeof(struct mpl_msg));
   return reclaim;
 }
+static uint8_t
+seed_hash_index(seed_id_t *seed_id, struct mpl_domain *domain)
+{
+  uint8_t i;
+  uint16_t h = domain - domain_set;
+
+  for(i = 0; i < sizeof(seed_id->id); i++) {
+    h = (h << 3) + (h >> 13) + seed_id->id[i];
+  }
+  return h % MPL_SEED_SET_HASH_SIZE;
+}
+static void
+seed_hash_add(struct mpl_seed *s)
+{
+  uint8_t i = seed_hash_index(&s->seed_id, s->domain);
+
+  s->hash_next = seed_hash[i];
+  seed_hash[i] = s;
+}
+static void
+seed_hash_remove(struct mpl_seed *s)
+{
+  struct mpl_seed **pp;
+
+  for(pp = &seed_hash[seed_hash_index(&s->seed_id, s->domain)];
+      *pp != NULL; pp = &(*pp)->hash_next) {
+    if(*pp == s) {
+      *pp = s->hash_next;
+      s->hash_next = NULL;
+      return;
+    }
+  }
+}
+/*
+ * A domain's data and control addresses only differ in the scope, so leave
+ * the flags and scope byte out of the hash. Both then map to the same bucket.
+ */
+static uint8_t
+domain_hash_index(uip_ip6addr_t *addr)
+{
+  uint8_t i;
+  uint16_t h = 0;
+
+  for(i = 2; i < sizeof(addr->u8); i++) {
+    h = (h << 3) + (h >> 13) + addr->u8[i];
+  }
+  return h % MPL_DOMAIN_SET_HASH_SIZE;
+}
+static void
+domain_hash_add(struct mpl_domain *d)
+{
+  uint8_t i = domain_hash_index(&d->data_addr);
+
+  d->hash_next = domain_hash[i];
+  domain_hash[i] = d;
+}
+static void
+domain_hash_remove(struct mpl_domain *d)
+{
+  struct mpl_domain **pp;
+
+  for(pp = &domain_hash[domain_hash_index(&d->data_addr)];
+      *pp != NULL; pp = &(*pp)->hash_next) {
+    if(*pp == d) {
+      *pp = d->hash_next;
+      d->hash_next = NULL;
+      return;
+    }
+  }
+}
 static struct mpl_domain *
 domain_set_allocate(uip_ip6addr_t *address)
 {
@@ -564,6 +686,7 @@ domain_set_allocate(uip_ip6addr_t *address)
         DOMAIN_SET_CLEAR_USED(locdsptr);
         return NULL;
       }
+      domain_hash_add(locdsptr);
       return locdsptr;
     }
   }
@@ -573,8 +696,8 @@ domain_set_allocate(uip_ip6addr_t *address)
 static struct mpl_seed *
 seed_set_lookup(seed_id_t *seed_id, struct mpl_domain *domain)
 {
-  for(locssptr = &seed_set[MPL_SEED_SET_SIZE - 1]; locssptr >= seed_set; locssptr--) {
-    if(SEED_SET_IS_USED(locssptr) && seed_id_cmp(seed_id, &locssptr->seed_id) && locssptr->domain == domain) {
+  for(locssptr = seed_hash[seed_hash_index(seed_id, domain)]; locssptr != NULL; locssptr = locssptr->hash_next) {
+    if(seed_id_cmp(seed_id, &locssptr->seed_id) && locssptr->domain == domain) {
       return locssptr;
     }
   }
@@ -598,17 +721,17 @@ seed_set_free(struct mpl_seed *s)
   while((locmmptr = list_pop(s->min_seq)) != NULL) {
     buffer_free(locmmptr);
   }
+  memset(s->seq_map, 0, sizeof(s->seq_map));
+  seed_hash_remove(s);
   SEED_SET_CLEAR_USED(s);
 }
 static struct mpl_domain *
 domain_set_lookup(uip_ip6addr_t *domain)
 {
-  for(locdsptr = &domain_set[MPL_DOMAIN_SET_SIZE - 1]; locdsptr >= domain_set; locdsptr--) {
-    if(DOMAIN_SET_IS_USED(locdsptr)) {
-      if(uip_ip6addr_cmp(domain, &locdsptr->data_addr)
-         || uip_ip6addr_cmp(domain, &locdsptr->ctrl_addr)) {
-        return locdsptr;
-      }
+  for(locdsptr = domain_hash[domain_hash_index(domain)]; locdsptr != NULL; locdsptr = locdsptr->hash_next) {
+    if(uip_ip6addr_cmp(domain, &locdsptr->data_addr)
+       || uip_ip6addr_cmp(domain, &locdsptr->ctrl_addr)) {
+      return locdsptr;
     }
   }
   return NULL;
@@ -618,7 +741,7 @@ domain_set_free(struct mpl_domain *domain)
 {
   uip_ds6_maddr_t *addr;
   /* Must include freeing seeds otherwise we leak memory */
-  for(locssptr = &seed_set[MPL_SEED_SET_SIZE]; locssptr >= seed_set; locssptr--) {
+  for(locssptr = &seed_set[MPL_SEED_SET_SIZE - 1]; locssptr >= seed_set; locssptr--) {
     if(SEED_SET_IS_USED(locssptr) && locssptr->domain == domain) {
       seed_set_free(locssptr);
     }
@@ -634,6 +757,7 @@ domain_set_free(struct mpl_domain *domain)
   if(trickle_timer_is_running(&domain->tt)) {
     trickle_timer_stop(&domain->tt);
   }
+  domain_hash_remove(domain);
   DOMAIN_SET_CLEAR_USED(domain);
 }
 static void
@@ -1114,7 +1238,7 @@ icmp_in(void)
     locdsptr = domain_set_allocate(&UIP_IP_BUF->destipaddr);
     if(!locdsptr) {
       LOG_ERR("Couldn't allocate new domain. Dropping.\n");
-      UIP_MCAST6_STATS_ADD(icmp_bad);
+      MPL_STATS_ADD(icmp_bad);
       goto discard;
     }
     mpl_control_trickle_timer_start(locdsptr);
@@ -1508,7 +1632,7 @@ accept(uint8_t in)
       UIP_MCAST6_STATS_ADD(mcast_dropped);
       return UIP_MCAST6_DROP;
     }
-    if(list_head(locssptr->min_seq) != NULL) {
+    if(SEED_SET_HAS_SEQ(locssptr, seq_val)) {
       for(locmmptr = list_head(locssptr->min_seq); locmmptr != NULL; locmmptr = list_item_next(locmmptr)) {
         if(SEQ_VAL_IS_EQ(seq_val, locmmptr->seq)) {
           /* Seen before , drop */
@@ -1540,6 +1664,7 @@ accept(uint8_t in)
     LIST_STRUCT_INIT(locssptr, min_seq);
     seed_id_cpy(&locssptr->seed_id, &seed_id);
     locssptr->domain = locdsptr;
+    seed_hash_add(locssptr);
   }
 
   /* Allocate a buffer */
@@ -1601,6 +1726,8 @@ accept(uint8_t in)
     }
   }
   locssptr->count++;
+  SEED_SET_ADD_SEQ(locssptr, locmmptr->seq);
+  lru_append(locmmptr);
 
 #if MPL_PROACTIVE_FORWARDING
   /* Start Forwarding the message */
@@ -1771,6 +1898,10 @@ init(void)
   memset(domain_set, 0, sizeof(struct mpl_domain) * MPL_DOMAIN_SET_SIZE);
   memset(seed_set, 0, sizeof(struct mpl_seed) * MPL_SEED_SET_SIZE);
   memset(buffered_message_set, 0, sizeof(struct mpl_msg) * MPL_BUFFERED_MESSAGE_SET_SIZE);
+  memset(seed_hash, 0, sizeof(seed_hash));
+  memset(domain_hash, 0, sizeof(domain_hash));
+  lru_head = NULL;
+  lru_tail = NULL;
 
   /* Register the ICMPv6 input handler */
   uip_icmp6_register_input_handler(&mpl_icmp_handler);
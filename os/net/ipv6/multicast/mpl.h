@@ -203,12 +203,32 @@
 #define MPL_SEED_SET_SIZE MPL_CONF_SEED_SET_SIZE
 #endif
 /*---------------------------------------------------------------------------*/
+/**
+ * Seed and Domain Set Hash Sizes
+ * Seeds and domains are looked up on every data and control message. They are
+ * indexed by hash tables with this many buckets, one per entry by default.
+ */
+#ifndef MPL_CONF_SEED_SET_HASH_SIZE
+#define MPL_SEED_SET_HASH_SIZE              MPL_SEED_SET_SIZE
+#else
+#define MPL_SEED_SET_HASH_SIZE MPL_CONF_SEED_SET_HASH_SIZE
+#endif
+
+#ifndef MPL_CONF_DOMAIN_SET_HASH_SIZE
+#define MPL_DOMAIN_SET_HASH_SIZE            MPL_DOMAIN_SET_SIZE
+#else
+#define MPL_DOMAIN_SET_HASH_SIZE MPL_CONF_DOMAIN_SET_HASH_SIZE
+#endif
+/*---------------------------------------------------------------------------*/
 /**
  * Buffered Message Set Size
  * MPL Forwarders maintain a buffer of data messages that are periodically
  * forwarded around the MPL domain. These are forwarded when trickle timers
  * expire, and remain in the buffer for the number of timer expirations
  * set in Data Message Timer Expirations.
+ *
+ * When the buffer is full, a new message replaces the message with the lowest
+ * sequence number of the seed that owns the oldest buffered message.
  */
 #ifndef MPL_CONF_BUFFERED_MESSAGE_SET_SIZE
 #define MPL_BUFFERED_MESSAGE_SET_SIZE       6
@@ -46,6 +46,7 @@
 #include "net/ipv6/uip-icmp6.h"
 #include "net/ipv6/multicast/uip-mcast6.h"
 #include "net/ipv6/multicast/roll-tm.h"
+#include "lib/trickle-timer.h"
 #include "dev/watchdog.h"
 #include <string.h>
 
@@ -82,34 +83,18 @@ typedef uip_ip6addr_t seed_id_t;
 #define seed_id_cmp(a, b) (memcmp((a), (b), sizeof(seed_id_t)) == 0)
 #define seed_id_cpy(a, b) (memcpy((a), (b), sizeof(seed_id_t)))
 
-/* Trickle Timers */
+/* Trickle Timers: Imin, Imax, k and c are handled by the trickle library */
 struct trickle_param {
-  clock_time_t i_min;           /* Clock ticks */
-  clock_time_t t_start;         /* Start of the interval (absolute clock_time) */
-  clock_time_t t_end;           /* End of the interval (absolute clock_time) */
-  clock_time_t t_next;          /* Clock ticks, randomised in [I/2, I) */
+  struct trickle_timer tt;
   clock_time_t t_last_trigger;
-  struct ctimer ct;
-  uint8_t i_current;            /* Current doublings from i_min */
-  uint8_t i_max;                /* Max number of doublings */
-  uint8_t k;                    /* Redundancy Constant */
   uint8_t t_active;             /* Units of Imax */
   uint8_t t_dwell;              /* Units of Imax */
-  uint8_t c;                    /* Consistency Counter */
   uint8_t inconsistency;
 };
 
 /**
- * \brief Convert a timer to a sane clock_time_t value after d doublings
- * m is a value of Imin, d is a number of doublings
- * Careful of overflows
- */
-#define TRICKLE_TIME(m, d) ((clock_time_t)((m) << (d)))
-
-/**
- * \brief Convert Imax from number of doublings to clock_time_t units for
- * trickle_param t. Again, watch out for overflows */
-#define TRICKLE_IMAX(t) ((uint32_t)((t)->i_min << (t)->i_max))
+ * \brief Imax in clock_time_t units for trickle_param t */
+#define TRICKLE_IMAX(t) ((uint32_t)TRICKLE_TIMER_INTERVAL_MAX(&(t)->tt))
 
 /**
  * \brief Convert Tactive for a trickle timer to a sane clock_time_t value
@@ -129,21 +114,21 @@ struct trickle_param {
  * \brief Check if suppression is enabled for trickle_param t
  * t is a pointer to the timer
  */
-#define SUPPRESSION_ENABLED(t) ((t)->k != ROLL_TM_INFINITE_REDUNDANCY)
+#define SUPPRESSION_ENABLED(t) TRICKLE_TIMER_SUPPRESSION_ENABLED(&(t)->tt)
 
 /**
  * \brief Check if suppression is disabled for trickle_param t
  * t is a pointer to the timer
  */
-#define SUPPRESSION_DISABLED(t) ((t)->k == ROLL_TM_INFINITE_REDUNDANCY)
+#define SUPPRESSION_DISABLED(t) TRICKLE_TIMER_SUPPRESSION_DISABLED(&(t)->tt)
 
 /**
  * \brief Init trickle_timer[m]
  */
 #define TIMER_CONFIGURE(m) do { \
-  t[m].i_min = ROLL_TM_IMIN_##m; \
-  t[m].i_max = ROLL_TM_IMAX_##m; \
-  t[m].k = ROLL_TM_K_##m; \
+  trickle_timer_config(&t[m].tt, ROLL_TM_IMIN_##m, ROLL_TM_IMAX_##m, \
+                       ROLL_TM_K_##m == ROLL_TM_INFINITE_REDUNDANCY ? \
+                       TRICKLE_TIMER_INFINITE_REDUNDANCY : ROLL_TM_K_##m); \
   t[m].t_active = ROLL_TM_T_ACTIVE_##m; \
   t[m].t_dwell = ROLL_TM_T_DWELL_##m; \
   t[m].t_last_trigger = clock_time(); \
@@ -467,70 +452,21 @@ static void icmp_input(void);
 static void icmp_output(void);
 static void window_update_bounds(void);
 static void reset_trickle_timer(uint8_t);
-static void handle_timer(void *);
+static void handle_timer(void *, uint8_t);
 /*---------------------------------------------------------------------------*/
 /* ROLL TM ICMPv6 handler declaration */
 UIP_ICMP6_HANDLER(roll_tm_icmp_handler, ICMP6_ROLL_TM,
                   UIP_ICMP6_HANDLER_CODE_ANY, icmp_input);
 /*---------------------------------------------------------------------------*/
-/* Return a random number in [I/2, I), for a timer with Imin when the timer's
- * current number of doublings is d */
-static clock_time_t
-random_interval(clock_time_t i_min, uint8_t d)
-{
-  clock_time_t min = TRICKLE_TIME(i_min >> 1, d);
-
-  VERBOSE_PRINTF("ROLL TM: Random [%lu, %lu)\n", (unsigned long)min,
-                 (unsigned long)(TRICKLE_TIME(i_min, d)));
-
-  return min + (random_rand() % (TRICKLE_TIME(i_min, d) - 1 - min));
-}
-/*---------------------------------------------------------------------------*/
-/* Called at the end of the current interval for timer ptr */
-static void
-double_interval(void *ptr)
-{
-  struct trickle_param *param = (struct trickle_param *)ptr;
-  int16_t offset;
-  clock_time_t next;
-
-  /*
-   * If we got called long past our expiration, store the offset and try to
-   * compensate this period
-   */
-  offset = (int16_t)(clock_time() - param->t_end);
-
-  /* Calculate next interval */
-  if(param->i_current < param->i_max) {
-    param->i_current++;
-  }
-
-  param->t_start = param->t_end;
-  param->t_end = param->t_start + (param->i_min << param->i_current);
-
-  next = random_interval(param->i_min, param->i_current);
-  if(next > offset) {
-    next -= offset;
-  } else {
-    next = 0;
-  }
-  param->t_next = next;
-  ctimer_set(&param->ct, param->t_next, handle_timer, (void *)param);
-
-  VERBOSE_PRINTF("ROLL TM: Doubling at %lu (offset %d), Start %lu, End %lu,"
-                 " Periodic in %lu\n", clock_time(), offset,
-                 (unsigned long)param->t_start,
-                 (unsigned long)param->t_end, (unsigned long)param->t_next);
-}
-/*---------------------------------------------------------------------------*/
 /*
  * Called at a random point in [I/2,I) of the current interval for ptr
  * PARAM is a pointer to the timer that triggered the callback (&t[index])
  */
 static void
-handle_timer(void *ptr)
+handle_timer(void *ptr, uint8_t suppress)
 {
   struct trickle_param *param;
+  clock_time_t now;
   clock_time_t diff_last;       /* Time diff from last pass */
   clock_time_t diff_start;      /* Time diff from interval start */
   uint8_t m;
@@ -557,11 +493,10 @@ handle_timer(void *ptr)
                  m, (unsigned long)clock_time(),
                  (unsigned long)param->t_last_trigger);
 
-  /* Temporarily store 'now' in t_next and calculate diffs */
-  param->t_next = clock_time();
-  diff_last = param->t_next - param->t_last_trigger;
-  diff_start = param->t_next - param->t_start;
-  param->t_last_trigger = param->t_next;
+  now = clock_time();
+  diff_last = now - param->t_last_trigger;
+  diff_start = now - param->tt.i_start;
+  param->t_last_trigger = now;
 
   VERBOSE_PRINTF
     ("ROLL TM: M=%u Periodic diff from last %lu, from start %lu\n", m,
@@ -583,7 +518,7 @@ handle_timer(void *ptr)
        * If the packet was not received during the last window, it is safe to
        * increase its lifetime counters by the time diff from last pass
        *
-       * if active == dwell == 0 but i_current != 0, this is an oops
+       * if active == dwell == 0 but I != Imin, this is an oops
        * (new packet that didn't reset us). We don't handle it
        */
       if(locmpptr->active == 0) {
@@ -631,50 +566,30 @@ handle_timer(void *ptr)
   }
 
   /* Suppression Enabled - Send an ICMP */
-  if(SUPPRESSION_ENABLED(param)) {
-    if(param->c < param->k) {
-      icmp_output();
-    }
+  if(SUPPRESSION_ENABLED(param) && suppress == TRICKLE_TIMER_TX_OK) {
+    icmp_output();
   }
 
-  /* Done handling inconsistencies for this timer */
+  /* Done handling inconsistencies for this timer. The trickle library resets
+   * c and schedules the end of the interval */
   param->inconsistency = 0;
-  param->c = 0;
 
   window_update_bounds();
 
-  /* Temporarily store 'now' in t_next */
-  param->t_next = clock_time();
-  if(param->t_next >= param->t_end) {
-    /* took us too long to process things, double interval asap */
-    param->t_next = 0;
-  } else {
-    param->t_next = param->t_end - param->t_next;
-  }
-  VERBOSE_PRINTF
-    ("ROLL TM: M=%u Periodic at %lu, Interval End at %lu in %lu\n", m,
-     (unsigned long)clock_time(), (unsigned long)param->t_end,
-     (unsigned long)param->t_next);
-  ctimer_set(&param->ct, param->t_next, double_interval, (void *)param);
-
   return;
 }
 /*---------------------------------------------------------------------------*/
 static void
 reset_trickle_timer(uint8_t index)
 {
-  t[index].t_start = clock_time();
-  t[index].t_end = t[index].t_start + (t[index].i_min);
-  t[index].i_current = 0;
-  t[index].c = 0;
-  t[index].t_next = random_interval(t[index].i_min, t[index].i_current);
+  /* Start over with I = Imin, even if I already is Imin */
+  trickle_timer_set_at_imin(&t[index].tt, handle_timer, &t[index]);
 
   VERBOSE_PRINTF
-    ("ROLL TM: M=%u Reset at %lu, Start %lu, End %lu, New Interval %lu\n",
-     index, (unsigned long)t[index].t_start, (unsigned long)t[index].t_start,
-     (unsigned long)t[index].t_end, (unsigned long)t[index].t_next);
-
-  ctimer_set(&t[index].ct, t[index].t_next, handle_timer, (void *)&t[index]);
+    ("ROLL TM: M=%u Reset at %lu, End %lu, Periodic at %lu\n",
+     index, (unsigned long)t[index].tt.i_start,
+     (unsigned long)TRICKLE_TIMER_INTERVAL_END(&t[index].tt),
+     (unsigned long)TRICKLE_TIMER_NEXT_EXPIRATION(&t[index].tt));
 }
 /*---------------------------------------------------------------------------*/
 static struct sliding_window *
@@ -1297,12 +1212,12 @@ drop:
   if(t[0].inconsistency) {
     reset_trickle_timer(0);
   } else {
-    t[0].c++;
+    trickle_timer_consistency(&t[0].tt);
   }
   if(t[1].inconsistency) {
     reset_trickle_timer(1);
   } else {
-    t[1].c++;
+    trickle_timer_consistency(&t[1].tt);
   }
 
 discard:
@@ -93,6 +93,7 @@ in()
   rpl_dag_t *d;                 /* Our DODAG */
   uip_ipaddr_t *parent_ipaddr;  /* Our pref. parent's IPv6 address */
   const uip_lladdr_t *parent_lladdr;  /* Our pref. parent's LL address */
+  uip_mcast6_route_t *route;   /* Route to the destination group */
 
   /*
    * Fetch a pointer to the LL address of our preferred parent
@@ -141,9 +142,15 @@ in()
 
   /* If we have an entry in the mcast routing table, something with
    * a higher RPL rank (somewhere down the tree) is a group member */
-  if(uip_mcast6_route_lookup(&UIP_IP_BUF->destipaddr)) {
+  route = uip_mcast6_route_lookup(&UIP_IP_BUF->destipaddr);
+  if(route != NULL) {
+    UIP_MCAST6_ROUTE_STATS_ADD(route, in);
+  }
+
+  if(route != NULL && uip_mcast6_route_rate_allow(route)) {
     /* If we enter here, we will definitely forward */
     UIP_MCAST6_STATS_ADD(mcast_fwd);
+    UIP_MCAST6_ROUTE_STATS_ADD(route, fwd);
 
     /*
      * Add a delay (D) of at least SMRF_FWD_DELAY() to compensate for how
@@ -180,6 +187,8 @@ in()
     }
     PRINTF("SMRF: %u bytes: fwd in %u [%u]\n",
            uip_len, fwd_delay, fwd_spread);
+  } else if(route != NULL) {
+    PRINTF("SMRF: Group over its rate limit, not forwarding\n");
   } else {
     PRINTF("SMRF: Group unknown, dropping\n");
   }
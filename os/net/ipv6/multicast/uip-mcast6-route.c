@@ -61,6 +61,14 @@ LIST(mcast_route_list);
 MEMB(mcast_route_memb, uip_mcast6_route_t, UIP_MCAST6_ROUTE_ROUTES);
 
 static uip_mcast6_route_t *locmcastrt;
+
+#if UIP_MCAST6_ROUTE_RATE_LIMIT
+/* One datagram's worth of tokens: rates are per minute, time is in ticks */
+#define TOKENS_PER_DATAGRAM ((uint32_t)60 * CLOCK_SECOND)
+
+static uint16_t default_rate = UIP_MCAST6_ROUTE_DEFAULT_RATE;
+static uint8_t default_burst = UIP_MCAST6_ROUTE_DEFAULT_BURST;
+#endif /* UIP_MCAST6_ROUTE_RATE_LIMIT */
 /*---------------------------------------------------------------------------*/
 uip_mcast6_route_t *
 uip_mcast6_route_lookup(uip_ipaddr_t *group)
@@ -89,6 +97,12 @@ uip_mcast6_route_add(uip_ipaddr_t *group)
       return NULL;
     }
     list_add(mcast_route_list, locmcastrt);
+#if UIP_MCAST6_STATS
+    memset(&locmcastrt->stats, 0, sizeof(locmcastrt->stats));
+#endif
+#if UIP_MCAST6_ROUTE_RATE_LIMIT
+    uip_mcast6_route_set_rate_limit(locmcastrt, default_rate, default_burst);
+#endif
   }
 
   /* Reaching here means we either found the prefix or allocated a new one */
@@ -125,6 +139,72 @@ uip_mcast6_route_count(void)
   return list_length(mcast_route_list);
 }
 /*---------------------------------------------------------------------------*/
+#if UIP_MCAST6_ROUTE_RATE_LIMIT
+int
+uip_mcast6_route_rate_allow(uip_mcast6_route_t *route)
+{
+  uint32_t max;
+  uint32_t missing;
+  clock_time_t now;
+  clock_time_t elapsed;
+
+  if(route->rate == 0) {
+    return 1;
+  }
+
+  now = clock_time();
+  elapsed = now - route->refilled;
+  route->refilled = now;
+
+  /*
+   * Refill. Compare elapsed time against the time needed to fill the bucket
+   * instead of multiplying first, so that long idle periods cannot overflow.
+   */
+  max = (uint32_t)route->burst * TOKENS_PER_DATAGRAM;
+  missing = max - route->tokens;
+  if(elapsed >= (missing + route->rate - 1) / route->rate) {
+    route->tokens = max;
+  } else {
+    route->tokens += (uint32_t)elapsed * route->rate;
+  }
+
+  if(route->tokens < TOKENS_PER_DATAGRAM) {
+    UIP_MCAST6_ROUTE_STATS_ADD(route, limited);
+    return 0;
+  }
+
+  route->tokens -= TOKENS_PER_DATAGRAM;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_mcast6_route_set_rate_limit(uip_mcast6_route_t *route,
+                                uint16_t rate, uint8_t burst)
+{
+  if(burst == 0) {
+    burst = 1;
+  }
+  route->rate = rate;
+  route->burst = burst;
+  route->tokens = (uint32_t)burst * TOKENS_PER_DATAGRAM;
+  route->refilled = clock_time();
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_mcast6_route_set_default_rate_limit(uint16_t rate, uint8_t burst)
+{
+  default_rate = rate;
+  default_burst = burst;
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_mcast6_route_get_default_rate_limit(uint16_t *rate, uint8_t *burst)
+{
+  *rate = default_rate;
+  *burst = default_burst;
+}
+#endif /* UIP_MCAST6_ROUTE_RATE_LIMIT */
+/*---------------------------------------------------------------------------*/
 void
 uip_mcast6_route_init()
 {
@@ -44,15 +44,71 @@
 
 #include "contiki.h"
 #include "net/ipv6/uip.h"
+#include "net/ipv6/multicast/uip-mcast6-stats.h"
 
 #include <stdint.h>
 /*---------------------------------------------------------------------------*/
+/**
+ * \brief Per-group forwarding rate limiter
+ *
+ *        When enabled, each multicast route carries a token bucket. Engines
+ *        that forward based on the routing table (SMRF, ESMRF) consult it
+ *        through uip_mcast6_route_rate_allow() before forwarding a datagram.
+ *        Limits can be changed at runtime, e.g. from the shell.
+ */
+#ifdef UIP_MCAST6_ROUTE_CONF_RATE_LIMIT
+#define UIP_MCAST6_ROUTE_RATE_LIMIT UIP_MCAST6_ROUTE_CONF_RATE_LIMIT
+#else
+#define UIP_MCAST6_ROUTE_RATE_LIMIT 0
+#endif
+
+/** Default forwarding rate for new groups, datagrams per minute (0: none) */
+#ifdef UIP_MCAST6_ROUTE_CONF_DEFAULT_RATE
+#define UIP_MCAST6_ROUTE_DEFAULT_RATE UIP_MCAST6_ROUTE_CONF_DEFAULT_RATE
+#else
+#define UIP_MCAST6_ROUTE_DEFAULT_RATE 0
+#endif
+
+/** Default bucket depth for new groups, in datagrams */
+#ifdef UIP_MCAST6_ROUTE_CONF_DEFAULT_BURST
+#define UIP_MCAST6_ROUTE_DEFAULT_BURST UIP_MCAST6_ROUTE_CONF_DEFAULT_BURST
+#else
+#define UIP_MCAST6_ROUTE_DEFAULT_BURST 4
+#endif
+/*---------------------------------------------------------------------------*/
+#if UIP_MCAST6_STATS
+/** \brief Per-group multicast statistics */
+typedef struct uip_mcast6_route_stats {
+  /** Count of datagrams received for this group */
+  UIP_MCAST6_STATS_DATATYPE in;
+
+  /** Count of datagrams forwarded for this group */
+  UIP_MCAST6_STATS_DATATYPE fwd;
+
+  /** Count of datagrams not forwarded due to the rate limit */
+  UIP_MCAST6_STATS_DATATYPE limited;
+} uip_mcast6_route_stats_t;
+
+#define UIP_MCAST6_ROUTE_STATS_ADD(r, x) (r)->stats.x++
+#else /* UIP_MCAST6_STATS */
+#define UIP_MCAST6_ROUTE_STATS_ADD(r, x)
+#endif /* UIP_MCAST6_STATS */
+/*---------------------------------------------------------------------------*/
 /** \brief An entry in the multicast routing table */
 typedef struct uip_mcast6_route {
   struct uip_mcast6_route *next; /**< Routes are arranged in a linked list */
   uip_ipaddr_t group; /**< The multicast group */
   uint32_t lifetime; /**< Entry lifetime seconds */
   void *dag; /**< Pointer to an rpl_dag_t struct */
+#if UIP_MCAST6_ROUTE_RATE_LIMIT
+  clock_time_t refilled; /**< Last time the token bucket was refilled */
+  uint32_t tokens; /**< Bucket level, in units of 1/(60 * CLOCK_SECOND) */
+  uint16_t rate; /**< Datagrams per minute, 0 for unlimited */
+  uint8_t burst; /**< Bucket depth in datagrams */
+#endif /* UIP_MCAST6_ROUTE_RATE_LIMIT */
+#if UIP_MCAST6_STATS
+  uip_mcast6_route_stats_t stats; /**< Per-group counters */
+#endif /* UIP_MCAST6_STATS */
 } uip_mcast6_route_t;
 /*---------------------------------------------------------------------------*/
 /** \name Multicast Routing Table Manipulation */
@@ -92,6 +148,52 @@ int uip_mcast6_route_count(void);
  * If the multicast routes list is empty, this function will return NULL
  */
 uip_mcast6_route_t *uip_mcast6_route_list_head(void);
+/** @} */
+/*---------------------------------------------------------------------------*/
+/** \name Per-group Rate Limiting */
+/** @{ */
+
+/**
+ * \brief Check whether a datagram for a group may be forwarded now
+ * \param route The route of the datagram's group
+ * \return 1 if the datagram may be forwarded, 0 if the group is over its rate
+ *
+ *        Consumes one token from the group's bucket when returning 1. Always
+ *        returns 1 when rate limiting is disabled or the group has no limit.
+ */
+#if UIP_MCAST6_ROUTE_RATE_LIMIT
+int uip_mcast6_route_rate_allow(uip_mcast6_route_t *route);
+#else
+#define uip_mcast6_route_rate_allow(route) 1
+#endif
+
+#if UIP_MCAST6_ROUTE_RATE_LIMIT
+/**
+ * \brief Set the forwarding rate limit of a group
+ * \param route The route of the group
+ * \param rate Datagrams per minute, 0 to disable the limit
+ * \param burst Maximum number of datagrams forwarded back to back
+ *
+ *        The bucket starts out full.
+ */
+void uip_mcast6_route_set_rate_limit(uip_mcast6_route_t *route,
+                                     uint16_t rate, uint8_t burst);
+
+/**
+ * \brief Set the rate limit applied to groups added from now on
+ * \param rate Datagrams per minute, 0 to disable the limit
+ * \param burst Maximum number of datagrams forwarded back to back
+ */
+void uip_mcast6_route_set_default_rate_limit(uint16_t rate, uint8_t burst);
+
+/**
+ * \brief Retrieve the rate limit applied to new groups
+ * \param rate Filled in with the rate in datagrams per minute
+ * \param burst Filled in with the bucket depth
+ */
+void uip_mcast6_route_get_default_rate_limit(uint16_t *rate, uint8_t *burst);
+#endif /* UIP_MCAST6_ROUTE_RATE_LIMIT */
+/** @} */
 /*---------------------------------------------------------------------------*/
 /**
  * \brief Multicast routing table init routine
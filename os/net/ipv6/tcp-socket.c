@@ -351,7 +351,10 @@ tcp_socket_send(struct tcp_socket *s,
 
   len = MIN(datalen, s->output_data_maxlen - s->output_data_len);
 
-  memmove(&s->output_data_ptr[s->output_data_len], data, len);
+  /* Data may already have been written in place in the output buffer */
+  if(data != &s->output_data_ptr[s->output_data_len]) {
+    memmove(&s->output_data_ptr[s->output_data_len], data, len);
+  }
   s->output_data_len += len;
 
   if(s->output_senddata_len == 0) {
@@ -389,8 +392,12 @@ tcp_socket_unregister(struct tcp_socket *s)
   }
 
   tcp_socket_unlisten(s);
-  if(s->c != NULL) {
+  if(s->c != NULL && s->c->appstate.state == s) {
+    /* Without a socket, the connection is reset when it is next polled */
+    PROCESS_CONTEXT_BEGIN(&tcp_socket_process);
     tcp_attach(s->c, NULL);
+    PROCESS_CONTEXT_END();
+    tcpip_poll_tcp(s->c);
   }
   list_remove(socketlist, s);
   return 1;
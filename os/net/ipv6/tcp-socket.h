@@ -224,6 +224,10 @@ int tcp_socket_unlisten(struct tcp_socket *s);
  *             data has been acknowledged by the remote host, the
  *             socket's event callback is called with the event
  *             argument set to TCP_SOCKET_DATA_SENT.
+ *
+ *             Data that the application has written directly into
+ *             the output buffer, right after the data already
+ *             queued, is sent without being copied.
  */
 int tcp_socket_send(struct tcp_socket *s,
                     const uint8_t *dataptr,
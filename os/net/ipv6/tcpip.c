@@ -510,7 +510,10 @@ get_nexthop(uip_ipaddr_t *addr)
 
   /* No route was found - we send to the default route instead. */
   if(route == NULL) {
-    nexthop = uip_ds6_defrt_choose();
+    nexthop = NETSTACK_ROUTING.get_default_nexthop();
+    if(nexthop == NULL) {
+      nexthop = uip_ds6_defrt_choose();
+    }
     if(nexthop == NULL) {
       output_fallback();
     } else {
@@ -709,6 +712,7 @@ tcpip_ipv6_output(void)
     nbr->state = NBR_DELAY;
     stimer_set(&nbr->reachable, UIP_ND6_DELAY_FIRST_PROBE_TIME);
     nbr->nscount = 0;
+    uip_ds6_nbr_reschedule(nbr);
     LOG_INFO("output: nbr cache entry stale moving to delay\n");
   }
 #endif /* UIP_ND6_SEND_NS */
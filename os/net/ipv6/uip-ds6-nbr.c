@@ -114,11 +114,34 @@ MEMB(uip_ds6_nbr_memb, uip_ds6_nbr_t, UIP_DS6_NBR_MAX_NEIGHBOR_CACHES);
 NBR_TABLE(uip_ds6_nbr_t, ds6_neighbors);
 #endif /* UIP_DS6_NBR_MULTI_IPV6_ADDRS */
 
+#if UIP_ND6_SEND_NS
+/* Is deadline a before deadline b? Deadlines are in clock_seconds() */
+#define DEADLINE_BEFORE(a, b) ((long)((a) - (b)) < 0)
+
+/*
+ * Neighbors with a pending NUD deadline, earliest first. A neighbor is
+ * queued according to its state: REACHABLE and DELAY wait for the
+ * reachable timer, INCOMPLETE and PROBE for the sendns timer. STALE
+ * neighbors are not queued.
+ *
+ * Deadlines that move later (e.g. a REACHABLE neighbor being refreshed)
+ * are not requeued eagerly: the neighbor is checked at its old deadline
+ * and requeued then. Deadlines that move earlier must be requeued through
+ * uip_ds6_nbr_reschedule().
+ */
+static uip_ds6_nbr_t *expiry_queue;
+
+static void expiry_queue_remove(uip_ds6_nbr_t *nbr);
+#endif /* UIP_ND6_SEND_NS */
+
 /*---------------------------------------------------------------------------*/
 void
 uip_ds6_neighbors_init(void)
 {
   link_stats_init();
+#if UIP_ND6_SEND_NS
+  expiry_queue = NULL;
+#endif /* UIP_ND6_SEND_NS */
 #if UIP_DS6_NBR_MULTI_IPV6_ADDRS
   memb_init(&uip_ds6_nbr_memb);
   nbr_table_register(uip_ds6_nbr_entries,
@@ -187,6 +210,13 @@ uip_ds6_nbr_add(const uip_ipaddr_t *ipaddr, const uip_lladdr_t *lladdr,
     add_uip_ds6_nbr_to_nbr_entry(nbr, nbr_entry);
   }
 #else
+#if UIP_ND6_SEND_NS
+  /* An existing entry for lladdr gets overwritten, take it off the queue */
+  nbr = nbr_table_get_from_lladdr(ds6_neighbors, (linkaddr_t *)lladdr);
+  if(nbr != NULL) {
+    expiry_queue_remove(nbr);
+  }
+#endif /* UIP_ND6_SEND_NS */
   nbr = nbr_table_add_lladdr(ds6_neighbors, (linkaddr_t*)lladdr, reason, data);
 #endif /* UIP_DS6_NBR_MULTI_IPV6_ADDRS */
 
@@ -211,6 +241,8 @@ uip_ds6_nbr_add(const uip_ipaddr_t *ipaddr, const uip_lladdr_t *lladdr,
     }
     stimer_set(&nbr->sendns, 0);
     nbr->nscount = 0;
+    nbr->expiry_next = NULL;
+    uip_ds6_nbr_reschedule(nbr);
 #endif /* UIP_ND6_SEND_NS */
     LOG_INFO("Adding neighbor with ip addr ");
     LOG_INFO_6ADDR(ipaddr);
@@ -269,6 +301,9 @@ free_uip_ds6_nbr(uip_ds6_nbr_t *nbr)
   if(nbr == NULL) {
     return;
   }
+#if UIP_ND6_SEND_NS
+  expiry_queue_remove(nbr);
+#endif /* UIP_ND6_SEND_NS */
 #if UIP_CONF_IPV6_QUEUE_PKT
   uip_packetqueue_free(&nbr->packethandle);
 #endif /* UIP_CONF_IPV6_QUEUE_PKT */
@@ -327,6 +362,10 @@ uip_ds6_nbr_rm(uip_ds6_nbr_t *nbr)
 
 #else /* UIP_DS6_NBR_MULTI_IPV6_ADDRS */
 
+#if UIP_ND6_SEND_NS
+  expiry_queue_remove(nbr);
+#endif /* UIP_ND6_SEND_NS */
+
 #if UIP_CONF_IPV6_QUEUE_PKT
   uip_packetqueue_free(&nbr->packethandle);
 #endif /* UIP_CONF_IPV6_QUEUE_PKT */
@@ -405,7 +444,15 @@ uip_ds6_nbr_update_ll(uip_ds6_nbr_t **nbr_pp, const uip_lladdr_t *new_ll_addr)
     LOG_ERR("%s: cannot allocate a new nbr for new_ll_addr\n", __func__);
     return -1;
   }
+#if UIP_ND6_SEND_NS
+  /* The backup holds a stale queue link, requeue once restored */
+  expiry_queue_remove(*nbr_pp);
+#endif /* UIP_ND6_SEND_NS */
   memcpy(*nbr_pp, &nbr_backup, sizeof(uip_ds6_nbr_t));
+#if UIP_ND6_SEND_NS
+  (*nbr_pp)->expiry_next = NULL;
+  uip_ds6_nbr_reschedule(*nbr_pp);
+#endif /* UIP_ND6_SEND_NS */
 #endif /* UIP_DS6_NBR_MULTI_IPV6_ADDRS */
 
   return 0;
@@ -548,27 +595,63 @@ uip_ds6_nbr_lladdr_from_ipaddr(const uip_ipaddr_t *ipaddr)
 #if UIP_DS6_LL_NUD
 /*---------------------------------------------------------------------------*/
 static void
-update_nbr_reachable_state_by_ack(uip_ds6_nbr_t *nbr, const linkaddr_t *lladdr)
+confirm_nbr_reachable(uip_ds6_nbr_t *nbr, const linkaddr_t *lladdr)
 {
   if(nbr != NULL && nbr->state != NBR_INCOMPLETE) {
+#if UIP_ND6_SEND_NS
+    /* STALE neighbors are not queued. In other states, the deadline
+     * only moves later, which the queue picks up lazily. */
+    int requeue = nbr->state == NBR_STALE;
+#endif /* UIP_ND6_SEND_NS */
     nbr->state = NBR_REACHABLE;
     stimer_set(&nbr->reachable, UIP_ND6_REACHABLE_TIME / 1000);
-    LOG_INFO("received a link layer ACK : ");
+#if UIP_ND6_SEND_NS
+    if(requeue) {
+      uip_ds6_nbr_reschedule(nbr);
+    }
+#endif /* UIP_ND6_SEND_NS */
+    LOG_INFO("reachability of ");
     LOG_INFO_LLADDR(lladdr);
-    LOG_INFO_(" is reachable.\n");
+    LOG_INFO_(" confirmed\n");
   }
 }
 #endif /* UIP_DS6_LL_NUD */
 /*---------------------------------------------------------------------------*/
 void
-uip_ds6_link_callback(int status, int numtx)
+uip_ds6_nbr_confirm_reachable(const linkaddr_t *lladdr)
 {
 #if UIP_DS6_LL_NUD
-  const linkaddr_t *dest = packetbuf_addr(PACKETBUF_ADDR_RECEIVER);
-  if(linkaddr_cmp(dest, &linkaddr_null)) {
+  uip_ds6_nbr_t *nbr;
+#if UIP_DS6_NBR_MULTI_IPV6_ADDRS
+  uip_ds6_nbr_entry_t *nbr_entry;
+#endif /* UIP_DS6_NBR_MULTI_IPV6_ADDRS */
+
+  if(lladdr == NULL || linkaddr_cmp(lladdr, &linkaddr_null)) {
     return;
   }
 
+#if UIP_DS6_NBR_MULTI_IPV6_ADDRS
+  if((nbr_entry =
+      (uip_ds6_nbr_entry_t *)nbr_table_get_from_lladdr(uip_ds6_nbr_entries,
+                                                       lladdr)) == NULL) {
+    return;
+  }
+  for(nbr = (uip_ds6_nbr_t *)list_head(nbr_entry->uip_ds6_nbrs);
+      nbr != NULL;
+      nbr = (uip_ds6_nbr_t *)list_item_next(nbr)) {
+    confirm_nbr_reachable(nbr, lladdr);
+  }
+#else /* UIP_DS6_NBR_MULTI_IPV6_ADDRS */
+  nbr = uip_ds6_nbr_ll_lookup((const uip_lladdr_t *)lladdr);
+  confirm_nbr_reachable(nbr, lladdr);
+#endif /* UIP_DS6_NBR_MULTI_IPV6_ADDRS */
+#endif /* UIP_DS6_LL_NUD */
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_ds6_link_callback(int status, int numtx)
+{
+#if UIP_DS6_LL_NUD
   /* From RFC4861, page 72, last paragraph of section 7.3.3:
    *
    *         "In some cases, link-specific information may indicate that a path to
@@ -585,104 +668,168 @@ uip_ds6_link_callback(int status, int numtx)
    * not re-testing the state of a neighbour periodically if it
    * acknowledges link packets. */
   if(status == MAC_TX_OK) {
-    uip_ds6_nbr_t *nbr;
-#if UIP_DS6_NBR_MULTI_IPV6_ADDRS
-    uip_ds6_nbr_entry_t *nbr_entry;
-    if((nbr_entry =
-        (uip_ds6_nbr_entry_t *)nbr_table_get_from_lladdr(uip_ds6_nbr_entries,
-                                                         dest)) == NULL) {
-      return;
-    }
-    for(nbr = (uip_ds6_nbr_t *)list_head(nbr_entry->uip_ds6_nbrs);
-        nbr != NULL;
-        nbr = (uip_ds6_nbr_t *)list_item_next(nbr)) {
-      update_nbr_reachable_state_by_ack(nbr, dest);
-    }
-#else /* UIP_DS6_NBR_MULTI_IPV6_ADDRS */
-    nbr = uip_ds6_nbr_ll_lookup((uip_lladdr_t *)dest);
-    update_nbr_reachable_state_by_ack(nbr, dest);
-#endif /* UIP_DS6_NBR_MULTI_IPV6_ADDRS */
+    uip_ds6_nbr_confirm_reachable(packetbuf_addr(PACKETBUF_ADDR_RECEIVER));
   }
 #endif /* UIP_DS6_LL_NUD */
 }
 #if UIP_ND6_SEND_NS
 /*---------------------------------------------------------------------------*/
-/** Periodic processing on neighbors */
+/* The NUD deadline of a neighbor, if its state has one */
+static int
+nbr_deadline(const uip_ds6_nbr_t *nbr, unsigned long *deadline)
+{
+  switch(nbr->state) {
+  case NBR_REACHABLE:
+  case NBR_DELAY:
+    *deadline = nbr->reachable.start + nbr->reachable.interval;
+    return 1;
+  case NBR_INCOMPLETE:
+  case NBR_PROBE:
+    *deadline = nbr->sendns.start + nbr->sendns.interval;
+    return 1;
+  default:
+    return 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+expiry_queue_remove(uip_ds6_nbr_t *nbr)
+{
+  uip_ds6_nbr_t **p;
+
+  for(p = &expiry_queue; *p != NULL; p = &(*p)->expiry_next) {
+    if(*p == nbr) {
+      *p = nbr->expiry_next;
+      break;
+    }
+  }
+  nbr->expiry_next = NULL;
+}
+/*---------------------------------------------------------------------------*/
 void
-uip_ds6_neighbor_periodic(void)
+uip_ds6_nbr_reschedule(uip_ds6_nbr_t *nbr)
 {
-  uip_ds6_nbr_t *nbr = uip_ds6_nbr_head();
-  while(nbr != NULL) {
-    switch(nbr->state) {
-    case NBR_REACHABLE:
-      if(stimer_expired(&nbr->reachable)) {
+  uip_ds6_nbr_t **p;
+
+  expiry_queue_remove(nbr);
+  if(!nbr_deadline(nbr, &nbr->expiry)) {
+    return;
+  }
+
+  /* Insert after the neighbors with the same or an earlier deadline */
+  for(p = &expiry_queue;
+      *p != NULL && !DEADLINE_BEFORE(nbr->expiry, (*p)->expiry);
+      p = &(*p)->expiry_next);
+  nbr->expiry_next = *p;
+  *p = nbr;
+}
+/*---------------------------------------------------------------------------*/
+/* NUD processing of a neighbor whose deadline has passed. Returns 0 if an
+ * NS is due but cannot be sent now, as uip_buf is in use. */
+static int
+nbr_expired(uip_ds6_nbr_t *nbr)
+{
+  switch(nbr->state) {
+  case NBR_REACHABLE:
+    if(stimer_expired(&nbr->reachable)) {
 #if UIP_CONF_ROUTER
-        /* when a neighbor leave its REACHABLE state and is a default router,
-           instead of going to STALE state it enters DELAY state in order to
-           force a NUD on it. Otherwise, if there is no upward traffic, the
-           node never knows if the default router is still reachable. This
-           mimics the 6LoWPAN-ND behavior.
-         */
-        if(uip_ds6_defrt_lookup(&nbr->ipaddr) != NULL) {
-          LOG_INFO("REACHABLE: defrt moving to DELAY (");
-          LOG_INFO_6ADDR(&nbr->ipaddr);
-          LOG_INFO_(")\n");
-          nbr->state = NBR_DELAY;
-          stimer_set(&nbr->reachable, UIP_ND6_DELAY_FIRST_PROBE_TIME);
-          nbr->nscount = 0;
-        } else {
-          LOG_INFO("REACHABLE: moving to STALE (");
-          LOG_INFO_6ADDR(&nbr->ipaddr);
-          LOG_INFO_(")\n");
-          nbr->state = NBR_STALE;
-        }
-#else /* UIP_CONF_ROUTER */
+      /* when a neighbor leave its REACHABLE state and is a default router,
+         instead of going to STALE state it enters DELAY state in order to
+         force a NUD on it. Otherwise, if there is no upward traffic, the
+         node never knows if the default router is still reachable. This
+         mimics the 6LoWPAN-ND behavior.
+       */
+      if(uip_ds6_defrt_lookup(&nbr->ipaddr) != NULL) {
+        LOG_INFO("REACHABLE: defrt moving to DELAY (");
+        LOG_INFO_6ADDR(&nbr->ipaddr);
+        LOG_INFO_(")\n");
+        nbr->state = NBR_DELAY;
+        stimer_set(&nbr->reachable, UIP_ND6_DELAY_FIRST_PROBE_TIME);
+        nbr->nscount = 0;
+      } else {
         LOG_INFO("REACHABLE: moving to STALE (");
         LOG_INFO_6ADDR(&nbr->ipaddr);
         LOG_INFO_(")\n");
         nbr->state = NBR_STALE;
-#endif /* UIP_CONF_ROUTER */
       }
-      break;
-    case NBR_INCOMPLETE:
-      if(nbr->nscount >= UIP_ND6_MAX_MULTICAST_SOLICIT) {
-        uip_ds6_nbr_rm(nbr);
-      } else if(stimer_expired(&nbr->sendns) && (uip_len == 0)) {
-        nbr->nscount++;
-        LOG_INFO("NBR_INCOMPLETE: NS %u\n", nbr->nscount);
-        uip_nd6_ns_output(NULL, NULL, &nbr->ipaddr);
-        stimer_set(&nbr->sendns, uip_ds6_if.retrans_timer / 1000);
-      }
-      break;
-    case NBR_DELAY:
-      if(stimer_expired(&nbr->reachable)) {
-        nbr->state = NBR_PROBE;
-        nbr->nscount = 0;
-        LOG_INFO("DELAY: moving to PROBE\n");
-        stimer_set(&nbr->sendns, 0);
+#else /* UIP_CONF_ROUTER */
+      LOG_INFO("REACHABLE: moving to STALE (");
+      LOG_INFO_6ADDR(&nbr->ipaddr);
+      LOG_INFO_(")\n");
+      nbr->state = NBR_STALE;
+#endif /* UIP_CONF_ROUTER */
+    }
+    break;
+  case NBR_INCOMPLETE:
+    if(nbr->nscount >= UIP_ND6_MAX_MULTICAST_SOLICIT) {
+      uip_ds6_nbr_rm(nbr);
+      return 1;
+    } else if(stimer_expired(&nbr->sendns)) {
+      if(uip_len != 0) {
+        uip_ds6_nbr_reschedule(nbr);
+        return 0;
       }
-      break;
-    case NBR_PROBE:
-      if(nbr->nscount >= UIP_ND6_MAX_UNICAST_SOLICIT) {
-        uip_ds6_defrt_t *locdefrt;
-        LOG_INFO("PROBE END\n");
-        if((locdefrt = uip_ds6_defrt_lookup(&nbr->ipaddr)) != NULL) {
-          if (!locdefrt->isinfinite) {
-            uip_ds6_defrt_rm(locdefrt);
-          }
+      nbr->nscount++;
+      LOG_INFO("NBR_INCOMPLETE: NS %u\n", nbr->nscount);
+      uip_nd6_ns_output(NULL, NULL, &nbr->ipaddr);
+      stimer_set(&nbr->sendns, uip_ds6_if.retrans_timer / 1000);
+    }
+    break;
+  case NBR_DELAY:
+    if(stimer_expired(&nbr->reachable)) {
+      nbr->state = NBR_PROBE;
+      nbr->nscount = 0;
+      LOG_INFO("DELAY: moving to PROBE\n");
+      stimer_set(&nbr->sendns, 0);
+    }
+    break;
+  case NBR_PROBE:
+    if(nbr->nscount >= UIP_ND6_MAX_UNICAST_SOLICIT) {
+      uip_ds6_defrt_t *locdefrt;
+      LOG_INFO("PROBE END\n");
+      if((locdefrt = uip_ds6_defrt_lookup(&nbr->ipaddr)) != NULL) {
+        if (!locdefrt->isinfinite) {
+          uip_ds6_defrt_rm(locdefrt);
         }
-        uip_ds6_nbr_rm(nbr);
-      } else if(stimer_expired(&nbr->sendns) && (uip_len == 0)) {
-        nbr->nscount++;
-        LOG_INFO("PROBE: NS %u\n", nbr->nscount);
-        uip_nd6_ns_output(NULL, &nbr->ipaddr, &nbr->ipaddr);
-        stimer_set(&nbr->sendns, uip_ds6_if.retrans_timer / 1000);
       }
-      break;
-    default:
+      uip_ds6_nbr_rm(nbr);
+      return 1;
+    } else if(stimer_expired(&nbr->sendns)) {
+      if(uip_len != 0) {
+        uip_ds6_nbr_reschedule(nbr);
+        return 0;
+      }
+      nbr->nscount++;
+      LOG_INFO("PROBE: NS %u\n", nbr->nscount);
+      uip_nd6_ns_output(NULL, &nbr->ipaddr, &nbr->ipaddr);
+      stimer_set(&nbr->sendns, uip_ds6_if.retrans_timer / 1000);
+    }
+    break;
+  default:
+    break;
+  }
+
+  /* Requeue according to the new state, or drop from the queue */
+  uip_ds6_nbr_reschedule(nbr);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/** Periodic processing on neighbors. Only the neighbors at the head of the
+ * expiry queue are looked at. */
+void
+uip_ds6_neighbor_periodic(void)
+{
+  uip_ds6_nbr_t *nbr;
+  unsigned long now = clock_seconds();
+
+  while(expiry_queue != NULL && !DEADLINE_BEFORE(now, expiry_queue->expiry)) {
+    nbr = expiry_queue;
+    expiry_queue = nbr->expiry_next;
+    nbr->expiry_next = NULL;
+    if(!nbr_expired(nbr)) {
+      /* Retry on the next period */
       break;
     }
-    nbr = uip_ds6_nbr_next(nbr);
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -692,9 +839,14 @@ uip_ds6_nbr_refresh_reachable_state(const uip_ipaddr_t *ipaddr)
   uip_ds6_nbr_t *nbr;
   nbr = uip_ds6_nbr_lookup(ipaddr);
   if(nbr != NULL) {
+    /* STALE neighbors are not queued, other deadlines only move later */
+    int requeue = nbr->state == NBR_STALE;
     nbr->state = NBR_REACHABLE;
     nbr->nscount = 0;
     stimer_set(&nbr->reachable, UIP_ND6_REACHABLE_TIME / 1000);
+    if(requeue) {
+      uip_ds6_nbr_reschedule(nbr);
+    }
   }
 }
 #endif /* UIP_ND6_SEND_NS */
@@ -115,6 +115,10 @@ typedef struct uip_ds6_nbr {
   struct stimer sendns;
   uint8_t nscount;
 #endif /* UIP_ND6_SEND_NS || UIP_ND6_SEND_RA */
+#if UIP_ND6_SEND_NS
+  struct uip_ds6_nbr *expiry_next; /* Next entry in the NUD expiry queue */
+  unsigned long expiry;            /* Next NUD deadline, in clock_seconds() */
+#endif /* UIP_ND6_SEND_NS */
 #if UIP_CONF_IPV6_QUEUE_PKT
   struct uip_packetqueue_handle packethandle;
 #define UIP_DS6_NBR_PACKET_LIFETIME CLOCK_SECOND * 4
@@ -232,7 +236,18 @@ uip_ds6_nbr_t *uip_ds6_nbr_next(uip_ds6_nbr_t *nbr);
 void uip_ds6_link_callback(int status, int numtx);
 
 /**
- * The housekeeping function called periodically
+ * Confirm the reachability of all neighbor cache entries of a
+ * link-layer address from lower-layer or routing feedback: link-layer
+ * ACKs (including TSCH keepalives) and RPL DIO reception. Entries that
+ * are not INCOMPLETE move to REACHABLE, which suppresses NUD probes.
+ * Only has an effect when UIP_DS6_LL_NUD is enabled.
+ * \param lladdr the link-layer address of the neighbor
+ */
+void uip_ds6_nbr_confirm_reachable(const linkaddr_t *lladdr);
+
+/**
+ * The housekeeping function called periodically. Only neighbors whose
+ * NUD deadline has passed are processed.
  */
 void uip_ds6_neighbor_periodic(void);
 
@@ -245,6 +260,15 @@ void uip_ds6_neighbor_periodic(void);
  * should be refreshed.
  */
 void uip_ds6_nbr_refresh_reachable_state(const uip_ipaddr_t *ipaddr);
+
+/**
+ * \brief Update the position of a neighbor in the NUD expiry queue. Must
+ * be called after moving a neighbor to a state with an earlier deadline
+ * than before, e.g. from STALE to DELAY. Later deadlines are picked up
+ * without it.
+ * \param nbr the neighbor whose state or timers changed
+ */
+void uip_ds6_nbr_reschedule(uip_ds6_nbr_t *nbr);
 #endif /* UIP_ND6_SEND_NS */
 
 #endif /* UIP_DS6_NEIGHBOR_H_ */
@@ -45,6 +45,7 @@
 #include "net/routing/routing.h"
 #include "lib/list.h"
 #include "lib/memb.h"
+#include <string.h>
 
 /* Log configuration */
 #include "sys/log.h"
@@ -54,10 +55,25 @@
 /* Total number of nodes */
 static int num_nodes;
 
+/* Incremented whenever source routes may change */
+static uint16_t generation;
+
+#if UIP_SR_CHANGE_LOG_SIZE > 0
+/* The last changes of the graph, indexed by sequence number */
+static uip_sr_change_t change_log[UIP_SR_CHANGE_LOG_SIZE];
+#endif /* UIP_SR_CHANGE_LOG_SIZE > 0 */
+static uint32_t change_seqno;
+
 /* Every known node in the network */
 LIST(nodelist);
 MEMB(nodememb, uip_sr_node_t, UIP_SR_LINK_NUM);
 
+#if UIP_SR_HDR_CACHE_SIZE > 0
+/* Cached routing headers, most recently used first */
+LIST(hdr_cache);
+MEMB(hdr_cache_memb, uip_sr_hdr_cache_t, UIP_SR_HDR_CACHE_SIZE);
+#endif /* UIP_SR_HDR_CACHE_SIZE > 0 */
+
 /*---------------------------------------------------------------------------*/
 int
 uip_sr_num_nodes(void)
@@ -65,6 +81,56 @@ uip_sr_num_nodes(void)
   return num_nodes;
 }
 /*---------------------------------------------------------------------------*/
+uint16_t
+uip_sr_generation(void)
+{
+  return generation;
+}
+/*---------------------------------------------------------------------------*/
+static void
+topology_changed(uint8_t type, const uip_sr_node_t *node)
+{
+#if UIP_SR_CHANGE_LOG_SIZE > 0
+  uip_sr_change_t *change;
+#endif /* UIP_SR_CHANGE_LOG_SIZE > 0 */
+
+  generation++;
+  change_seqno++;
+
+#if UIP_SR_CHANGE_LOG_SIZE > 0
+  change = &change_log[change_seqno % UIP_SR_CHANGE_LOG_SIZE];
+  memset(change, 0, sizeof(uip_sr_change_t));
+  change->seqno = change_seqno;
+  change->type = type;
+  if(node != NULL) {
+    change->graph = node->graph;
+    memcpy(change->link_identifier, node->link_identifier, 8);
+    if(type != UIP_SR_CHANGE_REMOVED && node->parent != NULL) {
+      change->has_parent = 1;
+      memcpy(change->parent_identifier, node->parent->link_identifier, 8);
+    }
+  }
+#endif /* UIP_SR_CHANGE_LOG_SIZE > 0 */
+}
+/*---------------------------------------------------------------------------*/
+uint32_t
+uip_sr_change_seqno(void)
+{
+  return change_seqno;
+}
+/*---------------------------------------------------------------------------*/
+const uip_sr_change_t *
+uip_sr_change_get(uint32_t seqno)
+{
+#if UIP_SR_CHANGE_LOG_SIZE > 0
+  if(seqno != 0 && seqno <= change_seqno
+     && change_seqno - seqno < UIP_SR_CHANGE_LOG_SIZE) {
+    return &change_log[seqno % UIP_SR_CHANGE_LOG_SIZE];
+  }
+#endif /* UIP_SR_CHANGE_LOG_SIZE > 0 */
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
 static int
 node_matches_address(const void *graph, const uip_sr_node_t *node,
                      const uip_ipaddr_t *addr)
@@ -130,6 +196,7 @@ uip_sr_update_node(void *graph, const uip_ipaddr_t *child,
   uip_sr_node_t *child_node = uip_sr_get_node(graph, child);
   uip_sr_node_t *parent_node = uip_sr_get_node(graph, parent);
   uip_sr_node_t *old_parent_node;
+  int is_new = 0;
 
   if(parent != NULL) {
     /* No node for the parent, add one with infinite lifetime */
@@ -155,16 +222,20 @@ uip_sr_update_node(void *graph, const uip_ipaddr_t *child,
     child_node->parent = NULL;
     list_add(nodelist, child_node);
     num_nodes++;
+    is_new = 1;
   }
 
   /* Initialize node */
+  if(child_node->graph != graph) {
+    generation++;
+  }
   child_node->graph = graph;
   child_node->lifetime = lifetime;
   memcpy(child_node->link_identifier, ((const unsigned char *)child) + 8, 8);
 
+  old_parent_node = child_node->parent;
   /* Is the node reachable before the update? */
   if(uip_sr_is_addr_reachable(graph, child)) {
-    old_parent_node = child_node->parent;
     /* Update node */
     child_node->parent = parent_node;
     /* Has the node become unreachable? May happen if we create a loop. */
@@ -177,6 +248,11 @@ uip_sr_update_node(void *graph, const uip_ipaddr_t *child,
   } else {
     child_node->parent = parent_node;
   }
+  if(is_new) {
+    topology_changed(UIP_SR_CHANGE_ADDED, child_node);
+  } else if(child_node->parent != old_parent_node) {
+    topology_changed(UIP_SR_CHANGE_PARENT, child_node);
+  }
 
   LOG_INFO("NS: updating link, child ");
   LOG_INFO_6ADDR(child);
@@ -191,8 +267,13 @@ void
 uip_sr_init(void)
 {
   num_nodes = 0;
+  generation++;
   memb_init(&nodememb);
   list_init(nodelist);
+#if UIP_SR_HDR_CACHE_SIZE > 0
+  memb_init(&hdr_cache_memb);
+  list_init(hdr_cache);
+#endif /* UIP_SR_HDR_CACHE_SIZE > 0 */
 }
 /*---------------------------------------------------------------------------*/
 uip_sr_node_t *
@@ -207,6 +288,58 @@ uip_sr_node_next(const uip_sr_node_t *item)
   return list_item_next(item);
 }
 /*---------------------------------------------------------------------------*/
+const uip_sr_hdr_cache_t *
+uip_sr_hdr_cache_lookup(const void *graph, const uip_ipaddr_t *dest)
+{
+#if UIP_SR_HDR_CACHE_SIZE > 0
+  uip_sr_hdr_cache_t *e;
+  uip_sr_hdr_cache_t *next;
+
+  for(e = list_head(hdr_cache); e != NULL; e = next) {
+    next = list_item_next(e);
+    if(e->generation != generation) {
+      /* Built from an older graph, drop */
+      list_remove(hdr_cache, e);
+      memb_free(&hdr_cache_memb, e);
+    } else if(e->graph == graph && uip_ipaddr_cmp(&e->dest, dest)) {
+      /* Move to the front, so that the least recently used gets evicted */
+      list_remove(hdr_cache, e);
+      list_push(hdr_cache, e);
+      return e;
+    }
+  }
+#endif /* UIP_SR_HDR_CACHE_SIZE > 0 */
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_sr_hdr_cache_add(const void *graph, const uip_ipaddr_t *dest,
+                     const uip_ipaddr_t *next_hop,
+                     const uint8_t *hdr, uint8_t len)
+{
+#if UIP_SR_HDR_CACHE_SIZE > 0
+  uip_sr_hdr_cache_t *e;
+
+  if(len > UIP_SR_HDR_CACHE_MAX_LEN) {
+    return;
+  }
+
+  e = memb_alloc(&hdr_cache_memb);
+  if(e == NULL) {
+    /* Full, reuse the least recently used */
+    e = list_chop(hdr_cache);
+  }
+
+  e->graph = graph;
+  uip_ipaddr_copy(&e->dest, dest);
+  uip_ipaddr_copy(&e->next_hop, next_hop);
+  e->generation = generation;
+  e->len = len;
+  memcpy(e->hdr, hdr, len);
+  list_push(hdr_cache, e);
+#endif /* UIP_SR_HDR_CACHE_SIZE > 0 */
+}
+/*---------------------------------------------------------------------------*/
 void
 uip_sr_periodic(unsigned seconds)
 {
@@ -234,6 +367,7 @@ uip_sr_periodic(unsigned seconds)
           LOG_INFO_6ADDR(&node_addr);
           LOG_INFO_("\n");
         }
+        topology_changed(UIP_SR_CHANGE_REMOVED, l);
         list_remove(nodelist, l);
         memb_free(&nodememb, l);
         num_nodes--;
@@ -255,6 +389,7 @@ uip_sr_free_all(void)
     memb_free(&nodememb, l);
     num_nodes--;
   }
+  topology_changed(UIP_SR_CHANGE_RESET, NULL);
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -85,6 +85,33 @@
 
 #define UIP_SR_INFINITE_LIFETIME           0xFFFFFFFF
 
+/* The number of source routing headers cached at the root, so that
+ * repeated packets to the same destination do not walk the graph again */
+#ifdef UIP_SR_CONF_HDR_CACHE_SIZE
+#define UIP_SR_HDR_CACHE_SIZE UIP_SR_CONF_HDR_CACHE_SIZE
+#elif UIP_SR_LINK_NUM != 0
+#define UIP_SR_HDR_CACHE_SIZE 4
+#else /* UIP_SR_CONF_HDR_CACHE_SIZE */
+#define UIP_SR_HDR_CACHE_SIZE 0
+#endif /* UIP_SR_CONF_HDR_CACHE_SIZE */
+
+/* The maximum length of a cached routing header. Longer headers, i.e.
+ * deeper destinations, are built for every packet. */
+#ifdef UIP_SR_CONF_HDR_CACHE_MAX_LEN
+#define UIP_SR_HDR_CACHE_MAX_LEN UIP_SR_CONF_HDR_CACHE_MAX_LEN
+#else /* UIP_SR_CONF_HDR_CACHE_MAX_LEN */
+#define UIP_SR_HDR_CACHE_MAX_LEN 64
+#endif /* UIP_SR_CONF_HDR_CACHE_MAX_LEN */
+
+/* The number of graph changes kept for monitoring, 0 to disable. Each
+ * change has a sequence number, so that a client can fetch the changes
+ * since the last it knows of rather than the whole graph. */
+#ifdef UIP_SR_CONF_CHANGE_LOG_SIZE
+#define UIP_SR_CHANGE_LOG_SIZE UIP_SR_CONF_CHANGE_LOG_SIZE
+#else /* UIP_SR_CONF_CHANGE_LOG_SIZE */
+#define UIP_SR_CHANGE_LOG_SIZE 0
+#endif /* UIP_SR_CONF_CHANGE_LOG_SIZE */
+
 /********** Data Structures  **********/
 
 /** \brief A node in a source routing graph, stored at the root and representing
@@ -100,6 +127,38 @@ typedef struct uip_sr_node {
   struct uip_sr_node *parent;
 } uip_sr_node_t;
 
+/** \brief A routing header built by the routing protocol for a given
+ * destination, valid as long as the graph does not change */
+typedef struct uip_sr_hdr_cache {
+  struct uip_sr_hdr_cache *next;
+  const void *graph;
+  /* The final destination */
+  uip_ipaddr_t dest;
+  /* The first hop, to be used as IPv6 destination */
+  uip_ipaddr_t next_hop;
+  uint16_t generation;
+  uint8_t len;
+  uint8_t hdr[UIP_SR_HDR_CACHE_MAX_LEN];
+} uip_sr_hdr_cache_t;
+
+/* The types of graph changes */
+#define UIP_SR_CHANGE_ADDED   0 /* A node was added */
+#define UIP_SR_CHANGE_PARENT  1 /* A node changed parent */
+#define UIP_SR_CHANGE_REMOVED 2 /* A node expired and was removed */
+#define UIP_SR_CHANGE_RESET   3 /* All nodes were removed */
+
+/** \brief A change of the source routing graph */
+typedef struct uip_sr_change {
+  uint32_t seqno;
+  const void *graph;
+  uint8_t type;
+  uint8_t has_parent;
+  /* The node that changed, unused for UIP_SR_CHANGE_RESET */
+  unsigned char link_identifier[8];
+  /* Its new parent, if has_parent is set */
+  unsigned char parent_identifier[8];
+} uip_sr_change_t;
+
 /********** Public functions **********/
 
 /**
@@ -109,6 +168,30 @@ typedef struct uip_sr_node {
  */
 int uip_sr_num_nodes(void);
 
+/**
+ * Tells the generation of the graph. The generation changes whenever a
+ * node is added or removed, or a node changes parent, i.e. whenever a
+ * source route may have changed.
+ *
+ * \return The current generation
+ */
+uint16_t uip_sr_generation(void);
+
+/**
+ * Tells the sequence number of the last change of the graph
+ *
+ * \return The sequence number, 0 if the graph never changed
+ */
+uint32_t uip_sr_change_seqno(void);
+
+/**
+ * Returns a change of the graph from the change log
+ *
+ * \param seqno The sequence number of the change
+ * \return The change, or NULL if it is not in the log (anymore)
+ */
+const uip_sr_change_t *uip_sr_change_get(uint32_t seqno);
+
 /**
  * Expires a given child-parent link
  *
@@ -165,6 +248,30 @@ uip_sr_node_t *uip_sr_get_node(const void *graph, const uip_ipaddr_t *addr);
  */
 int uip_sr_is_addr_reachable(const void *graph, const uip_ipaddr_t *addr);
 
+/**
+ * Looks up the cached routing header to a destination. Headers cached
+ * before the last change of the graph are dropped.
+ *
+ * \param graph The graph the destination belongs to
+ * \param dest The final IPv6 destination
+ * \return The cached header, or NULL if none is valid
+ */
+const uip_sr_hdr_cache_t *uip_sr_hdr_cache_lookup(const void *graph,
+                                                  const uip_ipaddr_t *dest);
+
+/**
+ * Caches the routing header to a destination, built from the current graph
+ *
+ * \param graph The graph the destination belongs to
+ * \param dest The final IPv6 destination
+ * \param next_hop The first hop, used as IPv6 destination with the header
+ * \param hdr The routing header
+ * \param len The length of the routing header
+ */
+void uip_sr_hdr_cache_add(const void *graph, const uip_ipaddr_t *dest,
+                          const uip_ipaddr_t *next_hop,
+                          const uint8_t *hdr, uint8_t len);
+
 /**
  * A function called periodically. Used to age the links (decrease lifetime
  * and expire links accordingly)
@@ -37,6 +37,7 @@
 #include "net/nbr-table.h"
 #include "net/link-stats.h"
 #include <stdio.h>
+#include <string.h>
 
 /* Log configuration */
 #include "sys/log.h"
@@ -67,6 +68,11 @@
 /* Initial ETX value */
 #define ETX_DEFAULT                      2
 
+/* Flag set in a Tx window sample when the packet was ACKed */
+#define WINDOW_TX_ACKED               0x80
+/* Largest Tx count that fits in a Tx window sample */
+#define WINDOW_TX_MAX                 0x7f
+
 #define RSSI_DIFF (LINK_STATS_RSSI_HIGH - LINK_STATS_RSSI_LOW)
 
 /* Generate error on incorrect link stats configuration values */
@@ -100,6 +106,20 @@ link_stats_get_lladdr(const struct link_stats *stat)
   return nbr_table_get_lladdr(link_stats, stat);
 }
 /*---------------------------------------------------------------------------*/
+/* Returns the first entry of the link statistics table */
+const struct link_stats *
+link_stats_head(void)
+{
+  return nbr_table_head(link_stats);
+}
+/*---------------------------------------------------------------------------*/
+/* Returns the entry following a given one in the link statistics table */
+const struct link_stats *
+link_stats_next(const struct link_stats *stats)
+{
+  return nbr_table_next(link_stats, (struct link_stats *)stats);
+}
+/*---------------------------------------------------------------------------*/
 /* Are the statistics fresh? */
 int
 link_stats_is_fresh(const struct link_stats *stats)
@@ -136,6 +156,108 @@ guess_etx_from_rssi(const struct link_stats *stats)
 }
 #endif /* LINK_STATS_INIT_ETX_FROM_RSSI */
 /*---------------------------------------------------------------------------*/
+#if LINK_STATS_WINDOW_SIZE
+static void
+window_add_tx(struct link_stats *stats, int status, int numtx)
+{
+  struct link_stats_ring *w = &stats->window;
+
+  w->tx[w->tx_head] = MIN(numtx, WINDOW_TX_MAX)
+    | (status == MAC_TX_OK ? WINDOW_TX_ACKED : 0);
+  w->tx_head = (w->tx_head + 1) % LINK_STATS_WINDOW_SIZE;
+  if(w->tx_len < LINK_STATS_WINDOW_SIZE) {
+    w->tx_len++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+window_add_rssi(struct link_stats *stats, int16_t rssi)
+{
+  struct link_stats_ring *w = &stats->window;
+
+  w->rssi[w->rssi_head] = BOUND(rssi, INT8_MIN, INT8_MAX);
+  w->rssi_head = (w->rssi_head + 1) % LINK_STATS_WINDOW_SIZE;
+  if(w->rssi_len < LINK_STATS_WINDOW_SIZE) {
+    w->rssi_len++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* ETX of a Tx window sample, using ETX_DIVISOR as fixed point divisor. Same
+ * per-packet ETX as fed to the EWMA, including the no-ACK penalty. */
+static uint32_t
+window_sample_etx(uint8_t sample)
+{
+  uint32_t numtx = sample & WINDOW_TX_MAX;
+  if(!(sample & WINDOW_TX_ACKED)) {
+    numtx += ETX_NOACK_PENALTY;
+  }
+  return numtx * ETX_DIVISOR;
+}
+/*---------------------------------------------------------------------------*/
+/* Computes statistics over the window of recent samples */
+int
+link_stats_get_window(const struct link_stats *stats,
+                      struct link_stats_window *window)
+{
+  const struct link_stats_ring *w;
+  uint32_t sum;
+  uint32_t mean;
+  uint32_t var;
+  uint8_t acked;
+  int32_t rssi_sum;
+  uint8_t i;
+
+  memset(window, 0, sizeof(*window));
+  window->rssi = LINK_STATS_RSSI_UNKNOWN;
+  if(stats == NULL) {
+    return 0;
+  }
+  w = &stats->window;
+
+  if(w->rssi_len > 0) {
+    rssi_sum = 0;
+    for(i = 0; i < w->rssi_len; i++) {
+      rssi_sum += w->rssi[i];
+    }
+    window->rssi = rssi_sum / w->rssi_len;
+    window->rssi_samples = w->rssi_len;
+  }
+
+  if(w->tx_len == 0) {
+    return 0;
+  }
+
+  /* Mean. Ring order does not matter here, only the valid samples do: as
+   * long as the ring is not full, they are the first tx_len ones. */
+  sum = 0;
+  acked = 0;
+  for(i = 0; i < w->tx_len; i++) {
+    sum += window_sample_etx(w->tx[i]);
+    if(w->tx[i] & WINDOW_TX_ACKED) {
+      acked++;
+    }
+  }
+  mean = sum / w->tx_len;
+
+  /* Variance, second pass. Each squared deviation is scaled down to the
+   * ETX_DIVISOR fixed point before summing to stay within 32 bits. */
+  var = 0;
+  for(i = 0; i < w->tx_len; i++) {
+    uint32_t etx = window_sample_etx(w->tx[i]);
+    uint32_t dev = etx > mean ? etx - mean : mean - etx;
+    var += dev * dev / ETX_DIVISOR;
+  }
+  var /= w->tx_len;
+
+  window->etx = MIN(mean, 0xffff);
+  window->etx_variance = MIN(var, 0xffff);
+  window->pdr = (uint16_t)acked * 100 / w->tx_len;
+  window->tx_samples = w->tx_len;
+
+  return w->tx_len;
+}
+#endif /* LINK_STATS_WINDOW_SIZE */
+/*---------------------------------------------------------------------------*/
 /* Packet sent callback. Updates stats for transmissions to lladdr */
 void
 link_stats_packet_sent(const linkaddr_t *lladdr, int status, int numtx)
@@ -178,6 +300,10 @@ link_stats_packet_sent(const linkaddr_t *lladdr, int status, int numtx)
   stats->last_tx_time = clock_time();
   stats->freshness = MIN(stats->freshness + numtx, FRESHNESS_MAX);
 
+#if LINK_STATS_WINDOW_SIZE
+  window_add_tx(stats, status, numtx);
+#endif /* LINK_STATS_WINDOW_SIZE */
+
 #if LINK_STATS_PACKET_COUNTERS
   /* Update paket counters */
   stats->cnt_current.num_packets_tx += numtx;
@@ -254,6 +380,10 @@ link_stats_input_callback(const linkaddr_t *lladdr)
         (int32_t)packet_rssi * EWMA_ALPHA) / EWMA_SCALE;
   }
 
+#if LINK_STATS_WINDOW_SIZE
+  window_add_rssi(stats, packet_rssi);
+#endif /* LINK_STATS_WINDOW_SIZE */
+
   if(stats->etx == 0) {
     /* Initialize ETX */
 #if LINK_STATS_INIT_ETX_FROM_RSSI
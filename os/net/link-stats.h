@@ -84,6 +84,18 @@
 #define LINK_STATS_RSSI_LOW                -90
 #endif /* LINK_STATS_RSSI_LOW */
 
+/* Size of the per-neighbor window of recent Tx outcomes and RSSI samples,
+ * used for windowed ETX mean/variance and delivery ratio. 0 disables it. */
+#ifdef LINK_STATS_CONF_WINDOW_SIZE
+#define LINK_STATS_WINDOW_SIZE LINK_STATS_CONF_WINDOW_SIZE
+#else /* LINK_STATS_CONF_WINDOW_SIZE */
+#define LINK_STATS_WINDOW_SIZE               0
+#endif /* LINK_STATS_CONF_WINDOW_SIZE */
+
+#if LINK_STATS_WINDOW_SIZE > 255
+#error "LINK_STATS_WINDOW_SIZE must not exceed 255"
+#endif
+
 /* Special value that signal the RSSI is not initialized */
 #define LINK_STATS_RSSI_UNKNOWN 0x7fff
 
@@ -100,6 +112,28 @@ struct link_packet_counter {
   link_packet_stat_t num_queue_drops;
 };
 
+#if LINK_STATS_WINDOW_SIZE
+/* Ring buffer of the most recent samples of a link */
+struct link_stats_ring {
+  uint8_t tx[LINK_STATS_WINDOW_SIZE];   /* Tx count per packet, MSB set if ACKed */
+  int8_t rssi[LINK_STATS_WINDOW_SIZE];  /* RSSI per received packet */
+  uint8_t tx_head;                      /* Next Tx slot to write */
+  uint8_t tx_len;                       /* Number of valid Tx samples */
+  uint8_t rssi_head;                    /* Next RSSI slot to write */
+  uint8_t rssi_len;                     /* Number of valid RSSI samples */
+};
+
+/* Statistics computed over the window of recent samples of a link */
+struct link_stats_window {
+  uint16_t etx;          /* Mean ETX, using ETX_DIVISOR as fixed point divisor */
+  uint16_t etx_variance; /* ETX variance, using ETX_DIVISOR as fixed point divisor. Saturates at 0xffff. */
+  uint8_t pdr;           /* Delivery ratio: percentage of packets that were ACKed */
+  int16_t rssi;          /* Mean RSSI. LINK_STATS_RSSI_UNKNOWN if no samples. */
+  uint8_t tx_samples;    /* Number of Tx samples the above is computed from */
+  uint8_t rssi_samples;  /* Number of RSSI samples the above is computed from */
+};
+#endif /* LINK_STATS_WINDOW_SIZE */
+
 
 /* All statistics of a given link */
 struct link_stats {
@@ -116,12 +150,20 @@ struct link_stats {
   struct link_packet_counter cnt_current; /* packets in the current period */
   struct link_packet_counter cnt_total;   /* packets in total */
 #endif
+
+#if LINK_STATS_WINDOW_SIZE
+  struct link_stats_ring window;          /* recent samples */
+#endif /* LINK_STATS_WINDOW_SIZE */
 };
 
 /* Returns the neighbor's link statistics */
 const struct link_stats *link_stats_from_lladdr(const linkaddr_t *lladdr);
 /* Returns the address of the neighbor */
 const linkaddr_t *link_stats_get_lladdr(const struct link_stats *);
+/* Returns the first entry of the link statistics table */
+const struct link_stats *link_stats_head(void);
+/* Returns the entry following a given one in the link statistics table */
+const struct link_stats *link_stats_next(const struct link_stats *stats);
 /* Are the statistics fresh? */
 int link_stats_is_fresh(const struct link_stats *stats);
 /* Resets link-stats module */
@@ -132,5 +174,9 @@ void link_stats_init(void);
 void link_stats_packet_sent(const linkaddr_t *lladdr, int status, int numtx);
 /* Packet input callback. Updates statistics for receptions on a given link */
 void link_stats_input_callback(const linkaddr_t *lladdr);
+#if LINK_STATS_WINDOW_SIZE
+/* Computes statistics over the window of recent samples. Returns the number of Tx samples. */
+int link_stats_get_window(const struct link_stats *stats, struct link_stats_window *window);
+#endif /* LINK_STATS_WINDOW_SIZE */
 
 #endif /* LINK_STATS_H_ */
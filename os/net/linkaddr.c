@@ -43,6 +43,7 @@
  */
 
 #include "net/linkaddr.h"
+#include "net/mac/framer/framer-802154.h"
 #include <string.h>
 
 linkaddr_t linkaddr_node_addr;
@@ -71,4 +72,12 @@ linkaddr_cmp(const linkaddr_t *addr1, const linkaddr_t *addr2)
 	return (memcmp(addr1, addr2, LINKADDR_SIZE) == 0);
 }
 /*---------------------------------------------------------------------------*/
+void
+linkaddr_set_node_addr(linkaddr_t *addr)
+{
+	linkaddr_copy(&linkaddr_node_addr, addr);
+	/* Cached frame headers carry the old source address */
+	framer_802154_flush_hdr_cache();
+}
+/*---------------------------------------------------------------------------*/
 /** @} */
@@ -121,10 +121,7 @@ extern const linkaddr_t linkaddr_null;
  *             This function sets the link-layer address of the node.
  *
  */
-static inline void linkaddr_set_node_addr(linkaddr_t *addr)
-{
-  linkaddr_copy(&linkaddr_node_addr, addr);
-}
+void linkaddr_set_node_addr(linkaddr_t *addr);
 
 #endif /* LINKADDR_H_ */
 /** @} */
@@ -65,6 +65,7 @@
 
 #include "sys/cc.h"
 #include "net/mac/framer/frame802154.h"
+#include "net/mac/framer/framer-802154.h"
 #include "net/mac/llsec802154.h"
 #include "net/linkaddr.h"
 #include <string.h>
@@ -130,7 +131,10 @@ frame802154_get_pan_id(void)
 void
 frame802154_set_pan_id(uint16_t pan_id)
 {
-  mac_pan_id = pan_id;
+  if(pan_id != mac_pan_id) {
+    mac_pan_id = pan_id;
+    framer_802154_flush_hdr_cache();
+  }
 }
 /*----------------------------------------------------------------------------*/
 /* Tells whether a given Frame Control Field indicates a frame with
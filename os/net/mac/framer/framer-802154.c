@@ -47,17 +47,191 @@
 #define LOG_MODULE "Frame 15.4"
 #define LOG_LEVEL LOG_LEVEL_FRAMER
 
+#if FRAMER_802154_HDR_CACHE_SIZE
+
+/* Largest header we build: FCF, sequence number, two PAN IDs, two long
+ * addresses and an auxiliary security header with a 9-byte key ID */
+#define HDR_CACHE_MAX_LEN (2 + 1 + 2 + 8 + 2 + 8 + 1 + 4 + 9)
+
+#define HDR_FLAG_BROADCAST    0x01
+#define HDR_FLAG_ACK          0x02
+#define HDR_FLAG_IE_PRESENT   0x04
+#define HDR_FLAG_NO_SRC_ADDR  0x08
+#define HDR_FLAG_NO_DEST_ADDR 0x10
+
+/* Everything that the header depends on, except the sequence number
+ * and the frame counter */
+struct hdr_key {
+  linkaddr_t dest;
+  linkaddr_t src;
+  uint16_t pan_id;
+  uint8_t frame_type;
+  uint8_t flags;
+  uint8_t security_level;
+  uint8_t key_id_mode;
+  uint8_t key_index;
+};
+
+struct hdr_template {
+  struct hdr_key key;
+  uint8_t hdr[HDR_CACHE_MAX_LEN];
+  uint8_t hdr_len; /* 0 for an unused entry */
+  uint8_t seqno_pos; /* 0 if the sequence number is suppressed */
+  uint8_t counter_pos; /* 0 if there is no frame counter */
+};
+
+static struct hdr_template hdr_cache[FRAMER_802154_HDR_CACHE_SIZE];
+static uint8_t hdr_cache_next;
+
+/*---------------------------------------------------------------------------*/
+static void
+hdr_cache_get_key(struct hdr_key *key)
+{
+  /* The key is compared with memcmp, clear the padding */
+  memset(key, 0, sizeof(*key));
+
+  if(packetbuf_holds_broadcast()) {
+    key->flags |= HDR_FLAG_BROADCAST;
+  } else {
+    linkaddr_copy(&key->dest, packetbuf_addr(PACKETBUF_ADDR_RECEIVER));
+    if(packetbuf_attr(PACKETBUF_ATTR_MAC_ACK)) {
+      key->flags |= HDR_FLAG_ACK;
+    }
+  }
+  linkaddr_copy(&key->src, packetbuf_addr(PACKETBUF_ADDR_SENDER));
+  key->pan_id = frame802154_get_pan_id();
+  key->frame_type = packetbuf_attr(PACKETBUF_ATTR_FRAME_TYPE);
+  if(packetbuf_attr(PACKETBUF_ATTR_MAC_METADATA)) {
+    key->flags |= HDR_FLAG_IE_PRESENT;
+  }
+  if(packetbuf_attr(PACKETBUF_ATTR_MAC_NO_SRC_ADDR) == 1) {
+    key->flags |= HDR_FLAG_NO_SRC_ADDR;
+  }
+  if(packetbuf_attr(PACKETBUF_ATTR_MAC_NO_DEST_ADDR) == 1) {
+    key->flags |= HDR_FLAG_NO_DEST_ADDR;
+  }
+#if LLSEC802154_USES_AUX_HEADER
+  key->security_level = packetbuf_attr(PACKETBUF_ATTR_SECURITY_LEVEL);
+#if LLSEC802154_USES_EXPLICIT_KEYS
+  key->key_id_mode = packetbuf_attr(PACKETBUF_ATTR_KEY_ID_MODE);
+  key->key_index = packetbuf_attr(PACKETBUF_ATTR_KEY_INDEX);
+#endif /* LLSEC802154_USES_EXPLICIT_KEYS */
+#endif /* LLSEC802154_USES_AUX_HEADER */
+}
+/*---------------------------------------------------------------------------*/
+static struct hdr_template *
+hdr_cache_lookup(const struct hdr_key *key)
+{
+  int i;
+
+  for(i = 0; i < FRAMER_802154_HDR_CACHE_SIZE; i++) {
+    if(hdr_cache[i].hdr_len != 0
+       && memcmp(&hdr_cache[i].key, key, sizeof(*key)) == 0) {
+      return &hdr_cache[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+hdr_cache_add(const struct hdr_key *key, const frame802154_t *params,
+              const uint8_t *hdr, int hdr_len)
+{
+  struct hdr_template *t;
+
+  if(hdr_len > HDR_CACHE_MAX_LEN) {
+    return;
+  }
+
+  /* Replace entries in round-robin order */
+  t = &hdr_cache[hdr_cache_next];
+  hdr_cache_next = (hdr_cache_next + 1) % FRAMER_802154_HDR_CACHE_SIZE;
+
+  memcpy(&t->key, key, sizeof(*key));
+  memcpy(t->hdr, hdr, hdr_len);
+  t->hdr_len = hdr_len;
+  /* The sequence number directly follows the FCF */
+  t->seqno_pos = params->fcf.sequence_number_suppression ? 0 : 2;
+  t->counter_pos = 0;
+#if LLSEC802154_USES_FRAME_COUNTER
+  if(params->fcf.security_enabled
+     && !params->aux_hdr.security_control.frame_counter_suppression) {
+    /* The frame counter is followed only by the key identifier */
+    int key_id_len = 0;
+#if LLSEC802154_USES_EXPLICIT_KEYS
+    if(params->aux_hdr.security_control.key_id_mode) {
+      key_id_len = (params->aux_hdr.security_control.key_id_mode - 1) * 4 + 1;
+    }
+#endif /* LLSEC802154_USES_EXPLICIT_KEYS */
+    t->counter_pos = hdr_len - key_id_len - 4;
+  }
+#endif /* LLSEC802154_USES_FRAME_COUNTER */
+}
+/*---------------------------------------------------------------------------*/
+static void
+hdr_cache_apply(const struct hdr_template *t, uint8_t *buf)
+{
+  memcpy(buf, t->hdr, t->hdr_len);
+  if(t->seqno_pos) {
+    buf[t->seqno_pos] = packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO);
+  }
+#if LLSEC802154_USES_FRAME_COUNTER
+  if(t->counter_pos) {
+    frame802154_frame_counter_t counter;
+    counter.u16[0] = packetbuf_attr(PACKETBUF_ATTR_FRAME_COUNTER_BYTES_0_1);
+    counter.u16[1] = packetbuf_attr(PACKETBUF_ATTR_FRAME_COUNTER_BYTES_2_3);
+    memcpy(buf + t->counter_pos, counter.u8, 4);
+  }
+#endif /* LLSEC802154_USES_FRAME_COUNTER */
+}
+#endif /* FRAMER_802154_HDR_CACHE_SIZE */
+/*---------------------------------------------------------------------------*/
+void
+framer_802154_flush_hdr_cache(void)
+{
+#if FRAMER_802154_HDR_CACHE_SIZE
+  memset(hdr_cache, 0, sizeof(hdr_cache));
+  hdr_cache_next = 0;
+#endif /* FRAMER_802154_HDR_CACHE_SIZE */
+}
 /*---------------------------------------------------------------------------*/
 static int
 create_frame(int do_create)
 {
   frame802154_t params;
   int hdr_len;
+#if FRAMER_802154_HDR_CACHE_SIZE
+  struct hdr_key key;
+  struct hdr_template *t;
+#endif /* FRAMER_802154_HDR_CACHE_SIZE */
 
   if(frame802154_get_pan_id() == 0xffff) {
     return -1;
   }
 
+#if FRAMER_802154_HDR_CACHE_SIZE
+  /* The PAN ID is part of the key, so a PAN change never hits a stale
+   * template */
+  hdr_cache_get_key(&key);
+  t = hdr_cache_lookup(&key);
+  if(t != NULL) {
+    if(!do_create) {
+      return t->hdr_len;
+    } else if(packetbuf_hdralloc(t->hdr_len)) {
+      hdr_cache_apply(t, packetbuf_hdrptr());
+
+      LOG_INFO("Out: %2X ", key.frame_type);
+      LOG_INFO_LLADDR(&key.dest);
+      LOG_INFO_(" %d %u (%u)\n", t->hdr_len, packetbuf_datalen(), packetbuf_totlen());
+
+      return t->hdr_len;
+    } else {
+      LOG_ERR("Out: too large header: %u\n", t->hdr_len);
+      return FRAMER_FAILED;
+    }
+  }
+#endif /* FRAMER_802154_HDR_CACHE_SIZE */
+
   /* init to zeros */
   memset(&params, 0, sizeof(params));
 
@@ -83,6 +257,9 @@ create_frame(int do_create)
     return hdr_len;
   } else if(packetbuf_hdralloc(hdr_len)) {
     frame802154_create(&params, packetbuf_hdrptr());
+#if FRAMER_802154_HDR_CACHE_SIZE
+    hdr_cache_add(&key, &params, packetbuf_hdrptr(), hdr_len);
+#endif /* FRAMER_802154_HDR_CACHE_SIZE */
 
     LOG_INFO("Out: %2X ", params.fcf.frame_type);
     LOG_INFO_LLADDR((const linkaddr_t *)params.dest_addr);
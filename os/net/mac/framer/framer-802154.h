@@ -42,11 +42,25 @@
 #include "net/packetbuf.h"
 #include "net/mac/framer/framer.h"
 
+/* Number of cached header templates, one per destination and set of
+ * header-relevant packetbuf attributes. Creating a frame with a cached
+ * template is a copy of the header followed by patching the sequence
+ * number and frame counter. 0 disables the cache. */
+#ifdef FRAMER_802154_CONF_HDR_CACHE_SIZE
+#define FRAMER_802154_HDR_CACHE_SIZE FRAMER_802154_CONF_HDR_CACHE_SIZE
+#else /* FRAMER_802154_CONF_HDR_CACHE_SIZE */
+#define FRAMER_802154_HDR_CACHE_SIZE 4
+#endif /* FRAMER_802154_CONF_HDR_CACHE_SIZE */
+
 /* Setup frame802154_t with use of a specified get_attr */
 void framer_802154_setup_params(packetbuf_attr_t (*get_attr)(uint8_t type),
                                 uint8_t dest_is_broadcast,
                                 frame802154_t *params);
 
+/* Drop all cached header templates. Called whenever the PAN ID, the node
+ * address or the TSCH PAN security changes. */
+void framer_802154_flush_hdr_cache(void);
+
 extern const struct framer framer_802154;
 
 #endif /* FRAMER_802154_H_ */
@@ -45,6 +45,7 @@
 
 #include "net/mac/tsch/tsch.h"
 #include <stdio.h>
+#include <string.h>
 #include <inttypes.h>
 
 #if TSCH_ADAPTIVE_TIMESYNC
@@ -71,6 +72,250 @@ tsch_adaptive_timesync_get_drift_ppm(void)
   return (long int)drift_ppm / 256;
 }
 /*---------------------------------------------------------------------------*/
+#if TSCH_ADAPTIVE_TIMESYNC_REGRESSION
+
+#if TSCH_ADAPTIVE_TIMESYNC_WINDOW > 16 || TSCH_ADAPTIVE_TIMESYNC_WINDOW < 3
+#error TSCH_ADAPTIVE_TIMESYNC_WINDOW must be in [3, 16]
+#endif
+#if TSCH_ADAPTIVE_TIMESYNC_STEP_COUNT > TSCH_ADAPTIVE_TIMESYNC_WINDOW || TSCH_ADAPTIVE_TIMESYNC_STEP_COUNT < 2
+#error TSCH_ADAPTIVE_TIMESYNC_STEP_COUNT must be in [2, TSCH_ADAPTIVE_TIMESYNC_WINDOW]
+#endif
+
+/* The duration of one rtimer tick, in ns */
+#define TICK_NS ((int32_t)(1000000000LL / RTIMER_SECOND))
+/* Residuals below this bound are never considered outliers, as they are in
+ * the range of the timestamping quantization */
+#define OUTLIER_MIN_NS (3 * TICK_NS)
+/* Drift uncertainty always accounted for, e.g. for slow temperature changes.
+ * Expressed in ns per timeslot; equivalent to 1 ppm */
+#define MIN_UNCERTAINTY_NS_PER_SLOT ((int32_t)tsch_timing_us[tsch_ts_timeslot_length] / 1000)
+
+/* A point of the clock offset w.r.t. the time source, before local drift
+ * compensation. Both coordinates are relative to the oldest sample. */
+struct timesync_sample {
+  int32_t asn;
+  int32_t offset_ns;
+};
+/* The samples used for the fit, oldest first */
+static struct timesync_sample samples[TSCH_ADAPTIVE_TIMESYNC_WINDOW];
+/* The latest point, whether accepted as a sample or not */
+static struct timesync_sample current_point;
+/* The latest consecutive outliers, with the same sign */
+static struct timesync_sample outliers[TSCH_ADAPTIVE_TIMESYNC_STEP_COUNT];
+static uint8_t outlier_count;
+static int8_t outlier_sign;
+/* Weighted means of the last fit, through which the fitted line passes */
+static int32_t fit_mean_asn;
+static int32_t fit_mean_offset_ns;
+/* Smoothed absolute residual of the accepted samples, in ns */
+static int32_t jitter_ns;
+
+/*---------------------------------------------------------------------------*/
+/* Make all coordinates relative to the oldest sample */
+static void
+timesync_rebase(void)
+{
+  int32_t asn = samples[0].asn;
+  int32_t offset_ns = samples[0].offset_ns;
+  int i;
+
+  for(i = 0; i < timesync_entry_count; i++) {
+    samples[i].asn -= asn;
+    samples[i].offset_ns -= offset_ns;
+  }
+  for(i = 0; i < outlier_count; i++) {
+    outliers[i].asn -= asn;
+    outliers[i].offset_ns -= offset_ns;
+  }
+  current_point.asn -= asn;
+  current_point.offset_ns -= offset_ns;
+  fit_mean_asn -= asn;
+  fit_mean_offset_ns -= offset_ns;
+}
+/*---------------------------------------------------------------------------*/
+/* Weighted least-squares fit of the samples. More recent samples get a
+ * larger weight, so that the estimate follows slow drift changes.
+ * Returns the slope as drift in ppm * 256 */
+static int32_t
+timesync_fit(void)
+{
+  int64_t sw = 0, swx = 0, swy = 0;
+  int64_t sxx = 0, sxy = 0;
+  int64_t q;
+  int i;
+
+  for(i = 0; i < timesync_entry_count; i++) {
+    int32_t w = i + 1;
+    sw += w;
+    swx += (int64_t)w * samples[i].asn;
+    swy += (int64_t)w * samples[i].offset_ns;
+  }
+  fit_mean_asn = swx / sw;
+  fit_mean_offset_ns = swy / sw;
+
+  for(i = 0; i < timesync_entry_count; i++) {
+    int32_t w = i + 1;
+    int64_t dx = samples[i].asn - fit_mean_asn;
+    int64_t dy = samples[i].offset_ns - fit_mean_offset_ns;
+    sxx += w * dx * dx;
+    sxy += w * dx * dy;
+  }
+
+  if(sxx == 0) {
+    return drift_ppm;
+  }
+
+  /* Slope in ns per timeslot * 256, split to avoid overflows */
+  q = (sxy / sxx) * 256 + ((sxy % sxx) * 256) / sxx;
+  /* Convert to ppm * 256 */
+  return (int32_t)(q * 1000 / tsch_timing_us[tsch_ts_timeslot_length]);
+}
+/*---------------------------------------------------------------------------*/
+/* Expected error of the offset predicted by the fit, in ns */
+static int32_t
+timesync_expected_error_ns(uint32_t slots_since_sync)
+{
+  int32_t span = samples[timesync_entry_count - 1].asn - samples[0].asn;
+  int64_t uncertainty;
+
+  /* The slope uncertainty decreases with the span of the samples */
+  uncertainty = MIN_UNCERTAINTY_NS_PER_SLOT + (span > 0 ? 2 * (int64_t)jitter_ns / span : 2 * jitter_ns);
+  return (int32_t)MIN(INT32_MAX, TICK_NS + 2 * (int64_t)jitter_ns + uncertainty * slots_since_sync);
+}
+/*---------------------------------------------------------------------------*/
+/* Is the drift estimate good enough to rely on it for guard times and keep-alives? */
+static int
+timesync_is_confident(void)
+{
+  return last_timesource_neighbor != NULL
+    && timesync_entry_count >= TSCH_ADAPTIVE_TIMESYNC_WINDOW / 2
+    && outlier_count == 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Pick a keep-alive timeout such that we stay well within the default guard time */
+static void
+timesync_update_ka_timeout(void)
+{
+  uint32_t timeout = TSCH_KEEPALIVE_TIMEOUT;
+
+  if(timesync_is_confident()) {
+    /* The error budget is a quarter of the default guard time (i.e. half of
+     * the one-sided guard), leaving the rest for the neighbors' errors */
+    int64_t budget_ns = (int64_t)tsch_timing_us[tsch_ts_rx_wait] * 1000 / 4;
+    int32_t span = samples[timesync_entry_count - 1].asn - samples[0].asn;
+    int64_t uncertainty = MIN_UNCERTAINTY_NS_PER_SLOT + (span > 0 ? 2 * (int64_t)jitter_ns / span : 2 * jitter_ns);
+    int64_t slots = (budget_ns - TICK_NS - 2 * (int64_t)jitter_ns) / uncertainty;
+    if(slots > 0) {
+      uint64_t ticks = (uint64_t)slots * tsch_timing_us[tsch_ts_timeslot_length] * CLOCK_SECOND / 1000000;
+      timeout = (uint32_t)MIN(ticks, TSCH_MAX_KEEPALIVE_TIMEOUT);
+      timeout = MAX(timeout, TSCH_KEEPALIVE_TIMEOUT);
+    }
+  }
+
+  tsch_set_ka_timeout(timeout);
+}
+/*---------------------------------------------------------------------------*/
+/* Add a sample, reject outliers and detect drift steps */
+static void
+timesync_learn_drift_ticks(uint32_t time_delta_asn, int32_t drift_ticks)
+{
+  int32_t real_drift_ticks = drift_ticks + compensated_ticks;
+
+  current_point.asn += time_delta_asn;
+  current_point.offset_ns += (int32_t)((int64_t)real_drift_ticks * 1000000000 / RTIMER_SECOND);
+
+  if(timesync_entry_count == 0) {
+    /* First sample after a reset: the point of the previous synchronization
+     * is the origin */
+    samples[0].asn = 0;
+    samples[0].offset_ns = 0;
+    timesync_entry_count = 1;
+  }
+
+  if(timesync_entry_count >= 3) {
+    /* Residual w.r.t. the current fit */
+    int64_t predicted = fit_mean_offset_ns
+      + (int64_t)drift_ppm * (current_point.asn - fit_mean_asn) * tsch_timing_us[tsch_ts_timeslot_length] / 256000;
+    int32_t residual = (int32_t)(current_point.offset_ns - predicted);
+    int32_t threshold = MAX(OUTLIER_MIN_NS, 4 * jitter_ns);
+
+    if(ABS(residual) > threshold) {
+      int8_t sign = residual > 0 ? 1 : -1;
+      if(sign != outlier_sign) {
+        outlier_count = 0;
+        outlier_sign = sign;
+      }
+      outliers[outlier_count++] = current_point;
+      if(outlier_count < TSCH_ADAPTIVE_TIMESYNC_STEP_COUNT) {
+        /* Isolated outlier, e.g. a mis-timestamped frame: do not use it */
+        TSCH_LOG_ADD(tsch_log_message,
+            snprintf(log->message, sizeof(log->message),
+                "drift outlier %"PRId32" ns", residual));
+        timesync_update_ka_timeout();
+        return;
+      }
+      /* The drift has changed, e.g. due to a temperature step: restart
+       * the estimation from the recent outliers */
+      TSCH_LOG_ADD(tsch_log_message,
+          snprintf(log->message, sizeof(log->message),
+              "drift step detected"));
+      memcpy(samples, outliers, sizeof(outliers));
+      timesync_entry_count = TSCH_ADAPTIVE_TIMESYNC_STEP_COUNT;
+      outlier_count = 0;
+      outlier_sign = 0;
+      jitter_ns = 0;
+      timesync_rebase();
+      drift_ppm = timesync_fit();
+      timesync_update_ka_timeout();
+      return;
+    }
+    /* Track the typical residual to scale the outlier threshold */
+    jitter_ns += (ABS(residual) - jitter_ns) / 8;
+  }
+
+  outlier_count = 0;
+  outlier_sign = 0;
+
+  if(timesync_entry_count == TSCH_ADAPTIVE_TIMESYNC_WINDOW) {
+    /* Drop the oldest sample */
+    memmove(&samples[0], &samples[1], (TSCH_ADAPTIVE_TIMESYNC_WINDOW - 1) * sizeof(samples[0]));
+    timesync_entry_count--;
+  }
+  samples[timesync_entry_count++] = current_point;
+  timesync_rebase();
+
+  drift_ppm = timesync_fit();
+  timesync_update_ka_timeout();
+
+  TSCH_LOG_ADD(tsch_log_message,
+      snprintf(log->message, sizeof(log->message),
+          "drift %ld ppm (min/max delta seen: %"PRId32"/%"PRId32")",
+          tsch_adaptive_timesync_get_drift_ppm(),
+          min_drift_seen, max_drift_seen));
+}
+/*---------------------------------------------------------------------------*/
+rtimer_clock_t
+tsch_timesync_adaptive_rx_wait(const linkaddr_t *sender, uint32_t slots_since_sync)
+{
+#if TSCH_ADAPTIVE_GUARD_TIME
+  /* Only our error w.r.t. the time source is known: other neighbors may be
+   * up to a full keep-alive drift budget away, so keep the default guard */
+  if(!tsch_is_coordinator && timesync_is_confident()
+     && last_timesource_neighbor != NULL
+     && linkaddr_cmp(sender, tsch_queue_get_nbr_address(last_timesource_neighbor))) {
+    /* Listen for +/- the sum of our own and the sender's expected error */
+    int64_t rx_wait_us = 4 * (int64_t)timesync_expected_error_ns(slots_since_sync) / 1000;
+    rx_wait_us = MAX(rx_wait_us, TSCH_ADAPTIVE_GUARD_TIME_MIN_US);
+    if(rx_wait_us < tsch_timing_us[tsch_ts_rx_wait]) {
+      return US_TO_RTIMERTICKS(rx_wait_us);
+    }
+  }
+#endif /* TSCH_ADAPTIVE_GUARD_TIME */
+  return tsch_timing[tsch_ts_rx_wait];
+}
+/*---------------------------------------------------------------------------*/
+#else /* TSCH_ADAPTIVE_TIMESYNC_REGRESSION */
+/*---------------------------------------------------------------------------*/
 /* Add a value to a moving average estimator */
 static int32_t
 timesync_entry_add(int32_t val)
@@ -117,6 +362,14 @@ timesync_learn_drift_ticks(uint32_t time_delta_asn, int32_t drift_ticks)
           min_drift_seen, max_drift_seen));
 }
 /*---------------------------------------------------------------------------*/
+rtimer_clock_t
+tsch_timesync_adaptive_rx_wait(const linkaddr_t *sender, uint32_t slots_since_sync)
+{
+  return tsch_timing[tsch_ts_rx_wait];
+}
+/*---------------------------------------------------------------------------*/
+#endif /* TSCH_ADAPTIVE_TIMESYNC_REGRESSION */
+/*---------------------------------------------------------------------------*/
 /* Either reset or update the neighbor's drift */
 void
 tsch_timesync_update(struct tsch_neighbor *n, uint16_t time_delta_asn, int32_t drift_correction)
@@ -200,6 +453,13 @@ tsch_adaptive_timesync_reset(void)
   timesync_entry_count = 0;
   compensated_ticks = 0;
   asn_since_last_learning = 0;
+#if TSCH_ADAPTIVE_TIMESYNC_REGRESSION
+  current_point.asn = 0;
+  current_point.offset_ns = 0;
+  outlier_count = 0;
+  outlier_sign = 0;
+  jitter_ns = 0;
+#endif /* TSCH_ADAPTIVE_TIMESYNC_REGRESSION */
 }
 /*---------------------------------------------------------------------------*/
 #else /* TSCH_ADAPTIVE_TIMESYNC */
@@ -219,6 +479,12 @@ tsch_adaptive_timesync_reset(void)
 {
 }
 /*---------------------------------------------------------------------------*/
+rtimer_clock_t
+tsch_timesync_adaptive_rx_wait(const linkaddr_t *sender, uint32_t slots_since_sync)
+{
+  return tsch_timing[tsch_ts_rx_wait];
+}
+/*---------------------------------------------------------------------------*/
 long int
 tsch_adaptive_timesync_get_drift_ppm(void)
 {
@@ -43,6 +43,7 @@
 /********** Includes **********/
 
 #include "contiki.h"
+#include "net/linkaddr.h"
 
 /********** Functions *********/
 
@@ -67,6 +68,17 @@ int32_t tsch_timesync_adaptive_compensate(rtimer_clock_t delta_ticks);
  */
 long int tsch_adaptive_timesync_get_drift_ppm(void);
 
+/**
+ * \brief Gives the Rx guard time to use, given the expected synchronization error
+ * \param sender The link address of the expected sender
+ * \param slots_since_sync The number of slots elapsed since the last synchronization
+ * \return The Rx guard time in rtimer ticks; the default one unless
+ * TSCH_ADAPTIVE_GUARD_TIME is enabled, the drift estimate is accurate and
+ * the sender is our time source
+ */
+rtimer_clock_t tsch_timesync_adaptive_rx_wait(const linkaddr_t *sender,
+                                              uint32_t slots_since_sync);
+
 /**
  * \brief Reset the status of the module
  */
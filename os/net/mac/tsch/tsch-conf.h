@@ -125,6 +125,50 @@
 #define TSCH_ADAPTIVE_TIMESYNC 1
 #endif
 
+/* With TSCH_ADAPTIVE_TIMESYNC enabled: estimate the drift with a weighted
+ * least-squares fit over the recent (ASN, offset) samples, with outlier
+ * rejection and detection of drift steps (e.g. temperature changes), instead of
+ * averaging the drift measured over the last intervals. */
+#ifdef TSCH_CONF_ADAPTIVE_TIMESYNC_REGRESSION
+#define TSCH_ADAPTIVE_TIMESYNC_REGRESSION TSCH_CONF_ADAPTIVE_TIMESYNC_REGRESSION
+#else
+#define TSCH_ADAPTIVE_TIMESYNC_REGRESSION 0
+#endif
+
+/* With TSCH_ADAPTIVE_TIMESYNC_REGRESSION enabled: number of samples in the fit (max 16) */
+#ifdef TSCH_CONF_ADAPTIVE_TIMESYNC_WINDOW
+#define TSCH_ADAPTIVE_TIMESYNC_WINDOW TSCH_CONF_ADAPTIVE_TIMESYNC_WINDOW
+#else
+#define TSCH_ADAPTIVE_TIMESYNC_WINDOW 8
+#endif
+
+/* With TSCH_ADAPTIVE_TIMESYNC_REGRESSION enabled: number of consecutive
+ * outliers with the same sign after which the drift is considered to have
+ * changed, and the estimation restarts from the most recent samples */
+#ifdef TSCH_CONF_ADAPTIVE_TIMESYNC_STEP_COUNT
+#define TSCH_ADAPTIVE_TIMESYNC_STEP_COUNT TSCH_CONF_ADAPTIVE_TIMESYNC_STEP_COUNT
+#else
+#define TSCH_ADAPTIVE_TIMESYNC_STEP_COUNT 3
+#endif
+
+/* With TSCH_ADAPTIVE_TIMESYNC_REGRESSION enabled: shrink the Rx guard time
+ * (TSCH_CONF_RX_WAIT) according to the expected synchronization error, and
+ * adapt the keep-alive timeout to the confidence in the drift estimate.
+ * The guard time is only shrunk on links to our time source, the one neighbor
+ * whose offset to us is tracked; other neighbors get the default guard time. */
+#ifdef TSCH_CONF_ADAPTIVE_GUARD_TIME
+#define TSCH_ADAPTIVE_GUARD_TIME TSCH_CONF_ADAPTIVE_GUARD_TIME
+#else
+#define TSCH_ADAPTIVE_GUARD_TIME 0
+#endif
+
+/* With TSCH_ADAPTIVE_GUARD_TIME enabled: the minimum Rx guard time in micro-seconds */
+#ifdef TSCH_CONF_ADAPTIVE_GUARD_TIME_MIN_US
+#define TSCH_ADAPTIVE_GUARD_TIME_MIN_US TSCH_CONF_ADAPTIVE_GUARD_TIME_MIN_US
+#else
+#define TSCH_ADAPTIVE_GUARD_TIME_MIN_US 400
+#endif
+
 /* An ad-hoc mechanism to have TSCH select its time source without the
  * help of an upper-layer, simply by collecting statistics on received
  * EBs and their join priority. Disabled by default as we recomment
@@ -48,8 +48,10 @@
 #include "contiki.h"
 #include <stdio.h>
 #include <inttypes.h>
+#include <string.h>
 #include "net/mac/tsch/tsch.h"
 #include "lib/ringbufindex.h"
+#include "lib/crc16.h"
 #include "sys/log.h"
 
 #if TSCH_LOG_PER_SLOT
@@ -65,6 +67,178 @@ static struct tsch_log_t log_array[TSCH_LOG_QUEUE_LEN];
 static int log_dropped = 0;
 static int log_active = 0;
 
+#if TSCH_LOG_BINARY
+/* SLIP-style framing of binary records */
+#define BINARY_END              0xc0
+#define BINARY_ESC              0xdb
+#define BINARY_ESC_END          0xdc
+#define BINARY_ESC_ESC          0xdd
+
+/* Last slotframe looked up, saves a schedule walk for consecutive logs */
+static uint16_t last_sf_handle = 0xffff;
+static uint16_t last_sf_size;
+#endif /* TSCH_LOG_BINARY */
+
+/*---------------------------------------------------------------------------*/
+#if TSCH_LOG_BINARY
+static void
+binary_putchar(uint8_t c)
+{
+  if(c == BINARY_END) {
+    putchar(BINARY_ESC);
+    putchar(BINARY_ESC_END);
+  } else if(c == BINARY_ESC) {
+    putchar(BINARY_ESC);
+    putchar(BINARY_ESC_ESC);
+  } else {
+    putchar(c);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t *
+binary_put_u16(uint8_t *ptr, uint16_t val)
+{
+  *ptr++ = val & 0xff;
+  *ptr++ = val >> 8;
+  return ptr;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t *
+binary_put_addr(uint8_t *ptr, const linkaddr_t *addr)
+{
+  memset(ptr, 0, TSCH_LOG_BINARY_ADDR_LEN);
+  if(addr != NULL) {
+    memcpy(ptr, addr, MIN(LINKADDR_SIZE, TSCH_LOG_BINARY_ADDR_LEN));
+  }
+  return ptr + TSCH_LOG_BINARY_ADDR_LEN;
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+get_slotframe_size(uint16_t handle)
+{
+  if(handle != last_sf_handle) {
+    struct tsch_slotframe *sf = tsch_schedule_get_slotframe_by_handle(handle);
+    last_sf_handle = handle;
+    last_sf_size = sf ? sf->size.val : 0;
+  }
+  return last_sf_size;
+}
+/*---------------------------------------------------------------------------*/
+/* Write a tx or rx log as a framed binary record */
+static void
+write_log_binary(const struct tsch_log_t *log)
+{
+  uint8_t record[TSCH_LOG_BINARY_RECORD_LEN];
+  uint8_t *ptr = record;
+  uint16_t crc;
+  int i;
+
+  *ptr++ = TSCH_LOG_BINARY_VERSION;
+  *ptr++ = log->type;
+  *ptr++ = log->asn.ms1b;
+  ptr = binary_put_u16(ptr, log->asn.ls4b & 0xffff);
+  ptr = binary_put_u16(ptr, log->asn.ls4b >> 16);
+  if(log->link == NULL) {
+    ptr = binary_put_u16(ptr, 0xffff);
+    ptr = binary_put_u16(ptr, 0);
+    *ptr++ = log->burst_count;
+    ptr = binary_put_u16(ptr, 0);
+  } else {
+    ptr = binary_put_u16(ptr, log->link->slotframe_handle);
+    ptr = binary_put_u16(ptr, get_slotframe_size(log->link->slotframe_handle));
+    *ptr++ = log->burst_count;
+    ptr = binary_put_u16(ptr, log->link->timeslot + log->burst_count);
+  }
+  *ptr++ = log->channel_offset;
+  *ptr++ = log->channel;
+  if(log->type == tsch_log_tx) {
+    *ptr++ = (linkaddr_cmp(&log->tx.dest, &linkaddr_null) ? 0 : TSCH_LOG_BINARY_FLAG_UNICAST)
+      | (log->tx.is_data ? TSCH_LOG_BINARY_FLAG_DATA : 0)
+      | (log->tx.drift_used ? TSCH_LOG_BINARY_FLAG_DRIFT_USED : 0);
+    *ptr++ = log->tx.sec_level;
+    *ptr++ = log->tx.datalen;
+    *ptr++ = log->tx.seqno;
+    *ptr++ = (uint8_t)(int8_t)log->tx.mac_tx_status;
+    *ptr++ = log->tx.num_tx;
+    ptr = binary_put_u16(ptr, (uint16_t)(int16_t)log->tx.drift);
+    ptr = binary_put_u16(ptr, 0);
+    *ptr++ = LINKADDR_SIZE;
+    ptr = binary_put_addr(ptr, &linkaddr_node_addr);
+    ptr = binary_put_addr(ptr, &log->tx.dest);
+  } else {
+    *ptr++ = (log->rx.is_unicast ? TSCH_LOG_BINARY_FLAG_UNICAST : 0)
+      | (log->rx.is_data ? TSCH_LOG_BINARY_FLAG_DATA : 0)
+      | (log->rx.drift_used ? TSCH_LOG_BINARY_FLAG_DRIFT_USED : 0);
+    *ptr++ = log->rx.sec_level;
+    *ptr++ = log->rx.datalen;
+    *ptr++ = log->rx.seqno;
+    *ptr++ = 0;
+    *ptr++ = 0;
+    ptr = binary_put_u16(ptr, (uint16_t)(int16_t)log->rx.drift);
+    ptr = binary_put_u16(ptr, (uint16_t)(int16_t)log->rx.estimated_drift);
+    *ptr++ = LINKADDR_SIZE;
+    ptr = binary_put_addr(ptr, &log->rx.src);
+    ptr = binary_put_addr(ptr, log->rx.is_unicast ? &linkaddr_node_addr : NULL);
+  }
+  crc = crc16_data(record, ptr - record, 0);
+  ptr = binary_put_u16(ptr, crc);
+
+  putchar(BINARY_END);
+  for(i = 0; i < ptr - record; i++) {
+    binary_putchar(record[i]);
+  }
+  putchar(BINARY_END);
+}
+#endif /* TSCH_LOG_BINARY */
+/*---------------------------------------------------------------------------*/
+/* Print a log as a human-readable text line */
+static void
+print_log_text(const struct tsch_log_t *log)
+{
+  if(log->link == NULL) {
+    printf("[INFO: TSCH-LOG  ] {asn %02x.%08"PRIx32" link-NULL} ", log->asn.ms1b, log->asn.ls4b);
+  } else {
+    struct tsch_slotframe *sf = tsch_schedule_get_slotframe_by_handle(log->link->slotframe_handle);
+    printf("[INFO: TSCH-LOG  ] {asn %02x.%08"PRIx32" link %2u %3u %3u %2u %2u ch %2u} ",
+           log->asn.ms1b, log->asn.ls4b,
+           log->link->slotframe_handle, sf ? sf->size.val : 0,
+           log->burst_count, log->link->timeslot + log->burst_count, log->channel_offset,
+           log->channel);
+  }
+  switch(log->type) {
+    case tsch_log_tx:
+      printf("%s-%u-%u tx ",
+              linkaddr_cmp(&log->tx.dest, &linkaddr_null) ? "bc" : "uc", log->tx.is_data, log->tx.sec_level);
+      log_lladdr_compact(&linkaddr_node_addr);
+      printf("->");
+      log_lladdr_compact(&log->tx.dest);
+      printf(", len %3u, seq %3u, st %d %2d",
+              log->tx.datalen, log->tx.seqno, log->tx.mac_tx_status, log->tx.num_tx);
+      if(log->tx.drift_used) {
+        printf(", dr %3d", log->tx.drift);
+      }
+      printf("\n");
+      break;
+    case tsch_log_rx:
+      printf("%s-%u-%u rx ",
+              log->rx.is_unicast == 0 ? "bc" : "uc", log->rx.is_data, log->rx.sec_level);
+      log_lladdr_compact(&log->rx.src);
+      printf("->");
+      log_lladdr_compact(log->rx.is_unicast ? &linkaddr_node_addr : NULL);
+      printf(", len %3u, seq %3u",
+              log->rx.datalen, log->rx.seqno);
+      printf(", edr %3d", (int)log->rx.estimated_drift);
+      if(log->rx.drift_used) {
+        printf(", dr %3d\n", log->rx.drift);
+      } else {
+        printf("\n");
+      }
+      break;
+    case tsch_log_message:
+      printf("%s\n", log->message);
+      break;
+  }
+}
 /*---------------------------------------------------------------------------*/
 /* Process pending log messages */
 void
@@ -77,50 +251,20 @@ tsch_log_process_pending(void)
     printf("[WARN: TSCH-LOG  ] logs dropped %u\n", log_dropped);
     last_log_dropped = log_dropped;
   }
+#if TSCH_LOG_BINARY
+  /* The schedule may have changed since the last batch */
+  last_sf_handle = 0xffff;
+#endif /* TSCH_LOG_BINARY */
   while((log_index = ringbufindex_peek_get(&log_ringbuf)) != -1) {
     struct tsch_log_t *log = &log_array[log_index];
-    if(log->link == NULL) {
-      printf("[INFO: TSCH-LOG  ] {asn %02x.%08"PRIx32" link-NULL} ", log->asn.ms1b, log->asn.ls4b);
-    } else {
-      struct tsch_slotframe *sf = tsch_schedule_get_slotframe_by_handle(log->link->slotframe_handle);
-      printf("[INFO: TSCH-LOG  ] {asn %02x.%08"PRIx32" link %2u %3u %3u %2u %2u ch %2u} ",
-             log->asn.ms1b, log->asn.ls4b,
-             log->link->slotframe_handle, sf ? sf->size.val : 0,
-             log->burst_count, log->link->timeslot + log->burst_count, log->channel_offset,
-             log->channel);
-    }
-    switch(log->type) {
-      case tsch_log_tx:
-        printf("%s-%u-%u tx ",
-                linkaddr_cmp(&log->tx.dest, &linkaddr_null) ? "bc" : "uc", log->tx.is_data, log->tx.sec_level);
-        log_lladdr_compact(&linkaddr_node_addr);
-        printf("->");
-        log_lladdr_compact(&log->tx.dest);
-        printf(", len %3u, seq %3u, st %d %2d",
-                log->tx.datalen, log->tx.seqno, log->tx.mac_tx_status, log->tx.num_tx);
-        if(log->tx.drift_used) {
-          printf(", dr %3d", log->tx.drift);
-        }
-        printf("\n");
-        break;
-      case tsch_log_rx:
-        printf("%s-%u-%u rx ",
-                log->rx.is_unicast == 0 ? "bc" : "uc", log->rx.is_data, log->rx.sec_level);
-        log_lladdr_compact(&log->rx.src);
-        printf("->");
-        log_lladdr_compact(log->rx.is_unicast ? &linkaddr_node_addr : NULL);
-        printf(", len %3u, seq %3u",
-                log->rx.datalen, log->rx.seqno);
-        printf(", edr %3d", (int)log->rx.estimated_drift);
-        if(log->rx.drift_used) {
-          printf(", dr %3d\n", log->rx.drift);
-        } else {
-          printf("\n");
-        }
-        break;
-      case tsch_log_message:
-        printf("%s\n", log->message);
-        break;
+#if TSCH_LOG_BINARY
+    /* Free-form messages are rare, keep them as text */
+    if(log->type != tsch_log_message) {
+      write_log_binary(log);
+    } else
+#endif /* TSCH_LOG_BINARY */
+    {
+      print_log_text(log);
     }
     /* Remove input from ringbuf */
     ringbufindex_get(&log_ringbuf);
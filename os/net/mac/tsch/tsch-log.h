@@ -62,6 +62,32 @@
 #define TSCH_LOG_QUEUE_LEN 8
 #endif /* TSCH_LOG_CONF_QUEUE_LEN */
 
+/* Output per-slot logs as compact binary records rather than text lines.
+ * Records are fixed-size and framed with SLIP-style delimiters, so they can
+ * be interleaved with the regular text output on the same serial line.
+ * Use tools/tsch-log/tsch-log-decode.py to turn them back into text or CSV. */
+#ifdef TSCH_LOG_CONF_BINARY
+#define TSCH_LOG_BINARY TSCH_LOG_CONF_BINARY
+#else /* TSCH_LOG_CONF_BINARY */
+#define TSCH_LOG_BINARY 0
+#endif /* TSCH_LOG_CONF_BINARY */
+
+/* Binary log record format, all multi-byte fields are little endian:
+ *   version (1), type (1), ASN ms1b (1), ASN ls4b (4),
+ *   slotframe handle (2, 0xffff if no link), slotframe size (2),
+ *   burst count (1), timeslot (2), channel offset (1), channel (1),
+ *   flags (1, see TSCH_LOG_BINARY_FLAG_*), security level (1),
+ *   datalen (1), seqno (1), MAC tx status (1, signed), num tx (1),
+ *   drift (2, signed), estimated drift (2, signed), address length (1),
+ *   source address (8), destination address (8), CRC-16 (2).
+ * Addresses are zero-padded; an all-zero address stands for LL-NULL. */
+#define TSCH_LOG_BINARY_VERSION           1
+#define TSCH_LOG_BINARY_ADDR_LEN          8
+#define TSCH_LOG_BINARY_RECORD_LEN        (29 + 2 * TSCH_LOG_BINARY_ADDR_LEN)
+#define TSCH_LOG_BINARY_FLAG_UNICAST      0x01
+#define TSCH_LOG_BINARY_FLAG_DATA         0x02
+#define TSCH_LOG_BINARY_FLAG_DRIFT_USED   0x04
+
 #if (TSCH_LOG_PER_SLOT == 0)
 
 #define tsch_log_init()
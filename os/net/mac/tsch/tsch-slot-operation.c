@@ -163,6 +163,20 @@ static struct tsch_link *backup_link = NULL;
 static struct tsch_packet *current_packet = NULL;
 static struct tsch_neighbor *current_neighbor = NULL;
 
+#if TSCH_STATS_SLOT_TIMING
+/* The timeslot phase being timed, and when it started. Deadline misses
+ * are accounted to the last phase that started before the miss. */
+static enum tsch_stats_slot_phase slot_phase;
+static rtimer_clock_t slot_phase_start;
+#define SLOT_PHASE_BEGIN(phase) do { slot_phase = (phase); slot_phase_start = RTIMER_NOW(); } while(0)
+#define SLOT_PHASE_END() tsch_stats_slot_timing_add(slot_phase, RTIMER_NOW() - slot_phase_start)
+#define SLOT_PHASE_MISS() tsch_stats_slot_timing_miss(slot_phase)
+#else /* TSCH_STATS_SLOT_TIMING */
+#define SLOT_PHASE_BEGIN(phase)
+#define SLOT_PHASE_END()
+#define SLOT_PHASE_MISS()
+#endif /* TSCH_STATS_SLOT_TIMING */
+
 /* Indicates whether an extra link is needed to handle the current burst */
 static int burst_link_scheduled = 0;
 /* Counts the length of the current burst */
@@ -307,6 +321,7 @@ tsch_schedule_slot_operation(struct rtimer *tm, rtimer_clock_t ref_time, rtimer_
   int missed = check_timer_miss(ref_time, offset - RTIMER_GUARD, now);
 
   if(missed) {
+    SLOT_PHASE_MISS();
     TSCH_LOG_ADD(tsch_log_message,
                 snprintf(log->message, sizeof(log->message),
                     "!dl-miss %s %d %d",
@@ -580,8 +595,10 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
         /* If we are going to encrypt, we need to generate the output in a separate buffer and keep
          * the original untouched. This is to allow for future retransmissions. */
         int with_encryption = queuebuf_attr(current_packet->qb, PACKETBUF_ATTR_SECURITY_LEVEL) & 0x4;
+        SLOT_PHASE_BEGIN(TSCH_STATS_PHASE_SECURITY);
         packet_len += tsch_security_secure_frame(packet, with_encryption ? encrypted_packet : packet, current_packet->header_len,
             packet_len - current_packet->header_len, &tsch_current_asn);
+        SLOT_PHASE_END();
         if(with_encryption) {
           packet = encrypted_packet;
         }
@@ -589,7 +606,12 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
 #endif /* LLSEC802154_ENABLED */
 
       /* prepare packet to send: copy to radio buffer */
-      if(packet_ready && NETSTACK_RADIO.prepare(packet, packet_len) == 0) { /* 0 means success */
+      if(packet_ready) {
+        SLOT_PHASE_BEGIN(TSCH_STATS_PHASE_RADIO_PREPARE);
+        packet_ready = NETSTACK_RADIO.prepare(packet, packet_len) == 0; /* 0 means success */
+        SLOT_PHASE_END();
+      }
+      if(packet_ready) {
         static rtimer_clock_t tx_duration;
 
 #if TSCH_CCA_ENABLED
@@ -613,7 +635,9 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
           TSCH_SCHEDULE_AND_YIELD(pt, t, current_slot_start, tsch_timing[tsch_ts_tx_offset] - RADIO_DELAY_BEFORE_TX, "TxBeforeTx");
           TSCH_DEBUG_TX_EVENT();
           /* send packet already in radio tx buffer */
+          SLOT_PHASE_BEGIN(TSCH_STATS_PHASE_RADIO_TX);
           mac_tx_status = NETSTACK_RADIO.transmit(packet_len);
+          SLOT_PHASE_END();
           tx_count++;
           /* Save tx timestamp */
           tx_start_time = current_slot_start + tsch_timing[tsch_ts_tx_offset];
@@ -665,6 +689,7 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
 #endif /* TSCH_HW_FRAME_FILTERING */
 
               /* Read ack frame */
+              SLOT_PHASE_BEGIN(TSCH_STATS_PHASE_RADIO_RX);
               ack_len = NETSTACK_RADIO.read((void *)ackbuf, sizeof(ackbuf));
 
               is_time_source = 0;
@@ -675,9 +700,11 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
                     &frame, &ack_ies, &ack_hdrlen) == 0) {
                   ack_len = 0;
                 }
+                SLOT_PHASE_END();
 
 #if LLSEC802154_ENABLED
                 if(ack_len != 0) {
+                  SLOT_PHASE_BEGIN(TSCH_STATS_PHASE_SECURITY);
                   if(!tsch_security_parse_frame(ackbuf, ack_hdrlen, ack_len - ack_hdrlen - tsch_security_mic_len(&frame),
                       &frame, tsch_queue_get_nbr_address(current_neighbor), &tsch_current_asn)) {
                     TSCH_LOG_ADD(tsch_log_message,
@@ -685,6 +712,7 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
                         "!failed to authenticate ACK"));
                     ack_len = 0;
                   }
+                  SLOT_PHASE_END();
                 } else {
                   TSCH_LOG_ADD(tsch_log_message,
                       snprintf(log->message, sizeof(log->message),
@@ -818,6 +846,9 @@ PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
     static rtimer_clock_t rx_start_time;
     static rtimer_clock_t expected_rx_time;
     static rtimer_clock_t packet_duration;
+    /* Rx guard time, possibly shrunk by the adaptive timesync */
+    static rtimer_clock_t rx_wait;
+    static rtimer_clock_t rx_offset;
     uint8_t packet_seen;
 
     expected_rx_time = current_slot_start + tsch_timing[tsch_ts_tx_offset];
@@ -826,8 +857,13 @@ PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
 
     current_input = &input_array[input_index];
 
+    /* Center the guard time on the expected Rx time */
+    rx_wait = tsch_timesync_adaptive_rx_wait(&current_link->addr,
+                                             TSCH_ASN_DIFF(tsch_current_asn, last_sync_asn));
+    rx_offset = tsch_timing[tsch_ts_rx_offset] + (tsch_timing[tsch_ts_rx_wait] - rx_wait) / 2;
+
     /* Wait before starting to listen */
-    TSCH_SCHEDULE_AND_YIELD(pt, t, current_slot_start, tsch_timing[tsch_ts_rx_offset] - RADIO_DELAY_BEFORE_RX, "RxBeforeListen");
+    TSCH_SCHEDULE_AND_YIELD(pt, t, current_slot_start, rx_offset - RADIO_DELAY_BEFORE_RX, "RxBeforeListen");
     TSCH_DEBUG_RX_EVENT();
 
     /* Start radio for at least guard time */
@@ -836,7 +872,7 @@ PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
     if(!packet_seen) {
       /* Check if receiving within guard time */
       RTIMER_BUSYWAIT_UNTIL_ABS((packet_seen = (NETSTACK_RADIO.receiving_packet() || NETSTACK_RADIO.pending_packet())),
-          current_slot_start, tsch_timing[tsch_ts_rx_offset] + tsch_timing[tsch_ts_rx_wait] + RADIO_DELAY_BEFORE_DETECT);
+          current_slot_start, rx_offset + rx_wait + RADIO_DELAY_BEFORE_DETECT);
     }
     if(!packet_seen) {
       /* no packets on air */
@@ -860,6 +896,7 @@ PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
         radio_value_t radio_last_lqi;
 
         /* Read packet */
+        SLOT_PHASE_BEGIN(TSCH_STATS_PHASE_RADIO_RX);
         current_input->len = NETSTACK_RADIO.read((void *)current_input->payload, TSCH_PACKET_MAX_LEN);
         NETSTACK_RADIO.get_value(RADIO_PARAM_LAST_RSSI, &radio_last_rssi);
         current_input->rx_asn = tsch_current_asn;
@@ -869,6 +906,7 @@ PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
         frame_valid = header_len > 0 &&
           frame802154_check_dest_panid(&frame) &&
           frame802154_extract_linkaddr(&frame, &source_address, &destination_address);
+        SLOT_PHASE_END();
 
 #if TSCH_RESYNC_WITH_SFD_TIMESTAMPS
         /* At the end of the reception, get an more accurate estimate of SFD arrival time */
@@ -898,6 +936,7 @@ PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
 #if LLSEC802154_ENABLED
         /* Decrypt and verify incoming frame */
         if(frame_valid) {
+          SLOT_PHASE_BEGIN(TSCH_STATS_PHASE_SECURITY);
           if(tsch_security_parse_frame(
                current_input->payload, header_len, current_input->len - header_len - tsch_security_mic_len(&frame),
                &frame, &source_address, &tsch_current_asn)) {
@@ -908,6 +947,7 @@ PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
                 "!failed to authenticate frame %u", current_input->len));
             frame_valid = 0;
           }
+          SLOT_PHASE_END();
         }
 #endif /* LLSEC802154_ENABLED */
 
@@ -953,18 +993,24 @@ PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
 #if LLSEC802154_ENABLED
                 if(tsch_is_pan_secured) {
                   /* Secure ACK frame. There is only header and header IEs, therefore data len == 0. */
+                  SLOT_PHASE_BEGIN(TSCH_STATS_PHASE_SECURITY);
                   ack_len += tsch_security_secure_frame(ack_buf, ack_buf, ack_len, 0, &tsch_current_asn);
+                  SLOT_PHASE_END();
                 }
 #endif /* LLSEC802154_ENABLED */
 
                 /* Copy to radio buffer */
+                SLOT_PHASE_BEGIN(TSCH_STATS_PHASE_RADIO_PREPARE);
                 NETSTACK_RADIO.prepare((const void *)ack_buf, ack_len);
+                SLOT_PHASE_END();
 
                 /* Wait for time to ACK and transmit ACK */
                 TSCH_SCHEDULE_AND_YIELD(pt, t, rx_start_time,
                                         packet_duration + tsch_timing[tsch_ts_tx_ack_delay] - RADIO_DELAY_BEFORE_TX, "RxBeforeAck");
                 TSCH_DEBUG_RX_EVENT();
+                SLOT_PHASE_BEGIN(TSCH_STATS_PHASE_RADIO_TX);
                 NETSTACK_RADIO.transmit(ack_len);
+                SLOT_PHASE_END();
                 tsch_radio_off(TSCH_RADIO_CMD_OFF_WITHIN_TIMESLOT);
 
                 /* Schedule a burst link iff the frame pending bit was set */
@@ -1058,12 +1104,15 @@ PT_THREAD(tsch_slot_operation(struct rtimer *t, void *ptr))
       int is_active_slot;
       TSCH_DEBUG_SLOT_START();
       tsch_in_slot_operation = 1;
+      tsch_stats_slot_timing_add(TSCH_STATS_PHASE_WAKEUP,
+                                 MAX(RTIMER_CLOCK_DIFF(RTIMER_NOW(), current_slot_start), 0));
       /* Measure on-air noise level while TSCH is idle */
       tsch_stats_sample_rssi();
       /* Reset drift correction */
       drift_correction = 0;
       is_drift_correction_used = 0;
       /* Get a packet ready to be sent */
+      SLOT_PHASE_BEGIN(TSCH_STATS_PHASE_QUEUE);
       current_packet = get_packet_and_neighbor_for_link(current_link, &current_neighbor);
       uint8_t do_skip_best_link = 0;
       if(current_packet == NULL && backup_link != NULL) {
@@ -1083,6 +1132,7 @@ PT_THREAD(tsch_slot_operation(struct rtimer *t, void *ptr))
         current_link = backup_link;
         current_packet = get_packet_and_neighbor_for_link(current_link, &current_neighbor);
       }
+      SLOT_PHASE_END();
       is_active_slot = current_packet != NULL || (current_link->link_options & LINK_OPTION_RX);
       if(is_active_slot) {
         /* If we are in a burst, we stick to current channel instead of
@@ -1118,6 +1168,8 @@ PT_THREAD(tsch_slot_operation(struct rtimer *t, void *ptr))
          * in a burst but now without any more packet to send. */
         burst_link_scheduled = 0;
       }
+      tsch_stats_slot_timing_add(TSCH_STATS_PHASE_SLOT,
+                                 MAX(RTIMER_CLOCK_DIFF(RTIMER_NOW(), current_slot_start), 0));
       TSCH_DEBUG_SLOT_END();
     }
 
@@ -1147,6 +1199,7 @@ PT_THREAD(tsch_slot_operation(struct rtimer *t, void *ptr))
       /* Time to next wake up */
       rtimer_clock_t time_to_next_active_slot;
       /* Schedule next wakeup skipping slots if missed deadline */
+      SLOT_PHASE_BEGIN(TSCH_STATS_PHASE_SCHEDULE);
       do {
         update_link_backoff(current_link);
 
@@ -1182,6 +1235,7 @@ PT_THREAD(tsch_slot_operation(struct rtimer *t, void *ptr))
         prev_slot_start = current_slot_start;
         current_slot_start += time_to_next_active_slot;
       } while(!tsch_schedule_slot_operation(t, prev_slot_start, time_to_next_active_slot, "main"));
+      SLOT_PHASE_END();
     }
 
     tsch_in_slot_operation = 0;
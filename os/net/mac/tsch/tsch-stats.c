@@ -38,6 +38,7 @@
 #include "net/mac/tsch/tsch.h"
 #include "net/netstack.h"
 #include "dev/radio.h"
+#include <string.h>
 
 /* Log configuration */
 #include "sys/log.h"
@@ -220,6 +221,22 @@ periodic(void *ptr)
     }
   }
 
+#if TSCH_STATS_SLOT_TIMING
+  LOG_DBG("Timeslot phases:\n");
+  for(i = 0; i < TSCH_STATS_NUM_PHASES; ++i) {
+    struct tsch_stats_phase_timing *t = &tsch_stats_slot_timing[i];
+    if(t->count > 0) {
+      LOG_DBG("  %s: %lu samples, %lu/%lu/%lu us min/avg/max, %u deadline misses\n",
+          tsch_stats_slot_phase_name(i),
+          (unsigned long)t->count,
+          (unsigned long)RTIMERTICKS_TO_US(t->min),
+          (unsigned long)RTIMERTICKS_TO_US(t->total / t->count),
+          (unsigned long)RTIMERTICKS_TO_US(t->max),
+          t->deadline_misses);
+    }
+  }
+#endif /* TSCH_STATS_SLOT_TIMING */
+
   /* Do not decay the periodic global stats, as they are updated independely of packet rate */
   for(i = 0; i < TSCH_STATS_NUM_CHANNELS; ++i) {
     /* decay Rx stats */
@@ -234,3 +251,65 @@ periodic(void *ptr)
 /*---------------------------------------------------------------------------*/
 #endif /* TSCH_STATS_ON */
 /*---------------------------------------------------------------------------*/
+#if TSCH_STATS_SLOT_TIMING
+/*---------------------------------------------------------------------------*/
+
+struct tsch_stats_phase_timing tsch_stats_slot_timing[TSCH_STATS_NUM_PHASES];
+
+static const char *const phase_names[TSCH_STATS_NUM_PHASES] = {
+  "wakeup", "queue", "security", "prepare", "tx", "rx", "schedule", "slot"
+};
+
+/* Width of a histogram bin in rtimer ticks, at least one tick */
+#define BIN_TICKS MAX(US_TO_RTIMERTICKS(TSCH_STATS_SLOT_TIMING_BIN_US), 1)
+
+/*---------------------------------------------------------------------------*/
+void
+tsch_stats_slot_timing_add(enum tsch_stats_slot_phase phase, rtimer_clock_t duration)
+{
+  struct tsch_stats_phase_timing *t = &tsch_stats_slot_timing[phase];
+  rtimer_clock_t bin;
+
+  if(t->count == 0 || duration < t->min) {
+    t->min = duration;
+  }
+  if(duration > t->max) {
+    t->max = duration;
+  }
+  t->count++;
+  t->total += duration;
+
+  bin = duration / BIN_TICKS;
+  if(bin >= TSCH_STATS_SLOT_TIMING_BINS) {
+    bin = TSCH_STATS_SLOT_TIMING_BINS - 1;
+  }
+  if(t->histogram[bin] < 0xffff) {
+    t->histogram[bin]++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_stats_slot_timing_miss(enum tsch_stats_slot_phase phase)
+{
+  if(tsch_stats_slot_timing[phase].deadline_misses < 0xffff) {
+    tsch_stats_slot_timing[phase].deadline_misses++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_stats_slot_timing_reset(void)
+{
+  memset(tsch_stats_slot_timing, 0, sizeof(tsch_stats_slot_timing));
+}
+/*---------------------------------------------------------------------------*/
+const char *
+tsch_stats_slot_phase_name(enum tsch_stats_slot_phase phase)
+{
+  if(phase < TSCH_STATS_NUM_PHASES) {
+    return phase_names[phase];
+  }
+  return "unknown";
+}
+/*---------------------------------------------------------------------------*/
+#endif /* TSCH_STATS_SLOT_TIMING */
+/*---------------------------------------------------------------------------*/
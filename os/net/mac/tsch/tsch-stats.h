@@ -48,6 +48,7 @@
 #include "net/linkaddr.h"
 #include "net/mac/tsch/tsch-conf.h"
 #include "net/mac/tsch/tsch-queue.h"
+#include "sys/rtimer.h"
 
 /************ Constants ***********/
 
@@ -109,6 +110,28 @@
 #define TSCH_STATS_FIRST_CHANNEL 11
 #endif
 
+/* Enable the collection of timeslot phase timing statistics? */
+#ifdef TSCH_STATS_CONF_SLOT_TIMING
+#define TSCH_STATS_SLOT_TIMING TSCH_STATS_CONF_SLOT_TIMING
+#else
+#define TSCH_STATS_SLOT_TIMING 0
+#endif
+
+/* The number of histogram bins for each timeslot phase. The last bin
+ * collects all durations that do not fit in the previous ones. */
+#ifdef TSCH_STATS_CONF_SLOT_TIMING_BINS
+#define TSCH_STATS_SLOT_TIMING_BINS TSCH_STATS_CONF_SLOT_TIMING_BINS
+#else
+#define TSCH_STATS_SLOT_TIMING_BINS 8
+#endif
+
+/* The width of a histogram bin, in microseconds */
+#ifdef TSCH_STATS_CONF_SLOT_TIMING_BIN_US
+#define TSCH_STATS_SLOT_TIMING_BIN_US TSCH_STATS_CONF_SLOT_TIMING_BIN_US
+#else
+#define TSCH_STATS_SLOT_TIMING_BIN_US 250
+#endif
+
 /* Internal: the scaling of the various stats */
 #define TSCH_STATS_RSSI_SCALING_FACTOR    -16
 #define TSCH_STATS_LQI_SCALING_FACTOR      16
@@ -166,6 +189,42 @@ struct tsch_neighbor_stats {
 
 struct tsch_neighbor; /* Forward declaration */
 
+/* The phases of a timeslot that are timed separately */
+enum tsch_stats_slot_phase {
+  /* From the scheduled start of the slot to the start of slot operation */
+  TSCH_STATS_PHASE_WAKEUP,
+  /* Selecting the link, the packet and the neighbor */
+  TSCH_STATS_PHASE_QUEUE,
+  /* Securing or authenticating frames and ACKs */
+  TSCH_STATS_PHASE_SECURITY,
+  /* Loading frames and ACKs into the radio */
+  TSCH_STATS_PHASE_RADIO_PREPARE,
+  /* Transmitting frames and ACKs */
+  TSCH_STATS_PHASE_RADIO_TX,
+  /* Reading and parsing received frames and ACKs */
+  TSCH_STATS_PHASE_RADIO_RX,
+  /* Finding the next active link and scheduling the next wakeup */
+  TSCH_STATS_PHASE_SCHEDULE,
+  /* The whole active part of the slot, from its start to its end */
+  TSCH_STATS_PHASE_SLOT,
+  TSCH_STATS_NUM_PHASES
+};
+
+struct tsch_stats_phase_timing {
+  /* number of samples */
+  uint32_t count;
+  /* sum of all durations, in rtimer ticks; 64 bits so that it does not
+   * overflow before count does */
+  uint64_t total;
+  /* shortest and longest duration, in rtimer ticks */
+  rtimer_clock_t min;
+  rtimer_clock_t max;
+  /* deadline misses right after this phase */
+  uint16_t deadline_misses;
+  /* histogram of durations, in bins of TSCH_STATS_SLOT_TIMING_BIN_US */
+  uint16_t histogram[TSCH_STATS_SLOT_TIMING_BINS];
+};
+
 
 /************ External variables ***********/
 
@@ -206,6 +265,31 @@ void tsch_stats_reset_neighbor_stats(void);
 
 #endif /* TSCH_STATS_ON */
 
+#if TSCH_STATS_SLOT_TIMING
+
+/* Timing statistics of the timeslot phases */
+extern struct tsch_stats_phase_timing tsch_stats_slot_timing[TSCH_STATS_NUM_PHASES];
+
+/* Add a duration, in rtimer ticks, to the statistics of a phase */
+void tsch_stats_slot_timing_add(enum tsch_stats_slot_phase phase, rtimer_clock_t duration);
+
+/* Count a missed deadline that followed a phase */
+void tsch_stats_slot_timing_miss(enum tsch_stats_slot_phase phase);
+
+/* Clear the timing statistics of all phases */
+void tsch_stats_slot_timing_reset(void);
+
+/* Return the printable name of a phase */
+const char *tsch_stats_slot_phase_name(enum tsch_stats_slot_phase phase);
+
+#else /* TSCH_STATS_SLOT_TIMING */
+
+#define tsch_stats_slot_timing_add(phase, duration)
+#define tsch_stats_slot_timing_miss(phase)
+#define tsch_stats_slot_timing_reset()
+
+#endif /* TSCH_STATS_SLOT_TIMING */
+
 static inline uint8_t
 tsch_stats_channel_to_index(uint8_t channel)
 {
@@ -57,6 +57,9 @@
 #include "net/mac/mac-sequence.h"
 #include "lib/random.h"
 #include "net/routing/routing.h"
+#if NETSTACK_CONF_WITH_IPV6
+#include "net/ipv6/uip-ds6-nbr.h"
+#endif /* NETSTACK_CONF_WITH_IPV6 */
 #include <inttypes.h>
 
 #if TSCH_WITH_SIXTOP
@@ -178,6 +181,7 @@ void
 tsch_set_pan_secured(int enable)
 {
   tsch_is_pan_secured = LLSEC802154_ENABLED && enable;
+  framer_802154_flush_hdr_cache();
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -287,6 +291,12 @@ keepalive_packet_sent(void *ptr, int status, int transmissions)
   int schedule_next_keepalive = 1;
   /* Update neighbor link statistics */
   link_stats_packet_sent(packetbuf_addr(PACKETBUF_ADDR_RECEIVER), status, transmissions);
+#if NETSTACK_CONF_WITH_IPV6
+  /* Keepalives bypass 6LoWPAN, feed their ACKs to neighbor discovery here */
+  if(status == MAC_TX_OK) {
+    uip_ds6_nbr_confirm_reachable(packetbuf_addr(PACKETBUF_ADDR_RECEIVER));
+  }
+#endif /* NETSTACK_CONF_WITH_IPV6 */
   /* Call RPL callback if RPL is enabled */
 #ifdef TSCH_CALLBACK_KA_SENT
   TSCH_CALLBACK_KA_SENT(status, transmissions);
@@ -734,6 +744,7 @@ tsch_associate(const struct input_packet *input_eb, rtimer_clock_t timestamp)
       /* Update global flags */
       tsch_is_associated = 1;
       tsch_is_pan_secured = frame.fcf.security_enabled;
+      framer_802154_flush_hdr_cache();
       tx_count = 0;
       rx_count = 0;
       sync_count = 0;
@@ -55,14 +55,13 @@ static void print_table();
 #endif
 
 /* For each neighbor, a map of the tables that use the neighbor.
- * As we are using uint8_t, we have a maximum of 8 tables in the system */
+ * As we are using uint8_t, we have a maximum of 8 tables in the system,
+ * see NBR_TABLE_MAX_NUM_TABLES */
 static uint8_t used_map[NBR_TABLE_MAX_NEIGHBORS];
 /* For each neighbor, a map of the tables that lock the neighbor */
 static uint8_t locked_map[NBR_TABLE_MAX_NEIGHBORS];
-/* The maximum number of tables */
-#define MAX_NUM_TABLES 8
 /* A list of pointers to tables in use */
-static struct nbr_table *all_tables[MAX_NUM_TABLES];
+static struct nbr_table *all_tables[NBR_TABLE_MAX_NUM_TABLES];
 /* The current number of tables */
 static unsigned num_tables;
 
@@ -169,7 +168,7 @@ static void
 remove_key(nbr_table_key_t *key, bool do_free)
 {
   int i;
-  for(i = 0; i < MAX_NUM_TABLES; i++) {
+  for(i = 0; i < NBR_TABLE_MAX_NUM_TABLES; i++) {
     if(all_tables[i] != NULL && all_tables[i]->callback != NULL) {
       /* Call table callback for each table that uses this item */
       nbr_table_item_t *removed_item = item_from_key(all_tables[i], key);
@@ -339,7 +338,7 @@ nbr_table_register(nbr_table_t *table, nbr_table_callback *callback)
     return 1;
   }
 
-  if(num_tables < MAX_NUM_TABLES) {
+  if(num_tables < NBR_TABLE_MAX_NUM_TABLES) {
     table->index = num_tables++;
     table->callback = callback;
     all_tables[table->index] = table;
@@ -354,7 +353,7 @@ nbr_table_register(nbr_table_t *table, nbr_table_callback *callback)
 int
 nbr_table_is_registered(const nbr_table_t *table)
 {
-  if(table != NULL && table->index >= 0 && table->index < MAX_NUM_TABLES
+  if(table != NULL && table->index >= 0 && table->index < NBR_TABLE_MAX_NUM_TABLES
                    && all_tables[table->index] == table) {
     return 1;
   }
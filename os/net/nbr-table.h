@@ -55,6 +55,10 @@ typedef enum {
 
 #define NBR_TABLE_MAX_NEIGHBORS NBR_TABLE_CONF_MAX_NEIGHBORS
 
+/* The maximum number of tables. Each neighbor has an 8-bit map of the
+ * tables that use it. */
+#define NBR_TABLE_MAX_NUM_TABLES 8
+
 #ifdef NBR_TABLE_CONF_GC_GET_WORST
 #define NBR_TABLE_GC_GET_WORST NBR_TABLE_CONF_GC_GET_WORST
 #else /* NBR_TABLE_CONF_GC_GET_WORST */
@@ -158,6 +158,12 @@ is_in_leaf_mode(void)
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+static const uip_ipaddr_t *
+get_default_nexthop(void)
+{
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
 const struct routing_driver nullrouting_driver = {
   "nullrouting",
   init,
@@ -180,6 +186,7 @@ const struct routing_driver nullrouting_driver = {
   neighbor_state_changed,
   drop_route,
   is_in_leaf_mode,
+  get_default_nexthop,
 };
 /*---------------------------------------------------------------------------*/
 
@@ -186,6 +186,14 @@ struct routing_driver {
    * \retval 1 if the protocol is in leaf mode, 0 if not.
    */
   uint8_t (* is_in_leaf_mode)(void);
+  /**
+   * Selects the next hop for the packet in uip_buf when there is no route
+   * to its destination. Lets protocols that maintain several topologies
+   * pick the next hop per flow.
+   *
+   * \return The next-hop address, or NULL to use the DS6 default route
+   */
+  const uip_ipaddr_t *(* get_default_nexthop)(void);
 };
 
 #endif /* ROUTING_H_ */
@@ -325,6 +325,41 @@
 #define RPL_DIO_REFRESH_DAO_ROUTES 1
 #endif /* RPL_CONF_DIO_REFRESH_DAO_ROUTES */
 
+/*
+ * RPL DAO aggregation (storing mode). When enabled, targets learned
+ * from the DAOs of our children are not forwarded one DAO at a time.
+ * They are queued for RPL_DAO_AGGREGATION_DELAY and then advertised to
+ * the preferred parent in as few DAOs as fit in the MTU, or together
+ * with our own next DAO if that comes first. DAOs requesting a DAO-ACK
+ * are always forwarded as they are.
+ */
+#ifdef RPL_CONF_DAO_AGGREGATION
+#define RPL_DAO_AGGREGATION RPL_CONF_DAO_AGGREGATION
+#else
+#define RPL_DAO_AGGREGATION 0
+#endif /* RPL_CONF_DAO_AGGREGATION */
+
+/* How long targets are collected before being sent to the parent. */
+#ifdef RPL_CONF_DAO_AGGREGATION_DELAY
+#define RPL_DAO_AGGREGATION_DELAY RPL_CONF_DAO_AGGREGATION_DELAY
+#else
+#define RPL_DAO_AGGREGATION_DELAY (CLOCK_SECOND)
+#endif /* RPL_CONF_DAO_AGGREGATION_DELAY */
+
+/*
+ * The number of targets that can wait for aggregation. Also used for
+ * the targets of incoming DAOs that carry more than one target, which
+ * are accepted whether or not aggregation is enabled. A node advertises
+ * at most one target per route, so with aggregation the queue is sized
+ * from the routing table. DAOs whose targets do not fit are forwarded
+ * as they are.
+ */
+#ifdef RPL_CONF_DAO_AGGREGATION_QUEUE_SIZE
+#define RPL_DAO_AGGREGATION_QUEUE_SIZE RPL_CONF_DAO_AGGREGATION_QUEUE_SIZE
+#else
+#define RPL_DAO_AGGREGATION_QUEUE_SIZE (RPL_DAO_AGGREGATION ? UIP_DS6_ROUTE_NB : 4)
+#endif /* RPL_CONF_DAO_AGGREGATION_QUEUE_SIZE */
+
 /*
  * RPL probing. When enabled, probes will be sent periodically to keep
  * parent link estimates up to date.
@@ -414,10 +414,6 @@ rpl_set_root(uint8_t instance_id, uip_ipaddr_t *dag_id)
 
   instance->dio_intdoubl = RPL_DIO_INTERVAL_DOUBLINGS;
   instance->dio_intmin = RPL_DIO_INTERVAL_MIN;
-  /* The current interval must differ from the minimum interval in order to
-     trigger a DIO timer reset. */
-  instance->dio_intcurrent = RPL_DIO_INTERVAL_MIN +
-    RPL_DIO_INTERVAL_DOUBLINGS;
   instance->dio_redundancy = RPL_DIO_REDUNDANCY;
   instance->max_rankinc = RPL_MAX_RANKINC;
   instance->min_hoprankinc = RPL_MIN_HOPRANKINC;
@@ -658,7 +654,7 @@ rpl_free_instance(rpl_instance_t *instance)
 #if RPL_WITH_PROBING
   ctimer_stop(&instance->probing_timer);
 #endif /* RPL_WITH_PROBING */
-  ctimer_stop(&instance->dio_timer);
+  trickle_timer_stop(&instance->dio_timer);
   ctimer_stop(&instance->dao_timer);
   ctimer_stop(&instance->dao_lifetime_timer);
 
@@ -1187,7 +1183,6 @@ rpl_join_instance(uip_ipaddr_t *from, rpl_dio_t *dio)
   instance->min_hoprankinc = dio->dag_min_hoprankinc;
   instance->dio_intdoubl = dio->dag_intdoubl;
   instance->dio_intmin = dio->dag_intmin;
-  instance->dio_intcurrent = instance->dio_intmin + instance->dio_intdoubl;
   instance->dio_redundancy = dio->dag_redund;
   instance->default_lifetime = dio->default_lifetime;
   instance->lifetime_unit = dio->lifetime_unit;
@@ -1598,7 +1593,7 @@ rpl_process_dio(uip_ipaddr_t *from, rpl_dio_t *dio)
 
   if(dag->rank == ROOT_RANK(instance)) {
     if(dio->rank != RPL_INFINITE_RANK) {
-      instance->dio_counter++;
+      trickle_timer_consistency(&instance->dio_timer);
     }
     return;
   }
@@ -1642,7 +1637,7 @@ rpl_process_dio(uip_ipaddr_t *from, rpl_dio_t *dio)
     if(p->rank == dio->rank) {
       LOG_INFO("Received consistent DIO\n");
       if(dag->joined) {
-        instance->dio_counter++;
+        trickle_timer_consistency(&instance->dio_timer);
       }
     }
   }
@@ -376,6 +376,31 @@ count_matching_bytes(const void *p1, const void *p2, size_t n)
   return n;
 }
 /*---------------------------------------------------------------------------*/
+/* Makes room for an SRH of ext_len bytes, inserted as the first extension
+   header. Returns 1 on success, 0 if the packet would get too long. */
+static int
+make_room_for_srh_header(uint8_t ext_len)
+{
+  struct uip_routing_hdr *rh_hdr = (struct uip_routing_hdr *)UIP_IP_PAYLOAD(0);
+
+  /* Check if there is enough space to store the extension header. */
+  if(uip_len + ext_len > UIP_LINK_MTU) {
+    LOG_ERR("Too long packet: impossible to add SRH (%u bytes)\n", ext_len);
+    return 0;
+  }
+
+  /* Move existing ext headers and payload ext_len further. */
+  memmove(uip_buf + UIP_IPH_LEN + uip_ext_len + ext_len,
+          uip_buf + UIP_IPH_LEN + uip_ext_len, uip_len - UIP_IPH_LEN);
+  memset(uip_buf + UIP_IPH_LEN + uip_ext_len, 0, ext_len);
+
+  /* Insert source routing header (as first ext header). */
+  rh_hdr->next = UIP_IP_BUF->proto;
+  UIP_IP_BUF->proto = UIP_PROTO_ROUTING;
+
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
 static int
 insert_srh_header(void)
 {
@@ -390,6 +415,7 @@ insert_srh_header(void)
   uip_sr_node_t *node;
   rpl_dag_t *dag;
   uip_ipaddr_t node_addr;
+  const uip_sr_hdr_cache_t *cached;
 
   /* Always insert the SRH as the first extension header. */
   struct uip_routing_hdr *rh_hdr = (struct uip_routing_hdr *)UIP_IP_PAYLOAD(0);
@@ -409,6 +435,22 @@ insert_srh_header(void)
     return 0;
   }
 
+  /* Reuse the header built for a previous packet, if the graph has not
+     changed since. */
+  cached = uip_sr_hdr_cache_lookup(dag, &UIP_IP_BUF->destipaddr);
+  if(cached != NULL) {
+    LOG_DBG("SRH using cached header, ext len %u\n", cached->len);
+    if(!make_room_for_srh_header(cached->len)) {
+      return 0;
+    }
+    /* Copy all but the next header field. */
+    memcpy((uint8_t *)rh_hdr + 1, cached->hdr + 1, cached->len - 1);
+    uip_ipaddr_copy(&UIP_IP_BUF->destipaddr, &cached->next_hop);
+    uipbuf_add_ext_hdr(cached->len);
+    uipbuf_set_len_field(UIP_IP_BUF, uip_len - UIP_IPH_LEN);
+    return 1;
+  }
+
   dest_node = uip_sr_get_node(dag, &UIP_IP_BUF->destipaddr);
   if(dest_node == NULL) {
     /* The destination was not found, skip SRH insertion. */
@@ -465,21 +507,10 @@ insert_srh_header(void)
   LOG_DBG("SRH Path len: %u, ComprI %u, ComprE %u, ext len %u (padding %u)\n",
           path_len, cmpri, cmpre, ext_len, padding);
 
-  /* Check if there is enough space to store the extension header. */
-  if(uip_len + ext_len > UIP_LINK_MTU) {
-    LOG_ERR("Too long packet: impossible to add SRH (%u bytes)\n", ext_len);
+  if(!make_room_for_srh_header(ext_len)) {
     return 0;
   }
 
-  /* Move existing ext headers and payload ext_len further. */
-  memmove(uip_buf + UIP_IPH_LEN + uip_ext_len + ext_len,
-          uip_buf + UIP_IPH_LEN + uip_ext_len, uip_len - UIP_IPH_LEN);
-  memset(uip_buf + UIP_IPH_LEN + uip_ext_len, 0, ext_len);
-
-  /* Insert source routing header (as first ext header). */
-  rh_hdr->next = UIP_IP_BUF->proto;
-  UIP_IP_BUF->proto = UIP_PROTO_ROUTING;
-
   /* Initialize IPv6 Routing Header. */
   rh_hdr->len = (ext_len - 8) / 8;
   rh_hdr->routing_type = RPL_RH_TYPE_SRH;
@@ -508,6 +539,8 @@ insert_srh_header(void)
   /* The next hop (i.e. node whose parent is the root) is placed as
      the current IPv6 destination. */
   NETSTACK_ROUTING.get_sr_node_ipaddr(&node_addr, node);
+  uip_sr_hdr_cache_add(dag, &UIP_IP_BUF->destipaddr, &node_addr,
+                       (uint8_t *)rh_hdr, ext_len);
   uip_ipaddr_copy(&UIP_IP_BUF->destipaddr, &node_addr);
 
   /* Update the IPv6 length field. */
@@ -51,6 +51,8 @@
 #include "net/routing/rpl-classic/rpl-private.h"
 #include "net/packetbuf.h"
 #include "net/ipv6/multicast/uip-mcast6.h"
+#include "lib/list.h"
+#include "lib/memb.h"
 #include "lib/random.h"
 
 #include "sys/log.h"
@@ -130,6 +132,230 @@ prepare_for_dao_fwd(uint8_t sequence, uip_ds6_route_t *rep)
 }
 #endif /* RPL_WITH_STORING */
 /*---------------------------------------------------------------------------*/
+/* Writes the DAO base object and returns its length. */
+static int
+dao_output_header(rpl_dag_t *dag, unsigned char *buffer, uint8_t flags,
+                  uint8_t seq_no)
+{
+  int pos;
+
+  pos = 0;
+  buffer[pos++] = dag->instance->instance_id;
+#if RPL_DAO_SPECIFY_DAG
+  flags |= RPL_DAO_D_FLAG;
+#endif /* RPL_DAO_SPECIFY_DAG */
+  buffer[pos++] = flags;
+  buffer[pos++] = 0; /* reserved */
+  buffer[pos++] = seq_no;
+#if RPL_DAO_SPECIFY_DAG
+  memcpy(buffer + pos, &dag->dag_id, sizeof(dag->dag_id));
+  pos += sizeof(dag->dag_id);
+#endif /* RPL_DAO_SPECIFY_DAG */
+  return pos;
+}
+/*---------------------------------------------------------------------------*/
+#if RPL_WITH_STORING
+/*
+ * Targets waiting to be advertised to our preferred parent. Several
+ * targets share one DAO, each run of targets with the same lifetime
+ * being followed by a single transit option (RFC 6550, section 6.7.8).
+ */
+struct dao_target {
+  struct dao_target *next;
+  rpl_instance_t *instance;
+  uip_ipaddr_t prefix;
+  uint8_t prefixlen;
+  uint8_t lifetime;
+};
+
+MEMB(dao_target_memb, struct dao_target, RPL_DAO_AGGREGATION_QUEUE_SIZE);
+LIST(dao_target_list);
+/* Counts the targets that did not fit in the queue. */
+static uint16_t dao_targets_dropped;
+#if RPL_DAO_AGGREGATION
+static struct ctimer dao_aggregation_timer;
+#endif /* RPL_DAO_AGGREGATION */
+/*---------------------------------------------------------------------------*/
+static int
+dao_target_queue(rpl_instance_t *instance, const uip_ipaddr_t *prefix,
+                 uint8_t prefixlen, uint8_t lifetime)
+{
+  struct dao_target *t;
+
+  /* A target that is queued already is only refreshed. */
+  for(t = list_head(dao_target_list); t != NULL; t = list_item_next(t)) {
+    if(t->instance == instance && t->prefixlen == prefixlen &&
+       uip_ipaddr_cmp(&t->prefix, prefix)) {
+      t->lifetime = lifetime;
+      RPL_STAT(rpl_stats.dao_targets_merged++);
+      return 1;
+    }
+  }
+
+  t = memb_alloc(&dao_target_memb);
+  if(t == NULL) {
+    LOG_WARN("No room to queue DAO target ");
+    LOG_WARN_6ADDR(prefix);
+    LOG_WARN_("\n");
+    dao_targets_dropped++;
+    return 0;
+  }
+  t->instance = instance;
+  uip_ipaddr_copy(&t->prefix, prefix);
+  t->prefixlen = prefixlen;
+  t->lifetime = lifetime;
+  list_add(dao_target_list, t);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+dao_output_transit(unsigned char *buffer, int pos, uint8_t lifetime)
+{
+  buffer[pos++] = RPL_OPTION_TRANSIT;
+  buffer[pos++] = 4;
+  buffer[pos++] = 0; /* flags - ignored */
+  buffer[pos++] = 0; /* path control - ignored */
+  buffer[pos++] = 0; /* path seq - ignored */
+  buffer[pos++] = lifetime;
+  return pos;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Moves as many queued targets of an instance as fit into the DAO
+ * being built at buffer[0..pos) and returns the new DAO length.
+ */
+static int
+dao_output_queued_targets(rpl_instance_t *instance, unsigned char *buffer,
+                          int pos)
+{
+  struct dao_target *t;
+  struct dao_target *next;
+  int run_lifetime;
+  int len;
+
+  run_lifetime = -1;
+  for(t = list_head(dao_target_list); t != NULL; t = next) {
+    next = list_item_next(t);
+    if(t->instance != instance) {
+      continue;
+    }
+
+    len = 4 + (t->prefixlen + 7) / CHAR_BIT;
+    /* Keep room for the transit option that closes the run. */
+    if(pos + len + 2 * 6 > RPL_DAO_MAX_SIZE) {
+      break;
+    }
+
+    if(run_lifetime >= 0 && run_lifetime != t->lifetime) {
+      pos = dao_output_transit(buffer, pos, run_lifetime);
+    }
+    run_lifetime = t->lifetime;
+
+    buffer[pos++] = RPL_OPTION_TARGET;
+    buffer[pos++] = len - 2;
+    buffer[pos++] = 0; /* reserved */
+    buffer[pos++] = t->prefixlen;
+    memcpy(buffer + pos, &t->prefix, len - 4);
+    pos += len - 4;
+
+    list_remove(dao_target_list, t);
+    memb_free(&dao_target_memb, t);
+  }
+
+  if(run_lifetime >= 0) {
+    pos = dao_output_transit(buffer, pos, run_lifetime);
+  }
+  return pos;
+}
+/*---------------------------------------------------------------------------*/
+/* Sends all queued targets to the preferred parents, in as few DAOs as
+   the MTU allows. */
+static void
+dao_flush_targets(void *ptr)
+{
+  struct dao_target *t;
+  struct dao_target *next;
+  rpl_instance_t *instance;
+  rpl_parent_t *parent;
+  uip_ipaddr_t *parent_ipaddr;
+  int pos;
+
+#if RPL_DAO_AGGREGATION
+  ctimer_stop(&dao_aggregation_timer);
+#endif /* RPL_DAO_AGGREGATION */
+
+  while((t = list_head(dao_target_list)) != NULL) {
+    instance = t->instance;
+    parent = NULL;
+    parent_ipaddr = NULL;
+    if(instance->used && instance->current_dag != NULL) {
+      parent = instance->current_dag->preferred_parent;
+    }
+    if(parent != NULL) {
+      parent_ipaddr = rpl_parent_get_ipaddr(parent);
+    }
+
+    if(parent_ipaddr == NULL || rpl_get_mode() == RPL_MODE_FEATHER) {
+      /* Nowhere to send them; the next DAO refresh will recover. */
+      LOG_WARN("Dropping queued DAO targets, no preferred parent\n");
+      for(; t != NULL; t = next) {
+        next = list_item_next(t);
+        if(t->instance == instance) {
+          list_remove(dao_target_list, t);
+          memb_free(&dao_target_memb, t);
+        }
+      }
+      continue;
+    }
+
+    RPL_LOLLIPOP_INCREMENT(dao_sequence);
+    pos = dao_output_header(parent->dag, UIP_ICMP_PAYLOAD, 0, dao_sequence);
+    pos = dao_output_queued_targets(instance, UIP_ICMP_PAYLOAD, pos);
+
+    LOG_INFO("Sending an aggregated DAO with sequence number %u to ",
+             dao_sequence);
+    LOG_INFO_6ADDR(parent_ipaddr);
+    LOG_INFO_("\n");
+
+    RPL_STAT(rpl_stats.dao_out++);
+    uip_icmp6_send(parent_ipaddr, ICMP6_RPL, RPL_CODE_DAO, pos);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+dao_schedule_targets(void)
+{
+#if RPL_DAO_AGGREGATION
+  if(ctimer_expired(&dao_aggregation_timer)) {
+    ctimer_set(&dao_aggregation_timer, RPL_DAO_AGGREGATION_DELAY,
+               dao_flush_targets, NULL);
+  }
+#else /* RPL_DAO_AGGREGATION */
+  dao_flush_targets(NULL);
+#endif /* RPL_DAO_AGGREGATION */
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Queues a target of an incoming single-target DAO instead of
+ * forwarding the DAO itself. Returns 0 if the DAO is to be forwarded as
+ * it is: aggregation is disabled, the DAO requests a DAO-ACK (whose
+ * sequence numbers are tracked per forwarded DAO), or the queue is full.
+ */
+static int
+dao_aggregate_target(rpl_instance_t *instance, uip_ipaddr_t *prefix,
+                     uint8_t prefixlen, uint8_t lifetime, uint8_t flags)
+{
+#if RPL_DAO_AGGREGATION
+  if(!(flags & RPL_DAO_K_FLAG) &&
+     dao_target_queue(instance, prefix, prefixlen, lifetime)) {
+    dao_schedule_targets();
+    return 1;
+  }
+#endif /* RPL_DAO_AGGREGATION */
+  return 0;
+}
+#endif /* RPL_WITH_STORING */
+/*---------------------------------------------------------------------------*/
 static int
 get_global_addr(uip_ipaddr_t *addr)
 {
@@ -204,6 +430,9 @@ rpl_icmp6_update_nbr_table(uip_ipaddr_t *from, nbr_table_reason_t reason,
       LOG_INFO_LLADDR(packetbuf_addr(PACKETBUF_ADDR_SENDER));
       LOG_INFO_("\n");
     }
+  } else if(reason == NBR_TABLE_REASON_RPL_DIO) {
+    /* A DIO from a known neighbor spares a NUD probe to it */
+    uip_ds6_nbr_confirm_reachable(packetbuf_addr(PACKETBUF_ADDR_SENDER));
   }
 
   return nbr;
@@ -659,6 +888,189 @@ dio_output(rpl_instance_t *instance, uip_ipaddr_t *uc_addr)
 #endif /* RPL_LEAF_ONLY */
 }
 /*---------------------------------------------------------------------------*/
+#if RPL_WITH_STORING
+/*
+ * Installs, or starts removing, the route to one target of a DAO that
+ * carries several targets, and queues the target for our own parent if
+ * it is to be propagated. Returns 0 if the route could not be added.
+ */
+static int
+dao_input_storing_target(rpl_instance_t *instance, uip_ipaddr_t *from,
+                         uip_ipaddr_t *prefix, uint8_t prefixlen,
+                         uint8_t lifetime, int propagate)
+{
+  rpl_dag_t *dag;
+  uip_ds6_route_t *rep;
+
+  dag = instance->current_dag;
+
+  LOG_INFO("DAO lifetime: %u, prefix length: %u prefix: ",
+           (unsigned)lifetime, (unsigned)prefixlen);
+  LOG_INFO_6ADDR(prefix);
+  LOG_INFO_("\n");
+
+#if RPL_WITH_MULTICAST
+  if(uip_is_addr_mcast_global(prefix)) {
+    mcast_group = uip_mcast6_route_add(prefix);
+    if(mcast_group) {
+      mcast_group->dag = dag;
+      mcast_group->lifetime = RPL_LIFETIME(instance, lifetime);
+    }
+    if(propagate) {
+      dao_target_queue(instance, prefix, prefixlen, lifetime);
+    }
+    return 1;
+  }
+#endif
+
+  if(lifetime == RPL_ZERO_LIFETIME) {
+    rep = uip_ds6_route_lookup(prefix);
+    if(rep == NULL ||
+       RPL_ROUTE_IS_NOPATH_RECEIVED(rep) ||
+       rep->length != prefixlen ||
+       uip_ds6_route_nexthop(rep) == NULL ||
+       !uip_ipaddr_cmp(uip_ds6_route_nexthop(rep), from)) {
+      /* Not a route of ours through this child, nothing to propagate. */
+      return 1;
+    }
+    RPL_ROUTE_SET_NOPATH_RECEIVED(rep);
+    rep->state.lifetime = RPL_NOPATH_REMOVAL_DELAY;
+  } else {
+    rep = rpl_add_route(dag, prefix, prefixlen, from);
+    if(rep == NULL) {
+      RPL_STAT(rpl_stats.mem_overflows++);
+      LOG_ERR("Could not add a route after receiving a DAO\n");
+      return 0;
+    }
+    rep->state.lifetime = RPL_LIFETIME(instance, lifetime);
+    RPL_ROUTE_CLEAR_NOPATH_RECEIVED(rep);
+  }
+
+  if(propagate) {
+    dao_target_queue(instance, prefix, prefixlen, lifetime);
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Handles the targets in buffer[start..end), which share a lifetime. */
+static int
+dao_input_storing_run(rpl_instance_t *instance, uip_ipaddr_t *from,
+                      int start, int end, uint8_t lifetime, int propagate)
+{
+  unsigned char *buffer;
+  uip_ipaddr_t prefix;
+  uint8_t prefixlen;
+  int accepted;
+  int len;
+  int i;
+
+  buffer = UIP_ICMP_PAYLOAD;
+  accepted = 1;
+  for(i = start; i < end; i += len) {
+    len = buffer[i] == RPL_OPTION_PAD1 ? 1 : 2 + buffer[i + 1];
+    if(buffer[i] != RPL_OPTION_TARGET || buffer[i + 3] == 0) {
+      continue;
+    }
+    prefixlen = buffer[i + 3];
+    memset(&prefix, 0, sizeof(prefix));
+    memcpy(&prefix, buffer + i + 4, (prefixlen + 7) / CHAR_BIT);
+    if(!dao_input_storing_target(instance, from, &prefix, prefixlen,
+                                 lifetime, propagate)) {
+      accepted = 0;
+    }
+  }
+  return accepted;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Handles a DAO that carries several targets, as sent by a child that
+ * aggregates DAOs. The options have already been validated by
+ * dao_input_storing(). Each transit option applies to the targets that
+ * precede it. Instead of forwarding the DAO, the targets are queued and
+ * advertised to our parent in DAOs of our own.
+ */
+static void
+dao_input_storing_targets(rpl_instance_t *instance, uip_ipaddr_t *from,
+                          int pos, uint16_t buffer_length, uint8_t flags,
+                          uint8_t sequence, int learned_from)
+{
+  unsigned char *buffer;
+  rpl_parent_t *parent;
+  uint16_t dropped;
+  int propagate;
+  int accepted;
+  int is_root;
+  int run;
+  int len;
+  int i;
+
+  buffer = UIP_ICMP_PAYLOAD;
+  dropped = dao_targets_dropped;
+  is_root = (instance->current_dag->rank == ROOT_RANK(instance));
+  /* As with single targets, only unicast DAOs are propagated. */
+  propagate = !is_root && learned_from == RPL_ROUTE_FROM_UNICAST_DAO;
+
+  if(rpl_icmp6_update_nbr_table(from, NBR_TABLE_REASON_RPL_DAO,
+                                instance) == NULL) {
+    LOG_ERR("Out of memory, dropping DAO from ");
+    LOG_ERR_6ADDR(from);
+    LOG_ERR_("\n");
+    accepted = 0;
+  } else {
+    accepted = 1;
+    run = -1;
+    for(i = pos; i < buffer_length; i += len) {
+      len = buffer[i] == RPL_OPTION_PAD1 ? 1 : 2 + buffer[i + 1];
+      if(buffer[i] == RPL_OPTION_TARGET && run < 0) {
+        run = i;
+      } else if(buffer[i] == RPL_OPTION_TRANSIT && run >= 0) {
+        accepted &= dao_input_storing_run(instance, from, run, i,
+                                          buffer[i + 5], propagate);
+        run = -1;
+      }
+    }
+    if(run >= 0) {
+      /* Targets without a transit option get the default lifetime. */
+      accepted &= dao_input_storing_run(instance, from, run, buffer_length,
+                                        instance->default_lifetime, propagate);
+    }
+  }
+
+  /*
+   * If targets did not fit in the queue, forward the DAO as it is. Targets
+   * that were queued are advertised twice, which does no harm.
+   */
+  parent = instance->current_dag->preferred_parent;
+  if(propagate && dao_targets_dropped != dropped &&
+     parent != NULL && rpl_parent_get_ipaddr(parent) != NULL) {
+    RPL_LOLLIPOP_INCREMENT(dao_sequence);
+    /* The DAO-ACK, if any, is ours to send. */
+    buffer[1] &= ~RPL_DAO_K_FLAG;
+    buffer[3] = dao_sequence;
+
+    LOG_DBG("Forwarding a DAO whose targets did not fit in the queue to ");
+    LOG_DBG_6ADDR(rpl_parent_get_ipaddr(parent));
+    LOG_DBG_("\n");
+
+    RPL_STAT(rpl_stats.dao_out++);
+    uip_icmp6_send(rpl_parent_get_ipaddr(parent), ICMP6_RPL, RPL_CODE_DAO,
+                   buffer_length);
+  }
+
+  if(flags & RPL_DAO_K_FLAG) {
+    uipbuf_clear();
+    dao_ack_output(instance, from, sequence,
+                   accepted ? RPL_DAO_ACK_UNCONDITIONAL_ACCEPT :
+                   (is_root ? RPL_DAO_ACK_UNABLE_TO_ADD_ROUTE_AT_ROOT :
+                    RPL_DAO_ACK_UNABLE_TO_ACCEPT));
+  }
+
+  if(list_head(dao_target_list) != NULL) {
+    dao_schedule_targets();
+  }
+}
+#endif /* RPL_WITH_STORING */
+/*---------------------------------------------------------------------------*/
 static void
 dao_input_storing(void)
 {
@@ -682,9 +1094,11 @@ dao_input_storing(void)
   rpl_parent_t *parent;
   uip_ds6_nbr_t *nbr;
   int is_root;
+  int targets;
 
   prefixlen = 0;
   parent = NULL;
+  targets = 0;
   memset(&prefix, 0, sizeof(prefix));
 
   uip_ipaddr_copy(&dao_sender_addr, &UIP_IP_BUF->srcipaddr);
@@ -804,6 +1218,8 @@ dao_input_storing(void)
       }
       memset(&prefix, 0, sizeof(prefix));
       memcpy(&prefix, buffer + i + 4, (prefixlen + 7) / CHAR_BIT);
+      targets++;
+      RPL_STAT(rpl_stats.dao_targets_in++);
       break;
     case RPL_OPTION_TRANSIT:
       /* The path sequence and control are ignored. */
@@ -818,6 +1234,12 @@ dao_input_storing(void)
     }
   }
 
+  if(targets > 1) {
+    dao_input_storing_targets(instance, &dao_sender_addr, pos, buffer_length,
+                              flags, sequence, learned_from);
+    return;
+  }
+
   LOG_INFO("DAO lifetime: %u, prefix length: %u prefix: ",
            (unsigned)lifetime, (unsigned)prefixlen);
   LOG_INFO_6ADDR(&prefix);
@@ -858,7 +1280,9 @@ dao_input_storing(void)
       /* We forward the incoming No-Path DAO to our parent, if we have
          one. */
       if(dag->preferred_parent != NULL &&
-         rpl_parent_get_ipaddr(dag->preferred_parent) != NULL) {
+         rpl_parent_get_ipaddr(dag->preferred_parent) != NULL &&
+         !dao_aggregate_target(instance, &prefix, prefixlen,
+                               RPL_ZERO_LIFETIME, flags)) {
         uint8_t out_seq;
         out_seq = prepare_for_dao_fwd(sequence, rep);
 
@@ -868,6 +1292,7 @@ dao_input_storing(void)
 
         buffer = UIP_ICMP_PAYLOAD;
         buffer[3] = out_seq; /* add an outgoing seq no before fwd */
+        RPL_STAT(rpl_stats.dao_out++);
         uip_icmp6_send(rpl_parent_get_ipaddr(dag->preferred_parent),
                        ICMP6_RPL, RPL_CODE_DAO, buffer_length);
       }
@@ -944,7 +1369,8 @@ fwd_dao:
     }
 
     if(dag->preferred_parent != NULL &&
-       rpl_parent_get_ipaddr(dag->preferred_parent) != NULL) {
+       rpl_parent_get_ipaddr(dag->preferred_parent) != NULL &&
+       !dao_aggregate_target(instance, &prefix, prefixlen, lifetime, flags)) {
       uint8_t out_seq = 0;
       if(rep != NULL) {
         /* If this is pending and we get the same sequence number,
@@ -964,6 +1390,7 @@ fwd_dao:
 
       buffer = UIP_ICMP_PAYLOAD;
       buffer[3] = out_seq; /* add an outgoing seq no before fwd */
+      RPL_STAT(rpl_stats.dao_out++);
       uip_icmp6_send(rpl_parent_get_ipaddr(dag->preferred_parent),
                      ICMP6_RPL, RPL_CODE_DAO, buffer_length);
     }
@@ -1081,6 +1508,7 @@ dao_input_nonstoring(void)
 
       memset(&prefix, 0, sizeof(prefix));
       memcpy(&prefix, buffer + i + 4, (prefixlen + 7) / CHAR_BIT);
+      RPL_STAT(rpl_stats.dao_targets_in++);
       break;
     case RPL_OPTION_TRANSIT:
       /* The path sequence and control are ignored. */
@@ -1144,6 +1572,8 @@ dao_input(void)
     goto discard;
   }
 
+  RPL_STAT(rpl_stats.dao_in++);
+
   instance_id = UIP_ICMP_PAYLOAD[0];
   instance = rpl_get_instance(instance_id);
   if(instance == NULL) {
@@ -1275,6 +1705,7 @@ dao_output_target_seq(rpl_parent_t *parent, uip_ipaddr_t *prefix,
   rpl_instance_t *instance;
   unsigned char *buffer;
   uint8_t prefixlen;
+  uint8_t flags;
   int pos;
   uip_ipaddr_t *parent_ipaddr = NULL;
   uip_ipaddr_t *dest_ipaddr = NULL;
@@ -1318,25 +1749,13 @@ dao_output_target_seq(rpl_parent_t *parent, uip_ipaddr_t *prefix,
 #endif
 
   buffer = UIP_ICMP_PAYLOAD;
-  pos = 0;
-
-  buffer[pos++] = instance->instance_id;
-  buffer[pos] = 0;
-#if RPL_DAO_SPECIFY_DAG
-  buffer[pos] |= RPL_DAO_D_FLAG;
-#endif /* RPL_DAO_SPECIFY_DAG */
+  flags = 0;
 #if RPL_WITH_DAO_ACK
   if(lifetime != RPL_ZERO_LIFETIME) {
-    buffer[pos] |= RPL_DAO_K_FLAG;
+    flags |= RPL_DAO_K_FLAG;
   }
 #endif /* RPL_WITH_DAO_ACK */
-  ++pos;
-  buffer[pos++] = 0; /* reserved */
-  buffer[pos++] = seq_no;
-#if RPL_DAO_SPECIFY_DAG
-  memcpy(buffer + pos, &dag->dag_id, sizeof(dag->dag_id));
-  pos += sizeof(dag->dag_id);
-#endif /* RPL_DAO_SPECIFY_DAG */
+  pos = dao_output_header(dag, buffer, flags, seq_no);
 
   /* Create a target suboption. */
   prefixlen = sizeof(*prefix) * CHAR_BIT;
@@ -1358,6 +1777,16 @@ dao_output_target_seq(rpl_parent_t *parent, uip_ipaddr_t *prefix,
   if(instance->mop != RPL_MOP_NON_STORING) {
     /* Send DAO to the parent. */
     dest_ipaddr = parent_ipaddr;
+#if RPL_WITH_STORING
+    /* Advertise the queued targets of our children along with ours,
+       unless this DAO is to be acknowledged or is a No-Path DAO to a
+       former parent. */
+    if(!(flags & RPL_DAO_K_FLAG) && lifetime != RPL_ZERO_LIFETIME &&
+       instance->current_dag != NULL &&
+       parent == instance->current_dag->preferred_parent) {
+      pos = dao_output_queued_targets(instance, buffer, pos);
+    }
+#endif /* RPL_WITH_STORING */
   } else {
     /* Include the parent's global IP address. */
     memcpy(buffer + pos, &parent->dag->dag_id, 8); /* Prefix */
@@ -1380,6 +1809,7 @@ dao_output_target_seq(rpl_parent_t *parent, uip_ipaddr_t *prefix,
   LOG_INFO_("\n");
 
   if(dest_ipaddr != NULL) {
+    RPL_STAT(rpl_stats.dao_out++);
     uip_icmp6_send(dest_ipaddr, ICMP6_RPL, RPL_CODE_DAO, pos);
   }
 }
@@ -99,6 +99,26 @@
 /* Reject parents that have a higher path cost than the following. */
 #define MAX_PATH_COST      32768   /* Eq path ETX of 256 */
 
+/*
+ * Optional penalty for unstable links, added to the path cost through a
+ * neighbor: RPL_MRHOF_CONF_VARIANCE_PENALTY percent of the ETX variance over
+ * the link-stats window. A stable link and an oscillating one with the same
+ * mean ETX no longer look alike, which reduces parent switches caused by the
+ * EWMA following the oscillation. Requires LINK_STATS_CONF_WINDOW_SIZE.
+ */
+#ifdef RPL_MRHOF_CONF_VARIANCE_PENALTY
+#define RPL_MRHOF_VARIANCE_PENALTY RPL_MRHOF_CONF_VARIANCE_PENALTY
+#else /* RPL_MRHOF_CONF_VARIANCE_PENALTY */
+#define RPL_MRHOF_VARIANCE_PENALTY 0
+#endif /* RPL_MRHOF_CONF_VARIANCE_PENALTY */
+
+#if RPL_MRHOF_VARIANCE_PENALTY && !LINK_STATS_WINDOW_SIZE
+#error "RPL_MRHOF_CONF_VARIANCE_PENALTY requires LINK_STATS_CONF_WINDOW_SIZE"
+#endif
+
+/* Minimum number of samples in the window before the variance is used */
+#define VARIANCE_MIN_SAMPLES 4
+
 /*---------------------------------------------------------------------------*/
 static void
 reset(rpl_dag_t *dag)
@@ -126,6 +146,20 @@ dao_ack_callback(rpl_parent_t *p, int status)
 #endif /* RPL_WITH_DAO_ACK */
 /*---------------------------------------------------------------------------*/
 static uint16_t
+link_variance_penalty(const struct link_stats *stats)
+{
+#if RPL_MRHOF_VARIANCE_PENALTY
+  struct link_stats_window window;
+
+  if(link_stats_get_window(stats, &window) >= VARIANCE_MIN_SAMPLES) {
+    return MIN((uint32_t)window.etx_variance * RPL_MRHOF_VARIANCE_PENALTY / 100,
+               0xffff);
+  }
+#endif /* RPL_MRHOF_VARIANCE_PENALTY */
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
 parent_link_metric(rpl_parent_t *p)
 {
   const struct link_stats *stats = rpl_get_parent_link_stats(p);
@@ -167,7 +201,8 @@ parent_path_cost(rpl_parent_t *p)
 #endif /* RPL_WITH_MC */
 
   /* path cost upper bound: 0xffff */
-  return MIN((uint32_t)base + parent_link_metric(p), 0xffff);
+  return MIN((uint32_t)base + parent_link_metric(p)
+             + link_variance_penalty(rpl_get_parent_link_stats(p)), 0xffff);
 }
 /*---------------------------------------------------------------------------*/
 static rpl_rank_t
@@ -122,6 +122,14 @@
 #define RPL_DAO_DELAY                 (CLOCK_SECOND * 4)
 #endif /* RPL_CONF_DAO_DELAY */
 
+/* The largest DAO sent when advertising several targets at once */
+#ifdef RPL_CONF_DAO_MAX_SIZE
+#define RPL_DAO_MAX_SIZE              RPL_CONF_DAO_MAX_SIZE
+#else /* RPL_CONF_DAO_MAX_SIZE */
+#define RPL_DAO_MAX_SIZE              (UIP_BUFSIZE - UIP_IPH_LEN - \
+                                       UIP_ICMPH_LEN - RPL_HOP_BY_HOP_LEN)
+#endif /* RPL_CONF_DAO_MAX_SIZE */
+
 /* Delay between reception of a no-path DAO and actual route removal */
 #ifdef RPL_CONF_NOPATH_REMOVAL_DELAY
 #define RPL_NOPATH_REMOVAL_DELAY          RPL_CONF_NOPATH_REMOVAL_DELAY
@@ -261,6 +269,11 @@ struct rpl_stats {
   uint16_t loop_errors;
   uint16_t loop_warnings;
   uint16_t root_repairs;
+  /* DAO aggregation: the root receives fewer DAOs than targets. */
+  uint16_t dao_in;
+  uint16_t dao_targets_in;
+  uint16_t dao_out;
+  uint16_t dao_targets_merged;
 };
 typedef struct rpl_stats rpl_stats_t;
 
@@ -45,6 +45,7 @@
 #include "net/ipv6/multicast/uip-mcast6.h"
 #include "net/ipv6/uip-sr.h"
 #include "lib/random.h"
+#include "lib/trickle-timer.h"
 #include "sys/ctimer.h"
 #include "sys/log.h"
 
@@ -68,8 +69,7 @@ clock_time_t RPL_PROBING_DELAY_FUNC(rpl_dag_t *dag);
 static struct ctimer periodic_timer;
 
 static void handle_periodic_timer(void *ptr);
-static void new_dio_interval(rpl_instance_t *instance);
-static void handle_dio_timer(void *ptr);
+static void handle_dio_timer(void *ptr, uint8_t suppress);
 
 static uint16_t next_dis;
 
@@ -105,58 +105,27 @@ handle_periodic_timer(void *ptr)
   ctimer_reset(&periodic_timer);
 }
 /*---------------------------------------------------------------------------*/
+/* Called by the trickle library at the start of each DIO interval. Keeps
+ * dio_intcurrent in sync and notifies the lower layers of the new interval */
 static void
-new_dio_interval(rpl_instance_t *instance)
+dio_interval_started(void *ptr)
 {
-  uint32_t time;
-  clock_time_t ticks;
-
-  /* TODO: too small timer intervals for many cases. */
-  time = 1UL << instance->dio_intcurrent;
-
-  /* Convert from milliseconds to CLOCK_TICKS. */
-  ticks = (time * CLOCK_SECOND) / 1000;
-  instance->dio_next_delay = ticks;
-
-  /* Random number between I/2 and I. */
-  ticks = ticks / 2 + (ticks / 2 * (uint32_t)random_rand()) / RANDOM_RAND_MAX;
-
-  /*
-   * The intervals must be equally long among the nodes for Trickle to
-   * operate efficiently. Therefore we need to calculate the delay between
-   * the randomized time and the start time of the next interval.
-   */
-  instance->dio_next_delay -= ticks;
-  instance->dio_send = 1;
-
-#if RPL_CONF_STATS
-  /* Keep some stats. */
-  instance->dio_totint++;
-  instance->dio_totrecv += instance->dio_counter;
-  LOG_ANNOTATE("#A rank=%u.%u(%u),stats=%d %d %d %d,color=%s\n",
-               DAG_RANK(instance->current_dag->rank, instance),
-               (10 * (instance->current_dag->rank % instance->min_hoprankinc)) / instance->min_hoprankinc,
-               instance->current_dag->version,
-               instance->dio_totint, instance->dio_totsend,
-               instance->dio_totrecv, instance->dio_intcurrent,
-               instance->current_dag->rank == ROOT_RANK(instance) ? "BLUE" : "ORANGE");
-#endif /* RPL_CONF_STATS */
-
-  /* Reset the redundancy counter. */
-  instance->dio_counter = 0;
+  rpl_instance_t *instance = (rpl_instance_t *)ptr;
+  struct trickle_timer *tt = &instance->dio_timer;
+  uint8_t doublings = 0;
 
-  /* Schedule the timer. */
-  LOG_INFO("Scheduling DIO timer %lu ticks in future (Interval)\n",
-           (unsigned long)ticks);
-  ctimer_set(&instance->dio_timer, ticks, &handle_dio_timer, instance);
+  while(doublings < tt->i_max && (tt->i_min << doublings) < tt->i_cur) {
+    doublings++;
+  }
+  instance->dio_intcurrent = instance->dio_intmin + doublings;
 
 #ifdef RPL_CALLBACK_NEW_DIO_INTERVAL
-  RPL_CALLBACK_NEW_DIO_INTERVAL((CLOCK_SECOND * 1UL << instance->dio_intcurrent) / 1000);
+  RPL_CALLBACK_NEW_DIO_INTERVAL(tt->i_cur);
 #endif /* RPL_CALLBACK_NEW_DIO_INTERVAL */
 }
 /*---------------------------------------------------------------------------*/
 static void
-handle_dio_timer(void *ptr)
+handle_dio_timer(void *ptr, uint8_t suppress)
 {
   rpl_instance_t *instance = (rpl_instance_t *)ptr;
 
@@ -166,35 +135,36 @@ handle_dio_timer(void *ptr)
       dio_send_ok = 1;
     } else {
       LOG_WARN("Postponing DIO transmission since link local address is not ok\n");
-      ctimer_set(&instance->dio_timer, CLOCK_SECOND, &handle_dio_timer, instance);
+      /* Try again within Imin, without doubling the interval */
+      trickle_timer_set_at_imin(&instance->dio_timer, handle_dio_timer,
+                                instance);
       return;
     }
   }
 
-  if(instance->dio_send) {
-    /* Send DIO if counter is less than desired redundancy. */
-    if(instance->dio_redundancy == 0 || instance->dio_counter < instance->dio_redundancy) {
 #if RPL_CONF_STATS
-      instance->dio_totsend++;
+  /* Keep some stats. */
+  instance->dio_totint++;
+  instance->dio_totrecv += instance->dio_timer.c;
+  LOG_ANNOTATE("#A rank=%u.%u(%u),stats=%d %d %d %d,color=%s\n",
+               DAG_RANK(instance->current_dag->rank, instance),
+               (10 * (instance->current_dag->rank % instance->min_hoprankinc)) / instance->min_hoprankinc,
+               instance->current_dag->version,
+               instance->dio_totint, instance->dio_totsend,
+               instance->dio_totrecv, instance->dio_intcurrent,
+               instance->current_dag->rank == ROOT_RANK(instance) ? "BLUE" : "ORANGE");
 #endif /* RPL_CONF_STATS */
-      dio_output(instance, NULL);
-    } else {
-      LOG_DBG("Suppressing DIO transmission (%d >= %d)\n",
-              instance->dio_counter, instance->dio_redundancy);
-    }
-    instance->dio_send = 0;
-    LOG_DBG("Scheduling DIO timer %lu ticks in future (sent)\n",
-            (unsigned long)instance->dio_next_delay);
-    ctimer_set(&instance->dio_timer, instance->dio_next_delay,
-               handle_dio_timer, instance);
+
+  /* Send DIO if counter is less than desired redundancy, or if
+     dio_redundancy is 0 (checked by the trickle library). */
+  if(suppress == TRICKLE_TIMER_TX_OK) {
+#if RPL_CONF_STATS
+    instance->dio_totsend++;
+#endif /* RPL_CONF_STATS */
+    dio_output(instance, NULL);
   } else {
-    /* Check if we need to double interval. */
-    if(instance->dio_intcurrent <
-       instance->dio_intmin + instance->dio_intdoubl) {
-      instance->dio_intcurrent++;
-      LOG_DBG("DIO Timer interval doubled %d\n", instance->dio_intcurrent);
-    }
-    new_dio_interval(instance);
+    LOG_DBG("Suppressing DIO transmission (%d >= %d)\n",
+            instance->dio_timer.c, instance->dio_redundancy);
   }
 
   if(LOG_DBG_ENABLED) {
@@ -211,17 +181,50 @@ rpl_reset_periodic_timer(void)
   ctimer_set(&periodic_timer, CLOCK_SECOND, handle_periodic_timer, NULL);
 }
 /*---------------------------------------------------------------------------*/
+/* Tells whether the DIO timer runs with other parameters than the instance,
+ * e.g. after a global repair changed them */
+static int
+dio_timer_config_changed(rpl_instance_t *instance, clock_time_t imin)
+{
+  struct trickle_timer *tt = &instance->dio_timer;
+
+  return tt->i_min != imin
+    || tt->k != instance->dio_redundancy
+    /* the library lowers an Imax that the clock cannot hold */
+    || (tt->i_max != instance->dio_intdoubl
+        && !TRICKLE_TIMER_IPAIR_IS_BAD(imin, instance->dio_intdoubl));
+}
+/*---------------------------------------------------------------------------*/
 /* Resets the DIO timer in the instance to its minimal interval. */
 void
 rpl_reset_dio_timer(rpl_instance_t *instance)
 {
 #if !RPL_LEAF_ONLY
-  /* Do not reset if we are already on the minimum interval,
-     unless forced to do so. */
-  if(instance->dio_intcurrent > instance->dio_intmin) {
-    instance->dio_counter = 0;
-    instance->dio_intcurrent = instance->dio_intmin;
-    new_dio_interval(instance);
+  clock_time_t imin;
+
+  /* Convert Imin from milliseconds to clock ticks */
+  imin = ((1UL << instance->dio_intmin) * CLOCK_SECOND) / 1000;
+  if(imin < 2) {
+    imin = 2;
+  }
+
+  if(!trickle_timer_is_running(&instance->dio_timer)
+     || dio_timer_config_changed(instance, imin)) {
+    /* Configuring also stops the timer if it was running */
+    if(!trickle_timer_config(&instance->dio_timer, imin,
+                             instance->dio_intdoubl,
+                             instance->dio_redundancy)) {
+      LOG_ERR("failed to configure the DIO timer\n");
+      return;
+    }
+    trickle_timer_set_interval_callback(&instance->dio_timer,
+                                        dio_interval_started);
+    trickle_timer_set_at_imin(&instance->dio_timer, handle_dio_timer,
+                              instance);
+  } else if(instance->dio_timer.i_cur != instance->dio_timer.i_min) {
+    /* Do not reset if we are already on the minimum interval, see
+       Section 4.2, RFC 6206. */
+    trickle_timer_reset_event(&instance->dio_timer);
   }
 #if RPL_CONF_STATS
   rpl_stats.resets++;
@@ -444,6 +444,13 @@ rpl_is_in_leaf_mode(void)
   return RPL_LEAF_ONLY ? 1 : 0;
 }
 /*---------------------------------------------------------------------------*/
+static const uip_ipaddr_t *
+get_default_nexthop(void)
+{
+  /* RPL classic maintains the DS6 default route of the instance in use */
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
 const struct routing_driver rpl_classic_driver = {
   "RPL Classic",
   init,
@@ -466,6 +473,7 @@ const struct routing_driver rpl_classic_driver = {
   rpl_ipv6_neighbor_callback,
   drop_route,
   rpl_is_in_leaf_mode,
+  get_default_nexthop,
 };
 /*---------------------------------------------------------------------------*/
 
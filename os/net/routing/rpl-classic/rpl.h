@@ -42,6 +42,7 @@
 #include "lib/list.h"
 #include "net/ipv6/uip.h"
 #include "net/ipv6/uip-ds6.h"
+#include "lib/trickle-timer.h"
 #include "sys/ctimer.h"
 
 /*---------------------------------------------------------------------------*/
@@ -235,9 +236,7 @@ struct rpl_instance {
   uint8_t dio_intmin;
   uint8_t dio_redundancy;
   uint8_t default_lifetime;
-  uint8_t dio_intcurrent;
-  uint8_t dio_send; /* For keeping track of which mode the timer is in. */
-  uint8_t dio_counter;
+  uint8_t dio_intcurrent; /* Current DIO interval, follows dio_timer. */
   /* My last registered DAO that I might be waiting for an ACK on. */
   uint8_t my_dao_seqno;
   uint8_t my_dao_transmissions;
@@ -251,13 +250,12 @@ struct rpl_instance {
   uint16_t dio_totsend;
   uint16_t dio_totrecv;
 #endif /* RPL_CONF_STATS */
-  clock_time_t dio_next_delay; /* Delay for completion of the DIO interval. */
 #if RPL_WITH_PROBING
   struct ctimer probing_timer;
   rpl_parent_t *urgent_probing_target;
   int last_dag;
 #endif /* RPL_WITH_PROBING */
-  struct ctimer dio_timer;
+  struct trickle_timer dio_timer;
   struct ctimer dao_timer;
   struct ctimer dao_lifetime_timer;
   struct ctimer unicast_dio_timer;
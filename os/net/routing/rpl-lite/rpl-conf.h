@@ -147,6 +147,21 @@
 #endif
 #endif /* RPL_CONF_TRICKLE_REFRESH_DAO_ROUTES */
 
+/*
+ * Keep the neighbors sorted by path cost as they are updated, so that
+ * parent selection only evaluates the preferred parent and the neighbors
+ * that are at least as good as the best candidate found so far, instead
+ * of the whole neighbor table. This relies on the OF never preferring a
+ * neighbor with a higher path cost, other than the preferred parent, which
+ * holds for OF0 and MRHOF. Call rpl_neighbor_update() after changing the
+ * rank, metric container or link metric of a neighbor.
+ */
+#ifdef RPL_CONF_INCREMENTAL_PARENT_SELECTION
+#define RPL_INCREMENTAL_PARENT_SELECTION RPL_CONF_INCREMENTAL_PARENT_SELECTION
+#else
+#define RPL_INCREMENTAL_PARENT_SELECTION 1
+#endif
+
 /*
  * RPL probing. When enabled, probes will be sent periodically to keep
  * neighbor link estimates up to date. Further configurable
@@ -367,6 +382,19 @@
 #define RPL_DEFAULT_INSTANCE	          0 /* Default of 0 for compression */
 #endif /* RPL_CONF_DEFAULT_INSTANCE */
 
+/*
+ * Maximum number of RPL instances (one DODAG each) a node can participate
+ * in concurrently. Each instance has its own neighbor set, timers and
+ * objective function. Non-root nodes join every instance they hear DIOs
+ * from, up to this limit, and pick an instance per packet (see
+ * rpl-ext-header.c). A root only participates in its own instance.
+ */
+#ifdef RPL_CONF_MAX_INSTANCES
+#define RPL_MAX_INSTANCES               RPL_CONF_MAX_INSTANCES
+#else
+#define RPL_MAX_INSTANCES               1
+#endif /* RPL_CONF_MAX_INSTANCES */
+
 /* Set to have the root advertise a grounded DAG */
 #ifndef RPL_CONF_GROUNDED
 #define RPL_GROUNDED                    0
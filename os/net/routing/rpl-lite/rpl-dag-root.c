@@ -122,14 +122,39 @@ rpl_dag_root_set_prefix(uip_ipaddr_t *prefix, uip_ipaddr_t *iid)
 /*---------------------------------------------------------------------------*/
 int
 rpl_dag_root_start(void)
+{
+  return rpl_dag_root_start_instance(RPL_DEFAULT_INSTANCE);
+}
+/*---------------------------------------------------------------------------*/
+int
+rpl_dag_root_start_instance(uint8_t instance_id)
 {
   struct uip_ds6_addr *root_if;
   int i;
   uint8_t state;
   uip_ipaddr_t *ipaddr = NULL;
+  rpl_instance_t *instance;
+  rpl_instance_t *prev;
+  int ret;
 
   rpl_dag_root_set_prefix(NULL, NULL);
 
+  /* Re-use the instance if we are already in it. Otherwise, the root
+   * takes over the first instance. */
+  instance = rpl_instance_get(instance_id);
+  prev = rpl_instance_set_current(instance != NULL ? instance : &rpl_instances[0]);
+
+#if RPL_MAX_INSTANCES > 1
+  /* Leave all other instances */
+  for(i = 0; i < RPL_MAX_INSTANCES; i++) {
+    if(rpl_instances[i].used && &rpl_instances[i] != rpl_curr_instance) {
+      instance = rpl_instance_set_current(&rpl_instances[i]);
+      rpl_dag_leave();
+      rpl_instance_set_current(instance);
+    }
+  }
+#endif /* RPL_MAX_INSTANCES > 1 */
+
   for(i = 0; i < UIP_DS6_ADDR_NB; i++) {
     state = uip_ds6_if.addr_list[i].state;
     if(uip_ds6_if.addr_list[i].isused &&
@@ -140,18 +165,24 @@ rpl_dag_root_start(void)
   }
 
   root_if = uip_ds6_addr_lookup(ipaddr);
-  if(ipaddr != NULL || root_if != NULL) {
+  if(!rpl_neighbor_instance_has_table(rpl_curr_instance)) {
+    LOG_ERR("failed to create a new RPL DAG, no neighbor table\n");
+    ret = -1;
+  } else if(ipaddr != NULL || root_if != NULL) {
 
-    rpl_dag_init_root(RPL_DEFAULT_INSTANCE, ipaddr,
+    rpl_dag_init_root(instance_id, ipaddr,
       (uip_ipaddr_t *)rpl_get_global_address(), 64, UIP_ND6_RA_FLAG_AUTONOMOUS);
     rpl_dag_update_state();
 
     LOG_INFO("created a new RPL DAG\n");
-    return 0;
+    ret = 0;
   } else {
     LOG_ERR("failed to create a new RPL DAG\n");
-    return -1;
+    ret = -1;
   }
+
+  rpl_instance_set_current(prev);
+  return ret;
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -57,6 +57,15 @@ void rpl_dag_root_set_prefix(uip_ipaddr_t *prefix, uip_ipaddr_t *iid);
 */
 int rpl_dag_root_start(void);
 
+/**
+ * Set the node as root and start a DAG with a given instance ID. As a
+ * root only participates in its own instance, any other instance is left.
+ *
+ * \param instance_id The RPL instance ID
+ * \return 0 in case of success, -1 otherwise
+*/
+int rpl_dag_root_start_instance(uint8_t instance_id);
+
 /**
  * Tells whether we are DAG root or not
  *
@@ -59,7 +59,10 @@ static int process_dio_init_dag(rpl_dio_t *dio);
 
 /*---------------------------------------------------------------------------*/
 /* Allocate instance table. */
-rpl_instance_t curr_instance;
+rpl_instance_t rpl_instances[RPL_MAX_INSTANCES];
+#if RPL_MAX_INSTANCES > 1
+rpl_instance_t *rpl_curr_instance = &rpl_instances[0];
+#endif /* RPL_MAX_INSTANCES > 1 */
 
 /*---------------------------------------------------------------------------*/
 
@@ -84,6 +87,91 @@ rpl_dag_state_to_str(enum rpl_dag_state state)
       return "unknown";
   }
 }
+#if RPL_MAX_INSTANCES > 1
+rpl_instance_t *
+rpl_instance_set_current(rpl_instance_t *instance)
+{
+  rpl_instance_t *prev = rpl_curr_instance;
+  if(instance != NULL) {
+    rpl_curr_instance = instance;
+    rpl_neighbor_set_instance(instance);
+  }
+  return prev;
+}
+#endif /* RPL_MAX_INSTANCES > 1 */
+/*---------------------------------------------------------------------------*/
+rpl_instance_t *
+rpl_instance_get(uint8_t instance_id)
+{
+  int i;
+  for(i = 0; i < RPL_MAX_INSTANCES; i++) {
+    if(rpl_instances[i].used && rpl_instances[i].instance_id == instance_id) {
+      return &rpl_instances[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+rpl_instance_t *
+rpl_instance_get_from_addr(const uip_ipaddr_t *addr)
+{
+  int i;
+  for(i = 0; i < RPL_MAX_INSTANCES; i++) {
+    rpl_instance_t *instance = &rpl_instances[i];
+    if(instance->used && instance->dag.prefix_info.length != 0
+       && uip_ipaddr_prefixcmp(&instance->dag.dag_id, addr,
+                               instance->dag.prefix_info.length)) {
+      return instance;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static int
+primary_preference(const rpl_instance_t *instance)
+{
+  switch(instance->dag.state) {
+    case DAG_REACHABLE:
+      return 2;
+    case DAG_JOINED:
+      return 1;
+    default:
+      return 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+rpl_instance_t *
+rpl_instance_get_primary(void)
+{
+  rpl_instance_t *best = NULL;
+  int i;
+
+  for(i = 0; i < RPL_MAX_INSTANCES; i++) {
+    rpl_instance_t *instance = &rpl_instances[i];
+    if(!instance->used) {
+      continue;
+    }
+    if(best == NULL
+       || primary_preference(instance) > primary_preference(best)
+       || (primary_preference(instance) == primary_preference(best)
+           && instance->instance_id < best->instance_id)) {
+      best = instance;
+    }
+  }
+  return best != NULL ? best : &rpl_instances[0];
+}
+/*---------------------------------------------------------------------------*/
+int
+rpl_instance_any_root(void)
+{
+  int i;
+  for(i = 0; i < RPL_MAX_INSTANCES; i++) {
+    if(rpl_instances[i].used && rpl_instances[i].dag.rank == ROOT_RANK) {
+      return 1;
+    }
+  }
+  return 0;
+}
 /*---------------------------------------------------------------------------*/
 int
 rpl_dag_get_root_ipaddr(uip_ipaddr_t *ipaddr)
@@ -95,6 +183,18 @@ rpl_dag_get_root_ipaddr(uip_ipaddr_t *ipaddr)
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+static int
+other_instances_used(void)
+{
+  int i;
+  for(i = 0; i < RPL_MAX_INSTANCES; i++) {
+    if(&rpl_instances[i] != rpl_curr_instance && rpl_instances[i].used) {
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
 void
 rpl_dag_leave(void)
 {
@@ -108,8 +208,10 @@ rpl_dag_leave(void)
     rpl_icmp6_dao_output(0);
   }
 
-  /* Forget past link statistics */
-  link_stats_reset();
+  /* Forget past link statistics, unless other instances still use them */
+  if(!other_instances_used()) {
+    link_stats_reset();
+  }
 
   /* Remove all neighbors, links and default route */
   rpl_neighbor_remove_all();
@@ -138,6 +240,10 @@ void
 rpl_dag_periodic(unsigned seconds)
 {
   if(curr_instance.used) {
+    /* Link metrics may also change without a neighbor update, e.g. when
+     * link statistics are evicted. Refresh the parent selection order. */
+    rpl_neighbor_update_all();
+
     if(curr_instance.dag.lifetime != RPL_LIFETIME(RPL_INFINITE_LIFETIME)) {
       curr_instance.dag.lifetime =
         curr_instance.dag.lifetime > seconds ? curr_instance.dag.lifetime - seconds : 0;
@@ -164,13 +270,15 @@ rpl_is_addr_in_our_dag(const uip_ipaddr_t *addr)
 rpl_instance_t *
 rpl_get_default_instance(void)
 {
-  return curr_instance.used ? &curr_instance : NULL;
+  rpl_instance_t *instance = rpl_instance_get_primary();
+  return instance->used ? instance : NULL;
 }
 /*---------------------------------------------------------------------------*/
 rpl_dag_t *
 rpl_get_any_dag(void)
 {
-  return curr_instance.used ? &curr_instance.dag : NULL;
+  rpl_instance_t *instance = rpl_instance_get_primary();
+  return instance->used ? &instance->dag : NULL;
 }
 /*---------------------------------------------------------------------------*/
 static rpl_of_t *
@@ -393,6 +501,7 @@ update_nbr_from_dio(uip_ipaddr_t *from, rpl_dio_t *dio)
 #if RPL_WITH_MC
   memcpy(&nbr->mc, &dio->mc, sizeof(nbr->mc));
 #endif /* RPL_WITH_MC */
+  rpl_neighbor_update(nbr);
 
   return nbr;
 }
@@ -424,7 +533,7 @@ process_dio_from_current_dag(uip_ipaddr_t *from, rpl_dio_t *dio)
 
   /* Update DIO counter for redundancy mngt */
   if(dio->rank != RPL_INFINITE_RANK) {
-    curr_instance.dag.dio_counter++;
+    trickle_timer_consistency(&curr_instance.dag.dio_timer);
   }
 
   /* The DIO has a newer version: global repair.
@@ -700,6 +809,7 @@ rpl_process_hbh(rpl_nbr_t *sender, uint16_t sender_rank, int loop_detected, int
      * the sender's rank from ext header */
     if(sender != NULL) {
       sender->rank = sender_rank;
+      rpl_neighbor_update(sender);
       /* Select DAG and preferred parent. In case of a parent switch,
       the new parent will be used to forward the current packet. */
       rpl_dag_update_state();
@@ -761,7 +871,7 @@ rpl_dag_init_root(uint8_t instance_id, uip_ipaddr_t *dag_id,
 void
 rpl_dag_init(void)
 {
-  memset(&curr_instance, 0, sizeof(curr_instance));
+  memset(rpl_instances, 0, sizeof(rpl_instances));
 }
 /*---------------------------------------------------------------------------*/
 /** @} */
@@ -51,6 +51,56 @@
 
 /********** Public functions **********/
 
+/**
+ * Makes an instance the current instance, i.e. the one curr_instance
+ * and rpl_neighbors refer to
+ *
+ * \param instance The instance. If NULL, the current instance is kept
+ * \return The previous current instance, to be restored by the caller
+*/
+#if RPL_MAX_INSTANCES > 1
+rpl_instance_t *rpl_instance_set_current(rpl_instance_t *instance);
+#else /* RPL_MAX_INSTANCES > 1 */
+static inline rpl_instance_t *
+rpl_instance_set_current(rpl_instance_t *instance)
+{
+  return rpl_curr_instance;
+}
+#endif /* RPL_MAX_INSTANCES > 1 */
+
+/**
+ * Returns the instance in use with a given instance ID
+ *
+ * \param instance_id The instance ID
+ * \return The instance, NULL if there is none
+*/
+rpl_instance_t *rpl_instance_get(uint8_t instance_id);
+
+/**
+ * Returns the instance in use whose DAG prefix covers a given address
+ *
+ * \param addr The global IPv6 address
+ * \return The instance, NULL if there is none
+*/
+rpl_instance_t *rpl_instance_get_from_addr(const uip_ipaddr_t *addr);
+
+/**
+ * Returns the primary instance: the reachable instance with the lowest
+ * instance ID, or failing that, the joined (then used) instance with the
+ * lowest ID. Used for traffic that carries no per-flow information, for
+ * the root address handed to applications and to drive TSCH.
+ *
+ * \return The primary instance, rpl_instances[0] if no instance is in use
+*/
+rpl_instance_t *rpl_instance_get_primary(void);
+
+/**
+ * Tells whether we are root of any instance
+ *
+ * \return 1 if we are root of an instance, 0 otherwise
+*/
+int rpl_instance_any_root(void);
+
 /**
  * Returns a textual description of the current DAG state
  *
@@ -120,14 +170,14 @@ void rpl_dag_init_root(uint8_t instance_id, uip_ipaddr_t *dag_id,
 /**
  * Returns pointer to the default instance (for compatibility with legagy RPL code)
  *
- * \return A pointer to the only supported instance
+ * \return A pointer to the primary instance, NULL if there is none
 */
 rpl_instance_t *rpl_get_default_instance(void);
 
 /**
  * Returns pointer to any DAG (for compatibility with legagy RPL code)
  *
- * \return A pointer to the only supported DAG
+ * \return A pointer to the DAG of the primary instance, NULL if there is none
 */
 rpl_dag_t *rpl_get_any_dag(void);
 
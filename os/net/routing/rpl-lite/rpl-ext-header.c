@@ -53,6 +53,14 @@
 #define LOG_MODULE "RPL"
 #define LOG_LEVEL LOG_LEVEL_RPL
 
+/* A configurable function that selects the instance of packets we
+ * originate, returning NULL to fall back to the default selection */
+#ifdef RPL_CALLBACK_SELECT_INSTANCE
+rpl_instance_t *RPL_CALLBACK_SELECT_INSTANCE(void);
+#endif /* RPL_CALLBACK_SELECT_INSTANCE */
+
+static int process_hbh_option(struct uip_ext_hdr_opt_rpl *rpl_opt);
+
 /*---------------------------------------------------------------------------*/
 int
 rpl_ext_header_srh_get_next_hop(uip_ipaddr_t *ipaddr)
@@ -60,15 +68,17 @@ rpl_ext_header_srh_get_next_hop(uip_ipaddr_t *ipaddr)
   struct uip_routing_hdr *rh_header;
   uip_sr_node_t *dest_node;
   uip_sr_node_t *root_node;
+  rpl_instance_t *instance;
 
   /* Look for routing ext header */
   rh_header = (struct uip_routing_hdr *)uipbuf_search_header(uip_buf, uip_len, UIP_PROTO_ROUTING);
 
-  if(!rpl_is_addr_in_our_dag(&UIP_IP_BUF->destipaddr)) {
+  instance = rpl_instance_get_from_addr(&UIP_IP_BUF->destipaddr);
+  if(instance == NULL) {
     return 0;
   }
 
-  root_node = uip_sr_get_node(NULL, &curr_instance.dag.dag_id);
+  root_node = uip_sr_get_node(NULL, &instance->dag.dag_id);
   dest_node = uip_sr_get_node(NULL, &UIP_IP_BUF->destipaddr);
 
   if((rh_header != NULL && rh_header->routing_type == RPL_RH_TYPE_SRH) ||
@@ -243,6 +253,32 @@ count_matching_bytes(const void *p1, const void *p2, size_t n)
   return n;
 }
 /*---------------------------------------------------------------------------*/
+/* Makes room for a RPL SRH extension header of ext_len bytes, inserted as
+ * first extension header. Returns 1 on success, 0 if the packet would get
+ * too long. */
+static int
+make_room_for_srh_header(uint8_t ext_len)
+{
+  struct uip_routing_hdr *rh_hdr = (struct uip_routing_hdr *)UIP_IP_PAYLOAD(0);
+
+  /* Check if there is enough space to store the extension header */
+  if(uip_len + ext_len > UIP_LINK_MTU) {
+    LOG_ERR("packet too long: impossible to add source routing header (%u bytes)\n", ext_len);
+    return 0;
+  }
+
+  /* Move existing ext headers and payload ext_len further */
+  memmove(uip_buf + UIP_IPH_LEN + uip_ext_len + ext_len,
+      uip_buf + UIP_IPH_LEN + uip_ext_len, uip_len - UIP_IPH_LEN);
+  memset(uip_buf + UIP_IPH_LEN + uip_ext_len, 0, ext_len);
+
+  /* Insert source routing header (as first ext header) */
+  rh_hdr->next = UIP_IP_BUF->proto;
+  UIP_IP_BUF->proto = UIP_PROTO_ROUTING;
+
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
 /* Used by rpl_ext_header_update to insert a RPL SRH extension header. This
  * is used at the root, to initiate downward routing. Returns 1 on success,
  * 0 on failure.
@@ -260,6 +296,7 @@ insert_srh_header(void)
   uip_sr_node_t *root_node;
   uip_sr_node_t *node;
   uip_ipaddr_t node_addr;
+  const uip_sr_hdr_cache_t *cached;
 
   /* Always insest SRH as first extension header */
   struct uip_routing_hdr *rh_hdr = (struct uip_routing_hdr *)UIP_IP_PAYLOAD(0);
@@ -279,6 +316,22 @@ insert_srh_header(void)
     return 1;
   }
 
+  /* Reuse the header built for a previous packet, if the graph has not
+   * changed since */
+  cached = uip_sr_hdr_cache_lookup(NULL, &UIP_IP_BUF->destipaddr);
+  if(cached != NULL) {
+    LOG_INFO("SRH using cached header, ext len %u\n", cached->len);
+    if(!make_room_for_srh_header(cached->len)) {
+      return 0;
+    }
+    /* Copy all but the next header field */
+    memcpy((uint8_t *)rh_hdr + 1, cached->hdr + 1, cached->len - 1);
+    uip_ipaddr_copy(&UIP_IP_BUF->destipaddr, &cached->next_hop);
+    uipbuf_add_ext_hdr(cached->len);
+    uipbuf_set_len_field(UIP_IP_BUF, uip_len - UIP_IPH_LEN);
+    return 1;
+  }
+
   dest_node = uip_sr_get_node(NULL, &UIP_IP_BUF->destipaddr);
   if(dest_node == NULL) {
     /* The destination is not found, skip SRH insertion */
@@ -334,21 +387,10 @@ insert_srh_header(void)
   LOG_INFO("SRH path len: %u, ComprI %u, ComprE %u, ext len %u (padding %u)\n",
       path_len, cmpri, cmpre, ext_len, padding);
 
-  /* Check if there is enough space to store the extension header */
-  if(uip_len + ext_len > UIP_LINK_MTU) {
-    LOG_ERR("packet too long: impossible to add source routing header (%u bytes)\n", ext_len);
+  if(!make_room_for_srh_header(ext_len)) {
     return 0;
   }
 
-  /* Move existing ext headers and payload ext_len further */
-  memmove(uip_buf + UIP_IPH_LEN + uip_ext_len + ext_len,
-      uip_buf + UIP_IPH_LEN + uip_ext_len, uip_len - UIP_IPH_LEN);
-  memset(uip_buf + UIP_IPH_LEN + uip_ext_len, 0, ext_len);
-
-  /* Insert source routing header (as first ext header) */
-  rh_hdr->next = UIP_IP_BUF->proto;
-  UIP_IP_BUF->proto = UIP_PROTO_ROUTING;
-
   /* Initialize IPv6 Routing Header */
   rh_hdr->len = (ext_len - 8) / 8;
   rh_hdr->routing_type = RPL_RH_TYPE_SRH;
@@ -374,6 +416,8 @@ insert_srh_header(void)
 
   /* The next hop (i.e. node whose parent is the root) is placed as the current IPv6 destination */
   NETSTACK_ROUTING.get_sr_node_ipaddr(&node_addr, node);
+  uip_sr_hdr_cache_add(NULL, &UIP_IP_BUF->destipaddr, &node_addr,
+                       (uint8_t *)rh_hdr, ext_len);
   uip_ipaddr_copy(&UIP_IP_BUF->destipaddr, &node_addr);
 
   /* Update the IPv6 length field */
@@ -386,12 +430,8 @@ insert_srh_header(void)
 int
 rpl_ext_header_hbh_update(uint8_t *ext_buf, int opt_offset)
 {
-  int down;
-  int rank_error_signaled;
-  int loop_detected;
-  uint16_t sender_rank;
-  uint8_t sender_closer;
-  rpl_nbr_t *sender;
+  rpl_instance_t *prev;
+  int ret;
 
   /* RFC 6553: "This option has an alignment requirement of 2n." */
   if(opt_offset < 0 || opt_offset & 1) {
@@ -410,6 +450,24 @@ rpl_ext_header_hbh_update(uint8_t *ext_buf, int opt_offset)
     return 0; /* Drop */
   }
 
+  prev = rpl_instance_set_current(rpl_instance_get(rpl_opt->instance));
+  ret = process_hbh_option(rpl_opt);
+  rpl_instance_set_current(prev);
+  return ret;
+}
+/*---------------------------------------------------------------------------*/
+/* Processes the RPL option of a packet being forwarded, in the context of
+ * the instance it refers to. Returns 1 to forward, 0 to drop. */
+static int
+process_hbh_option(struct uip_ext_hdr_opt_rpl *rpl_opt)
+{
+  int down;
+  int rank_error_signaled;
+  int loop_detected;
+  uint16_t sender_rank;
+  uint8_t sender_closer;
+  rpl_nbr_t *sender;
+
   if(!curr_instance.used || curr_instance.instance_id != rpl_opt->instance) {
     LOG_ERR("unknown instance: %u\n", rpl_opt->instance);
     return 0; /* Drop */
@@ -513,8 +571,75 @@ insert_hbh_header(void)
   return update_hbh_header();
 }
 /*---------------------------------------------------------------------------*/
-int
-rpl_ext_header_update(void)
+rpl_instance_t *
+rpl_ext_header_get_instance(void)
+{
+  struct uip_ext_hdr_opt_rpl *rpl_opt = (struct uip_ext_hdr_opt_rpl *)(UIP_IP_PAYLOAD(2));
+
+  if(UIP_IP_BUF->proto == UIP_PROTO_HBHO && rpl_opt->opt_type == UIP_EXT_HDR_OPT_RPL) {
+    return rpl_instance_get(rpl_opt->instance);
+  }
+  return NULL;
+}
+#if RPL_MAX_INSTANCES > 1
+/*---------------------------------------------------------------------------*/
+/* Selects the instance of a packet we originate or forward. Forwarded
+ * packets stay in the instance of their RPI. Otherwise, we use the instance
+ * whose DAG covers the destination, then spread flows with a non-zero IPv6
+ * flow label over all joined instances, and finally use the primary
+ * instance. */
+static rpl_instance_t *
+select_instance(void)
+{
+  rpl_instance_t *instance;
+  uint32_t flow_label;
+  int count;
+  int i;
+
+  if(UIP_IP_BUF->proto == UIP_PROTO_HBHO
+     && ((struct uip_ext_hdr_opt_rpl *)UIP_IP_PAYLOAD(2))->opt_type == UIP_EXT_HDR_OPT_RPL) {
+    /* NULL if the instance is unknown. The packet will be dropped. */
+    return rpl_ext_header_get_instance();
+  }
+
+#ifdef RPL_CALLBACK_SELECT_INSTANCE
+  instance = RPL_CALLBACK_SELECT_INSTANCE();
+  if(instance != NULL) {
+    return instance;
+  }
+#endif /* RPL_CALLBACK_SELECT_INSTANCE */
+
+  instance = rpl_instance_get_from_addr(&UIP_IP_BUF->destipaddr);
+  if(instance != NULL) {
+    return instance;
+  }
+
+  flow_label = ((uint32_t)(UIP_IP_BUF->tcflow & 0x0f) << 16) | UIP_HTONS(UIP_IP_BUF->flow);
+  if(flow_label != 0) {
+    count = 0;
+    for(i = 0; i < RPL_MAX_INSTANCES; i++) {
+      if(rpl_instances[i].used && rpl_instances[i].dag.state >= DAG_JOINED
+         && rpl_instances[i].dag.state != DAG_POISONING) {
+        count++;
+      }
+    }
+    if(count > 0) {
+      count = flow_label % count;
+      for(i = 0; i < RPL_MAX_INSTANCES; i++) {
+        if(rpl_instances[i].used && rpl_instances[i].dag.state >= DAG_JOINED
+           && rpl_instances[i].dag.state != DAG_POISONING && count-- == 0) {
+          return &rpl_instances[i];
+        }
+      }
+    }
+  }
+
+  return rpl_instance_get_primary();
+}
+#endif /* RPL_MAX_INSTANCES > 1 */
+/*---------------------------------------------------------------------------*/
+static int
+update_ext_header(void)
 {
   if(!curr_instance.used
       || uip_is_addr_linklocal(&UIP_IP_BUF->destipaddr)
@@ -541,6 +666,19 @@ rpl_ext_header_update(void)
   }
 }
 /*---------------------------------------------------------------------------*/
+int
+rpl_ext_header_update(void)
+{
+#if RPL_MAX_INSTANCES > 1
+  rpl_instance_t *prev = rpl_instance_set_current(select_instance());
+  int ret = update_ext_header();
+  rpl_instance_set_current(prev);
+  return ret;
+#else /* RPL_MAX_INSTANCES > 1 */
+  return update_ext_header();
+#endif /* RPL_MAX_INSTANCES > 1 */
+}
+/*---------------------------------------------------------------------------*/
 bool
 rpl_ext_header_remove(void)
 {
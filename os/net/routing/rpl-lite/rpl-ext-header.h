@@ -73,11 +73,22 @@ int rpl_ext_header_hbh_update(uint8_t *ext_buf, int opt_offset);
 
 /**
  * Adds/updates all RPL extension headers to current uIP packet.
+ * With several instances, this also selects the instance the packet
+ * is sent in.
  *
  * \return 1 in case of success, 0 otherwise
 */
 int rpl_ext_header_update(void);
 
+/**
+ * Returns the instance referred to by the RPL option of the current
+ * uIP packet.
+ *
+ * \return The instance, NULL if there is no RPL option or the
+ * instance is unknown
+*/
+rpl_instance_t *rpl_ext_header_get_instance(void);
+
 /**
  * Removes all RPL extension headers.
  *
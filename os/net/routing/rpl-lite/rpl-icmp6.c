@@ -124,6 +124,9 @@ rpl_icmp6_update_nbr_table(uip_ipaddr_t *from, nbr_table_reason_t reason, void *
       LOG_ERR_LLADDR(packetbuf_addr(PACKETBUF_ADDR_SENDER));
       LOG_ERR_("\n");
     }
+  } else if(reason == NBR_TABLE_REASON_RPL_DIO) {
+    /* A DIO from a known neighbor spares a NUD probe to it */
+    uip_ds6_nbr_confirm_reachable(packetbuf_addr(PACKETBUF_ADDR_SENDER));
   }
 
   return nbr;
@@ -132,19 +135,29 @@ rpl_icmp6_update_nbr_table(uip_ipaddr_t *from, nbr_table_reason_t reason, void *
 static void
 dis_input(void)
 {
-  if(!curr_instance.used) {
-    LOG_WARN("dis_input: not in an instance yet, discard\n");
-    goto discard;
-  }
+  int processed = 0;
+  int i;
 
-  LOG_INFO("received a DIS from ");
-  LOG_INFO_6ADDR(&UIP_IP_BUF->srcipaddr);
-  LOG_INFO_("\n");
+  /* A DIS solicits all instances */
+  for(i = 0; i < RPL_MAX_INSTANCES; i++) {
+    if(rpl_instances[i].used) {
+      rpl_instance_t *prev = rpl_instance_set_current(&rpl_instances[i]);
 
-  rpl_process_dis(&UIP_IP_BUF->srcipaddr, uip_is_addr_mcast(&UIP_IP_BUF->destipaddr));
+      LOG_INFO("received a DIS from ");
+      LOG_INFO_6ADDR(&UIP_IP_BUF->srcipaddr);
+      LOG_INFO_(", instance %u\n", curr_instance.instance_id);
 
-  discard:
-    uipbuf_clear();
+      rpl_process_dis(&UIP_IP_BUF->srcipaddr, uip_is_addr_mcast(&UIP_IP_BUF->destipaddr));
+      rpl_instance_set_current(prev);
+      processed = 1;
+    }
+  }
+
+  if(!processed) {
+    LOG_WARN("dis_input: not in an instance yet, discard\n");
+  }
+
+  uipbuf_clear();
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -169,10 +182,31 @@ rpl_icmp6_dis_output(uip_ipaddr_t *addr)
   uip_icmp6_send(addr, ICMP6_RPL, RPL_CODE_DIS, 2);
 }
 /*---------------------------------------------------------------------------*/
+/* Returns the instance a DIO applies to: the instance with the same ID if
+ * any, otherwise an unused instance to join, unless we are root */
+static rpl_instance_t *
+get_dio_instance(uint8_t instance_id)
+{
+  rpl_instance_t *instance = rpl_instance_get(instance_id);
+  int i;
+
+  if(instance == NULL && !rpl_instance_any_root()) {
+    for(i = 0; i < RPL_MAX_INSTANCES; i++) {
+      if(!rpl_instances[i].used
+         && rpl_neighbor_instance_has_table(&rpl_instances[i])) {
+        return &rpl_instances[i];
+      }
+    }
+  }
+  return instance;
+}
+/*---------------------------------------------------------------------------*/
 static void
 dio_input(void)
 {
   unsigned char *buffer;
+  rpl_instance_t *instance;
+  rpl_instance_t *prev;
   uint16_t buffer_length;
   rpl_dio_t dio;
   uint8_t subopt_type;
@@ -348,7 +382,15 @@ dio_input(void)
          (unsigned)dio.dtsn,
          (unsigned)dio.rank);
 
+  instance = get_dio_instance(dio.instance_id);
+  if(instance == NULL) {
+    LOG_WARN("dio_input: no room for instance %u, discard\n", dio.instance_id);
+    goto discard;
+  }
+
+  prev = rpl_instance_set_current(instance);
   rpl_process_dio(&from, &dio);
+  rpl_instance_set_current(prev);
 
 discard:
   uipbuf_clear();
@@ -481,10 +523,12 @@ dao_input(void)
   int len;
   int i;
   uip_ipaddr_t from;
+  rpl_instance_t *prev;
 
   memset(&dao, 0, sizeof(dao));
 
   dao.instance_id = UIP_ICMP_PAYLOAD[0];
+  prev = rpl_instance_set_current(rpl_instance_get(dao.instance_id));
   if(!curr_instance.used || curr_instance.instance_id != dao.instance_id) {
     LOG_ERR("dao_input: unknown RPL instance %u, discard\n", dao.instance_id);
     goto discard;
@@ -587,6 +631,7 @@ dao_input(void)
   rpl_process_dao(&from, &dao);
 
   discard:
+    rpl_instance_set_current(prev);
     uipbuf_clear();
 }
 /*---------------------------------------------------------------------------*/
@@ -677,6 +722,7 @@ dao_ack_input(void)
   uint8_t instance_id;
   uint8_t sequence;
   uint8_t status;
+  rpl_instance_t *prev;
 
   buffer = UIP_ICMP_PAYLOAD;
 
@@ -684,6 +730,8 @@ dao_ack_input(void)
   sequence = buffer[2];
   status = buffer[3];
 
+  prev = rpl_instance_set_current(rpl_instance_get(instance_id));
+
   if(!curr_instance.used || curr_instance.instance_id != instance_id) {
     LOG_ERR("dao_ack_input: unknown instance, discard\n");
     goto discard;
@@ -698,6 +746,7 @@ dao_ack_input(void)
   rpl_process_dao_ack(sequence, status);
 
   discard:
+    rpl_instance_set_current(prev);
     uipbuf_clear();
 }
 /*---------------------------------------------------------------------------*/
@@ -98,6 +98,26 @@
 #define RANK_THRESHOLD 384 /* Eq ETX of sqrt(3) */
 #endif /* !RPL_MRHOF_SQUARED_ETX */
 
+/*
+ * Optional penalty for unstable links, added to the path cost through a
+ * neighbor: RPL_MRHOF_CONF_VARIANCE_PENALTY percent of the ETX variance over
+ * the link-stats window. A stable link and an oscillating one with the same
+ * mean ETX no longer look alike, which reduces parent switches caused by the
+ * EWMA following the oscillation. Requires LINK_STATS_CONF_WINDOW_SIZE.
+ */
+#ifdef RPL_MRHOF_CONF_VARIANCE_PENALTY
+#define RPL_MRHOF_VARIANCE_PENALTY RPL_MRHOF_CONF_VARIANCE_PENALTY
+#else /* RPL_MRHOF_CONF_VARIANCE_PENALTY */
+#define RPL_MRHOF_VARIANCE_PENALTY 0
+#endif /* RPL_MRHOF_CONF_VARIANCE_PENALTY */
+
+#if RPL_MRHOF_VARIANCE_PENALTY && !LINK_STATS_WINDOW_SIZE
+#error "RPL_MRHOF_CONF_VARIANCE_PENALTY requires LINK_STATS_CONF_WINDOW_SIZE"
+#endif
+
+/* Minimum number of samples in the window before the variance is used */
+#define VARIANCE_MIN_SAMPLES 4
+
 /* Additional, custom hysteresis based on time. If a neighbor was consistently
  * better than our preferred parent for at least TIME_THRESHOLD, switch to
  * this neighbor regardless of RANK_THRESHOLD. */
@@ -118,6 +138,20 @@ nbr_link_metric(rpl_nbr_t *nbr)
 }
 /*---------------------------------------------------------------------------*/
 static uint16_t
+link_variance_penalty(const struct link_stats *stats)
+{
+#if RPL_MRHOF_VARIANCE_PENALTY
+  struct link_stats_window window;
+
+  if(link_stats_get_window(stats, &window) >= VARIANCE_MIN_SAMPLES) {
+    return MIN((uint32_t)window.etx_variance * RPL_MRHOF_VARIANCE_PENALTY / 100,
+               0xffff);
+  }
+#endif /* RPL_MRHOF_VARIANCE_PENALTY */
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
 link_metric_to_rank(uint16_t etx)
 {
 #if RPL_MRHOF_SQUARED_ETX
@@ -155,7 +189,8 @@ nbr_path_cost(rpl_nbr_t *nbr)
 #endif /* RPL_WITH_MC */
 
   /* path cost upper bound: 0xffff */
-  return MIN((uint32_t)base + link_metric_to_rank(nbr_link_metric(nbr)), 0xffff);
+  return MIN((uint32_t)base + link_metric_to_rank(nbr_link_metric(nbr))
+             + link_variance_penalty(rpl_neighbor_get_link_stats(nbr)), 0xffff);
 }
 /*---------------------------------------------------------------------------*/
 static rpl_rank_t
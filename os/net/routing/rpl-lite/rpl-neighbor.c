@@ -62,7 +62,35 @@ static rpl_nbr_t * best_parent(int fresh_only);
 
 /*---------------------------------------------------------------------------*/
 /* Per-neighbor RPL information */
+#if RPL_MAX_INSTANCES > 1
+/* One neighbor table per instance. rpl_neighbors points to the table of the
+ * current instance. */
+static rpl_nbr_t nbr_mem[RPL_MAX_INSTANCES][NBR_TABLE_MAX_NEIGHBORS];
+static nbr_table_t nbr_tables[RPL_MAX_INSTANCES];
+nbr_table_t *rpl_neighbors = &nbr_tables[0];
+
+/* The neighbor tables that the rest of the stack registers: IPv6 neighbors
+ * and link-stats, and with TSCH its neighbors and EB statistics */
+#if MAC_CONF_WITH_TSCH
+#define RPL_NBR_TABLES_ELSEWHERE 4
+#else /* MAC_CONF_WITH_TSCH */
+#define RPL_NBR_TABLES_ELSEWHERE 2
+#endif /* MAC_CONF_WITH_TSCH */
+
+#if RPL_MAX_INSTANCES + RPL_NBR_TABLES_ELSEWHERE > NBR_TABLE_MAX_NUM_TABLES
+#error "RPL_CONF_MAX_INSTANCES is too large: each instance needs one of the NBR_TABLE_MAX_NUM_TABLES neighbor tables"
+#endif
+#else /* RPL_MAX_INSTANCES > 1 */
 NBR_TABLE_GLOBAL(rpl_nbr_t, rpl_neighbors);
+#endif /* RPL_MAX_INSTANCES > 1 */
+/* The number of instance neighbor tables that could be registered */
+static int num_nbr_tables;
+
+#if RPL_INCREMENTAL_PARENT_SELECTION
+/* For each instance, the neighbors in order of increasing path cost */
+static void *candidate_lists[RPL_MAX_INSTANCES];
+#define candidates ((list_t)&candidate_lists[rpl_curr_instance - rpl_instances])
+#endif /* RPL_INCREMENTAL_PARENT_SELECTION */
 
 /*---------------------------------------------------------------------------*/
 static int
@@ -204,9 +232,53 @@ remove_neighbor(rpl_nbr_t *nbr)
   if(nbr == curr_instance.dag.unicast_dio_target) {
     curr_instance.dag.unicast_dio_target = NULL;
   }
+#if RPL_INCREMENTAL_PARENT_SELECTION
+  list_remove(candidates, nbr);
+#endif /* RPL_INCREMENTAL_PARENT_SELECTION */
   nbr_table_remove(rpl_neighbors, nbr);
   rpl_timers_schedule_state_update(); /* Updating from here is unsafe; postpone */
 }
+#if RPL_MAX_INSTANCES > 1
+/*---------------------------------------------------------------------------*/
+void
+rpl_neighbor_set_instance(const rpl_instance_t *instance)
+{
+  rpl_neighbors = &nbr_tables[instance - rpl_instances];
+}
+/*---------------------------------------------------------------------------*/
+/* Called by nbr-table when a neighbor is removed from one of the tables,
+ * possibly while another instance is current */
+static void
+remove_neighbor_callback(rpl_nbr_t *nbr)
+{
+  int i = (nbr - &nbr_mem[0][0]) / NBR_TABLE_MAX_NEIGHBORS;
+  rpl_instance_t *prev = rpl_instance_set_current(&rpl_instances[i]);
+  remove_neighbor(nbr);
+  rpl_instance_set_current(prev);
+}
+/*---------------------------------------------------------------------------*/
+/* Tells whether another instance has the node with link-layer address
+ * lladdr as preferred parent, in which case the DS6 default route through
+ * it must be kept */
+static int
+is_preferred_parent_elsewhere(const linkaddr_t *lladdr)
+{
+  int i;
+  if(lladdr == NULL) {
+    return 0;
+  }
+  for(i = 0; i < RPL_MAX_INSTANCES; i++) {
+    if(&rpl_instances[i] != rpl_curr_instance
+       && rpl_instances[i].used
+       && rpl_instances[i].dag.preferred_parent != NULL
+       && linkaddr_cmp(lladdr, nbr_table_get_lladdr(&nbr_tables[i],
+                         rpl_instances[i].dag.preferred_parent))) {
+      return 1;
+    }
+  }
+  return 0;
+}
+#endif /* RPL_MAX_INSTANCES > 1 */
 /*---------------------------------------------------------------------------*/
 rpl_nbr_t *
 rpl_neighbor_get_from_lladdr(uip_lladdr_t *addr)
@@ -285,7 +357,10 @@ rpl_neighbor_set_preferred_parent(rpl_nbr_t *nbr)
     LOG_INFO_("\n");
 
 #ifdef RPL_CALLBACK_PARENT_SWITCH
-    RPL_CALLBACK_PARENT_SWITCH(curr_instance.dag.preferred_parent, nbr);
+    /* Only the primary instance drives the lower layers */
+    if(rpl_curr_instance == rpl_instance_get_primary()) {
+      RPL_CALLBACK_PARENT_SWITCH(curr_instance.dag.preferred_parent, nbr);
+    }
 #endif /* RPL_CALLBACK_PARENT_SWITCH */
 
     /* Always keep the preferred parent locked, so it remains in the
@@ -294,8 +369,16 @@ rpl_neighbor_set_preferred_parent(rpl_nbr_t *nbr)
     nbr_table_lock(rpl_neighbors, nbr);
 
     /* Update DS6 default route. Use an infinite lifetime */
+#if RPL_MAX_INSTANCES > 1
+    if(!is_preferred_parent_elsewhere(
+         rpl_neighbor_get_lladdr(curr_instance.dag.preferred_parent))) {
+      uip_ds6_defrt_rm(uip_ds6_defrt_lookup(
+        rpl_neighbor_get_ipaddr(curr_instance.dag.preferred_parent)));
+    }
+#else /* RPL_MAX_INSTANCES > 1 */
     uip_ds6_defrt_rm(uip_ds6_defrt_lookup(
       rpl_neighbor_get_ipaddr(curr_instance.dag.preferred_parent)));
+#endif /* RPL_MAX_INSTANCES > 1 */
     uip_ds6_defrt_add(rpl_neighbor_get_ipaddr(nbr), 0);
 
     curr_instance.dag.preferred_parent = nbr;
@@ -335,6 +418,67 @@ rpl_neighbor_get_from_ipaddr(uip_ipaddr_t *addr)
   return nbr_table_get_from_lladdr(rpl_neighbors, (linkaddr_t *)lladdr);
 }
 /*---------------------------------------------------------------------------*/
+void
+rpl_neighbor_update(rpl_nbr_t *nbr)
+{
+#if RPL_INCREMENTAL_PARENT_SELECTION
+  rpl_nbr_t *prev;
+  rpl_nbr_t *n;
+
+  if(nbr == NULL || curr_instance.used == 0) {
+    return;
+  }
+
+  list_remove(candidates, nbr);
+  nbr->path_cost = curr_instance.of->nbr_path_cost(nbr);
+
+  /* Insert after all neighbors with a lower or equal path cost */
+  prev = NULL;
+  for(n = list_head(candidates);
+      n != NULL && n->path_cost <= nbr->path_cost;
+      n = list_item_next(n)) {
+    prev = n;
+  }
+  list_insert(candidates, prev, nbr);
+#endif /* RPL_INCREMENTAL_PARENT_SELECTION */
+}
+/*---------------------------------------------------------------------------*/
+void
+rpl_neighbor_update_all(void)
+{
+#if RPL_INCREMENTAL_PARENT_SELECTION
+  rpl_nbr_t *nbr;
+
+  for(nbr = nbr_table_head(rpl_neighbors); nbr != NULL; nbr = nbr_table_next(rpl_neighbors, nbr)) {
+    rpl_neighbor_update(nbr);
+  }
+#endif /* RPL_INCREMENTAL_PARENT_SELECTION */
+}
+/*---------------------------------------------------------------------------*/
+static int
+is_candidate(rpl_nbr_t *nbr, int fresh_only)
+{
+  if(!acceptable_rank(rpl_neighbor_rank_via_nbr(nbr))
+    || !curr_instance.of->nbr_is_acceptable_parent(nbr)) {
+    /* Exclude neighbors with a rank that is not acceptable */
+    return 0;
+  }
+
+  if(fresh_only && !rpl_neighbor_is_fresh(nbr)) {
+    /* Filter out non-fresh nerighbors if fresh_only is set */
+    return 0;
+  }
+
+#if UIP_ND6_SEND_NS
+  /* Exclude links to a neighbor that is not reachable at a NUD level */
+  if(rpl_get_ds6_nbr(nbr) == NULL) {
+    return 0;
+  }
+#endif /* UIP_ND6_SEND_NS */
+
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
 static rpl_nbr_t *
 best_parent(int fresh_only)
 {
@@ -345,30 +489,34 @@ best_parent(int fresh_only)
     return NULL;
   }
 
-  /* Search for the best parent according to the OF */
-  for(nbr = nbr_table_head(rpl_neighbors); nbr != NULL; nbr = nbr_table_next(rpl_neighbors, nbr)) {
+#if RPL_INCREMENTAL_PARENT_SELECTION
+  /* Start with the preferred parent, which the OF may favor over better
+   * neighbors, then go through the neighbors by increasing path cost. A
+   * neighbor with a higher path cost than the best so far cannot be
+   * selected, and neither can any neighbor after it. */
+  nbr = curr_instance.dag.preferred_parent;
+  if(nbr != NULL && is_candidate(nbr, fresh_only)) {
+    best = nbr;
+  }
 
-    if(!acceptable_rank(rpl_neighbor_rank_via_nbr(nbr))
-      || !curr_instance.of->nbr_is_acceptable_parent(nbr)) {
-      /* Exclude neighbors with a rank that is not acceptable */
-      continue;
+  for(nbr = list_head(candidates); nbr != NULL; nbr = list_item_next(nbr)) {
+    if(best != NULL && nbr->path_cost > best->path_cost) {
+      break;
     }
-
-    if(fresh_only && !rpl_neighbor_is_fresh(nbr)) {
-      /* Filter out non-fresh nerighbors if fresh_only is set */
-      continue;
+    if(nbr != curr_instance.dag.preferred_parent
+       && is_candidate(nbr, fresh_only)) {
+      best = curr_instance.of->best_parent(best, nbr);
     }
-
-#if UIP_ND6_SEND_NS
-    /* Exclude links to a neighbor that is not reachable at a NUD level */
-    if(rpl_get_ds6_nbr(nbr) == NULL) {
-      continue;
+  }
+#else /* RPL_INCREMENTAL_PARENT_SELECTION */
+  /* Search for the best parent according to the OF */
+  for(nbr = nbr_table_head(rpl_neighbors); nbr != NULL; nbr = nbr_table_next(rpl_neighbors, nbr)) {
+    if(is_candidate(nbr, fresh_only)) {
+      /* Now we have an acceptable parent, check if it is the new best */
+      best = curr_instance.of->best_parent(best, nbr);
     }
-#endif /* UIP_ND6_SEND_NS */
-
-    /* Now we have an acceptable parent, check if it is the new best */
-    best = curr_instance.of->best_parent(best, nbr);
   }
+#endif /* RPL_INCREMENTAL_PARENT_SELECTION */
 
   return best;
 }
@@ -437,9 +585,32 @@ rpl_neighbor_select_best(void)
 #endif /* RPL_WITH_PROBING */
 }
 /*---------------------------------------------------------------------------*/
+int
+rpl_neighbor_instance_has_table(const rpl_instance_t *instance)
+{
+  return instance - rpl_instances < num_nbr_tables;
+}
+/*---------------------------------------------------------------------------*/
 void
 rpl_neighbor_init(void)
 {
-  nbr_table_register(rpl_neighbors, (nbr_table_callback *)remove_neighbor);
+#if RPL_MAX_INSTANCES > 1
+  for(num_nbr_tables = 0; num_nbr_tables < RPL_MAX_INSTANCES; num_nbr_tables++) {
+    nbr_tables[num_nbr_tables].item_size = sizeof(rpl_nbr_t);
+    nbr_tables[num_nbr_tables].data = (nbr_table_item_t *)nbr_mem[num_nbr_tables];
+    if(!nbr_table_register(&nbr_tables[num_nbr_tables],
+                           (nbr_table_callback *)remove_neighbor_callback)) {
+      /* Another module got the table: fewer instances can be joined */
+      LOG_ERR("no neighbor table for instances beyond %d\n", num_nbr_tables);
+      break;
+    }
+  }
+#else /* RPL_MAX_INSTANCES > 1 */
+  if(nbr_table_register(rpl_neighbors, (nbr_table_callback *)remove_neighbor)) {
+    num_nbr_tables = 1;
+  } else {
+    LOG_ERR("failed to register the neighbor table\n");
+  }
+#endif /* RPL_MAX_INSTANCES > 1 */
 }
 /** @} */
@@ -71,6 +71,25 @@ NBR_TABLE_DECLARE(rpl_neighbors);
 */
 void rpl_neighbor_init(void);
 
+#if RPL_MAX_INSTANCES > 1
+/**
+ * Points rpl_neighbors to the neighbor table of an instance. Called by
+ * rpl_instance_set_current().
+ *
+ * \param instance The instance
+*/
+void rpl_neighbor_set_instance(const rpl_instance_t *instance);
+#endif /* RPL_MAX_INSTANCES > 1 */
+
+/**
+ * Tells whether the neighbor table of an instance could be registered.
+ * Instances without one are never joined.
+ *
+ * \param instance The instance
+ * \return 1 if the instance has a neighbor table, 0 otherwise
+*/
+int rpl_neighbor_instance_has_table(const rpl_instance_t *instance);
+
 /**
  * Tells whether a neighbor is in the parent set.
  *
@@ -177,6 +196,21 @@ void rpl_neighbor_print_list(const char *str);
 */
 void rpl_neighbor_remove_all(void);
 
+/**
+ * Updates the position of a neighbor in the parent selection order. Must be
+ * called after changing the rank, metric container or link metric of the
+ * neighbor.
+ *
+ * \param nbr The neighbor
+*/
+void rpl_neighbor_update(rpl_nbr_t *nbr);
+
+/**
+ * Updates the parent selection order of all neighbors of the current
+ * instance
+*/
+void rpl_neighbor_update_all(void);
+
 /**
  * Returns the best candidate for preferred parent
  *
@@ -69,7 +69,7 @@ clock_time_t RPL_PROBING_DELAY_FUNC(void);
 #define PERIODIC_DELAY             ((PERIODIC_DELAY_SECONDS) * CLOCK_SECOND)
 
 static void handle_dis_timer(void *ptr);
-static void handle_dio_timer(void *ptr);
+static void handle_dio_timer(void *ptr, uint8_t suppress);
 static void handle_unicast_dio_timer(void *ptr);
 static void send_new_dao(void *ptr);
 #if RPL_WITH_DAO_ACK
@@ -98,13 +98,28 @@ rpl_timers_schedule_periodic_dis(void)
   }
 }
 /*---------------------------------------------------------------------------*/
+/* Tells whether we still look for a DAG, i.e. we are not root and none of
+ * our instances has a preferred parent */
+static int
+needs_dis(void)
+{
+  int i;
+  for(i = 0; i < RPL_MAX_INSTANCES; i++) {
+    rpl_instance_t *instance = &rpl_instances[i];
+    if(instance->used &&
+       (instance->dag.rank == ROOT_RANK ||
+        (instance->dag.preferred_parent != NULL &&
+         instance->dag.rank != RPL_INFINITE_RANK))) {
+      return 0;
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
 static void
 handle_dis_timer(void *ptr)
 {
-  if(!rpl_dag_root_is_root() &&
-     (!curr_instance.used ||
-       curr_instance.dag.preferred_parent == NULL ||
-       curr_instance.dag.rank == RPL_INFINITE_RANK)) {
+  if(needs_dis()) {
     /* Send DIS and schedule next */
     rpl_icmp6_dis_output(NULL);
     rpl_timers_schedule_periodic_dis();
@@ -113,70 +128,102 @@ handle_dis_timer(void *ptr)
 /*---------------------------------------------------------------------------*/
 /*------------------------------- DIO -------------------------------------- */
 /*---------------------------------------------------------------------------*/
+/* Called by the trickle library at the start of each DIO interval. Keeps
+ * dio_intcurrent in sync and notifies the lower layers of the new interval */
 static void
-new_dio_interval(void)
+dio_interval_started(void *ptr)
 {
-  uint32_t time;
-  clock_time_t ticks;
-
-  time = 1UL << curr_instance.dag.dio_intcurrent;
-
-  /* Convert from milliseconds to CLOCK_TICKS. */
-  ticks = (time * CLOCK_SECOND) / 1000;
-  curr_instance.dag.dio_next_delay = ticks;
+  rpl_instance_t *prev = rpl_instance_set_current(ptr);
+  struct trickle_timer *tt = &curr_instance.dag.dio_timer;
+  uint8_t doublings = 0;
 
-  /* random number between I/2 and I */
-  ticks = ticks / 2 + (ticks / 2 * (uint32_t)random_rand()) / RANDOM_RAND_MAX;
-
-  /*
-   * The intervals must be equally long among the nodes for Trickle to
-   * operate efficiently. Therefore we need to calculate the delay between
-   * the randomized time and the start time of the next interval.
-   */
-  curr_instance.dag.dio_next_delay -= ticks;
-  curr_instance.dag.dio_send = 1;
-  /* reset the redundancy counter */
-  curr_instance.dag.dio_counter = 0;
-
-  /* schedule the timer */
-  ctimer_set(&curr_instance.dag.dio_timer, ticks, &handle_dio_timer, NULL);
+  while(doublings < tt->i_max && (tt->i_min << doublings) < tt->i_cur) {
+    doublings++;
+  }
+  curr_instance.dag.dio_intcurrent = curr_instance.dio_intmin + doublings;
 
 #ifdef RPL_CALLBACK_NEW_DIO_INTERVAL
-  RPL_CALLBACK_NEW_DIO_INTERVAL((CLOCK_SECOND * 1UL << curr_instance.dag.dio_intcurrent) / 1000);
+  /* Only the primary instance drives the lower layers */
+  if(rpl_curr_instance == rpl_instance_get_primary()) {
+    RPL_CALLBACK_NEW_DIO_INTERVAL(tt->i_cur);
+  }
 #endif /* RPL_CALLBACK_NEW_DIO_INTERVAL */
+
+  rpl_instance_set_current(prev);
+}
+/*---------------------------------------------------------------------------*/
+static void
+dio_timer_stop(void)
+{
+  trickle_timer_stop(&curr_instance.dag.dio_timer);
+  curr_instance.dag.dio_intcurrent = 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Tells whether the DIO timer runs with other parameters than the instance,
+ * e.g. after they were changed by a new DODAG configuration */
+static int
+dio_timer_config_changed(clock_time_t imin)
+{
+  struct trickle_timer *tt = &curr_instance.dag.dio_timer;
+
+  return tt->i_min != imin
+    || tt->k != curr_instance.dio_redundancy
+    /* the library lowers an Imax that the clock cannot hold */
+    || (tt->i_max != curr_instance.dio_intdoubl
+        && !TRICKLE_TIMER_IPAIR_IS_BAD(imin, curr_instance.dio_intdoubl));
 }
 /*---------------------------------------------------------------------------*/
 void
 rpl_timers_dio_reset(const char *str)
 {
-  if(rpl_dag_ready_to_advertise() &&
-     (curr_instance.dag.dio_intcurrent == 0 ||
-      curr_instance.dag.dio_intcurrent > curr_instance.dio_intmin)) {
+  clock_time_t imin;
+
+  if(!rpl_dag_ready_to_advertise() || rpl_get_leaf_only()) {
+    return;
+  }
+
+  /* Convert Imin from milliseconds to clock ticks */
+  imin = ((1UL << curr_instance.dio_intmin) * CLOCK_SECOND) / 1000;
+  if(imin < 2) {
+    imin = 2;
+  }
+
+  if(!trickle_timer_is_running(&curr_instance.dag.dio_timer)
+     || dio_timer_config_changed(imin)) {
+    LOG_INFO("reset DIO timer (%s)\n", str);
+    /* Configuring also stops the timer if it was running */
+    if(!trickle_timer_config(&curr_instance.dag.dio_timer, imin,
+                             curr_instance.dio_intdoubl,
+                             curr_instance.dio_redundancy)) {
+      LOG_ERR("failed to configure the DIO timer\n");
+      return;
+    }
+    trickle_timer_set_interval_callback(&curr_instance.dag.dio_timer,
+                                        dio_interval_started);
+    trickle_timer_set_at_imin(&curr_instance.dag.dio_timer,
+                              handle_dio_timer, rpl_curr_instance);
+  } else if(curr_instance.dag.dio_timer.i_cur != curr_instance.dag.dio_timer.i_min) {
     /*
      * don't reset the DIO timer if the current interval is Imin; see
      * Section 4.2, RFC 6206.
      */
     LOG_INFO("reset DIO timer (%s)\n", str);
-    if(!rpl_get_leaf_only()) {
-        curr_instance.dag.dio_counter = 0;
-        curr_instance.dag.dio_intcurrent = curr_instance.dio_intmin;
-        new_dio_interval();
-    }
+    trickle_timer_reset_event(&curr_instance.dag.dio_timer);
   }
 }
 /*---------------------------------------------------------------------------*/
 static void
-handle_dio_timer(void *ptr)
+handle_dio_timer(void *ptr, uint8_t suppress)
 {
-  if(!rpl_dag_ready_to_advertise()) {
-    return; /* We will be scheduled again later */
-  }
+  rpl_instance_t *prev = rpl_instance_set_current(ptr);
 
-  if(curr_instance.dag.dio_send) {
+  if(!rpl_dag_ready_to_advertise()) {
+    /* We will be started again by rpl_timers_dio_reset() */
+    dio_timer_stop();
+  } else {
     /* send DIO if counter is less than desired redundancy, or if dio_redundancy
-    is set to 0, or if we are the root */
-    if(rpl_dag_root_is_root() || curr_instance.dio_redundancy == 0 ||
-        curr_instance.dag.dio_counter < curr_instance.dio_redundancy) {
+    is set to 0 (checked by the trickle library), or if we are the root */
+    if(rpl_dag_root_is_root() || suppress == TRICKLE_TIMER_TX_OK) {
 #if RPL_TRICKLE_REFRESH_DAO_ROUTES
       if(rpl_dag_root_is_root()) {
         static int count = 0;
@@ -190,15 +237,9 @@ handle_dio_timer(void *ptr)
       curr_instance.dag.last_advertised_rank = curr_instance.dag.rank;
       rpl_icmp6_dio_output(NULL);
     }
-    curr_instance.dag.dio_send = 0;
-    ctimer_set(&curr_instance.dag.dio_timer, curr_instance.dag.dio_next_delay, handle_dio_timer, NULL);
-  } else {
-    /* check if we need to double interval */
-    if(curr_instance.dag.dio_intcurrent < curr_instance.dio_intmin + curr_instance.dio_intdoubl) {
-      curr_instance.dag.dio_intcurrent++;
-    }
-    new_dio_interval();
   }
+
+  rpl_instance_set_current(prev);
 }
 /*---------------------------------------------------------------------------*/
 /*------------------------------- Unicast DIO ------------------------------ */
@@ -210,17 +251,19 @@ rpl_timers_schedule_unicast_dio(rpl_nbr_t *target)
   if(curr_instance.used) {
     curr_instance.dag.unicast_dio_target = target;
     ctimer_set(&curr_instance.dag.unicast_dio_timer, 0,
-                  handle_unicast_dio_timer, NULL);
+                  handle_unicast_dio_timer, rpl_curr_instance);
   }
 }
 /*---------------------------------------------------------------------------*/
 static void
 handle_unicast_dio_timer(void *ptr)
 {
+  rpl_instance_t *prev = rpl_instance_set_current(ptr);
   uip_ipaddr_t *target_ipaddr = rpl_neighbor_get_ipaddr(curr_instance.dag.unicast_dio_target);
   if(target_ipaddr != NULL) {
     rpl_icmp6_dio_output(target_ipaddr);
   }
+  rpl_instance_set_current(prev);
 }
 /*---------------------------------------------------------------------------*/
 /*------------------------------- DAO -------------------------------------- */
@@ -231,7 +274,7 @@ static void
 schedule_dao_retransmission(void)
 {
   clock_time_t expiration_time = RPL_DAO_RETRANSMISSION_TIMEOUT / 2 + (random_rand() % (RPL_DAO_RETRANSMISSION_TIMEOUT));
-  ctimer_set(&curr_instance.dag.dao_timer, expiration_time, resend_dao, NULL);
+  ctimer_set(&curr_instance.dag.dao_timer, expiration_time, resend_dao, rpl_curr_instance);
 }
 #endif /* RPL_WITH_DAO_ACK */
 /*---------------------------------------------------------------------------*/
@@ -255,7 +298,7 @@ schedule_dao_refresh(void)
     }
 
     /* Schedule transmission */
-    ctimer_set(&curr_instance.dag.dao_timer, target_refresh, send_new_dao, NULL);
+    ctimer_set(&curr_instance.dag.dao_timer, target_refresh, send_new_dao, rpl_curr_instance);
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -267,13 +310,15 @@ rpl_timers_schedule_dao(void)
     * only serves storing mode. Use simple delay instead, with the only purpose
     * to reduce congestion. */
     clock_time_t expiration_time = RPL_DAO_DELAY / 2 + (random_rand() % (RPL_DAO_DELAY));
-    ctimer_set(&curr_instance.dag.dao_timer, expiration_time, send_new_dao, NULL);
+    ctimer_set(&curr_instance.dag.dao_timer, expiration_time, send_new_dao, rpl_curr_instance);
   }
 }
 /*---------------------------------------------------------------------------*/
 static void
 send_new_dao(void *ptr)
 {
+  rpl_instance_t *prev = rpl_instance_set_current(ptr);
+
 #if RPL_WITH_DAO_ACK
   /* We are sending a new DAO here. Prepare retransmissions */
   curr_instance.dag.dao_transmissions = 1;
@@ -293,6 +338,8 @@ send_new_dao(void *ptr)
   RPL_LOLLIPOP_INCREMENT(curr_instance.dag.dao_last_seqno);
   /* Send a DAO with own prefix as target and default lifetime */
   rpl_icmp6_dao_output(curr_instance.default_lifetime);
+
+  rpl_instance_set_current(prev);
 }
 #if RPL_WITH_DAO_ACK
 /*---------------------------------------------------------------------------*/
@@ -305,15 +352,17 @@ rpl_timers_schedule_dao_ack(uip_ipaddr_t *target, uint16_t sequence)
   if(curr_instance.used) {
     uip_ipaddr_copy(&curr_instance.dag.dao_ack_target, target);
     curr_instance.dag.dao_ack_sequence = sequence;
-    ctimer_set(&curr_instance.dag.dao_ack_timer, 0, handle_dao_ack_timer, NULL);
+    ctimer_set(&curr_instance.dag.dao_ack_timer, 0, handle_dao_ack_timer, rpl_curr_instance);
   }
 }
 /*---------------------------------------------------------------------------*/
 static void
 handle_dao_ack_timer(void *ptr)
 {
+  rpl_instance_t *prev = rpl_instance_set_current(ptr);
   rpl_icmp6_dao_ack_output(&curr_instance.dag.dao_ack_target,
     curr_instance.dag.dao_ack_sequence, RPL_DAO_ACK_UNCONDITIONAL_ACCEPT);
+  rpl_instance_set_current(prev);
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -327,6 +376,8 @@ rpl_timers_notify_dao_ack(void)
 static void
 resend_dao(void *ptr)
 {
+  rpl_instance_t *prev = rpl_instance_set_current(ptr);
+
   /* Increment transmission counter before sending */
   curr_instance.dag.dao_transmissions++;
   /* Send a DAO with own prefix as target and default lifetime */
@@ -338,8 +389,9 @@ resend_dao(void *ptr)
   } else {
     /* No more retransmissions. Perform local repair. */
     rpl_local_repair("DAO max rtx");
-    return;
   }
+
+  rpl_instance_set_current(prev);
 }
 #endif /* RPL_WITH_DAO_ACK */
 /*---------------------------------------------------------------------------*/
@@ -425,6 +477,7 @@ get_probing_target(void)
 static void
 handle_probing_timer(void *ptr)
 {
+  rpl_instance_t *prev = rpl_instance_set_current(ptr);
   rpl_nbr_t *probing_target = RPL_PROBING_SELECT_FUNC();
   uip_ipaddr_t *target_ipaddr = rpl_neighbor_get_ipaddr(probing_target);
 
@@ -448,6 +501,8 @@ handle_probing_timer(void *ptr)
 
   /* Schedule next probing */
   rpl_schedule_probing();
+
+  rpl_instance_set_current(prev);
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -455,7 +510,7 @@ rpl_schedule_probing(void)
 {
   if(curr_instance.used) {
     ctimer_set(&curr_instance.dag.probing_timer, RPL_PROBING_DELAY_FUNC(),
-                  handle_probing_timer, NULL);
+                  handle_probing_timer, rpl_curr_instance);
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -464,7 +519,7 @@ rpl_schedule_probing_now(void)
 {
   if(curr_instance.used) {
     ctimer_set(&curr_instance.dag.probing_timer,
-      random_rand() % (CLOCK_SECOND * 4), handle_probing_timer, NULL);
+      random_rand() % (CLOCK_SECOND * 4), handle_probing_timer, rpl_curr_instance);
   }
 }
 #endif /* RPL_WITH_PROBING */
@@ -474,9 +529,11 @@ rpl_schedule_probing_now(void)
 static void
 handle_leaving_timer(void *ptr)
 {
+  rpl_instance_t *prev = rpl_instance_set_current(ptr);
   if(curr_instance.used) {
     rpl_dag_leave();
   }
+  rpl_instance_set_current(prev);
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -494,7 +551,7 @@ rpl_timers_schedule_leaving(void)
 {
   if(curr_instance.used) {
     if(ctimer_expired(&curr_instance.dag.leave)) {
-      ctimer_set(&curr_instance.dag.leave, RPL_DELAY_BEFORE_LEAVING, handle_leaving_timer, NULL);
+      ctimer_set(&curr_instance.dag.leave, RPL_DELAY_BEFORE_LEAVING, handle_leaving_timer, rpl_curr_instance);
     }
   }
 }
@@ -511,24 +568,39 @@ rpl_timers_init(void)
 static void
 handle_periodic_timer(void *ptr)
 {
-  if(curr_instance.used) {
-    rpl_dag_periodic(PERIODIC_DELAY_SECONDS);
+  rpl_instance_t *prev;
+  int any_used = 0;
+  int i;
+
+  for(i = 0; i < RPL_MAX_INSTANCES; i++) {
+    if(rpl_instances[i].used) {
+      prev = rpl_instance_set_current(&rpl_instances[i]);
+      rpl_dag_periodic(PERIODIC_DELAY_SECONDS);
+      rpl_instance_set_current(prev);
+      any_used = 1;
+    }
+  }
+  if(any_used) {
     uip_sr_periodic(PERIODIC_DELAY_SECONDS);
   }
 
-  if(!curr_instance.used ||
-      curr_instance.dag.preferred_parent == NULL ||
-      curr_instance.dag.rank == RPL_INFINITE_RANK) {
+  if(needs_dis()) {
     rpl_timers_schedule_periodic_dis(); /* Schedule DIS if needed */
   }
 
-  /* Useful because part of the state update is time-dependent, e.g.,
-  the meaning of last_advertised_rank changes with time */
-  rpl_dag_update_state();
+  for(i = 0; i < RPL_MAX_INSTANCES; i++) {
+    prev = rpl_instance_set_current(&rpl_instances[i]);
+
+    /* Useful because part of the state update is time-dependent, e.g.,
+    the meaning of last_advertised_rank changes with time */
+    rpl_dag_update_state();
+
+    if(LOG_INFO_ENABLED) {
+      rpl_neighbor_print_list("Periodic");
+      rpl_dag_root_print_links("Periodic");
+    }
 
-  if(LOG_INFO_ENABLED) {
-    rpl_neighbor_print_list("Periodic");
-    rpl_dag_root_print_links("Periodic");
+    rpl_instance_set_current(prev);
   }
 
   ctimer_reset(&periodic_timer);
@@ -540,7 +612,7 @@ rpl_timers_stop_dag_timers(void)
   /* Stop all timers related to the DAG */
   ctimer_stop(&curr_instance.dag.state_update);
   ctimer_stop(&curr_instance.dag.leave);
-  ctimer_stop(&curr_instance.dag.dio_timer);
+  dio_timer_stop();
   ctimer_stop(&curr_instance.dag.unicast_dio_timer);
   ctimer_stop(&curr_instance.dag.dao_timer);
 #if RPL_WITH_PROBING
@@ -555,14 +627,16 @@ void
 rpl_timers_schedule_state_update(void)
 {
   if(curr_instance.used) {
-    ctimer_set(&curr_instance.dag.state_update, 0, handle_state_update, NULL);
+    ctimer_set(&curr_instance.dag.state_update, 0, handle_state_update, rpl_curr_instance);
   }
 }
 /*---------------------------------------------------------------------------*/
 static void
 handle_state_update(void *ptr)
 {
+  rpl_instance_t *prev = rpl_instance_set_current(ptr);
   rpl_dag_update_state();
+  rpl_instance_set_current(prev);
 }
 
 /** @}*/
@@ -134,6 +134,9 @@ typedef struct rpl_prefix rpl_prefix_t;
 
 /** \brief All information related to a RPL neighbor */
 struct rpl_nbr {
+#if RPL_INCREMENTAL_PARENT_SELECTION
+  struct rpl_nbr *next; /* The next neighbor in order of path cost */
+#endif /* RPL_INCREMENTAL_PARENT_SELECTION */
   clock_time_t better_parent_since;  /* The neighbor has been a possible
   replacement for our preferred parent consistently since 'parent_since'.
   Currently used by MRHOF only. */
@@ -141,6 +144,9 @@ struct rpl_nbr {
   rpl_metric_container_t mc;
 #endif /* RPL_WITH_MC */
   rpl_rank_t rank;
+#if RPL_INCREMENTAL_PARENT_SELECTION
+  uint16_t path_cost; /* The path cost as of the last neighbor update */
+#endif /* RPL_INCREMENTAL_PARENT_SELECTION */
   uint8_t dtsn;
 };
 typedef struct rpl_nbr rpl_nbr_t;
@@ -193,9 +199,7 @@ struct rpl_dag {
   uint8_t version;
   uint8_t grounded;
   uint8_t preference;
-  uint8_t dio_intcurrent; /* Current DIO interval */
-  uint8_t dio_send; /* internal trickle timer state: do we need to send a DIO at the next wakeup? */
-  uint8_t dio_counter; /* internal trickle timer state: redundancy counter */
+  uint8_t dio_intcurrent; /* Current DIO interval, 0 when the DIO timer is not running */
   uint8_t dao_last_seqno; /* the node's last sent DAO seqno */
   uint8_t dao_last_acked_seqno; /* the last seqno we got an ACK for */
   uint8_t dao_transmissions; /* the number of transmissions for the current DAO */
@@ -203,10 +207,9 @@ struct rpl_dag {
   enum rpl_dag_state state;
 
   /* Timers */
-  clock_time_t dio_next_delay; /* delay for completion of dio interval */
   struct ctimer state_update;
   struct ctimer leave;
-  struct ctimer dio_timer;
+  struct trickle_timer dio_timer;
   struct ctimer unicast_dio_timer;
   struct ctimer dao_timer;
   rpl_nbr_t *unicast_dio_target;
@@ -93,8 +93,8 @@ rpl_get_global_address(void)
   return ipaddr;
 }
 /*---------------------------------------------------------------------------*/
-void
-rpl_link_callback(const linkaddr_t *addr, int status, int numtx)
+static void
+link_callback(const linkaddr_t *addr, int status, int numtx)
 {
   if(curr_instance.used == 1 ) {
     rpl_nbr_t *nbr = rpl_neighbor_get_from_lladdr((uip_lladdr_t *)addr);
@@ -107,26 +107,54 @@ rpl_link_callback(const linkaddr_t *addr, int status, int numtx)
       }
 #endif
       /* Link stats were updated, and we need to update our internal state.
-      Updating from here is unsafe; postpone */
+      Re-sorting the neighbor among the parent candidates is safe here: it
+      only refreshes its cached path cost and its position in the list,
+      and the MAC calls us from process context, not while the list is
+      being walked. Changing parents, routes or timers from here is unsafe;
+      postpone the rest of the state update */
       LOG_INFO("packet sent to ");
       LOG_INFO_LLADDR(addr);
       LOG_INFO_(", status %u, tx %u, new link metric %u\n",
                 status, numtx, rpl_neighbor_get_link_metric(nbr));
+      rpl_neighbor_update(nbr);
       rpl_timers_schedule_state_update();
     }
   }
 }
 /*---------------------------------------------------------------------------*/
+void
+rpl_link_callback(const linkaddr_t *addr, int status, int numtx)
+{
+  int i;
+  for(i = 0; i < RPL_MAX_INSTANCES; i++) {
+    rpl_instance_t *prev = rpl_instance_set_current(&rpl_instances[i]);
+    link_callback(addr, status, numtx);
+    rpl_instance_set_current(prev);
+  }
+}
+/*---------------------------------------------------------------------------*/
 int
 rpl_has_joined(void)
 {
-  return curr_instance.used && curr_instance.dag.state >= DAG_JOINED;
+  int i;
+  for(i = 0; i < RPL_MAX_INSTANCES; i++) {
+    if(rpl_instances[i].used && rpl_instances[i].dag.state >= DAG_JOINED) {
+      return 1;
+    }
+  }
+  return 0;
 }
 /*---------------------------------------------------------------------------*/
 int
 rpl_is_reachable(void)
 {
-  return curr_instance.used && curr_instance.dag.state == DAG_REACHABLE;
+  int i;
+  for(i = 0; i < RPL_MAX_INSTANCES; i++) {
+    if(rpl_instances[i].used && rpl_instances[i].dag.state == DAG_REACHABLE) {
+      return 1;
+    }
+  }
+  return 0;
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -208,11 +236,24 @@ init(void)
   uip_sr_init();
 }
 /*---------------------------------------------------------------------------*/
+static rpl_instance_t *
+get_root_instance(void)
+{
+  int i;
+  for(i = 0; i < RPL_MAX_INSTANCES; i++) {
+    if(rpl_instances[i].used && rpl_instances[i].dag.rank == ROOT_RANK) {
+      return &rpl_instances[i];
+    }
+  }
+  return rpl_curr_instance;
+}
+/*---------------------------------------------------------------------------*/
 static int
 get_sr_node_ipaddr(uip_ipaddr_t *addr, const uip_sr_node_t *node)
 {
   if(addr != NULL && node != NULL) {
-    memcpy(addr, &curr_instance.dag.dag_id, 8);
+    /* Source routes are only kept at the root */
+    memcpy(addr, &get_root_instance()->dag.dag_id, 8);
     memcpy(((unsigned char *)addr) + 8, &node->link_identifier, 8);
     return 1;
   } else {
@@ -220,6 +261,67 @@ get_sr_node_ipaddr(uip_ipaddr_t *addr, const uip_sr_node_t *node)
   }
 }
 /*---------------------------------------------------------------------------*/
+static int
+get_root_ipaddr(uip_ipaddr_t *ipaddr)
+{
+  rpl_instance_t *prev = rpl_instance_set_current(rpl_instance_get_primary());
+  int ret = rpl_dag_get_root_ipaddr(ipaddr);
+  rpl_instance_set_current(prev);
+  return ret;
+}
+/*---------------------------------------------------------------------------*/
+static void
+leave_network(void)
+{
+  int i;
+  for(i = 0; i < RPL_MAX_INSTANCES; i++) {
+    if(rpl_instances[i].used) {
+      rpl_instance_t *prev = rpl_instance_set_current(&rpl_instances[i]);
+      rpl_dag_poison_and_leave();
+      rpl_instance_set_current(prev);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+global_repair(const char *str)
+{
+  int i;
+  for(i = 0; i < RPL_MAX_INSTANCES; i++) {
+    rpl_instance_t *prev = rpl_instance_set_current(&rpl_instances[i]);
+    rpl_global_repair(str);
+    rpl_instance_set_current(prev);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+local_repair(const char *str)
+{
+  int i;
+  for(i = 0; i < RPL_MAX_INSTANCES; i++) {
+    rpl_instance_t *prev = rpl_instance_set_current(&rpl_instances[i]);
+    rpl_local_repair(str);
+    rpl_instance_set_current(prev);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static const uip_ipaddr_t *
+get_default_nexthop(void)
+{
+#if RPL_MAX_INSTANCES > 1
+  /* Send via the preferred parent of the packet's instance rather than
+   * any of the DS6 default routes, which are shared by all instances */
+  rpl_instance_t *instance = rpl_ext_header_get_instance();
+  if(instance != NULL && instance->dag.preferred_parent != NULL) {
+    rpl_instance_t *prev = rpl_instance_set_current(instance);
+    const uip_ipaddr_t *nexthop = rpl_neighbor_get_ipaddr(curr_instance.dag.preferred_parent);
+    rpl_instance_set_current(prev);
+    return nexthop;
+  }
+#endif /* RPL_MAX_INSTANCES > 1 */
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
 static void
 neighbor_state_changed(uip_ds6_nbr_t *nbr)
 {
@@ -249,14 +351,14 @@ const struct routing_driver rpl_lite_driver = {
   init,
   rpl_dag_root_set_prefix,
   rpl_dag_root_start,
-  rpl_dag_root_is_root,
-  rpl_dag_get_root_ipaddr,
+  rpl_instance_any_root,
+  get_root_ipaddr,
   get_sr_node_ipaddr,
-  rpl_dag_poison_and_leave,
+  leave_network,
   rpl_has_joined,
   rpl_is_reachable,
-  rpl_global_repair,
-  rpl_local_repair,
+  global_repair,
+  local_repair,
   rpl_ext_header_remove,
   rpl_ext_header_update,
   rpl_ext_header_hbh_update,
@@ -266,6 +368,7 @@ const struct routing_driver rpl_lite_driver = {
   neighbor_state_changed,
   drop_route,
   rpl_get_leaf_only,
+  get_default_nexthop,
 };
 /*---------------------------------------------------------------------------*/
 
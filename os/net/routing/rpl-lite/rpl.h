@@ -48,14 +48,24 @@
 /********** Includes **********/
 
 #include "net/ipv6/uip.h"
+#include "lib/trickle-timer.h"
 #include "net/routing/rpl-lite/rpl-const.h"
 #include "net/routing/rpl-lite/rpl-conf.h"
 #include "net/routing/rpl-lite/rpl-types.h"
 
 /********** Public symbols **********/
 
-/* The only instance */
-extern rpl_instance_t curr_instance;
+/* All instances. Most of RPL-lite operates on the current instance,
+ * curr_instance, which entry points (ICMPv6 input, timers, packet output)
+ * select through rpl_instance_set_current(). Outside of these, the current
+ * instance is the first one, rpl_instances[0]. */
+extern rpl_instance_t rpl_instances[RPL_MAX_INSTANCES];
+#if RPL_MAX_INSTANCES > 1
+extern rpl_instance_t *rpl_curr_instance;
+#else /* RPL_MAX_INSTANCES > 1 */
+#define rpl_curr_instance (&rpl_instances[0])
+#endif /* RPL_MAX_INSTANCES > 1 */
+#define curr_instance (*rpl_curr_instance)
 /* The RPL multicast address (used for DIS and DIO) */
 extern uip_ipaddr_t rpl_multicast_addr;
 
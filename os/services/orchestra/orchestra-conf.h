@@ -150,6 +150,38 @@
   (MAX(ORCHESTRA_UNICAST_MIN_CHANNEL_OFFSET, sizeof(TSCH_DEFAULT_HOPPING_SEQUENCE) - 1))
 #endif
 
+/* Maximum number of cells per direction that the traffic-aware unicast rule
+ * installs for a given child/parent pair */
+#ifdef ORCHESTRA_CONF_TRAFFIC_AWARE_MAX_CELLS
+#define ORCHESTRA_TRAFFIC_AWARE_MAX_CELLS          ORCHESTRA_CONF_TRAFFIC_AWARE_MAX_CELLS
+#else
+#define ORCHESTRA_TRAFFIC_AWARE_MAX_CELLS          4
+#endif
+
+/* Number of nodes in a child's sub-DODAG (including the child) served by each
+ * cell of the traffic-aware unicast rule. E.g. with the default value of 4,
+ * a child with 5 to 8 nodes in its sub-DODAG gets 2 cells per direction. */
+#ifdef ORCHESTRA_CONF_TRAFFIC_AWARE_NODES_PER_CELL
+#define ORCHESTRA_TRAFFIC_AWARE_NODES_PER_CELL     ORCHESTRA_CONF_TRAFFIC_AWARE_NODES_PER_CELL
+#else
+#define ORCHESTRA_TRAFFIC_AWARE_NODES_PER_CELL     4
+#endif
+
+/* Number of cells beyond k that the traffic-aware unicast rule listens on,
+ * to cover the parent and the child counting different sub-DODAG sizes */
+#ifdef ORCHESTRA_CONF_TRAFFIC_AWARE_RX_MARGIN
+#define ORCHESTRA_TRAFFIC_AWARE_RX_MARGIN          ORCHESTRA_CONF_TRAFFIC_AWARE_RX_MARGIN
+#else
+#define ORCHESTRA_TRAFFIC_AWARE_RX_MARGIN          1
+#endif
+
+/* How often the traffic-aware unicast rule re-evaluates the number of cells */
+#ifdef ORCHESTRA_CONF_TRAFFIC_AWARE_UPDATE_PERIOD
+#define ORCHESTRA_TRAFFIC_AWARE_UPDATE_PERIOD      ORCHESTRA_CONF_TRAFFIC_AWARE_UPDATE_PERIOD
+#else
+#define ORCHESTRA_TRAFFIC_AWARE_UPDATE_PERIOD      (30 * CLOCK_SECOND)
+#endif
+
 /* Channel offsets for the EB rule, default: 1 */
 #ifdef ORCHESTRA_CONF_EB_MIN_CHANNEL_OFFSET
 #define ORCHESTRA_EB_MIN_CHANNEL_OFFSET ORCHESTRA_CONF_EB_MIN_CHANNEL_OFFSET
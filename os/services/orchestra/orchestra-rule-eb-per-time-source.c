@@ -97,6 +97,7 @@ new_time_source(const struct tsch_neighbor *old, const struct tsch_neighbor *new
   uint16_t new_ts = 0xffff;
   uint16_t old_channel_offset = 0xffff;
   uint16_t new_channel_offset = 0xffff;
+  const linkaddr_t *new_addr = NULL;
 
   if(old != NULL) {
     const linkaddr_t *addr = tsch_queue_get_nbr_address(old);
@@ -105,12 +106,14 @@ new_time_source(const struct tsch_neighbor *old, const struct tsch_neighbor *new
   }
 
   if(new != NULL) {
-    const linkaddr_t *addr = tsch_queue_get_nbr_address(new);
-    new_ts = get_node_timeslot(addr);
-    new_channel_offset = get_node_channel_offset(addr);
+    new_addr = tsch_queue_get_nbr_address(new);
+    new_ts = get_node_timeslot(new_addr);
+    new_channel_offset = get_node_channel_offset(new_addr);
   }
 
-  if(new_ts == old_ts && old_channel_offset == new_channel_offset) {
+  if(new_ts == old_ts && old_channel_offset == new_channel_offset
+     && timesource_link != NULL && new_addr != NULL
+     && linkaddr_cmp(&timesource_link->addr, new_addr)) {
     return;
   }
 
@@ -120,9 +123,10 @@ new_time_source(const struct tsch_neighbor *old, const struct tsch_neighbor *new
     timesource_link = NULL;
   }
   if(new_ts != 0xffff) {
-    /* Listen to the time source's EBs */
+    /* Listen to the time source's EBs. The link carries the time source's
+     * address so that TSCH knows the sender, e.g. for adaptive guard times */
     timesource_link = tsch_schedule_add_link(sf_eb, LINK_OPTION_RX, LINK_TYPE_ADVERTISING_ONLY,
-        &tsch_broadcast_address, new_ts, new_channel_offset, 0);
+        new_addr, new_ts, new_channel_offset, 0);
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -0,0 +1,421 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden AB
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * \file
+ *         Orchestra: a slotframe dedicated to unicast data transmission. Designed for
+ *         RPL storing mode only, as this is based on the knowledge of the children (and parent).
+ *         This is a traffic-aware variant of the link-based rule: instead of a single
+ *         cell per direction, k cells are installed for each child/parent pair:
+ *             nodes listen at: (hash(nbr.MAC, local.MAC) + i * S) % ORCHESTRA_UNICAST_PERIOD
+ *             nodes transmit at: (hash(local.MAC, nbr.MAC) + i * S) % ORCHESTRA_UNICAST_PERIOD
+ *         for i in [0, k), where S = ORCHESTRA_UNICAST_PERIOD / ORCHESTRA_TRAFFIC_AWARE_MAX_CELLS.
+ *         k is derived from the size of the child's sub-DODAG, which both ends of the link
+ *         know without any signaling: the child counts its own routing entries, while the
+ *         parent counts the routes (learned from DAOs) that go through the child.
+ *         As convergecast traffic is proportional to sub-DODAG size, the capacity of the
+ *         links closer to the root grows with the traffic they have to forward.
+ *         The two counts may differ for a while, e.g. during DAO propagation or when routes
+ *         expire, so the receiver listens on ORCHESTRA_TRAFFIC_AWARE_RX_MARGIN more cells
+ *         than k. The transmitter uses a new, larger k only once it held for an update
+ *         period, while the receiver drops cells only an update period after k decreased.
+ */
+
+#include "contiki.h"
+#include "orchestra.h"
+#include "net/ipv6/uip-ds6-route.h"
+#include "net/packetbuf.h"
+#include "lib/memb.h"
+#include "lib/list.h"
+
+/*
+ * The body of this rule should be compiled only when "nbr_routes" is available,
+ * otherwise a link error causes build failure. "nbr_routes" is compiled if
+ * UIP_MAX_ROUTES != 0. See uip-ds6-route.c.
+ */
+#if UIP_MAX_ROUTES != 0
+
+#include "sys/log.h"
+#define LOG_MODULE "Orchestra"
+#define LOG_LEVEL  LOG_LEVEL_MAC
+
+/* Distance, in timeslots, between two consecutive cells of a given pair */
+#define CELL_SPACING MAX(1, ORCHESTRA_UNICAST_PERIOD / ORCHESTRA_TRAFFIC_AWARE_MAX_CELLS)
+
+/* The cells currently installed towards and from a given neighbor */
+struct traffic_aware_nbr {
+  struct traffic_aware_nbr *next;
+  linkaddr_t addr;
+  uint8_t num_tx_cells;
+  uint8_t num_rx_cells;
+  /* k at the previous update */
+  uint8_t last_target;
+};
+
+MEMB(traffic_aware_nbr_memb, struct traffic_aware_nbr, NBR_TABLE_MAX_NEIGHBORS);
+LIST(traffic_aware_nbr_list);
+
+static uint16_t slotframe_handle = 0;
+static uint16_t local_channel_offset;
+static struct tsch_slotframe *sf_unicast;
+static struct ctimer update_timer;
+
+/*---------------------------------------------------------------------------*/
+static uint16_t
+get_node_pair_timeslot(const linkaddr_t *from, const linkaddr_t *to, uint8_t cell)
+{
+  if(from != NULL && to != NULL && ORCHESTRA_UNICAST_PERIOD > 0) {
+    return (ORCHESTRA_LINKADDR_HASH2(from, to) + cell * CELL_SPACING) % ORCHESTRA_UNICAST_PERIOD;
+  } else {
+    return 0xffff;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+get_node_channel_offset(const linkaddr_t *addr)
+{
+  if(addr != NULL && ORCHESTRA_UNICAST_MAX_CHANNEL_OFFSET >= ORCHESTRA_UNICAST_MIN_CHANNEL_OFFSET) {
+    return ORCHESTRA_LINKADDR_HASH(addr) % (ORCHESTRA_UNICAST_MAX_CHANNEL_OFFSET - ORCHESTRA_UNICAST_MIN_CHANNEL_OFFSET + 1)
+        + ORCHESTRA_UNICAST_MIN_CHANNEL_OFFSET;
+  } else {
+    return 0xffff;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static struct traffic_aware_nbr *
+get_traffic_aware_nbr(const linkaddr_t *linkaddr)
+{
+  struct traffic_aware_nbr *n;
+  for(n = list_head(traffic_aware_nbr_list); n != NULL; n = list_item_next(n)) {
+    if(linkaddr_cmp(&n->addr, linkaddr)) {
+      return n;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+get_target_num_cells(const linkaddr_t *linkaddr)
+{
+  unsigned subtree_size;
+  unsigned num_cells;
+
+  if(linkaddr_cmp(&orchestra_parent_linkaddr, linkaddr)) {
+    /* Our parent reaches us and all our descendants through this link */
+    subtree_size = 1 + uip_ds6_route_num_routes();
+  } else {
+    /* A child: count the routes that go through it, including the one to the child itself */
+    struct uip_ds6_route_neighbor_routes *routes;
+    routes = nbr_table_get_from_lladdr(nbr_routes, linkaddr);
+    subtree_size = routes != NULL ? list_length(routes->route_list) : 0;
+  }
+
+  num_cells = 1 + (subtree_size > 0 ? subtree_size - 1 : 0) / ORCHESTRA_TRAFFIC_AWARE_NODES_PER_CELL;
+  return MIN(num_cells, ORCHESTRA_TRAFFIC_AWARE_MAX_CELLS);
+}
+/*---------------------------------------------------------------------------*/
+static int
+neighbor_has_uc_link(const linkaddr_t *linkaddr)
+{
+  if(linkaddr == NULL || linkaddr_cmp(linkaddr, &linkaddr_null)) {
+    return 0;
+  }
+
+  if(linkaddr_cmp(&orchestra_parent_linkaddr, linkaddr)) {
+    /* The node is our parent */
+    return orchestra_parent_knows_us ? 1 : 0;
+  }
+
+  if(nbr_table_get_from_lladdr(nbr_routes, (linkaddr_t *)linkaddr) != NULL) {
+    /* We have a route to this node;
+     * it should have selected us as its parent and installed a link */
+    return 1;
+  }
+
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_unicast_link(uint16_t timeslot, uint16_t options)
+{
+  struct tsch_link *l = list_head(sf_unicast->links_list);
+  while(l != NULL) {
+    if(l->timeslot == timeslot
+        && l->channel_offset == local_channel_offset
+        && l->link_options == options) {
+      tsch_schedule_remove_link(sf_unicast, l);
+      break;
+    }
+    l = list_item_next(l);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+get_cell_timeslot(const linkaddr_t *linkaddr, uint16_t options, uint8_t cell)
+{
+  if(options & LINK_OPTION_TX) {
+    return get_node_pair_timeslot(&linkaddr_node_addr, linkaddr, cell);
+  } else {
+    return get_node_pair_timeslot(linkaddr, &linkaddr_node_addr, cell);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Adds or removes cells in one direction so that there are num of them */
+static void
+set_cells(const linkaddr_t *linkaddr, uint16_t options, uint8_t *cur, uint8_t num)
+{
+  uint8_t i;
+
+  if(num == *cur) {
+    return;
+  }
+
+  LOG_INFO("traffic-aware: %u -> %u %s cells with ", *cur, num,
+           (options & LINK_OPTION_TX) ? "Tx" : "Rx");
+  LOG_INFO_LLADDR(linkaddr);
+  LOG_INFO_("\n");
+
+  for(i = *cur; i < num; i++) {
+    tsch_schedule_add_link(sf_unicast, options, LINK_TYPE_NORMAL, &tsch_broadcast_address,
+                           get_cell_timeslot(linkaddr, options, i), local_channel_offset, 0);
+  }
+  for(i = num; i < *cur; i++) {
+    remove_unicast_link(get_cell_timeslot(linkaddr, options, i), options);
+  }
+  *cur = num;
+}
+/*---------------------------------------------------------------------------*/
+static void
+update_uc_links(struct traffic_aware_nbr *n)
+{
+  uint8_t target = get_target_num_cells(&n->addr);
+  uint8_t num_tx_cells = n->num_tx_cells;
+  uint8_t num_rx_cells;
+  struct tsch_neighbor *tn;
+
+  if(target > num_tx_cells) {
+    /* Grow once k held for a whole period, giving the receiver's view
+     * time to catch up */
+    num_tx_cells = MAX(num_tx_cells, MIN(target, n->last_target));
+  } else if(target < num_tx_cells) {
+    /* Only shrink when the queue is empty, as queued packets
+     * may be bound to the timeslots of the cells being removed.
+     * Without a queue, nothing is queued. */
+    tn = tsch_queue_get_nbr(&n->addr);
+    if(tn == NULL || tsch_queue_is_empty(tn)) {
+      num_tx_cells = target;
+    }
+  }
+
+  /* Listen on a margin, and keep listening on the cells of the previous k
+   * until the transmitter had a whole period to stop using them */
+  num_rx_cells = MIN(MAX(target, n->last_target) + ORCHESTRA_TRAFFIC_AWARE_RX_MARGIN,
+                     ORCHESTRA_TRAFFIC_AWARE_MAX_CELLS);
+
+  set_cells(&n->addr, LINK_OPTION_TX | LINK_OPTION_SHARED, &n->num_tx_cells, num_tx_cells);
+  set_cells(&n->addr, LINK_OPTION_RX, &n->num_rx_cells, num_rx_cells);
+  n->last_target = target;
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_uc_links(const linkaddr_t *linkaddr)
+{
+  struct traffic_aware_nbr *n;
+
+  if(linkaddr == NULL || get_traffic_aware_nbr(linkaddr) != NULL) {
+    return;
+  }
+
+  n = memb_alloc(&traffic_aware_nbr_memb);
+  if(n == NULL) {
+    LOG_ERR("traffic-aware: could not allocate neighbor\n");
+    return;
+  }
+  linkaddr_copy(&n->addr, linkaddr);
+  n->num_tx_cells = 0;
+  n->num_rx_cells = 0;
+  /* Start with a single Tx cell, the one both ends always have */
+  n->last_target = 1;
+  list_add(traffic_aware_nbr_list, n);
+  update_uc_links(n);
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_uc_links(const linkaddr_t *linkaddr)
+{
+  struct traffic_aware_nbr *n;
+
+  if(linkaddr == NULL) {
+    return;
+  }
+
+  n = get_traffic_aware_nbr(linkaddr);
+  if(n != NULL) {
+    set_cells(linkaddr, LINK_OPTION_TX | LINK_OPTION_SHARED, &n->num_tx_cells, 0);
+    set_cells(linkaddr, LINK_OPTION_RX, &n->num_rx_cells, 0);
+    list_remove(traffic_aware_nbr_list, n);
+    memb_free(&traffic_aware_nbr_memb, n);
+  }
+
+  /* Packets to this address were marked with this slotframe and neighbor-specific timeslot;
+   * make sure they don't remain stuck in the queues after the link is removed. */
+  tsch_queue_free_packets_to(linkaddr);
+}
+/*---------------------------------------------------------------------------*/
+static void
+update_timer_callback(void *ptr)
+{
+  struct traffic_aware_nbr *n;
+  for(n = list_head(traffic_aware_nbr_list); n != NULL; n = list_item_next(n)) {
+    update_uc_links(n);
+  }
+  ctimer_reset(&update_timer);
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+select_cell_timeslot(const linkaddr_t *dest)
+{
+  const struct traffic_aware_nbr *n = get_traffic_aware_nbr(dest);
+  uint16_t distance[ORCHESTRA_TRAFFIC_AWARE_MAX_CELLS];
+  uint16_t current_timeslot;
+  int rank;
+  uint8_t i, j;
+
+  if(n == NULL || n->num_tx_cells <= 1) {
+    return get_node_pair_timeslot(&linkaddr_node_addr, dest, 0);
+  }
+
+  /* Spread the packets queued for this neighbor over its cells, in the
+   * order in which the cells occur from now on: the first queued packet
+   * goes to the next cell, the second one to the cell after, etc. */
+  current_timeslot = TSCH_ASN_MOD(tsch_current_asn, sf_unicast->size);
+  rank = tsch_queue_nbr_packet_count(tsch_queue_get_nbr(dest));
+  rank = (rank > 0 ? rank : 0) % n->num_tx_cells;
+
+  for(i = 0; i < n->num_tx_cells; i++) {
+    uint16_t timeslot = get_node_pair_timeslot(&linkaddr_node_addr, dest, i);
+    distance[i] = (timeslot + ORCHESTRA_UNICAST_PERIOD - current_timeslot) % ORCHESTRA_UNICAST_PERIOD;
+  }
+
+  /* Find the cell with the given rank in the order of occurrence */
+  for(i = 0; i < n->num_tx_cells; i++) {
+    int num_before = 0;
+    for(j = 0; j < n->num_tx_cells; j++) {
+      if(distance[j] < distance[i] || (distance[j] == distance[i] && j < i)) {
+        num_before++;
+      }
+    }
+    if(num_before == rank) {
+      return get_node_pair_timeslot(&linkaddr_node_addr, dest, i);
+    }
+  }
+
+  return get_node_pair_timeslot(&linkaddr_node_addr, dest, 0);
+}
+/*---------------------------------------------------------------------------*/
+static void
+child_added(const linkaddr_t *linkaddr)
+{
+  add_uc_links(linkaddr);
+}
+/*---------------------------------------------------------------------------*/
+static void
+child_removed(const linkaddr_t *linkaddr)
+{
+  remove_uc_links(linkaddr);
+}
+/*---------------------------------------------------------------------------*/
+static int
+select_packet(uint16_t *slotframe, uint16_t *timeslot, uint16_t *channel_offset)
+{
+  /* Select data packets we have a unicast link to */
+  const linkaddr_t *dest = packetbuf_addr(PACKETBUF_ADDR_RECEIVER);
+  if(packetbuf_attr(PACKETBUF_ATTR_FRAME_TYPE) == FRAME802154_DATAFRAME
+     && !orchestra_is_root_schedule_active(dest)
+     && neighbor_has_uc_link(dest)) {
+    if(slotframe != NULL) {
+      *slotframe = slotframe_handle;
+    }
+    if(timeslot != NULL) {
+      *timeslot = select_cell_timeslot(dest);
+    }
+    /* set per-packet channel offset */
+    if(channel_offset != NULL) {
+      *channel_offset = get_node_channel_offset(dest);
+    }
+    return 1;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+new_time_source(const struct tsch_neighbor *old, const struct tsch_neighbor *new)
+{
+  if(new != old) {
+    const linkaddr_t *old_addr = tsch_queue_get_nbr_address(old);
+    const linkaddr_t *new_addr = tsch_queue_get_nbr_address(new);
+    if(new_addr != NULL) {
+      linkaddr_copy(&orchestra_parent_linkaddr, new_addr);
+    } else {
+      linkaddr_copy(&orchestra_parent_linkaddr, &linkaddr_null);
+    }
+    remove_uc_links(old_addr);
+    add_uc_links(new_addr);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+init(uint16_t sf_handle)
+{
+  slotframe_handle = sf_handle;
+  local_channel_offset = get_node_channel_offset(&linkaddr_node_addr);
+  memb_init(&traffic_aware_nbr_memb);
+  list_init(traffic_aware_nbr_list);
+  /* Slotframe for unicast transmissions */
+  sf_unicast = tsch_schedule_add_slotframe(slotframe_handle, ORCHESTRA_UNICAST_PERIOD);
+  /* Periodically adapt the number of cells to the sub-DODAG sizes */
+  ctimer_set(&update_timer, ORCHESTRA_TRAFFIC_AWARE_UPDATE_PERIOD, update_timer_callback, NULL);
+}
+/*---------------------------------------------------------------------------*/
+struct orchestra_rule unicast_per_neighbor_traffic_aware = {
+  init,
+  new_time_source,
+  select_packet,
+  child_added,
+  child_removed,
+  NULL,
+  NULL,
+  "unicast per neighbor traffic aware",
+  ORCHESTRA_UNICAST_PERIOD,
+};
+
+#endif /* UIP_MAX_ROUTES */
@@ -58,6 +58,7 @@ extern struct orchestra_rule eb_per_time_source;
 extern struct orchestra_rule unicast_per_neighbor_rpl_storing;
 extern struct orchestra_rule unicast_per_neighbor_rpl_ns;
 extern struct orchestra_rule unicast_per_neighbor_link_based;
+extern struct orchestra_rule unicast_per_neighbor_traffic_aware;
 extern struct orchestra_rule special_for_root;
 extern struct orchestra_rule default_common;
 
@@ -66,6 +66,7 @@
 #endif
 #include "net/routing/routing.h"
 #include "net/mac/llsec802154.h"
+#include "net/link-stats.h"
 
 /* For RPL-specific commands */
 #if ROUTING_CONF_RPL_LITE
@@ -74,6 +75,16 @@
 #include "net/routing/rpl-classic/rpl.h"
 #endif
 
+/* For multicast routing table commands */
+#if UIP_IPV6_MULTICAST && \
+  (UIP_MCAST6_ENGINE == UIP_MCAST6_ENGINE_SMRF || \
+   UIP_MCAST6_ENGINE == UIP_MCAST6_ENGINE_ESMRF)
+#include "net/ipv6/multicast/uip-mcast6-route.h"
+#define SHELL_WITH_MCAST6_ROUTES 1
+#else
+#define SHELL_WITH_MCAST6_ROUTES 0
+#endif
+
 #include <stdlib.h>
 
 #define PING_TIMEOUT (5 * CLOCK_SECOND)
@@ -218,70 +229,105 @@ rpl_ocp_to_str(int ocp)
   }
 }
 /*---------------------------------------------------------------------------*/
+static void
+print_rpl_nbr(shell_output_func output)
+{
+  rpl_nbr_t *nbr = nbr_table_head(rpl_neighbors);
+#if RPL_MAX_INSTANCES > 1
+  SHELL_OUTPUT(output, "RPL neighbors, instance %u:\n", curr_instance.instance_id);
+#else /* RPL_MAX_INSTANCES > 1 */
+  SHELL_OUTPUT(output, "RPL neighbors:\n");
+#endif /* RPL_MAX_INSTANCES > 1 */
+  while(nbr != NULL) {
+    char buf[120];
+    rpl_neighbor_snprint(buf, sizeof(buf), nbr);
+    SHELL_OUTPUT(output, "%s\n", buf);
+    nbr = nbr_table_next(rpl_neighbors, nbr);
+  }
+}
+/*---------------------------------------------------------------------------*/
 static
 PT_THREAD(cmd_rpl_nbr(struct pt *pt, shell_output_func output, char *args))
 {
+  int found = 0;
+  int i;
+
   PT_BEGIN(pt);
 
-  if(!curr_instance.used || rpl_neighbor_count() == 0) {
-    SHELL_OUTPUT(output, "RPL neighbors: none\n");
-  } else {
-    rpl_nbr_t *nbr = nbr_table_head(rpl_neighbors);
-    SHELL_OUTPUT(output, "RPL neighbors:\n");
-    while(nbr != NULL) {
-      char buf[120];
-      rpl_neighbor_snprint(buf, sizeof(buf), nbr);
-      SHELL_OUTPUT(output, "%s\n", buf);
-      nbr = nbr_table_next(rpl_neighbors, nbr);
+  for(i = 0; i < RPL_MAX_INSTANCES; i++) {
+    rpl_instance_t *prev = rpl_instance_set_current(&rpl_instances[i]);
+    if(curr_instance.used && rpl_neighbor_count() > 0) {
+      print_rpl_nbr(output);
+      found = 1;
     }
+    rpl_instance_set_current(prev);
+  }
+
+  if(!found) {
+    SHELL_OUTPUT(output, "RPL neighbors: none\n");
   }
 
   PT_END(pt);
 }
 /*---------------------------------------------------------------------------*/
+static void
+print_rpl_instance(shell_output_func output)
+{
+  SHELL_OUTPUT(output, "-- Instance: %u\n", curr_instance.instance_id);
+  if(rpl_dag_root_is_root()) {
+    SHELL_OUTPUT(output, "-- DAG root\n");
+  } else {
+    SHELL_OUTPUT(output, "-- DAG node\n");
+  }
+  SHELL_OUTPUT(output, "-- DAG: ");
+  shell_output_6addr(output, &curr_instance.dag.dag_id);
+  SHELL_OUTPUT(output, ", version %u\n", curr_instance.dag.version);
+  SHELL_OUTPUT(output, "-- Prefix: ");
+  shell_output_6addr(output, &curr_instance.dag.prefix_info.prefix);
+  SHELL_OUTPUT(output, "/%u\n", curr_instance.dag.prefix_info.length);
+  SHELL_OUTPUT(output, "-- MOP: %s\n", rpl_mop_to_str(curr_instance.mop));
+  SHELL_OUTPUT(output, "-- OF: %s\n", rpl_ocp_to_str(curr_instance.of->ocp));
+  SHELL_OUTPUT(output, "-- Hop rank increment: %u\n", curr_instance.min_hoprankinc);
+  SHELL_OUTPUT(output, "-- Default lifetime: %lu seconds\n", RPL_LIFETIME(curr_instance.default_lifetime));
+
+  SHELL_OUTPUT(output, "-- State: %s\n", rpl_state_to_str(curr_instance.dag.state));
+  SHELL_OUTPUT(output, "-- Preferred parent: ");
+  if(curr_instance.dag.preferred_parent) {
+    shell_output_6addr(output, rpl_neighbor_get_ipaddr(curr_instance.dag.preferred_parent));
+    SHELL_OUTPUT(output, " (last DTSN: %u)\n", curr_instance.dag.preferred_parent->dtsn);
+  } else {
+    SHELL_OUTPUT(output, "None\n");
+  }
+  SHELL_OUTPUT(output, "-- Rank: %u\n", curr_instance.dag.rank);
+  SHELL_OUTPUT(output, "-- Lowest rank: %u (%u)\n", curr_instance.dag.lowest_rank, curr_instance.max_rankinc);
+  SHELL_OUTPUT(output, "-- DTSN out: %u\n", curr_instance.dtsn_out);
+  SHELL_OUTPUT(output, "-- DAO sequence: last sent %u, last acked %u\n",
+      curr_instance.dag.dao_last_seqno, curr_instance.dag.dao_last_acked_seqno);
+  SHELL_OUTPUT(output, "-- Trickle timer: current %u, min %u, max %u, redundancy %u\n",
+    curr_instance.dag.dio_intcurrent, curr_instance.dio_intmin,
+    curr_instance.dio_intmin + curr_instance.dio_intdoubl, curr_instance.dio_redundancy);
+}
+/*---------------------------------------------------------------------------*/
 static
 PT_THREAD(cmd_rpl_status(struct pt *pt, shell_output_func output, char *args))
 {
+  int found = 0;
+  int i;
+
   PT_BEGIN(pt);
 
   SHELL_OUTPUT(output, "RPL status:\n");
-  if(!curr_instance.used) {
-    SHELL_OUTPUT(output, "-- Instance: None\n");
-  } else {
-    SHELL_OUTPUT(output, "-- Instance: %u\n", curr_instance.instance_id);
-    if(NETSTACK_ROUTING.node_is_root()) {
-      SHELL_OUTPUT(output, "-- DAG root\n");
-    } else {
-      SHELL_OUTPUT(output, "-- DAG node\n");
-    }
-    SHELL_OUTPUT(output, "-- DAG: ");
-    shell_output_6addr(output, &curr_instance.dag.dag_id);
-    SHELL_OUTPUT(output, ", version %u\n", curr_instance.dag.version);
-    SHELL_OUTPUT(output, "-- Prefix: ");
-    shell_output_6addr(output, &curr_instance.dag.prefix_info.prefix);
-    SHELL_OUTPUT(output, "/%u\n", curr_instance.dag.prefix_info.length);
-    SHELL_OUTPUT(output, "-- MOP: %s\n", rpl_mop_to_str(curr_instance.mop));
-    SHELL_OUTPUT(output, "-- OF: %s\n", rpl_ocp_to_str(curr_instance.of->ocp));
-    SHELL_OUTPUT(output, "-- Hop rank increment: %u\n", curr_instance.min_hoprankinc);
-    SHELL_OUTPUT(output, "-- Default lifetime: %lu seconds\n", RPL_LIFETIME(curr_instance.default_lifetime));
-
-    SHELL_OUTPUT(output, "-- State: %s\n", rpl_state_to_str(curr_instance.dag.state));
-    SHELL_OUTPUT(output, "-- Preferred parent: ");
-    if(curr_instance.dag.preferred_parent) {
-      shell_output_6addr(output, rpl_neighbor_get_ipaddr(curr_instance.dag.preferred_parent));
-      SHELL_OUTPUT(output, " (last DTSN: %u)\n", curr_instance.dag.preferred_parent->dtsn);
-    } else {
-      SHELL_OUTPUT(output, "None\n");
+  for(i = 0; i < RPL_MAX_INSTANCES; i++) {
+    rpl_instance_t *prev = rpl_instance_set_current(&rpl_instances[i]);
+    if(curr_instance.used) {
+      print_rpl_instance(output);
+      found = 1;
     }
-    SHELL_OUTPUT(output, "-- Rank: %u\n", curr_instance.dag.rank);
-    SHELL_OUTPUT(output, "-- Lowest rank: %u (%u)\n", curr_instance.dag.lowest_rank, curr_instance.max_rankinc);
-    SHELL_OUTPUT(output, "-- DTSN out: %u\n", curr_instance.dtsn_out);
-    SHELL_OUTPUT(output, "-- DAO sequence: last sent %u, last acked %u\n",
-        curr_instance.dag.dao_last_seqno, curr_instance.dag.dao_last_acked_seqno);
-    SHELL_OUTPUT(output, "-- Trickle timer: current %u, min %u, max %u, redundancy %u\n",
-      curr_instance.dag.dio_intcurrent, curr_instance.dio_intmin,
-      curr_instance.dio_intmin + curr_instance.dio_intdoubl, curr_instance.dio_redundancy);
+    rpl_instance_set_current(prev);
+  }
 
+  if(!found) {
+    SHELL_OUTPUT(output, "-- Instance: None\n");
   }
 
   PT_END(pt);
@@ -488,6 +534,55 @@ PT_THREAD(cmd_macaddr(struct pt *pt, shell_output_func output, char *args))
 
   PT_END(pt);
 }
+/*---------------------------------------------------------------------------*/
+static
+PT_THREAD(cmd_link_stats(struct pt *pt, shell_output_func output, char *args))
+{
+  const struct link_stats *stats;
+#if LINK_STATS_WINDOW_SIZE
+  struct link_stats_window window;
+#endif /* LINK_STATS_WINDOW_SIZE */
+
+  PT_BEGIN(pt);
+
+  stats = link_stats_head();
+  if(stats == NULL) {
+    SHELL_OUTPUT(output, "No link statistics\n");
+    PT_EXIT(pt);
+  }
+
+  SHELL_OUTPUT(output, "Link statistics:\n");
+  for(; stats != NULL; stats = link_stats_next(stats)) {
+    SHELL_OUTPUT(output, "-- ");
+    shell_output_lladdr(output, link_stats_get_lladdr(stats));
+    SHELL_OUTPUT(output, " etx %u.%02u",
+                 stats->etx / LINK_STATS_ETX_DIVISOR,
+                 (stats->etx % LINK_STATS_ETX_DIVISOR) * 100 / LINK_STATS_ETX_DIVISOR);
+    if(stats->rssi != LINK_STATS_RSSI_UNKNOWN) {
+      SHELL_OUTPUT(output, " rssi %d", stats->rssi);
+    }
+    if(link_stats_is_fresh(stats)) {
+      SHELL_OUTPUT(output, " fresh");
+    }
+#if LINK_STATS_WINDOW_SIZE
+    if(link_stats_get_window(stats, &window) > 0) {
+      SHELL_OUTPUT(output, " | last %u: etx %u.%02u var %u.%02u pdr %u%%",
+                   window.tx_samples,
+                   window.etx / LINK_STATS_ETX_DIVISOR,
+                   (window.etx % LINK_STATS_ETX_DIVISOR) * 100 / LINK_STATS_ETX_DIVISOR,
+                   window.etx_variance / LINK_STATS_ETX_DIVISOR,
+                   (window.etx_variance % LINK_STATS_ETX_DIVISOR) * 100 / LINK_STATS_ETX_DIVISOR,
+                   window.pdr);
+    }
+    if(window.rssi_samples > 0) {
+      SHELL_OUTPUT(output, " rssi %d", window.rssi);
+    }
+#endif /* LINK_STATS_WINDOW_SIZE */
+    SHELL_OUTPUT(output, "\n");
+  }
+
+  PT_END(pt);
+}
 #if NETSTACK_CONF_WITH_IPV6
 /*---------------------------------------------------------------------------*/
 static
@@ -698,6 +793,126 @@ PT_THREAD(cmd_routes(struct pt *pt, shell_output_func output, char *args))
   PT_END(pt);
 }
 /*---------------------------------------------------------------------------*/
+#if SHELL_WITH_MCAST6_ROUTES
+static
+PT_THREAD(cmd_mcast_groups(struct pt *pt, shell_output_func output, char *args))
+{
+  uip_mcast6_route_t *route;
+
+  PT_BEGIN(pt);
+
+  if(uip_mcast6_route_count() == 0) {
+    SHELL_OUTPUT(output, "No multicast routes\n");
+    PT_EXIT(pt);
+  }
+
+  SHELL_OUTPUT(output, "Multicast routes (%u in total):\n",
+               uip_mcast6_route_count());
+  for(route = uip_mcast6_route_list_head();
+      route != NULL;
+      route = list_item_next(route)) {
+    SHELL_OUTPUT(output, "-- ");
+    shell_output_6addr(output, &route->group);
+#if UIP_MCAST6_STATS
+    SHELL_OUTPUT(output, " in %lu fwd %lu limited %lu",
+                 (unsigned long)route->stats.in,
+                 (unsigned long)route->stats.fwd,
+                 (unsigned long)route->stats.limited);
+#endif /* UIP_MCAST6_STATS */
+#if UIP_MCAST6_ROUTE_RATE_LIMIT
+    if(route->rate != 0) {
+      SHELL_OUTPUT(output, " (limit: %u/min, burst %u)",
+                   route->rate, route->burst);
+    } else {
+      SHELL_OUTPUT(output, " (limit: none)");
+    }
+#endif /* UIP_MCAST6_ROUTE_RATE_LIMIT */
+    SHELL_OUTPUT(output, "\n");
+  }
+
+  PT_END(pt);
+}
+/*---------------------------------------------------------------------------*/
+#if UIP_MCAST6_ROUTE_RATE_LIMIT
+static
+PT_THREAD(cmd_mcast_limit(struct pt *pt, shell_output_func output, char *args))
+{
+  static uip_ipaddr_t group;
+  uip_mcast6_route_t *route;
+  uint16_t rate;
+  uint8_t burst;
+  int is_default;
+  char *next_args;
+  long value;
+
+  PT_BEGIN(pt);
+
+  SHELL_ARGS_INIT(args, next_args);
+
+  /* Get first arg (group or "default") */
+  SHELL_ARGS_NEXT(args, next_args);
+  if(args == NULL) {
+    uip_mcast6_route_get_default_rate_limit(&rate, &burst);
+    SHELL_OUTPUT(output, "Default limit: %u/min, burst %u\n", rate, burst);
+    PT_EXIT(pt);
+  }
+
+  is_default = !strcmp(args, "default");
+  if(!is_default && uiplib_ipaddrconv(args, &group) == 0) {
+    SHELL_OUTPUT(output, "Invalid group: %s\n", args);
+    PT_EXIT(pt);
+  }
+
+  /* Get second arg (rate) */
+  SHELL_ARGS_NEXT(args, next_args);
+  if(args == NULL) {
+    SHELL_OUTPUT(output, "Rate (datagrams per minute) is not specified\n");
+    PT_EXIT(pt);
+  }
+  value = strtol(args, NULL, 10);
+  if(value < 0 || value > UINT16_MAX) {
+    SHELL_OUTPUT(output, "Invalid rate: %s\n", args);
+    PT_EXIT(pt);
+  }
+  rate = (uint16_t)value;
+
+  /* Get optional third arg (burst) */
+  burst = UIP_MCAST6_ROUTE_DEFAULT_BURST;
+  SHELL_ARGS_NEXT(args, next_args);
+  if(args != NULL) {
+    value = strtol(args, NULL, 10);
+    if(value < 1 || value > UINT8_MAX) {
+      SHELL_OUTPUT(output, "Invalid burst: %s\n", args);
+      PT_EXIT(pt);
+    }
+    burst = (uint8_t)value;
+  }
+
+  if(is_default) {
+    uip_mcast6_route_set_default_rate_limit(rate, burst);
+    SHELL_OUTPUT(output, "Default limit set to %u/min, burst %u\n",
+                 rate, burst);
+    PT_EXIT(pt);
+  }
+
+  route = uip_mcast6_route_lookup(&group);
+  if(route == NULL) {
+    SHELL_OUTPUT(output, "No multicast route for ");
+    shell_output_6addr(output, &group);
+    SHELL_OUTPUT(output, "\n");
+    PT_EXIT(pt);
+  }
+
+  uip_mcast6_route_set_rate_limit(route, rate, burst);
+  SHELL_OUTPUT(output, "Limit for ");
+  shell_output_6addr(output, &group);
+  SHELL_OUTPUT(output, " set to %u/min, burst %u\n", rate, burst);
+
+  PT_END(pt);
+}
+#endif /* UIP_MCAST6_ROUTE_RATE_LIMIT */
+/*---------------------------------------------------------------------------*/
+#endif /* SHELL_WITH_MCAST6_ROUTES */
 #if BUILD_WITH_RESOLV
 static
 PT_THREAD(cmd_resolv(struct pt *pt, shell_output_func output, char *args))
@@ -846,6 +1061,48 @@ PT_THREAD(cmd_tsch_schedule(struct pt *pt, shell_output_func output, char *args)
   }
   PT_END(pt);
 }
+#if TSCH_STATS_SLOT_TIMING
+/*---------------------------------------------------------------------------*/
+static
+PT_THREAD(cmd_tsch_timing(struct pt *pt, shell_output_func output, char *args))
+{
+  char *next_args;
+  int i;
+  int j;
+
+  PT_BEGIN(pt);
+
+  SHELL_ARGS_INIT(args, next_args);
+
+  SHELL_ARGS_NEXT(args, next_args);
+  if(args != NULL && !strcmp(args, "reset")) {
+    tsch_stats_slot_timing_reset();
+    SHELL_OUTPUT(output, "TSCH timing statistics cleared\n");
+    PT_EXIT(pt);
+  }
+
+  SHELL_OUTPUT(output, "TSCH timing (us; histogram bins of %u us):\n",
+               TSCH_STATS_SLOT_TIMING_BIN_US);
+  for(i = 0; i < TSCH_STATS_NUM_PHASES; i++) {
+    struct tsch_stats_phase_timing *t = &tsch_stats_slot_timing[i];
+    SHELL_OUTPUT(output, "-- %-8s: count %lu", tsch_stats_slot_phase_name(i),
+                 (unsigned long)t->count);
+    if(t->count > 0) {
+      SHELL_OUTPUT(output, ", min/avg/max %lu/%lu/%lu",
+                   (unsigned long)RTIMERTICKS_TO_US(t->min),
+                   (unsigned long)RTIMERTICKS_TO_US(t->total / t->count),
+                   (unsigned long)RTIMERTICKS_TO_US(t->max));
+    }
+    SHELL_OUTPUT(output, ", deadline misses %u, histogram", t->deadline_misses);
+    for(j = 0; j < TSCH_STATS_SLOT_TIMING_BINS; j++) {
+      SHELL_OUTPUT(output, " %u", t->histogram[j]);
+    }
+    SHELL_OUTPUT(output, "\n");
+  }
+
+  PT_END(pt);
+}
+#endif /* TSCH_STATS_SLOT_TIMING */
 #endif /* MAC_CONF_WITH_TSCH */
 /*---------------------------------------------------------------------------*/
 #if TSCH_WITH_SIXTOP
@@ -998,6 +1255,7 @@ const struct shell_command_t builtin_shell_commands[] = {
   { "reboot",               cmd_reboot,               "'> reboot': Reboot the board by watchdog_reboot()" },
   { "log",                  cmd_log,                  "'> log module level': Sets log level (0--4) for a given module (or \"all\"). For module \"mac\", level 4 also enables per-slot logging." },
   { "mac-addr",             cmd_macaddr,               "'> mac-addr': Shows the node's MAC address" },
+  { "link-stats",           cmd_link_stats,           "'> link-stats': Shows the link statistics of all neighbors" },
 #if NETSTACK_CONF_WITH_IPV6
   { "ip-addr",              cmd_ipaddr,               "'> ip-addr': Shows all IPv6 addresses" },
   { "ip-nbr",               cmd_ip_neighbors,         "'> ip-nbr': Shows all IPv6 neighbors" },
@@ -1010,6 +1268,12 @@ const struct shell_command_t builtin_shell_commands[] = {
   { "wget",                 cmd_wget,                 "'> wget url': get content of URL (only http)." },
 #endif /* BUILD_WITH_HTTP_SOCKET */
 #endif /* NETSTACK_CONF_WITH_IPV6 */
+#if SHELL_WITH_MCAST6_ROUTES
+  { "mcast-groups",         cmd_mcast_groups,         "'> mcast-groups': Shows the multicast routes with per-group counters and limits" },
+#if UIP_MCAST6_ROUTE_RATE_LIMIT
+  { "mcast-limit",          cmd_mcast_limit,          "'> mcast-limit [group|default rate [burst]]': Sets the forwarding limit (datagrams per minute, 0: none) of a group or of new groups" },
+#endif /* UIP_MCAST6_ROUTE_RATE_LIMIT */
+#endif /* SHELL_WITH_MCAST6_ROUTES */
 #if UIP_CONF_IPV6_RPL
   { "rpl-set-root",         cmd_rpl_set_root,         "'> rpl-set-root 0/1 [prefix]': Sets node as root (1) or not (0). A /64 prefix can be optionally specified." },
   { "rpl-local-repair",     cmd_rpl_local_repair,     "'> rpl-local-repair': Triggers a RPL local repair" },
@@ -1024,6 +1288,9 @@ const struct shell_command_t builtin_shell_commands[] = {
   { "tsch-set-coordinator", cmd_tsch_set_coordinator, "'> tsch-set-coordinator 0/1 [0/1]': Sets node as coordinator (1) or not (0). Second, optional parameter: enable (1) or disable (0) security." },
   { "tsch-schedule",        cmd_tsch_schedule,        "'> tsch-schedule': Shows the current TSCH schedule" },
   { "tsch-status",          cmd_tsch_status,          "'> tsch-status': Shows a summary of the current TSCH state" },
+#if TSCH_STATS_SLOT_TIMING
+  { "tsch-timing",          cmd_tsch_timing,          "'> tsch-timing [reset]': Shows (or clears) the timing statistics of TSCH timeslot phases" },
+#endif /* TSCH_STATS_SLOT_TIMING */
 #endif /* MAC_CONF_WITH_TSCH */
 #if TSCH_WITH_SIXTOP
   { "6top",                 cmd_6top,                 "'> 6top help': Shows 6top command usage" },
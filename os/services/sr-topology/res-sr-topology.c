@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden AB
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \addtogroup sr-topology
+ * @{
+ *
+ * \file
+ *         CoAP resources for the source routing topology
+ */
+
+#include "contiki.h"
+#include "coap-engine.h"
+#include "net/ipv6/uip-sr.h"
+#include "sr-topology.h"
+#include <stdlib.h>
+#include <string.h>
+
+static void res_topology_get_handler(coap_message_t *request, coap_message_t *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset);
+static void res_changes_get_handler(coap_message_t *request, coap_message_t *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset);
+static void res_changes_periodic_handler(void);
+
+RESOURCE(res_sr_topology,
+         "title=\"Source routing topology\";ct=60",
+         res_topology_get_handler,
+         NULL,
+         NULL,
+         NULL);
+
+PERIODIC_RESOURCE(res_sr_topology_changes,
+                  "title=\"Source routing topology changes\";ct=60;obs",
+                  res_changes_get_handler,
+                  NULL,
+                  NULL,
+                  NULL,
+                  SR_TOPOLOGY_NOTIFY_PERIOD,
+                  res_changes_periodic_handler);
+
+/* The last change observers were notified of, and the one before it */
+static uint32_t notified_seqno;
+static uint32_t notify_since;
+
+/*---------------------------------------------------------------------------*/
+/* Sets the block of an encoding of total bytes written at buffer */
+static void
+set_block(coap_message_t *response, uint8_t *buffer, uint16_t preferred_size,
+          int32_t *offset, int total)
+{
+  if(*offset >= total) {
+    coap_set_status_code(response, BAD_OPTION_4_02);
+    /* A block error message should not exceed the minimum block size (16). */
+    const char *error_msg = "BlockOutOfScope";
+    coap_set_payload(response, error_msg, strlen(error_msg));
+    return;
+  }
+
+  coap_set_header_content_format(response, APPLICATION_CBOR);
+  if(total - *offset > preferred_size) {
+    coap_set_payload(response, buffer, preferred_size);
+    *offset += preferred_size;
+  } else {
+    coap_set_payload(response, buffer, total - *offset);
+    *offset = -1;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+res_topology_get_handler(coap_message_t *request, coap_message_t *response,
+                         uint8_t *buffer, uint16_t preferred_size,
+                         int32_t *offset)
+{
+  uint8_t etag[SR_TOPOLOGY_ETAG_LEN];
+
+  coap_set_header_etag(response, etag, sr_topology_snapshot_etag(etag));
+  set_block(response, buffer, preferred_size, offset,
+            sr_topology_snapshot(buffer, preferred_size, *offset));
+}
+/*---------------------------------------------------------------------------*/
+static void
+res_changes_get_handler(coap_message_t *request, coap_message_t *response,
+                        uint8_t *buffer, uint16_t preferred_size,
+                        int32_t *offset)
+{
+  const char *str;
+  char since_str[11];
+  uint8_t etag[SR_TOPOLOGY_ETAG_LEN];
+  uint32_t since = 0;
+  int len;
+
+  if(coap_get_src_endpoint(request) == NULL) {
+    /* A notification, only with the changes since the previous one */
+    since = notify_since;
+  } else if((len = coap_get_query_variable(request, "since", &str)) > 0
+            && len < sizeof(since_str)) {
+    memcpy(since_str, str, len);
+    since_str[len] = '\0';
+    since = strtoul(since_str, NULL, 10);
+  }
+
+  /* Lets clients detect blocks of different lists of changes */
+  coap_set_header_etag(response, etag, sr_topology_changes_etag(since, etag));
+  set_block(response, buffer, preferred_size, offset,
+            sr_topology_changes(since, buffer, preferred_size, *offset));
+}
+/*---------------------------------------------------------------------------*/
+static void
+res_changes_periodic_handler(void)
+{
+  /* Notify at most once per period, to keep the backhaul traffic low */
+  if(uip_sr_change_seqno() != notified_seqno) {
+    notify_since = notified_seqno;
+    notified_seqno = uip_sr_change_seqno();
+    coap_notify_observers(&res_sr_topology_changes);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+sr_topology_init(void)
+{
+  notified_seqno = uip_sr_change_seqno();
+  notify_since = notified_seqno;
+  coap_activate_resource(&res_sr_topology, "rpl/topology");
+  coap_activate_resource(&res_sr_topology_changes, "rpl/topology/changes");
+}
+/*---------------------------------------------------------------------------*/
+/** @} */
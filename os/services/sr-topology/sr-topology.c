@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden AB
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \addtogroup sr-topology
+ * @{
+ *
+ * \file
+ *         CBOR encoding of the source routing graph and of its changes
+ */
+
+#include "contiki.h"
+#include "net/ipv6/uip-sr.h"
+#include "net/routing/routing.h"
+#include "sr-topology.h"
+
+/* CBOR major types and simple values (RFC 8949) */
+#define CBOR_UINT  0
+#define CBOR_BYTES 2
+#define CBOR_ARRAY 4
+#define CBOR_NULL  0xf6
+
+/* Writes a window of an encoding to a buffer */
+struct writer {
+  uint8_t *buf;
+  int len;
+  /* The offset of the buffer in the encoding */
+  int32_t offset;
+  /* The current position in the encoding */
+  int32_t pos;
+};
+
+/*---------------------------------------------------------------------------*/
+static void
+put_byte(struct writer *w, uint8_t b)
+{
+  if(w->pos >= w->offset && w->pos < w->offset + w->len) {
+    w->buf[w->pos - w->offset] = b;
+  }
+  w->pos++;
+}
+/*---------------------------------------------------------------------------*/
+static void
+put_head(struct writer *w, uint8_t type, uint32_t value)
+{
+  type <<= 5;
+  if(value < 24) {
+    put_byte(w, type | value);
+  } else if(value <= 0xff) {
+    put_byte(w, type | 24);
+    put_byte(w, value);
+  } else if(value <= 0xffff) {
+    put_byte(w, type | 25);
+    put_byte(w, value >> 8);
+    put_byte(w, value);
+  } else {
+    put_byte(w, type | 26);
+    put_byte(w, value >> 24);
+    put_byte(w, value >> 16);
+    put_byte(w, value >> 8);
+    put_byte(w, value);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+put_bytes(struct writer *w, const unsigned char *bytes, int len)
+{
+  int i;
+
+  if(bytes == NULL) {
+    put_byte(w, CBOR_NULL);
+    return;
+  }
+  put_head(w, CBOR_BYTES, len);
+  for(i = 0; i < len; i++) {
+    put_byte(w, bytes[i]);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* A reset makes clients drop what they know and fetch a new snapshot */
+static void
+put_reset(struct writer *w)
+{
+  put_head(w, CBOR_UINT, UIP_SR_CHANGE_RESET);
+  put_bytes(w, NULL, 0);
+  put_bytes(w, NULL, 0);
+}
+/*---------------------------------------------------------------------------*/
+static int
+put_etag(uint8_t *etag, uint32_t first, uint32_t last)
+{
+  etag[0] = first >> 24;
+  etag[1] = first >> 16;
+  etag[2] = first >> 8;
+  etag[3] = first;
+  etag[4] = last >> 24;
+  etag[5] = last >> 16;
+  etag[6] = last >> 8;
+  etag[7] = last;
+  return SR_TOPOLOGY_ETAG_LEN;
+}
+/*---------------------------------------------------------------------------*/
+/* The first change to send to a client that knows of the changes up to
+ * since, or 0 if the client is ahead of the last change */
+static uint32_t
+changes_first(uint32_t since, uint32_t last)
+{
+  uint32_t first;
+
+  if(since > last) {
+    return 0;
+  }
+
+  /* Start from the oldest change still in the log, if needed */
+  first = since + 1;
+  if(last >= UIP_SR_CHANGE_LOG_SIZE && first <= last - UIP_SR_CHANGE_LOG_SIZE) {
+    first = last - UIP_SR_CHANGE_LOG_SIZE + 1;
+  }
+  if(first > last) {
+    first = last + 1;
+  }
+  return first;
+}
+/*---------------------------------------------------------------------------*/
+int
+sr_topology_snapshot_etag(uint8_t *etag)
+{
+  return put_etag(etag, 0, uip_sr_change_seqno());
+}
+/*---------------------------------------------------------------------------*/
+int
+sr_topology_changes_etag(uint32_t since, uint8_t *etag)
+{
+  uint32_t last = uip_sr_change_seqno();
+
+  return put_etag(etag, changes_first(since, last), last);
+}
+/*---------------------------------------------------------------------------*/
+int
+sr_topology_snapshot(uint8_t *buf, int len, int32_t offset)
+{
+  struct writer w = { buf, len, offset, 0 };
+  uip_ipaddr_t root_ipaddr;
+  uip_sr_node_t *node;
+
+  put_head(&w, CBOR_ARRAY, 3);
+  put_head(&w, CBOR_UINT, uip_sr_change_seqno());
+  if(NETSTACK_ROUTING.get_root_ipaddr(&root_ipaddr)) {
+    put_bytes(&w, root_ipaddr.u8, 8);
+  } else {
+    put_bytes(&w, NULL, 0);
+  }
+
+  put_head(&w, CBOR_ARRAY, 2 * uip_sr_num_nodes());
+  for(node = uip_sr_node_head(); node != NULL; node = uip_sr_node_next(node)) {
+    put_bytes(&w, node->link_identifier, 8);
+    put_bytes(&w, node->parent != NULL ? node->parent->link_identifier : NULL, 8);
+  }
+
+  return w.pos;
+}
+/*---------------------------------------------------------------------------*/
+int
+sr_topology_changes(uint32_t since, uint8_t *buf, int len, int32_t offset)
+{
+  struct writer w = { buf, len, offset, 0 };
+  uint32_t last = uip_sr_change_seqno();
+  uint32_t first = changes_first(since, last);
+  uint32_t seqno;
+  const uip_sr_change_t *change;
+
+  if(first == 0) {
+    /* The client knows of changes that were never made here, e.g. the
+     * root rebooted since */
+    put_head(&w, CBOR_ARRAY, 2);
+    put_head(&w, CBOR_UINT, last);
+    put_head(&w, CBOR_ARRAY, 3);
+    put_reset(&w);
+    return w.pos;
+  }
+
+  put_head(&w, CBOR_ARRAY, 2);
+  put_head(&w, CBOR_UINT, first);
+  put_head(&w, CBOR_ARRAY, 3 * (last + 1 - first));
+  for(seqno = first; seqno <= last; seqno++) {
+    change = uip_sr_change_get(seqno);
+    if(change == NULL) {
+      /* Without a log, report a reset to make clients fetch a snapshot */
+      put_reset(&w);
+      continue;
+    }
+    put_head(&w, CBOR_UINT, change->type);
+    put_bytes(&w, change->type != UIP_SR_CHANGE_RESET ? change->link_identifier : NULL, 8);
+    put_bytes(&w, change->has_parent ? change->parent_identifier : NULL, 8);
+  }
+
+  return w.pos;
+}
+/*---------------------------------------------------------------------------*/
+/** @} */
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden AB
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \addtogroup lib
+ * @{
+ *
+ * \defgroup sr-topology Source routing topology export
+ *
+ * Exports the source routing graph kept at a non-storing root as a
+ * compact CBOR snapshot, and the changes of the graph since a given
+ * sequence number, so that monitoring clients can fetch deltas only.
+ *
+ * The snapshot is the CBOR array [seqno, prefix, links], where seqno is
+ * the sequence number of the last change, prefix is the 8-byte DAG prefix
+ * (null if unknown), and links is a flat array of child and parent
+ * interface identifiers (8-byte strings, parent null for the root).
+ *
+ * The changes are the CBOR array [first, changes], where first is the
+ * sequence number of the first change and changes is a flat array of
+ * type (UIP_SR_CHANGE_*), node and parent (8-byte strings or null). A
+ * client that finds first to be more than one past the last change it
+ * knows of has missed changes and must fetch a new snapshot. So must a
+ * client that receives a UIP_SR_CHANGE_RESET, which is also the only
+ * change sent when the client asks for changes after the last one, e.g.
+ * because the root rebooted.
+ *
+ * Notifications to observers of the changes carry only the changes made
+ * since the previous notification.
+ *
+ * Every block of both resources carries an ETag that identifies its
+ * content. The content may change between two blocks, e.g. with a new
+ * change, and the blocks that follow the first one of a notification are
+ * fetched with the query of the observe registration, i.e. they belong to
+ * another list of changes. A client that gets a block with another ETag
+ * than the first one must therefore drop the transfer, and fetch the
+ * changes since the last one it knows of instead.
+ * @{
+ */
+
+/**
+ * \file
+ *         Source routing topology export
+ */
+
+#ifndef SR_TOPOLOGY_H_
+#define SR_TOPOLOGY_H_
+
+#include "contiki.h"
+
+/** \brief The minimum time between two notifications of the changes to
+ * CoAP observers, in milliseconds */
+#ifdef SR_TOPOLOGY_CONF_NOTIFY_PERIOD
+#define SR_TOPOLOGY_NOTIFY_PERIOD SR_TOPOLOGY_CONF_NOTIFY_PERIOD
+#else /* SR_TOPOLOGY_CONF_NOTIFY_PERIOD */
+#define SR_TOPOLOGY_NOTIFY_PERIOD 10000
+#endif /* SR_TOPOLOGY_CONF_NOTIFY_PERIOD */
+
+/** \brief The length of the ETags of the snapshot and the changes */
+#define SR_TOPOLOGY_ETAG_LEN 8
+
+/**
+ * Encodes a snapshot of the graph. Only the bytes of the encoding from
+ * offset on are written, up to len bytes, which supports block-wise
+ * transfers.
+ *
+ * \param buf The buffer where to write the encoding
+ * \param len The size of the buffer
+ * \param offset The offset in the encoding of the first byte to write
+ * \return The total length of the encoding
+ */
+int sr_topology_snapshot(uint8_t *buf, int len, int32_t offset);
+
+/**
+ * Encodes the changes of the graph since a given change. Only the bytes
+ * of the encoding from offset on are written, up to len bytes.
+ *
+ * \param since The sequence number of the last change known to the client
+ * \param buf The buffer where to write the encoding
+ * \param len The size of the buffer
+ * \param offset The offset in the encoding of the first byte to write
+ * \return The total length of the encoding
+ */
+int sr_topology_changes(uint32_t since, uint8_t *buf, int len, int32_t offset);
+
+/**
+ * Gives the ETag of the current snapshot of the graph.
+ *
+ * \param etag The buffer where to write the ETag, of SR_TOPOLOGY_ETAG_LEN bytes
+ * \return The length of the ETag
+ */
+int sr_topology_snapshot_etag(uint8_t *etag);
+
+/**
+ * Gives the ETag of the current encoding of the changes since a given
+ * change. Two encodings with the same ETag are identical.
+ *
+ * \param since The sequence number of the last change known to the client
+ * \param etag The buffer where to write the ETag, of SR_TOPOLOGY_ETAG_LEN bytes
+ * \return The length of the ETag
+ */
+int sr_topology_changes_etag(uint32_t since, uint8_t *etag);
+
+/**
+ * Activates the CoAP resources rpl/topology, the snapshot, and
+ * rpl/topology/changes, the changes (since the sequence number given as
+ * "since" query variable), which is observable. Notifications carry the
+ * changes since the previous notification.
+ */
+void sr_topology_init(void);
+
+#endif /* SR_TOPOLOGY_H_ */
+/** @} */
+/** @} */
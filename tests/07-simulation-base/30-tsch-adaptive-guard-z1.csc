@@ -0,0 +1,178 @@
+<?xml version="1.0" encoding="UTF-8"?>
+<simconf version="2022112801">
+  <simulation>
+    <title>TSCH adaptive guard time test</title>
+    <randomseed>1</randomseed>
+    <motedelay_us>1000000</motedelay_us>
+    <radiomedium>
+      org.contikios.cooja.radiomediums.UDGM
+      <transmitting_range>50.0</transmitting_range>
+      <interference_range>100.0</interference_range>
+      <success_ratio_tx>1.0</success_ratio_tx>
+      <success_ratio_rx>1.0</success_ratio_rx>
+    </radiomedium>
+    <events>
+      <logoutput>40000</logoutput>
+    </events>
+    <motetype>
+      org.contikios.cooja.mspmote.Z1MoteType
+      <description>Z1 Mote Type #z11 (adaptive guard time)</description>
+      <source>[CONTIKI_DIR]/examples/6tisch/timesync-demo/node.c</source>
+      <commands>$(MAKE) TARGET=z1 clean
+      $(MAKE) -j$(CPUS) node.z1 TARGET=z1 BUILD_DIR_CONFIG=guard MAKE_WITH_ORCHESTRA=1 MAKE_WITH_ADAPTIVE_GUARD_TIME=1 MAKE_WITH_ENERGEST=1</commands>
+      <firmware>[CONTIKI_DIR]/examples/6tisch/timesync-demo/build/z1/guard/node.z1</firmware>
+      <moteinterface>org.contikios.cooja.interfaces.Position</moteinterface>
+      <moteinterface>org.contikios.cooja.interfaces.RimeAddress</moteinterface>
+      <moteinterface>org.contikios.cooja.interfaces.IPAddress</moteinterface>
+      <moteinterface>org.contikios.cooja.interfaces.Mote2MoteRelations</moteinterface>
+      <moteinterface>org.contikios.cooja.interfaces.MoteAttributes</moteinterface>
+      <moteinterface>org.contikios.cooja.mspmote.interfaces.MspClock</moteinterface>
+      <moteinterface>org.contikios.cooja.mspmote.interfaces.MspMoteID</moteinterface>
+      <moteinterface>org.contikios.cooja.mspmote.interfaces.Msp802154Radio</moteinterface>
+      <moteinterface>org.contikios.cooja.mspmote.interfaces.MspDefaultSerial</moteinterface>
+      <moteinterface>org.contikios.cooja.mspmote.interfaces.MspLED</moteinterface>
+      <moteinterface>org.contikios.cooja.mspmote.interfaces.MspDebugOutput</moteinterface>
+      <mote>
+        <interface_config>
+          org.contikios.cooja.interfaces.Position
+          <pos x="-1.285769821276336" y="38.58045647334346" />
+        </interface_config>
+        <interface_config>
+          org.contikios.cooja.mspmote.interfaces.MspClock
+          <deviation>0.9999975</deviation>
+        </interface_config>
+        <interface_config>
+          org.contikios.cooja.mspmote.interfaces.MspMoteID
+          <id>1</id>
+        </interface_config>
+      </mote>
+      <mote>
+        <interface_config>
+          org.contikios.cooja.interfaces.Position
+          <pos x="10.0" y="50.0" />
+        </interface_config>
+        <interface_config>
+          org.contikios.cooja.mspmote.interfaces.MspMoteID
+          <id>2</id>
+        </interface_config>
+      </mote>
+    </motetype>
+    <motetype>
+      org.contikios.cooja.mspmote.Z1MoteType
+      <description>Z1 Mote Type #z12 (no adaptive guard time)</description>
+      <source>[CONTIKI_DIR]/examples/6tisch/timesync-demo/node.c</source>
+      <commands>$(MAKE) -j$(CPUS) node.z1 TARGET=z1 BUILD_DIR_CONFIG=noguard MAKE_WITH_ORCHESTRA=1 MAKE_WITH_ENERGEST=1 DEFINES=APP_CONF_COORDINATOR_ID=3</commands>
+      <firmware>[CONTIKI_DIR]/examples/6tisch/timesync-demo/build/z1/noguard/node.z1</firmware>
+      <moteinterface>org.contikios.cooja.interfaces.Position</moteinterface>
+      <moteinterface>org.contikios.cooja.interfaces.RimeAddress</moteinterface>
+      <moteinterface>org.contikios.cooja.interfaces.IPAddress</moteinterface>
+      <moteinterface>org.contikios.cooja.interfaces.Mote2MoteRelations</moteinterface>
+      <moteinterface>org.contikios.cooja.interfaces.MoteAttributes</moteinterface>
+      <moteinterface>org.contikios.cooja.mspmote.interfaces.MspClock</moteinterface>
+      <moteinterface>org.contikios.cooja.mspmote.interfaces.MspMoteID</moteinterface>
+      <moteinterface>org.contikios.cooja.mspmote.interfaces.Msp802154Radio</moteinterface>
+      <moteinterface>org.contikios.cooja.mspmote.interfaces.MspDefaultSerial</moteinterface>
+      <moteinterface>org.contikios.cooja.mspmote.interfaces.MspLED</moteinterface>
+      <moteinterface>org.contikios.cooja.mspmote.interfaces.MspDebugOutput</moteinterface>
+      <mote>
+        <interface_config>
+          org.contikios.cooja.interfaces.Position
+          <pos x="998.714230178724" y="38.58045647334346" />
+        </interface_config>
+        <interface_config>
+          org.contikios.cooja.mspmote.interfaces.MspClock
+          <deviation>0.9999975</deviation>
+        </interface_config>
+        <interface_config>
+          org.contikios.cooja.mspmote.interfaces.MspMoteID
+          <id>3</id>
+        </interface_config>
+      </mote>
+      <mote>
+        <interface_config>
+          org.contikios.cooja.interfaces.Position
+          <pos x="1010.0" y="50.0" />
+        </interface_config>
+        <interface_config>
+          org.contikios.cooja.mspmote.interfaces.MspMoteID
+          <id>4</id>
+        </interface_config>
+      </mote>
+    </motetype>
+  </simulation>
+  <plugin>
+    org.contikios.cooja.plugins.Visualizer
+    <plugin_config>
+      <moterelations>true</moterelations>
+      <skin>org.contikios.cooja.plugins.skins.IDVisualizerSkin</skin>
+      <skin>org.contikios.cooja.plugins.skins.GridVisualizerSkin</skin>
+      <skin>org.contikios.cooja.plugins.skins.TrafficVisualizerSkin</skin>
+      <skin>org.contikios.cooja.plugins.skins.UDGMVisualizerSkin</skin>
+      <viewport>1.7405603810040515 0.0 0.0 1.7405603810040515 47.95980153208088 -42.576134155447555</viewport>
+    </plugin_config>
+    <bounds x="1" y="1" height="230" width="236" z="3" />
+  </plugin>
+  <plugin>
+    org.contikios.cooja.plugins.LogListener
+    <plugin_config>
+      <filter />
+      <formatted_time />
+      <coloring />
+    </plugin_config>
+    <bounds x="273" y="6" height="394" width="1031" z="2" />
+  </plugin>
+  <plugin>
+    org.contikios.cooja.plugins.TimeLine
+    <plugin_config>
+      <mote>0</mote>
+      <mote>1</mote>
+      <showRadioRXTX />
+      <showRadioChannels />
+      <showRadioHW />
+      <zoomfactor>1000.0</zoomfactor>
+    </plugin_config>
+    <bounds x="0" y="412" height="311" width="1304" z="1" />
+  </plugin>
+  <plugin>
+    org.contikios.cooja.plugins.ScriptRunner
+    <plugin_config>
+      <script>TIMEOUT(1500000); /* Time out after 25 minutes */&#xD;
+/* Nodes 1 and 2 run with adaptive guard times, nodes 3 and 4 are the same&#xD;
+ * network without them, out of radio range. All must stay in sync, and once&#xD;
+ * its drift estimate is confident node 2 must listen less than node 4 */&#xD;
+SKIP = 5; /* Energest summaries spent learning the drift */&#xD;
+COUNT = 10; /* Energest summaries to compare */&#xD;
+rx = { 2: 0, 4: 0 };&#xD;
+summaries = { 2: 0, 4: 0 };&#xD;
+received = 0;&#xD;
+log.log("Comparing the radio Rx time of nodes 2 and 4\n");&#xD;
+while(true) {&#xD;
+  YIELD();&#xD;
+  if(msg.contains("leaving the network")) {&#xD;
+    log.log(id + ": " + msg + "\n");&#xD;
+    log.testFailed();&#xD;
+  }&#xD;
+  if(id == 1 &amp;&amp; msg.contains("Received from")) {&#xD;
+    received++;&#xD;
+  }&#xD;
+  if(id == 2 || id == 4) {&#xD;
+    if(msg.contains("--- Period summary")) {&#xD;
+      summaries[id]++;&#xD;
+    } else if(msg.contains("Radio Rx") &amp;&amp; summaries[id] &gt; SKIP &amp;&amp; summaries[id] &lt;= SKIP + COUNT) {&#xD;
+      rx[id] += parseInt(msg.match(/Radio Rx\s*:\s*(\d+)\//)[1]);&#xD;
+    }&#xD;
+  }&#xD;
+  if(summaries[2] &gt; SKIP + COUNT &amp;&amp; summaries[4] &gt; SKIP + COUNT) {&#xD;
+    log.log("Rx time with adaptive guard: " + rx[2] + ", without: " + rx[4]&#xD;
+            + ", packets at the coordinator: " + received + "\n");&#xD;
+    if(received &gt;= 8 &amp;&amp; rx[2] &lt; rx[4]) {&#xD;
+      log.testOK(); /* Report test success and quit */&#xD;
+    }&#xD;
+    log.testFailed();&#xD;
+  }&#xD;
+}</script>
+      <active>true</active>
+    </plugin_config>
+    <bounds x="963" y="111" height="995" width="764" />
+  </plugin>
+</simconf>
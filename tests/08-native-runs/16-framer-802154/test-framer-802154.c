@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden AB
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Tests and benchmark for the 802.15.4 framer header template cache
+ */
+
+#include "contiki.h"
+#include "net/packetbuf.h"
+#include "net/mac/framer/framer-802154.h"
+#include "net/mac/framer/frame802154.h"
+#include "unit-test.h"
+#include <stdio.h>
+#include <string.h>
+
+#define BENCHMARK_FRAMES 1000000
+#define NUM_DESTS 3
+
+PROCESS(test_process, "test");
+AUTOSTART_PROCESSES(&test_process);
+
+static const linkaddr_t dests[NUM_DESTS] = {
+  { { 0x00, 0x12, 0x4b, 0x00, 0x00, 0x00, 0x00, 0x02 } },
+  { { 0x00, 0x12, 0x4b, 0x00, 0x00, 0x00, 0x00, 0x03 } },
+  { { 0x00, 0x12, 0x4b, 0x00, 0x00, 0x00, 0x00, 0x04 } },
+};
+static const uint8_t payload[] = { 0x41, 0x42, 0x43, 0x44, 0x45 };
+static uint8_t reference[PACKETBUF_SIZE];
+/*---------------------------------------------------------------------------*/
+static void
+prepare_packet(const linkaddr_t *dest, uint8_t seqno, uint32_t counter,
+               uint8_t security_level, uint8_t key_id_mode)
+{
+  packetbuf_clear();
+  packetbuf_copyfrom(payload, sizeof(payload));
+  packetbuf_set_attr(PACKETBUF_ATTR_FRAME_TYPE, FRAME802154_DATAFRAME);
+  packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &linkaddr_node_addr);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, dest);
+  packetbuf_set_attr(PACKETBUF_ATTR_MAC_ACK, !linkaddr_cmp(dest, &linkaddr_null));
+  packetbuf_set_attr(PACKETBUF_ATTR_MAC_SEQNO, seqno);
+  packetbuf_set_attr(PACKETBUF_ATTR_SECURITY_LEVEL, security_level);
+  packetbuf_set_attr(PACKETBUF_ATTR_KEY_ID_MODE, key_id_mode);
+  packetbuf_set_attr(PACKETBUF_ATTR_KEY_INDEX, key_id_mode ? 1 : 0);
+  packetbuf_set_attr(PACKETBUF_ATTR_FRAME_COUNTER_BYTES_0_1, counter & 0xffff);
+  packetbuf_set_attr(PACKETBUF_ATTR_FRAME_COUNTER_BYTES_2_3, counter >> 16);
+}
+/*---------------------------------------------------------------------------*/
+/* Builds the header the way the framer does without a template cache */
+static int
+create_reference(uint8_t *buf)
+{
+  frame802154_t params;
+
+  memset(&params, 0, sizeof(params));
+  framer_802154_setup_params(packetbuf_attr, packetbuf_holds_broadcast(),
+                             &params);
+  if(packetbuf_holds_broadcast()) {
+    params.dest_addr[0] = 0xFF;
+    params.dest_addr[1] = 0xFF;
+  } else {
+    linkaddr_copy((linkaddr_t *)&params.dest_addr,
+                  packetbuf_addr(PACKETBUF_ADDR_RECEIVER));
+  }
+  linkaddr_copy((linkaddr_t *)&params.src_addr,
+                packetbuf_addr(PACKETBUF_ADDR_SENDER));
+  params.payload = packetbuf_dataptr();
+  params.payload_len = packetbuf_datalen();
+  return frame802154_create(&params, buf);
+}
+/*---------------------------------------------------------------------------*/
+static int
+check_frame(const linkaddr_t *dest, uint8_t seqno, uint32_t counter,
+            uint8_t security_level, uint8_t key_id_mode)
+{
+  int ref_len;
+  int len;
+
+  prepare_packet(dest, seqno, counter, security_level, key_id_mode);
+  ref_len = create_reference(reference);
+  if(framer_802154.length() != ref_len) {
+    return 0;
+  }
+  len = framer_802154.create();
+  return len == ref_len && memcmp(packetbuf_hdrptr(), reference, len) == 0;
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_equivalence,
+                   "Cached headers are identical to freshly built ones");
+UNIT_TEST(test_equivalence)
+{
+  int i;
+  int d;
+  uint8_t level;
+  uint8_t key_id_mode;
+
+  UNIT_TEST_BEGIN();
+
+  framer_802154_flush_hdr_cache();
+
+  /* More destinations and security settings than cache entries, with
+   * changing sequence numbers and frame counters */
+  for(i = 0; i < 4; i++) {
+    for(d = 0; d < NUM_DESTS; d++) {
+      for(level = 0; level <= 7; level += 5) {
+        for(key_id_mode = 0; key_id_mode <= 3; key_id_mode++) {
+          UNIT_TEST_ASSERT(check_frame(&dests[d], 17 * i + d,
+                                       0x01020304UL * (i + 1) + level,
+                                       level, level ? key_id_mode : 0));
+        }
+      }
+    }
+    UNIT_TEST_ASSERT(check_frame(&linkaddr_null, i, i, 0, 0));
+  }
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_pan_change,
+                   "PAN ID changes invalidate cached headers");
+UNIT_TEST(test_pan_change)
+{
+  uint16_t pan_id;
+
+  UNIT_TEST_BEGIN();
+
+  pan_id = frame802154_get_pan_id();
+  framer_802154_flush_hdr_cache();
+
+  UNIT_TEST_ASSERT(check_frame(&dests[0], 1, 1, 0, 0));
+  UNIT_TEST_ASSERT(check_frame(&dests[0], 2, 2, 0, 0));
+  frame802154_set_pan_id(0x1234);
+  UNIT_TEST_ASSERT(check_frame(&dests[0], 3, 3, 0, 0));
+  UNIT_TEST_ASSERT(frame802154_get_pan_id() == 0x1234);
+  frame802154_set_pan_id(pan_id);
+  UNIT_TEST_ASSERT(check_frame(&dests[0], 4, 4, 0, 0));
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_benchmark,
+                   "Frames per second with and without header templates");
+UNIT_TEST(test_benchmark)
+{
+  clock_time_t start;
+  clock_time_t ref_time;
+  clock_time_t cached_time;
+  uint32_t i;
+
+  UNIT_TEST_BEGIN();
+
+  framer_802154_flush_hdr_cache();
+
+  start = clock_time();
+  for(i = 0; i < BENCHMARK_FRAMES; i++) {
+    prepare_packet(&dests[i % NUM_DESTS], i, i, 5, 1);
+    packetbuf_hdralloc(create_reference(reference));
+  }
+  ref_time = MAX(clock_time() - start, 1);
+
+  start = clock_time();
+  for(i = 0; i < BENCHMARK_FRAMES; i++) {
+    prepare_packet(&dests[i % NUM_DESTS], i, i, 5, 1);
+    UNIT_TEST_ASSERT(framer_802154.create() > 0);
+  }
+  cached_time = MAX(clock_time() - start, 1);
+
+  printf("Without templates: %lu frames/s\n",
+         (unsigned long)((uint64_t)BENCHMARK_FRAMES * CLOCK_SECOND / ref_time));
+  printf("With templates: %lu frames/s\n",
+         (unsigned long)((uint64_t)BENCHMARK_FRAMES * CLOCK_SECOND / cached_time));
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(test_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  UNIT_TEST_RUN(test_equivalence);
+  UNIT_TEST_RUN(test_pan_change);
+  UNIT_TEST_RUN(test_benchmark);
+
+  if(!UNIT_TEST_PASSED(test_equivalence)
+      || !UNIT_TEST_PASSED(test_pan_change)
+      || !UNIT_TEST_PASSED(test_benchmark)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
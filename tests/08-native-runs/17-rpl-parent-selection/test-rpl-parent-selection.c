@@ -0,0 +1,267 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden AB
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Tests and benchmark for RPL-lite parent selection
+ */
+
+#include "contiki.h"
+#include "net/routing/rpl-lite/rpl.h"
+#include "net/link-stats.h"
+#include "net/mac/mac.h"
+#include "lib/random.h"
+#include "unit-test.h"
+#include <stdio.h>
+#include <string.h>
+
+#define NUM_NBRS 12
+#define NUM_UPDATES 20000
+#define BENCHMARK_SELECTIONS 200000
+
+extern rpl_of_t rpl_of0, rpl_mrhof;
+
+PROCESS(test_process, "test");
+AUTOSTART_PROCESSES(&test_process);
+
+static linkaddr_t addrs[NUM_NBRS];
+static rpl_nbr_t *nbrs[NUM_NBRS];
+/*---------------------------------------------------------------------------*/
+static void
+set_link_metric(int i, uint16_t etx)
+{
+  ((struct link_stats *)link_stats_from_lladdr(&addrs[i]))->etx = etx;
+}
+/*---------------------------------------------------------------------------*/
+static void
+randomize_nbr(int i)
+{
+  /* Mostly reasonable ranks, some infinite or beyond the acceptable rank */
+  switch(random_rand() % 8) {
+  case 0:
+    nbrs[i]->rank = RPL_INFINITE_RANK;
+    break;
+  case 1:
+    nbrs[i]->rank = 2048 + random_rand() % 2048;
+    break;
+  default:
+    nbrs[i]->rank = ROOT_RANK + random_rand() % 1024;
+    break;
+  }
+  set_link_metric(i, LINK_STATS_ETX_DIVISOR + random_rand() % (4 * LINK_STATS_ETX_DIVISOR));
+  rpl_neighbor_update(nbrs[i]);
+}
+/*---------------------------------------------------------------------------*/
+static void
+setup(rpl_of_t *of)
+{
+  int i, j;
+
+  /* Not a memset, the instance timers may be running */
+  curr_instance.used = 1;
+  curr_instance.of = of;
+  curr_instance.min_hoprankinc = RPL_MIN_HOPRANKINC;
+  curr_instance.max_rankinc = 4 * RPL_MIN_HOPRANKINC;
+  curr_instance.mc.type = RPL_DAG_MC_NONE;
+  curr_instance.dag.rank = 4 * RPL_MIN_HOPRANKINC;
+  curr_instance.dag.lowest_rank = curr_instance.dag.rank;
+  curr_instance.dag.preferred_parent = NULL;
+
+  for(i = 0; i < NUM_NBRS; i++) {
+    memset(&addrs[i], 0, sizeof(linkaddr_t));
+    addrs[i].u8[0] = 0x02;
+    addrs[i].u8[LINKADDR_SIZE - 1] = i + 2;
+    /* Make the link fresh */
+    for(j = 0; j < 4; j++) {
+      link_stats_packet_sent(&addrs[i], MAC_TX_OK, 1);
+    }
+    nbrs[i] = nbr_table_add_lladdr(rpl_neighbors, &addrs[i],
+                                   NBR_TABLE_REASON_RPL_DIO, NULL);
+    randomize_nbr(i);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+teardown(void)
+{
+  rpl_neighbor_remove_all();
+  curr_instance.used = 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Selects the best parent the way RPL does without incremental selection */
+static rpl_nbr_t *
+reference_best(void)
+{
+  rpl_nbr_t *nbr;
+  rpl_nbr_t *best = NULL;
+  rpl_rank_t rank;
+  int max_rank;
+
+  max_rank = curr_instance.max_rankinc == 0 ? RPL_INFINITE_RANK
+    : MIN(curr_instance.dag.lowest_rank + curr_instance.max_rankinc, RPL_INFINITE_RANK);
+
+  for(nbr = nbr_table_head(rpl_neighbors); nbr != NULL; nbr = nbr_table_next(rpl_neighbors, nbr)) {
+    rank = rpl_neighbor_rank_via_nbr(nbr);
+    if(rank != RPL_INFINITE_RANK && rank >= ROOT_RANK && rank <= max_rank
+       && curr_instance.of->nbr_is_acceptable_parent(nbr)) {
+      best = curr_instance.of->best_parent(best, nbr);
+    }
+  }
+  return best;
+}
+/*---------------------------------------------------------------------------*/
+static int
+run_equivalence(rpl_of_t *of)
+{
+  rpl_nbr_t *best;
+  rpl_nbr_t *ref;
+  int i, j;
+  int ok = 1;
+
+  setup(of);
+
+  for(i = 0; i < NUM_UPDATES && ok; i++) {
+    switch(random_rand() % 4) {
+    case 0:
+      /* Switch to what was selected, or to any neighbor */
+      curr_instance.dag.preferred_parent = (random_rand() % 2) ? reference_best()
+        : nbrs[random_rand() % NUM_NBRS];
+      break;
+    case 1:
+      /* Only the link metric changes, e.g. after a transmission */
+      j = random_rand() % NUM_NBRS;
+      set_link_metric(j, LINK_STATS_ETX_DIVISOR + random_rand() % (4 * LINK_STATS_ETX_DIVISOR));
+      rpl_neighbor_update(nbrs[j]);
+      break;
+    default:
+      randomize_nbr(random_rand() % NUM_NBRS);
+      break;
+    }
+
+    best = rpl_neighbor_select_best();
+    ref = reference_best();
+
+    /* Candidates with the same path cost may be picked in a different order */
+    if((best == NULL) != (ref == NULL)
+       || (best != NULL
+           && (of->nbr_path_cost(best) != of->nbr_path_cost(ref)
+               || (best == curr_instance.dag.preferred_parent)
+                  != (ref == curr_instance.dag.preferred_parent)))) {
+      printf("Mismatch after %d updates\n", i);
+      ok = 0;
+    }
+  }
+
+  teardown();
+  return ok;
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_mrhof, "Parent selection with MRHOF");
+UNIT_TEST(test_mrhof)
+{
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(run_equivalence(&rpl_mrhof));
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_of0, "Parent selection with OF0");
+UNIT_TEST(test_of0)
+{
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(run_equivalence(&rpl_of0));
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_benchmark, "Parent selection benchmark");
+UNIT_TEST(test_benchmark)
+{
+  clock_time_t start;
+  clock_time_t ref_time;
+  clock_time_t sel_time;
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  setup(&rpl_mrhof);
+  curr_instance.dag.preferred_parent = reference_best();
+
+  start = clock_time();
+  for(i = 0; i < BENCHMARK_SELECTIONS; i++) {
+    reference_best();
+  }
+  ref_time = MAX(clock_time() - start, 1);
+
+  start = clock_time();
+  for(i = 0; i < BENCHMARK_SELECTIONS; i++) {
+    rpl_neighbor_select_best();
+  }
+  sel_time = MAX(clock_time() - start, 1);
+
+  printf("Full scan: %lu selections/s\n",
+         (unsigned long)((uint64_t)BENCHMARK_SELECTIONS * CLOCK_SECOND / ref_time));
+  printf("rpl_neighbor_select_best: %lu selections/s\n",
+         (unsigned long)((uint64_t)BENCHMARK_SELECTIONS * CLOCK_SECOND / sel_time));
+
+  teardown();
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(test_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  UNIT_TEST_RUN(test_mrhof);
+  UNIT_TEST_RUN(test_of0);
+  UNIT_TEST_RUN(test_benchmark);
+
+  if(!UNIT_TEST_PASSED(test_mrhof)
+      || !UNIT_TEST_PASSED(test_of0)
+      || !UNIT_TEST_PASSED(test_benchmark)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
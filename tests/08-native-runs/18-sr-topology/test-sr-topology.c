@@ -0,0 +1,262 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden AB
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Tests for the source routing topology export
+ */
+
+#include "contiki.h"
+#include "net/routing/routing.h"
+#include "net/ipv6/uip-sr.h"
+#include "sr-topology.h"
+#include "unit-test.h"
+#include <stdio.h>
+#include <string.h>
+
+PROCESS(test_process, "test");
+AUTOSTART_PROCESSES(&test_process);
+
+static uint8_t buf[256];
+static uint8_t block[256];
+static uip_ipaddr_t root_ipaddr;
+/*---------------------------------------------------------------------------*/
+static void
+node_ipaddr(uip_ipaddr_t *ipaddr, int i)
+{
+  uip_ip6addr(ipaddr, 0xfd00, 0, 0, 0, 0x200 + i, i, i, i);
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_link(int child, int parent)
+{
+  uip_ipaddr_t child_ipaddr;
+  uip_ipaddr_t parent_ipaddr;
+
+  node_ipaddr(&child_ipaddr, child);
+  if(parent == 0) {
+    uip_ipaddr_copy(&parent_ipaddr, &root_ipaddr);
+  } else {
+    node_ipaddr(&parent_ipaddr, parent);
+  }
+  uip_sr_update_node(NULL, &child_ipaddr, &parent_ipaddr, 1000);
+}
+/*---------------------------------------------------------------------------*/
+/* Tells whether the encoding has the 8-byte string of the IID of node i
+ * (the root if i is 0) at pos */
+static int
+has_iid(const uint8_t *p, int i)
+{
+  uip_ipaddr_t ipaddr;
+
+  if(i == 0) {
+    uip_ipaddr_copy(&ipaddr, &root_ipaddr);
+  } else {
+    node_ipaddr(&ipaddr, i);
+  }
+  return p[0] == 0x48 && memcmp(&p[1], &ipaddr.u8[8], 8) == 0;
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_snapshot, "Topology snapshot");
+UNIT_TEST(test_snapshot)
+{
+  int len;
+  int i;
+  int32_t offset;
+
+  UNIT_TEST_BEGIN();
+
+  /* root <- 1 <- 2 */
+  add_link(1, 0);
+  add_link(2, 1);
+  UNIT_TEST_ASSERT(uip_sr_change_seqno() == 3);
+
+  len = sr_topology_snapshot(buf, sizeof(buf), 0);
+  /* [3, prefix, [three nodes with parents]] */
+  UNIT_TEST_ASSERT(len == 1 + 1 + 9 + 1 + (9 + 1) + 2 * (9 + 9));
+  UNIT_TEST_ASSERT(buf[0] == 0x83);
+  UNIT_TEST_ASSERT(buf[1] == 0x03);
+  UNIT_TEST_ASSERT(buf[2] == 0x48 && memcmp(&buf[3], root_ipaddr.u8, 8) == 0);
+  UNIT_TEST_ASSERT(buf[11] == 0x86);
+  /* The nodes are in order of insertion, the root has no parent */
+  UNIT_TEST_ASSERT(has_iid(&buf[12], 0) && buf[21] == 0xf6);
+  UNIT_TEST_ASSERT(has_iid(&buf[22], 1) && has_iid(&buf[31], 0));
+  UNIT_TEST_ASSERT(has_iid(&buf[40], 2) && has_iid(&buf[49], 1));
+
+  /* Block-wise encoding gives the same bytes */
+  for(offset = 0; offset < len; offset += 16) {
+    memset(block, 0, sizeof(block));
+    UNIT_TEST_ASSERT(sr_topology_snapshot(block, 16, offset) == len);
+    for(i = 0; i < 16 && offset + i < len; i++) {
+      UNIT_TEST_ASSERT(block[i] == buf[offset + i]);
+    }
+  }
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_changes, "Topology changes");
+UNIT_TEST(test_changes)
+{
+  int len;
+
+  UNIT_TEST_BEGIN();
+
+  /* Up to date */
+  len = sr_topology_changes(3, buf, sizeof(buf), 0);
+  UNIT_TEST_ASSERT(len == 3);
+  UNIT_TEST_ASSERT(buf[0] == 0x82 && buf[1] == 0x04 && buf[2] == 0x80);
+
+  /* Node 2 switches to the root */
+  add_link(2, 0);
+  len = sr_topology_changes(3, buf, sizeof(buf), 0);
+  UNIT_TEST_ASSERT(len == 3 + 1 + 9 + 9);
+  UNIT_TEST_ASSERT(buf[0] == 0x82 && buf[1] == 0x04 && buf[2] == 0x83);
+  UNIT_TEST_ASSERT(buf[3] == UIP_SR_CHANGE_PARENT);
+  UNIT_TEST_ASSERT(has_iid(&buf[4], 2) && has_iid(&buf[13], 0));
+
+  /* From the start, all changes are still in the log */
+  len = sr_topology_changes(0, buf, sizeof(buf), 0);
+  UNIT_TEST_ASSERT(buf[1] == 0x01 && buf[2] == 0x8c);
+  UNIT_TEST_ASSERT(buf[3] == UIP_SR_CHANGE_ADDED);
+  UNIT_TEST_ASSERT(has_iid(&buf[4], 0) && buf[13] == 0xf6);
+
+  /* The log wraps, older changes are lost */
+  add_link(3, 2);
+  len = sr_topology_changes(0, buf, sizeof(buf), 0);
+  UNIT_TEST_ASSERT(buf[1] == 0x02 && buf[2] == 0x8c);
+  UNIT_TEST_ASSERT(uip_sr_change_get(1) == NULL);
+  UNIT_TEST_ASSERT(uip_sr_change_get(5) != NULL);
+  UNIT_TEST_ASSERT(uip_sr_change_get(6) == NULL);
+
+  /* Removing all nodes is a reset */
+  uip_sr_free_all();
+  len = sr_topology_changes(5, buf, sizeof(buf), 0);
+  UNIT_TEST_ASSERT(len == 3 + 1 + 1 + 1);
+  UNIT_TEST_ASSERT(buf[1] == 0x06 && buf[3] == UIP_SR_CHANGE_RESET);
+  UNIT_TEST_ASSERT(buf[4] == 0xf6 && buf[5] == 0xf6);
+
+  /* A client ahead of the root, e.g. after a reboot, gets a reset too */
+  len = sr_topology_changes(9, buf, sizeof(buf), 0);
+  UNIT_TEST_ASSERT(len == 3 + 1 + 1 + 1);
+  UNIT_TEST_ASSERT(buf[0] == 0x82 && buf[1] == 0x06 && buf[2] == 0x83);
+  UNIT_TEST_ASSERT(buf[3] == UIP_SR_CHANGE_RESET);
+  UNIT_TEST_ASSERT(buf[4] == 0xf6 && buf[5] == 0xf6);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_changes_blocks, "Topology changes in blocks");
+UNIT_TEST(test_changes_blocks)
+{
+  uint8_t etag[SR_TOPOLOGY_ETAG_LEN];
+  uint8_t first_etag[SR_TOPOLOGY_ETAG_LEN];
+  uint32_t since;
+  int32_t offset;
+  int len;
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  /* root <- 1 <- 2 <- 3: more changes than fit in a 64-byte block */
+  since = uip_sr_change_seqno();
+  add_link(1, 0);
+  add_link(2, 1);
+  add_link(3, 2);
+  len = sr_topology_changes(since, buf, sizeof(buf), 0);
+  UNIT_TEST_ASSERT(len == 3 + 4 * (1 + 9 + 9) - 8);
+  UNIT_TEST_ASSERT(len > 64);
+
+  /* Every block has the same bytes and the same ETag */
+  UNIT_TEST_ASSERT(sr_topology_changes_etag(since, first_etag) == SR_TOPOLOGY_ETAG_LEN);
+  for(offset = 0; offset < len; offset += 64) {
+    memset(block, 0, sizeof(block));
+    UNIT_TEST_ASSERT(sr_topology_changes(since, block, 64, offset) == len);
+    for(i = 0; i < 64 && offset + i < len; i++) {
+      UNIT_TEST_ASSERT(block[i] == buf[offset + i]);
+    }
+    sr_topology_changes_etag(since, etag);
+    UNIT_TEST_ASSERT(memcmp(etag, first_etag, SR_TOPOLOGY_ETAG_LEN) == 0);
+  }
+
+  /* A block of another list of changes, e.g. fetched with the query of an
+   * observe registration after the first block of a notification, or after
+   * a new change, has another ETag */
+  sr_topology_changes_etag(since + 1, etag);
+  UNIT_TEST_ASSERT(memcmp(etag, first_etag, SR_TOPOLOGY_ETAG_LEN) != 0);
+  sr_topology_snapshot_etag(block);
+  add_link(3, 1);
+  sr_topology_changes_etag(since, etag);
+  UNIT_TEST_ASSERT(memcmp(etag, first_etag, SR_TOPOLOGY_ETAG_LEN) != 0);
+
+  /* So does a snapshot after a change */
+  sr_topology_snapshot_etag(etag);
+  UNIT_TEST_ASSERT(memcmp(etag, block, SR_TOPOLOGY_ETAG_LEN) != 0);
+
+  /* A client ahead of the root gets another ETag than an up to date one */
+  sr_topology_changes_etag(uip_sr_change_seqno(), first_etag);
+  sr_topology_changes_etag(uip_sr_change_seqno() + 1, etag);
+  UNIT_TEST_ASSERT(memcmp(etag, first_etag, SR_TOPOLOGY_ETAG_LEN) != 0);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(test_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  /* Start a DAG without waiting, only the graph is used */
+  NETSTACK_ROUTING.root_set_prefix(NULL, NULL);
+  NETSTACK_ROUTING.root_start();
+  NETSTACK_ROUTING.get_root_ipaddr(&root_ipaddr);
+
+  UNIT_TEST_RUN(test_snapshot);
+  UNIT_TEST_RUN(test_changes);
+  UNIT_TEST_RUN(test_changes_blocks);
+
+  if(!UNIT_TEST_PASSED(test_snapshot)
+      || !UNIT_TEST_PASSED(test_changes)
+      || !UNIT_TEST_PASSED(test_changes_blocks)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
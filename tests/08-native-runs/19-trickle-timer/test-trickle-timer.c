@@ -0,0 +1,340 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden AB
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Tests and benchmark for the shared trickle timer scheduler
+ */
+
+#include "contiki.h"
+#include "lib/trickle-timer.h"
+#include "lib/random.h"
+#include "sys/ctimer.h"
+#include "unit-test.h"
+#include <stdio.h>
+#include <string.h>
+
+#define NUM_TIMERS 32
+#define IMIN 20
+#define IMAX 3
+#define RUN_TIME (2 * CLOCK_SECOND)
+#define AFTER_RESET_TIME (IMIN * 2)
+/* Imin, 2 Imin, 4 Imin, then Imax until RUN_TIME */
+#define MIN_FIRES (3 + (RUN_TIME - 7 * IMIN) / (IMIN << IMAX) - 1)
+/* How long to wait for the scheduler on a loaded host */
+#define MAX_LAG (10 * CLOCK_SECOND)
+
+#define BENCHMARK_TIMERS 256
+#define BENCHMARK_OPS 200000
+#define BENCHMARK_IMIN (CLOCK_SECOND * 1000)
+
+PROCESS(test_process, "test");
+AUTOSTART_PROCESSES(&test_process);
+
+static struct trickle_timer timers[NUM_TIMERS];
+static struct {
+  uint16_t fires;
+  uint16_t suppressed;
+  uint16_t bad_t;
+  uint16_t bad_i;
+  uint16_t bad_start;
+  clock_time_t last_fire;
+  clock_time_t last_start;
+  clock_time_t first_i;
+} stats[NUM_TIMERS];
+
+static struct trickle_timer bench_timers[BENCHMARK_TIMERS];
+static struct ctimer bench_ctimers[BENCHMARK_TIMERS];
+/*---------------------------------------------------------------------------*/
+static void
+tx(void *ptr, uint8_t suppress)
+{
+  struct trickle_timer *tt = ptr;
+  int i = tt - timers;
+  clock_time_t now = clock_time();
+  clock_time_t t = tt->expiration - tt->i_start;
+
+  stats[i].fires++;
+  stats[i].last_fire = now;
+  if(stats[i].first_i == 0) {
+    stats[i].first_i = tt->i_cur;
+  }
+  if(suppress == TRICKLE_TIMER_TX_SUPPRESS) {
+    stats[i].suppressed++;
+  }
+
+  /*
+   * t must be in [I/2, I) and we must not be early. How late we are depends
+   * on the host's load, so that is not checked.
+   */
+  if(t < tt->i_cur / 2 || t >= tt->i_cur || CLOCK_LT(now, tt->expiration)) {
+    stats[i].bad_t++;
+  }
+
+  /* The interval callback was told about this interval */
+  if(stats[i].last_start != tt->i_start) {
+    stats[i].bad_start++;
+  }
+
+  /* I must be a power-of-two multiple of Imin, and at most Imax */
+  if(tt->i_cur < tt->i_min || tt->i_cur > TRICKLE_TIMER_INTERVAL_MAX(tt) ||
+     (tt->i_cur / tt->i_min) & ((tt->i_cur / tt->i_min) - 1)) {
+    stats[i].bad_i++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+interval_started(void *ptr)
+{
+  struct trickle_timer *tt = ptr;
+
+  stats[tt - timers].last_start = tt->i_start;
+}
+/*---------------------------------------------------------------------------*/
+static void
+start_timers(void)
+{
+  int i;
+
+  memset(stats, 0, sizeof(stats));
+  for(i = 0; i < NUM_TIMERS; i++) {
+    /* Timers 0-3 suppress once they hear a single consistent message */
+    trickle_timer_config(&timers[i], IMIN, IMAX,
+                         i < 4 ? 1 : TRICKLE_TIMER_INFINITE_REDUNDANCY);
+    trickle_timer_set_interval_callback(&timers[i], interval_started);
+    trickle_timer_set_at_imin(&timers[i], tx, &timers[i]);
+  }
+  trickle_timer_consistency(&timers[0]);
+  trickle_timer_consistency(&timers[1]);
+}
+/*---------------------------------------------------------------------------*/
+static int
+intervals_done(void)
+{
+  int i;
+
+  for(i = 0; i < NUM_TIMERS; i++) {
+    if(stats[i].fires < MIN_FIRES) {
+      return 0;
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_intervals, "Intervals and time t");
+UNIT_TEST(test_intervals)
+{
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  for(i = 0; i < NUM_TIMERS; i++) {
+    UNIT_TEST_ASSERT(stats[i].bad_t == 0);
+    UNIT_TEST_ASSERT(stats[i].bad_i == 0);
+    UNIT_TEST_ASSERT(stats[i].bad_start == 0);
+    UNIT_TEST_ASSERT(stats[i].fires >= MIN_FIRES);
+    UNIT_TEST_ASSERT(timers[i].i_cur == TRICKLE_TIMER_INTERVAL_MAX(&timers[i]));
+  }
+
+  /* The consistent message suppressed exactly the first transmission */
+  UNIT_TEST_ASSERT(stats[0].suppressed == 1);
+  UNIT_TEST_ASSERT(stats[1].suppressed == 1);
+  UNIT_TEST_ASSERT(stats[2].suppressed == 0);
+  UNIT_TEST_ASSERT(stats[3].suppressed == 0);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t fires_at_reset[NUM_TIMERS];
+
+static void
+reset_timers(void)
+{
+  int i;
+
+  for(i = 0; i < NUM_TIMERS; i++) {
+    fires_at_reset[i] = stats[i].fires;
+    stats[i].first_i = 0;
+    if(i & 1) {
+      trickle_timer_stop(&timers[i]);
+    } else {
+      trickle_timer_inconsistency(&timers[i]);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+reset_done(void)
+{
+  int i;
+
+  for(i = 0; i < NUM_TIMERS; i += 2) {
+    if(stats[i].fires == fires_at_reset[i]) {
+      return 0;
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_reset, "Inconsistency and stop");
+UNIT_TEST(test_reset)
+{
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  for(i = 0; i < NUM_TIMERS; i++) {
+    if(i & 1) {
+      /* Stopped timers never fire again */
+      UNIT_TEST_ASSERT(!trickle_timer_is_running(&timers[i]));
+      UNIT_TEST_ASSERT(stats[i].fires == fires_at_reset[i]);
+    } else {
+      /* Reset timers fired again, starting over with an Imin interval */
+      UNIT_TEST_ASSERT(stats[i].fires > fires_at_reset[i]);
+      UNIT_TEST_ASSERT(stats[i].bad_t == 0);
+      UNIT_TEST_ASSERT(stats[i].bad_start == 0);
+      UNIT_TEST_ASSERT(stats[i].first_i == IMIN);
+    }
+    trickle_timer_stop(&timers[i]);
+  }
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+static void
+nop(void *ptr)
+{
+}
+/*---------------------------------------------------------------------------*/
+static void
+bench_tx(void *ptr, uint8_t suppress)
+{
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_benchmark, "Trickle scheduler benchmark");
+UNIT_TEST(test_benchmark)
+{
+  clock_time_t start;
+  clock_time_t tt_time;
+  clock_time_t ct_time;
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  printf("RAM: %u bytes per trickle timer, %u bytes per ctimer\n",
+         (unsigned)sizeof(struct trickle_timer),
+         (unsigned)sizeof(struct ctimer));
+
+  /* Far away intervals: nothing fires during the benchmark */
+  for(i = 0; i < BENCHMARK_TIMERS; i++) {
+    trickle_timer_config(&bench_timers[i], BENCHMARK_IMIN, 4, 0);
+    trickle_timer_set(&bench_timers[i], bench_tx, NULL);
+    ctimer_set(&bench_ctimers[i], BENCHMARK_IMIN + random_rand(), nop, NULL);
+  }
+
+  /* Re-arm random timers, as on inconsistencies */
+  start = clock_time();
+  for(i = 0; i < BENCHMARK_OPS; i++) {
+    trickle_timer_set(&bench_timers[random_rand() % BENCHMARK_TIMERS],
+                      bench_tx, NULL);
+  }
+  tt_time = MAX(clock_time() - start, 1);
+
+  start = clock_time();
+  for(i = 0; i < BENCHMARK_OPS; i++) {
+    ctimer_set(&bench_ctimers[random_rand() % BENCHMARK_TIMERS],
+               BENCHMARK_IMIN + random_rand(), nop, NULL);
+  }
+  ct_time = MAX(clock_time() - start, 1);
+
+  printf("Shared trickle scheduler: %lu updates/s with %u timers\n",
+         (unsigned long)((uint64_t)BENCHMARK_OPS * CLOCK_SECOND / tt_time),
+         BENCHMARK_TIMERS);
+  printf("One ctimer per timer: %lu updates/s with %u timers\n",
+         (unsigned long)((uint64_t)BENCHMARK_OPS * CLOCK_SECOND / ct_time),
+         BENCHMARK_TIMERS);
+
+  for(i = 0; i < BENCHMARK_TIMERS; i++) {
+    UNIT_TEST_ASSERT(trickle_timer_is_running(&bench_timers[i]));
+    trickle_timer_stop(&bench_timers[i]);
+    UNIT_TEST_ASSERT(!trickle_timer_is_running(&bench_timers[i]));
+    ctimer_stop(&bench_ctimers[i]);
+  }
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(test_process, ev, data)
+{
+  static struct etimer et;
+  static clock_time_t waited;
+
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  start_timers();
+  etimer_set(&et, RUN_TIME);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+  /* The scheduler's ctimer may run after our etimer if the host is busy */
+  for(waited = 0; waited < MAX_LAG && !intervals_done(); waited += IMIN) {
+    etimer_set(&et, IMIN);
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+  }
+  UNIT_TEST_RUN(test_intervals);
+
+  reset_timers();
+  etimer_set(&et, AFTER_RESET_TIME);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+  for(waited = 0; waited < MAX_LAG && !reset_done(); waited += IMIN) {
+    etimer_set(&et, IMIN);
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+  }
+  UNIT_TEST_RUN(test_reset);
+
+  UNIT_TEST_RUN(test_benchmark);
+
+  if(!UNIT_TEST_PASSED(test_intervals)
+      || !UNIT_TEST_PASSED(test_reset)
+      || !UNIT_TEST_PASSED(test_benchmark)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden AB
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Tests for the link-stats window of recent samples
+ */
+
+#include "contiki.h"
+#include "net/link-stats.h"
+#include "net/mac/mac.h"
+#include "net/packetbuf.h"
+#include "unit-test.h"
+#include <stdio.h>
+#include <string.h>
+
+#define DIV LINK_STATS_ETX_DIVISOR
+
+PROCESS(test_process, "test");
+AUTOSTART_PROCESSES(&test_process);
+
+static linkaddr_t addr_stable;
+static linkaddr_t addr_oscillating;
+static linkaddr_t addr_lossy;
+static linkaddr_t addr_extreme;
+/*---------------------------------------------------------------------------*/
+static void
+make_addr(linkaddr_t *addr, uint8_t id)
+{
+  memset(addr, 0, sizeof(*addr));
+  addr->u8[LINKADDR_SIZE - 1] = id;
+}
+/*---------------------------------------------------------------------------*/
+static int
+window_of(const linkaddr_t *addr, struct link_stats_window *window)
+{
+  return link_stats_get_window(link_stats_from_lladdr(addr), window);
+}
+/*---------------------------------------------------------------------------*/
+static void
+receive(const linkaddr_t *addr, int16_t rssi)
+{
+  packetbuf_clear();
+  packetbuf_set_attr(PACKETBUF_ATTR_RSSI, rssi);
+  link_stats_input_callback(addr);
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_mean_variance, "Windowed ETX mean and variance");
+UNIT_TEST(test_mean_variance)
+{
+  struct link_stats_window window;
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  for(i = 0; i < LINK_STATS_WINDOW_SIZE; i++) {
+    link_stats_packet_sent(&addr_stable, MAC_TX_OK, 2);
+    link_stats_packet_sent(&addr_oscillating, MAC_TX_OK, i % 2 ? 1 : 3);
+  }
+
+  /* Same mean, different variance */
+  UNIT_TEST_ASSERT(window_of(&addr_stable, &window) == LINK_STATS_WINDOW_SIZE);
+  UNIT_TEST_ASSERT(window.etx == 2 * DIV);
+  UNIT_TEST_ASSERT(window.etx_variance == 0);
+  UNIT_TEST_ASSERT(window.pdr == 100);
+
+  UNIT_TEST_ASSERT(window_of(&addr_oscillating, &window) == LINK_STATS_WINDOW_SIZE);
+  UNIT_TEST_ASSERT(window.etx == 2 * DIV);
+  UNIT_TEST_ASSERT(window.etx_variance == 1 * DIV);
+  UNIT_TEST_ASSERT(window.pdr == 100);
+
+  /* Older samples fall out of the window */
+  for(i = 0; i < LINK_STATS_WINDOW_SIZE; i++) {
+    link_stats_packet_sent(&addr_oscillating, MAC_TX_OK, 1);
+  }
+  UNIT_TEST_ASSERT(window_of(&addr_oscillating, &window) == LINK_STATS_WINDOW_SIZE);
+  UNIT_TEST_ASSERT(window.etx == 1 * DIV);
+  UNIT_TEST_ASSERT(window.etx_variance == 0);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_delivery, "Windowed delivery ratio");
+UNIT_TEST(test_delivery)
+{
+  struct link_stats_window window;
+
+  UNIT_TEST_BEGIN();
+
+  /* Unknown neighbors are not added on failed transmissions */
+  link_stats_packet_sent(&addr_lossy, MAC_TX_NOACK, 1);
+  UNIT_TEST_ASSERT(window_of(&addr_lossy, &window) == 0);
+  UNIT_TEST_ASSERT(window.rssi == LINK_STATS_RSSI_UNKNOWN);
+
+  link_stats_packet_sent(&addr_lossy, MAC_TX_OK, 1);
+  link_stats_packet_sent(&addr_lossy, MAC_TX_OK, 1);
+  link_stats_packet_sent(&addr_lossy, MAC_TX_NOACK, 1);
+  link_stats_packet_sent(&addr_lossy, MAC_TX_NOACK, 1);
+  /* Neither collisions nor queue drops are link outcomes */
+  link_stats_packet_sent(&addr_lossy, MAC_TX_COLLISION, 1);
+  link_stats_packet_sent(&addr_lossy, MAC_TX_QUEUE_FULL, 1);
+
+  /* Samples of 1, 1, 13 and 13 transmissions, the no-ACK penalty included */
+  UNIT_TEST_ASSERT(window_of(&addr_lossy, &window) == 4);
+  UNIT_TEST_ASSERT(window.tx_samples == 4);
+  UNIT_TEST_ASSERT(window.pdr == 50);
+  UNIT_TEST_ASSERT(window.etx == 7 * DIV);
+  UNIT_TEST_ASSERT(window.etx_variance == 36 * DIV);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_rssi, "Windowed RSSI");
+UNIT_TEST(test_rssi)
+{
+  struct link_stats_window window;
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  receive(&addr_lossy, -70);
+  receive(&addr_lossy, -80);
+  receive(&addr_lossy, -90);
+  window_of(&addr_lossy, &window);
+  UNIT_TEST_ASSERT(window.rssi_samples == 3);
+  UNIT_TEST_ASSERT(window.rssi == -80);
+
+  for(i = 0; i < LINK_STATS_WINDOW_SIZE; i++) {
+    receive(&addr_lossy, -60);
+  }
+  window_of(&addr_lossy, &window);
+  UNIT_TEST_ASSERT(window.rssi_samples == LINK_STATS_WINDOW_SIZE);
+  UNIT_TEST_ASSERT(window.rssi == -60);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_saturation, "Variance saturation");
+UNIT_TEST(test_saturation)
+{
+  struct link_stats_window window;
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  link_stats_packet_sent(&addr_extreme, MAC_TX_OK, 1);
+  for(i = 1; i < LINK_STATS_WINDOW_SIZE; i++) {
+    link_stats_packet_sent(&addr_extreme, i % 2 ? MAC_TX_NOACK : MAC_TX_OK,
+                           i % 2 ? 200 : 1);
+  }
+
+  UNIT_TEST_ASSERT(window_of(&addr_extreme, &window) == LINK_STATS_WINDOW_SIZE);
+  UNIT_TEST_ASSERT(window.pdr == 50);
+  UNIT_TEST_ASSERT(window.etx_variance == 0xffff);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(test_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  make_addr(&addr_stable, 1);
+  make_addr(&addr_oscillating, 2);
+  make_addr(&addr_lossy, 3);
+  make_addr(&addr_extreme, 4);
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  UNIT_TEST_RUN(test_mean_variance);
+  UNIT_TEST_RUN(test_delivery);
+  UNIT_TEST_RUN(test_rssi);
+  UNIT_TEST_RUN(test_saturation);
+
+  if(!UNIT_TEST_PASSED(test_mean_variance)
+      || !UNIT_TEST_PASSED(test_delivery)
+      || !UNIT_TEST_PASSED(test_rssi)
+      || !UNIT_TEST_PASSED(test_saturation)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
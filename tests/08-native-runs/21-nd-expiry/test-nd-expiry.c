@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden AB
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Tests for the neighbor unreachability detection expiry queue
+ */
+
+#include "contiki.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/ipv6/uip-ds6-nbr.h"
+#include "unit-test.h"
+#include <stdio.h>
+#include <string.h>
+
+#define NUM_NBRS 16
+#define BENCHMARK_RUNS 100000
+
+PROCESS(test_process, "test");
+AUTOSTART_PROCESSES(&test_process);
+
+static uip_ipaddr_t ipaddrs[NUM_NBRS];
+static uip_lladdr_t lladdrs[NUM_NBRS];
+/*---------------------------------------------------------------------------*/
+static uip_ds6_nbr_t *
+nbr_of(int i)
+{
+  return uip_ds6_nbr_lookup(&ipaddrs[i]);
+}
+/*---------------------------------------------------------------------------*/
+static int
+state_of(int i)
+{
+  uip_ds6_nbr_t *nbr = nbr_of(i);
+  return nbr != NULL ? nbr->state : -1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_neighbors(void)
+{
+  int i;
+
+  for(i = 0; i < NUM_NBRS; i++) {
+    uip_ip6addr(&ipaddrs[i], 0xfe80, 0, 0, 0, 0, 0, 0, i + 1);
+    memset(&lladdrs[i], 0, sizeof(lladdrs[i]));
+    lladdrs[i].addr[sizeof(lladdrs[i].addr) - 1] = i + 1;
+    uip_ds6_nbr_add(&ipaddrs[i], &lladdrs[i], 0,
+                    i == NUM_NBRS - 1 ? NBR_INCOMPLETE : NBR_REACHABLE,
+                    NBR_TABLE_REASON_UNDEFINED, NULL);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+confirm(int i)
+{
+  uip_ds6_nbr_confirm_reachable((const linkaddr_t *)&lladdrs[i]);
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_confirmed, "Confirmed neighbors stay reachable");
+UNIT_TEST(test_confirmed)
+{
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  /* The first half was confirmed mid-way through the reachable time */
+  for(i = 0; i < NUM_NBRS / 2; i++) {
+    UNIT_TEST_ASSERT(state_of(i) == NBR_REACHABLE);
+  }
+  for(; i < NUM_NBRS - 1; i++) {
+    UNIT_TEST_ASSERT(state_of(i) == NBR_STALE);
+  }
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_requeue, "Stale neighbors are requeued when confirmed");
+UNIT_TEST(test_requeue)
+{
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  /* Confirmed from STALE, should be the only reachable ones */
+  UNIT_TEST_ASSERT(state_of(NUM_NBRS / 2) == NBR_REACHABLE);
+  UNIT_TEST_ASSERT(state_of(NUM_NBRS / 2 + 1) == NBR_REACHABLE);
+  for(i = 0; i < NUM_NBRS / 2; i++) {
+    UNIT_TEST_ASSERT(state_of(i) == NBR_STALE);
+  }
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_remove, "Incomplete and removed neighbors");
+UNIT_TEST(test_remove)
+{
+  UNIT_TEST_BEGIN();
+
+  /* Confirmation does not apply to INCOMPLETE entries; removing queued
+   * entries must leave the queue consistent */
+  UNIT_TEST_ASSERT(state_of(NUM_NBRS - 1) == NBR_INCOMPLETE
+                   || state_of(NUM_NBRS - 1) == -1);
+  uip_ds6_nbr_rm(nbr_of(NUM_NBRS / 2));
+  uip_ds6_neighbor_periodic();
+  UNIT_TEST_ASSERT(nbr_of(NUM_NBRS / 2) == NULL);
+  UNIT_TEST_ASSERT(state_of(NUM_NBRS / 2 + 1) == NBR_REACHABLE);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_benchmark, "Periodic processing benchmark");
+UNIT_TEST(test_benchmark)
+{
+  clock_time_t start;
+  clock_time_t duration;
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  for(i = 0; i < NUM_NBRS; i++) {
+    if(nbr_of(i) == NULL) {
+      uip_ds6_nbr_add(&ipaddrs[i], &lladdrs[i], 0, NBR_REACHABLE,
+                      NBR_TABLE_REASON_UNDEFINED, NULL);
+    } else {
+      confirm(i);
+    }
+  }
+
+  start = clock_time();
+  for(i = 0; i < BENCHMARK_RUNS; i++) {
+    uip_ds6_neighbor_periodic();
+  }
+  duration = clock_time() - start;
+  printf("Periodic processing with %u neighbors: %lu runs/s\n",
+         uip_ds6_nbr_num(), (unsigned long)
+         ((uint64_t)BENCHMARK_RUNS * CLOCK_SECOND / MAX(duration, 1)));
+
+  /* Nothing expired: all but the INCOMPLETE neighbor stay reachable */
+  for(i = 0; i < NUM_NBRS - 1; i++) {
+    UNIT_TEST_ASSERT(state_of(i) == NBR_REACHABLE);
+  }
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(test_process, ev, data)
+{
+  static struct etimer et;
+  int i;
+
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  add_neighbors();
+
+  /* Confirm half of the neighbors after 2s, check after 4s: the others
+   * have exceeded their reachable time of 3s, these have not */
+  etimer_set(&et, 2 * CLOCK_SECOND);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+  for(i = 0; i < NUM_NBRS / 2; i++) {
+    confirm(i);
+  }
+  confirm(NUM_NBRS - 1);
+  etimer_set(&et, 2 * CLOCK_SECOND);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+  uip_ds6_neighbor_periodic();
+  UNIT_TEST_RUN(test_confirmed);
+
+  /* Confirm two stale neighbors, let all others expire */
+  confirm(NUM_NBRS / 2);
+  confirm(NUM_NBRS / 2 + 1);
+  etimer_set(&et, 2 * CLOCK_SECOND);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+  uip_ds6_neighbor_periodic();
+  UNIT_TEST_RUN(test_requeue);
+
+  UNIT_TEST_RUN(test_remove);
+  UNIT_TEST_RUN(test_benchmark);
+
+  if(!UNIT_TEST_PASSED(test_confirmed)
+      || !UNIT_TEST_PASSED(test_requeue)
+      || !UNIT_TEST_PASSED(test_remove)
+      || !UNIT_TEST_PASSED(test_benchmark)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,398 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden AB
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         CoAP client load test: NSTART window and CoCoA retransmission
+ *         timeouts, with the CoAP engine serving as client and servers
+ *         over a simulated lossy link
+ */
+
+#include "contiki.h"
+#include "coap-engine.h"
+#include "coap-callback-api.h"
+#include "coap-transport.h"
+#include "unit-test.h"
+#include <stdio.h>
+#include <string.h>
+
+#define NUM_SERVERS        4
+#define STATES_PER_SERVER  8
+#define NUM_STATES         (NUM_SERVERS * STATES_PER_SERVER)
+#define NUM_REQUESTS       400
+#define LINK_DELAY         (20 * CLOCK_SECOND / 1000) /* one way */
+#define LOSS_INTERVAL      10 /* every tenth request is lost */
+#define MAX_PACKETS        64
+#define RUN_TIMEOUT        (60 * CLOCK_SECOND)
+
+PROCESS(test_process, "test");
+AUTOSTART_PROCESSES(&test_process);
+
+/*- Simulated link ----------------------------------------------------------*/
+typedef struct {
+  coap_endpoint_t src;
+  coap_endpoint_t dst;
+  clock_time_t deliver_at;
+  uint16_t len;
+  uint8_t used;
+  uint8_t data[COAP_MAX_PACKET_SIZE];
+} packet_t;
+
+static packet_t packets[MAX_PACKETS];
+static uint8_t databuf[COAP_MAX_PACKET_SIZE + 1];
+static coap_endpoint_t client_ep;
+static coap_endpoint_t server_eps[NUM_SERVERS];
+/* the endpoint the engine is currently sending as */
+static const coap_endpoint_t *local_ep = &client_ep;
+
+static uint32_t sent_requests;
+static uint32_t lost_requests;
+static uint32_t dropped_packets;
+
+/* MIDs of requests in flight per server, to check the NSTART window */
+static uint16_t window[NUM_SERVERS][COAP_MAX_OPEN_TRANSACTIONS];
+static uint8_t window_len[NUM_SERVERS];
+static uint8_t window_max[NUM_SERVERS];
+/*---------------------------------------------------------------------------*/
+static int
+server_index(const coap_endpoint_t *ep)
+{
+  int i;
+
+  for(i = 0; i < NUM_SERVERS; i++) {
+    if(coap_endpoint_cmp(ep, &server_eps[i])) {
+      return i;
+    }
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+window_add(int s, uint16_t mid)
+{
+  int i;
+
+  for(i = 0; i < window_len[s]; i++) {
+    if(window[s][i] == mid) {
+      /* retransmission */
+      return;
+    }
+  }
+  window[s][window_len[s]++] = mid;
+  window_max[s] = MAX(window_max[s], window_len[s]);
+}
+/*---------------------------------------------------------------------------*/
+static void
+window_remove(int s, uint16_t mid)
+{
+  int i;
+
+  for(i = 0; i < window_len[s]; i++) {
+    if(window[s][i] == mid) {
+      window[s][i] = window[s][--window_len[s]];
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+deliver_packets(void)
+{
+  static uint8_t buf[COAP_MAX_PACKET_SIZE];
+  static coap_endpoint_t src;
+  static coap_endpoint_t dst;
+  clock_time_t now = clock_time();
+  uint16_t len;
+  int s;
+  int i;
+
+  for(i = 0; i < MAX_PACKETS; i++) {
+    if(!packets[i].used || CLOCK_LT(now, packets[i].deliver_at)) {
+      continue;
+    }
+    /* free the slot first, the receiver may send right away */
+    coap_endpoint_copy(&src, &packets[i].src);
+    coap_endpoint_copy(&dst, &packets[i].dst);
+    len = packets[i].len;
+    memcpy(buf, packets[i].data, len);
+    packets[i].used = 0;
+
+    s = server_index(&src);
+    if(s >= 0 && ((buf[0] >> 4) & 0x3) == COAP_TYPE_ACK) {
+      window_remove(s, (buf[2] << 8) | buf[3]);
+    }
+
+    local_ep = &dst;
+    coap_receive(&src, buf, len);
+    local_ep = &client_ep;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/*- Transport ---------------------------------------------------------------*/
+/*---------------------------------------------------------------------------*/
+void
+coap_endpoint_copy(coap_endpoint_t *destination, const coap_endpoint_t *from)
+{
+  memcpy(destination, from, sizeof(coap_endpoint_t));
+}
+/*---------------------------------------------------------------------------*/
+int
+coap_endpoint_cmp(const coap_endpoint_t *e1, const coap_endpoint_t *e2)
+{
+  return uip_ipaddr_cmp(&e1->ipaddr, &e2->ipaddr) && e1->port == e2->port;
+}
+/*---------------------------------------------------------------------------*/
+int
+coap_endpoint_is_reliable(const coap_endpoint_t *ep)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+coap_endpoint_log(const coap_endpoint_t *ep)
+{
+}
+/*---------------------------------------------------------------------------*/
+void
+coap_endpoint_print(const coap_endpoint_t *ep)
+{
+}
+/*---------------------------------------------------------------------------*/
+uint8_t *
+coap_databuf(void)
+{
+  return databuf;
+}
+/*---------------------------------------------------------------------------*/
+void
+coap_transport_init(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+int
+coap_sendto(const coap_endpoint_t *ep, const uint8_t *data, uint16_t length)
+{
+  int s;
+  int i;
+
+  s = server_index(ep);
+  if(s >= 0 && ((data[0] >> 4) & 0x3) == COAP_TYPE_CON
+     && data[1] >= COAP_GET && data[1] <= COAP_DELETE) {
+    window_add(s, (data[2] << 8) | data[3]);
+    if(++sent_requests % LOSS_INTERVAL == 0) {
+      lost_requests++;
+      return length;
+    }
+  }
+
+  for(i = 0; i < MAX_PACKETS; i++) {
+    if(!packets[i].used) {
+      coap_endpoint_copy(&packets[i].src, local_ep);
+      coap_endpoint_copy(&packets[i].dst, ep);
+      packets[i].deliver_at = clock_time() + LINK_DELAY;
+      packets[i].len = MIN(length, sizeof(packets[i].data));
+      memcpy(packets[i].data, data, packets[i].len);
+      packets[i].used = 1;
+      return length;
+    }
+  }
+  dropped_packets++;
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+/*- Server ------------------------------------------------------------------*/
+/*---------------------------------------------------------------------------*/
+static void
+res_load_get_handler(coap_message_t *request, coap_message_t *response,
+                     uint8_t *buffer, uint16_t preferred_size,
+                     int32_t *offset)
+{
+  coap_set_header_content_format(response, TEXT_PLAIN);
+  coap_set_payload(response, buffer,
+                   snprintf((char *)buffer, preferred_size, "load"));
+}
+RESOURCE(res_load, "title=\"Load\"", res_load_get_handler, NULL, NULL, NULL);
+/*---------------------------------------------------------------------------*/
+/*- Client ------------------------------------------------------------------*/
+/*---------------------------------------------------------------------------*/
+static coap_callback_request_state_t states[NUM_STATES];
+static coap_message_t requests[NUM_STATES];
+static uint32_t issued;
+static uint32_t completed;
+static uint32_t bad_responses;
+static uint32_t timeouts;
+static clock_time_t load_time;
+
+static void response_callback(coap_callback_request_state_t *callback_state);
+/*---------------------------------------------------------------------------*/
+static void
+issue_request(int i)
+{
+  if(issued >= NUM_REQUESTS) {
+    return;
+  }
+  issued++;
+  coap_init_message(&requests[i], COAP_TYPE_CON, COAP_GET, 0);
+  coap_set_header_uri_path(&requests[i], "test/load");
+  coap_send_request(&states[i], &server_eps[i % NUM_SERVERS], &requests[i],
+                    response_callback);
+}
+/*---------------------------------------------------------------------------*/
+static void
+response_callback(coap_callback_request_state_t *callback_state)
+{
+  coap_request_state_t *state = &callback_state->state;
+
+  switch(state->status) {
+  case COAP_REQUEST_STATUS_RESPONSE:
+    if(state->response->code == CONTENT_2_05
+       && state->response->payload_len == 4
+       && memcmp(state->response->payload, "load", 4) == 0) {
+      completed++;
+    } else {
+      bad_responses++;
+    }
+    break;
+  case COAP_REQUEST_STATUS_TIMEOUT:
+    timeouts++;
+    issue_request(callback_state - states);
+    break;
+  case COAP_REQUEST_STATUS_FINISHED:
+    issue_request(callback_state - states);
+    break;
+  default:
+    bad_responses++;
+    break;
+  }
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_load, "Request load with NSTART window");
+UNIT_TEST(test_load)
+{
+  int s;
+
+  UNIT_TEST_BEGIN();
+
+  printf("%lu requests in %lu ms: %lu requests/s, %lu of %lu requests lost\n",
+         (unsigned long)completed,
+         (unsigned long)(load_time * 1000 / CLOCK_SECOND),
+         (unsigned long)(completed * CLOCK_SECOND / MAX(load_time, 1)),
+         (unsigned long)lost_requests, (unsigned long)sent_requests);
+
+  UNIT_TEST_ASSERT(completed == NUM_REQUESTS);
+  UNIT_TEST_ASSERT(bad_responses == 0);
+  UNIT_TEST_ASSERT(timeouts == 0);
+  UNIT_TEST_ASSERT(dropped_packets == 0);
+  UNIT_TEST_ASSERT(lost_requests > 0);
+
+  for(s = 0; s < NUM_SERVERS; s++) {
+    /* parallel requests were used, but never more than NSTART */
+    UNIT_TEST_ASSERT(window_max[s] == COAP_NSTART);
+    UNIT_TEST_ASSERT(window_len[s] == 0);
+  }
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_rto, "CoCoA RTO estimates");
+UNIT_TEST(test_rto)
+{
+  uint32_t rto;
+  int s;
+
+  UNIT_TEST_BEGIN();
+
+  for(s = 0; s < NUM_SERVERS; s++) {
+    rto = coap_get_peer_rto(&server_eps[s]);
+    printf("Server %d: RTO %lu ms (RTT %lu ms)\n", s, (unsigned long)rto,
+           (unsigned long)(2 * LINK_DELAY * 1000 / CLOCK_SECOND));
+    /* converged from the default towards the link RTT */
+    UNIT_TEST_ASSERT(rto >= 2 * LINK_DELAY * 1000 / CLOCK_SECOND);
+    UNIT_TEST_ASSERT(rto < COAP_RESPONSE_TIMEOUT_TICKS / 4);
+  }
+
+  /* unknown endpoints get the default timeout */
+  UNIT_TEST_ASSERT(coap_get_peer_rto(&client_ep) ==
+                   COAP_RESPONSE_TIMEOUT_TICKS);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(test_process, ev, data)
+{
+  static struct etimer et;
+  static clock_time_t start;
+  int i;
+
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  uip_ip6addr(&client_ep.ipaddr, 0xfd00, 0, 0, 0, 0, 0, 0, 0x100);
+  client_ep.port = UIP_HTONS(COAP_DEFAULT_PORT);
+  for(i = 0; i < NUM_SERVERS; i++) {
+    uip_ip6addr(&server_eps[i].ipaddr, 0xfd00, 0, 0, 0, 0, 0, 0, i + 1);
+    server_eps[i].port = UIP_HTONS(COAP_DEFAULT_PORT);
+  }
+
+  coap_engine_init();
+  coap_activate_resource(&res_load, "test/load");
+
+  start = clock_time();
+  for(i = 0; i < NUM_STATES; i++) {
+    issue_request(i);
+  }
+  while(completed + timeouts < NUM_REQUESTS
+        && clock_time() - start < RUN_TIMEOUT) {
+    deliver_packets();
+    etimer_set(&et, 1);
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+  }
+  load_time = clock_time() - start;
+
+  UNIT_TEST_RUN(test_load);
+  UNIT_TEST_RUN(test_rto);
+
+  if(!UNIT_TEST_PASSED(test_load) ||
+     !UNIT_TEST_PASSED(test_rto)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
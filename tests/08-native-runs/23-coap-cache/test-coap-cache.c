@@ -0,0 +1,274 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden AB
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         CoAP response cache: fresh hits, revalidation with ETags,
+ *         invalidation, expiry and the memory budget
+ */
+
+#include "contiki.h"
+#include "coap.h"
+#include "coap-cache.h"
+#include "unit-test.h"
+#include <stdio.h>
+#include <string.h>
+
+PROCESS(test_process, "test");
+AUTOSTART_PROCESSES(&test_process);
+
+static coap_message_t request[1];
+static coap_message_t response[1];
+static uint8_t large[150];
+static coap_endpoint_t secure_ep = { .secure = true };
+/*---------------------------------------------------------------------------*/
+static void
+make_request(coap_method_t method, const char *path)
+{
+  coap_init_message(request, COAP_TYPE_CON, method, 1);
+  coap_set_header_uri_path(request, path);
+}
+/*---------------------------------------------------------------------------*/
+static void
+make_response(coap_status_t code, uint32_t max_age, const void *payload,
+              size_t len)
+{
+  coap_init_message(response, COAP_TYPE_ACK, code, 1);
+  if(max_age > 0) {
+    coap_set_header_max_age(response, max_age);
+  }
+  coap_set_payload(response, payload, len);
+}
+/*---------------------------------------------------------------------------*/
+static int
+cached(const char *path)
+{
+  make_request(COAP_GET, path);
+  coap_init_message(response, COAP_TYPE_ACK, CONTENT_2_05, 1);
+  return coap_cache_respond(request, response);
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_hit, "Fresh hits and revalidation");
+UNIT_TEST(test_hit)
+{
+  const uint8_t *payload;
+  uint8_t etag[COAP_ETAG_LEN];
+  uint8_t etag_len;
+  uint32_t max_age;
+
+  UNIT_TEST_BEGIN();
+
+  /* responses without Max-Age are not cached */
+  make_request(COAP_GET, "a");
+  make_response(CONTENT_2_05, 0, "hello", 5);
+  coap_cache_store(request, response);
+  UNIT_TEST_ASSERT(!cached("a"));
+
+  make_request(COAP_GET, "a");
+  make_response(CONTENT_2_05, 30, "hello", 5);
+  coap_set_header_content_format(response, TEXT_PLAIN);
+  coap_cache_store(request, response);
+  UNIT_TEST_ASSERT(coap_is_option(response, COAP_OPTION_ETAG));
+  etag_len = response->etag_len;
+  memcpy(etag, response->etag, etag_len);
+
+  UNIT_TEST_ASSERT(cached("a"));
+  UNIT_TEST_ASSERT(response->code == CONTENT_2_05);
+  UNIT_TEST_ASSERT(coap_get_payload(response, &payload) == 5);
+  UNIT_TEST_ASSERT(memcmp(payload, "hello", 5) == 0);
+  UNIT_TEST_ASSERT(coap_is_option(response, COAP_OPTION_CONTENT_FORMAT));
+  coap_get_header_max_age(response, &max_age);
+  UNIT_TEST_ASSERT(max_age > 0 && max_age <= 30);
+
+  /* other Accept, query and observe requests are separate */
+  make_request(COAP_GET, "a");
+  coap_set_header_accept(request, APPLICATION_JSON);
+  UNIT_TEST_ASSERT(!coap_cache_respond(request, response));
+  make_request(COAP_GET, "a");
+  coap_set_header_uri_query(request, "x=1");
+  UNIT_TEST_ASSERT(!coap_cache_respond(request, response));
+  make_request(COAP_GET, "a");
+  coap_set_header_observe(request, 0);
+  UNIT_TEST_ASSERT(!coap_cache_respond(request, response));
+
+  /* a client with the current ETag gets 2.03 Valid */
+  make_request(COAP_GET, "a");
+  coap_set_header_etag(request, etag, etag_len);
+  coap_init_message(response, COAP_TYPE_ACK, CONTENT_2_05, 1);
+  UNIT_TEST_ASSERT(coap_cache_respond(request, response));
+  UNIT_TEST_ASSERT(response->code == VALID_2_03);
+  UNIT_TEST_ASSERT(response->payload_len == 0);
+  UNIT_TEST_ASSERT(response->etag_len == etag_len);
+
+  /* secure requests do not see plain entries, nor the other way around */
+  make_request(COAP_GET, "a");
+  coap_set_src_endpoint(request, &secure_ep);
+  UNIT_TEST_ASSERT(!coap_cache_respond(request, response));
+  make_response(CONTENT_2_05, 30, "secret", 6);
+  coap_cache_store(request, response);
+  UNIT_TEST_ASSERT(coap_cache_respond(request, response));
+  UNIT_TEST_ASSERT(response->payload_len == 6);
+  UNIT_TEST_ASSERT(cached("a"));
+  UNIT_TEST_ASSERT(response->payload_len == 5);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_invalidate, "Invalidation by unsafe methods");
+UNIT_TEST(test_invalidate)
+{
+  UNIT_TEST_BEGIN();
+
+  make_request(COAP_GET, "b/c");
+  make_response(CONTENT_2_05, 30, "b", 1);
+  coap_cache_store(request, response);
+  UNIT_TEST_ASSERT(cached("b/c"));
+
+  /* a failed PUT leaves the entry */
+  make_request(COAP_PUT, "b/c");
+  make_response(BAD_REQUEST_4_00, 0, NULL, 0);
+  coap_cache_store(request, response);
+  UNIT_TEST_ASSERT(cached("b/c"));
+
+  make_request(COAP_PUT, "b/c");
+  make_response(CHANGED_2_04, 0, NULL, 0);
+  coap_cache_store(request, response);
+  UNIT_TEST_ASSERT(!cached("b/c"));
+
+  /* notifications invalidate through the resource path */
+  make_request(COAP_GET, "b/c");
+  make_response(CONTENT_2_05, 30, "b", 1);
+  coap_cache_store(request, response);
+  coap_cache_invalidate("c", 1);
+  UNIT_TEST_ASSERT(cached("b/c"));
+  coap_cache_invalidate("b/c", 3);
+  UNIT_TEST_ASSERT(!cached("b/c"));
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_expiry, "Expiry and upstream revalidation");
+UNIT_TEST(test_expiry)
+{
+  UNIT_TEST_BEGIN();
+
+  /* "d" was stored with a Max-Age of one second before this test */
+  UNIT_TEST_ASSERT(!cached("d"));
+
+  /* a proxy revalidates the stale entry upstream */
+  make_request(COAP_GET, "d");
+  UNIT_TEST_ASSERT(coap_cache_add_validator(request));
+  UNIT_TEST_ASSERT(coap_is_option(request, COAP_OPTION_ETAG));
+  coap_init_message(response, COAP_TYPE_ACK, VALID_2_03, 1);
+  coap_set_header_etag(response, request->etag, request->etag_len);
+  coap_set_header_max_age(response, 30);
+  coap_cache_store(request, response);
+
+  UNIT_TEST_ASSERT(cached("d"));
+  UNIT_TEST_ASSERT(response->payload_len == 4);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_budget, "Memory budget and LRU eviction");
+UNIT_TEST(test_budget)
+{
+  coap_cache_stats_t stats;
+  uint32_t evictions;
+
+  UNIT_TEST_BEGIN();
+
+  coap_cache_stats(&stats);
+  evictions = stats.evictions;
+
+  make_request(COAP_GET, "e");
+  make_response(CONTENT_2_05, 30, large, sizeof(large));
+  coap_cache_store(request, response);
+  /* "a" becomes the most recently used entry */
+  UNIT_TEST_ASSERT(cached("a"));
+  make_request(COAP_GET, "f");
+  make_response(CONTENT_2_05, 30, large, sizeof(large));
+  coap_cache_store(request, response);
+
+  coap_cache_stats(&stats);
+  UNIT_TEST_ASSERT(stats.bytes <= COAP_CACHE_SIZE);
+  UNIT_TEST_ASSERT(stats.evictions > evictions);
+  UNIT_TEST_ASSERT(cached("f"));
+  UNIT_TEST_ASSERT(cached("a"));
+  UNIT_TEST_ASSERT(!cached("e"));
+
+  printf("hits %lu, misses %lu, revalidations %lu, evictions %lu\n",
+         (unsigned long)stats.hits, (unsigned long)stats.misses,
+         (unsigned long)stats.revalidations,
+         (unsigned long)stats.evictions);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(test_process, ev, data)
+{
+  static struct etimer et;
+
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  memset(large, 'x', sizeof(large));
+
+  UNIT_TEST_RUN(test_hit);
+  UNIT_TEST_RUN(test_invalidate);
+
+  make_request(COAP_GET, "d");
+  make_response(CONTENT_2_05, 1, "data", 4);
+  coap_cache_store(request, response);
+  etimer_set(&et, CLOCK_SECOND + CLOCK_SECOND / 4);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+
+  UNIT_TEST_RUN(test_expiry);
+  UNIT_TEST_RUN(test_budget);
+
+  if(!UNIT_TEST_PASSED(test_hit) ||
+     !UNIT_TEST_PASSED(test_invalidate) ||
+     !UNIT_TEST_PASSED(test_expiry) ||
+     !UNIT_TEST_PASSED(test_budget)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
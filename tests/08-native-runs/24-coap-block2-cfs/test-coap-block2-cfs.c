@@ -0,0 +1,481 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden AB
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         CoAP Block2 transfers from a CFS file: the streaming helper
+ *         against a handler that reads each block from the start of the
+ *         file, with the engine serving as client and server over an
+ *         in-memory link
+ */
+
+#include "contiki.h"
+#include "coap-engine.h"
+#include "coap-callback-api.h"
+#include "coap-block2-cfs.h"
+#include "coap-transport.h"
+#include "cfs/cfs.h"
+#include "unit-test.h"
+#include <stdio.h>
+#include <string.h>
+
+#define FILE_NAME          "block2.bin"
+#define FILE_SIZE          (100 * 1024UL)
+#define TRANSFERS          20
+#define MAX_PACKETS        4
+
+PROCESS(test_process, "test");
+AUTOSTART_PROCESSES(&test_process);
+
+/*- In-memory link ----------------------------------------------------------*/
+typedef struct {
+  coap_endpoint_t src;
+  coap_endpoint_t dst;
+  uint16_t len;
+  uint8_t used;
+  uint8_t data[COAP_MAX_PACKET_SIZE];
+} packet_t;
+
+static packet_t packets[MAX_PACKETS];
+static uint8_t databuf[COAP_MAX_PACKET_SIZE + 1];
+static coap_endpoint_t client_ep;
+static coap_endpoint_t server_ep;
+/* the endpoint the engine is currently sending as */
+static const coap_endpoint_t *local_ep = &client_ep;
+static uint32_t dropped_packets;
+/* changes the file contents when it is rewritten */
+static uint8_t salt;
+/*---------------------------------------------------------------------------*/
+static int
+deliver_packets(void)
+{
+  static uint8_t buf[COAP_MAX_PACKET_SIZE];
+  static coap_endpoint_t src;
+  static coap_endpoint_t dst;
+  uint16_t len;
+  int delivered = 0;
+  int i;
+
+  for(i = 0; i < MAX_PACKETS; i++) {
+    if(!packets[i].used) {
+      continue;
+    }
+    /* free the slot first, the receiver may send right away */
+    coap_endpoint_copy(&src, &packets[i].src);
+    coap_endpoint_copy(&dst, &packets[i].dst);
+    len = packets[i].len;
+    memcpy(buf, packets[i].data, len);
+    packets[i].used = 0;
+
+    local_ep = &dst;
+    coap_receive(&src, buf, len);
+    local_ep = &client_ep;
+    delivered++;
+  }
+  return delivered;
+}
+/*---------------------------------------------------------------------------*/
+/*- Transport ---------------------------------------------------------------*/
+/*---------------------------------------------------------------------------*/
+void
+coap_endpoint_copy(coap_endpoint_t *destination, const coap_endpoint_t *from)
+{
+  memcpy(destination, from, sizeof(coap_endpoint_t));
+}
+/*---------------------------------------------------------------------------*/
+int
+coap_endpoint_cmp(const coap_endpoint_t *e1, const coap_endpoint_t *e2)
+{
+  return uip_ipaddr_cmp(&e1->ipaddr, &e2->ipaddr) && e1->port == e2->port;
+}
+/*---------------------------------------------------------------------------*/
+int
+coap_endpoint_is_reliable(const coap_endpoint_t *ep)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+coap_endpoint_log(const coap_endpoint_t *ep)
+{
+}
+/*---------------------------------------------------------------------------*/
+void
+coap_endpoint_print(const coap_endpoint_t *ep)
+{
+}
+/*---------------------------------------------------------------------------*/
+uint8_t *
+coap_databuf(void)
+{
+  return databuf;
+}
+/*---------------------------------------------------------------------------*/
+void
+coap_transport_init(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+int
+coap_sendto(const coap_endpoint_t *ep, const uint8_t *data, uint16_t length)
+{
+  int i;
+
+  for(i = 0; i < MAX_PACKETS; i++) {
+    if(!packets[i].used) {
+      coap_endpoint_copy(&packets[i].src, local_ep);
+      coap_endpoint_copy(&packets[i].dst, ep);
+      packets[i].len = MIN(length, sizeof(packets[i].data));
+      memcpy(packets[i].data, data, packets[i].len);
+      packets[i].used = 1;
+      return length;
+    }
+  }
+  dropped_packets++;
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+/*- Server ------------------------------------------------------------------*/
+/*---------------------------------------------------------------------------*/
+static uint8_t
+file_byte(uint32_t offset)
+{
+  return ((offset * 7) % 251) ^ salt;
+}
+/*---------------------------------------------------------------------------*/
+static void
+res_file_get_handler(coap_message_t *request, coap_message_t *response,
+                     uint8_t *buffer, uint16_t preferred_size,
+                     int32_t *offset)
+{
+  coap_set_header_content_format(response, APPLICATION_OCTET_STREAM);
+  coap_block2_cfs_handler(request, response, buffer, preferred_size, offset,
+                          FILE_NAME);
+}
+RESOURCE(res_file, "title=\"File\"", res_file_get_handler, NULL, NULL, NULL);
+/*---------------------------------------------------------------------------*/
+static void
+res_missing_get_handler(coap_message_t *request, coap_message_t *response,
+                        uint8_t *buffer, uint16_t preferred_size,
+                        int32_t *offset)
+{
+  coap_block2_cfs_handler(request, response, buffer, preferred_size, offset,
+                          "missing.bin");
+}
+RESOURCE(res_missing, "title=\"Missing\"", res_missing_get_handler,
+         NULL, NULL, NULL);
+/*---------------------------------------------------------------------------*/
+/* The baseline: open the file and read up to the block for each request */
+static void
+res_naive_get_handler(coap_message_t *request, coap_message_t *response,
+                      uint8_t *buffer, uint16_t preferred_size,
+                      int32_t *offset)
+{
+  int32_t pos = 0;
+  int len = 0;
+  int fd;
+
+  fd = cfs_open(FILE_NAME, CFS_READ);
+  if(fd < 0) {
+    coap_set_status_code(response, NOT_FOUND_4_04);
+    return;
+  }
+  while(pos <= *offset) {
+    len = cfs_read(fd, buffer, preferred_size);
+    if(len <= 0) {
+      break;
+    }
+    pos += len;
+  }
+  cfs_close(fd);
+
+  coap_set_header_content_format(response, APPLICATION_OCTET_STREAM);
+  coap_set_payload(response, buffer, MAX(len, 0));
+  *offset = pos < FILE_SIZE ? pos : -1;
+}
+RESOURCE(res_naive, "title=\"Naive\"", res_naive_get_handler,
+         NULL, NULL, NULL);
+/*---------------------------------------------------------------------------*/
+/*- Client ------------------------------------------------------------------*/
+/*---------------------------------------------------------------------------*/
+static coap_callback_request_state_t state;
+static coap_message_t request[1];
+static uint8_t done;
+static uint8_t last_code;
+static uint32_t received;
+static uint32_t blocks;
+static uint32_t errors;
+static uint32_t size2;
+static uint8_t etag[COAP_ETAG_LEN];
+static uint8_t etag_len;
+/*---------------------------------------------------------------------------*/
+static void
+fetch_callback(coap_callback_request_state_t *callback_state)
+{
+  coap_message_t *response = callback_state->state.response;
+  const uint8_t *payload;
+  uint32_t block_num;
+  uint16_t block_size;
+  int len;
+  int i;
+
+  switch(callback_state->state.status) {
+  case COAP_REQUEST_STATUS_MORE:
+  case COAP_REQUEST_STATUS_RESPONSE:
+    last_code = response->code;
+    if(response->code != CONTENT_2_05) {
+      break;
+    }
+    if(coap_get_header_block2(response, &block_num, NULL, &block_size, NULL)
+       && block_num * block_size != received) {
+      errors++;
+    }
+    if(blocks == 0) {
+      coap_get_header_size2(response, &size2);
+      etag_len = response->etag_len;
+      memcpy(etag, response->etag, etag_len);
+    } else if(response->etag_len != etag_len
+              || memcmp(response->etag, etag, etag_len) != 0) {
+      errors++;
+    }
+    len = coap_get_payload(response, &payload);
+    for(i = 0; i < len; i++) {
+      if(payload[i] != file_byte(received + i)) {
+        errors++;
+        break;
+      }
+    }
+    received += len;
+    blocks++;
+    break;
+  case COAP_REQUEST_STATUS_FINISHED:
+    done = 1;
+    break;
+  default:
+    errors++;
+    done = 1;
+    break;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+start_fetch(const char *path)
+{
+  done = 0;
+  last_code = 0;
+  received = 0;
+  blocks = 0;
+  size2 = 0;
+  coap_init_message(request, COAP_TYPE_CON, COAP_GET, 0);
+  coap_set_header_uri_path(request, path);
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_fetch(void)
+{
+  coap_send_request(&state, &server_ep, request, fetch_callback);
+  while(!done && deliver_packets() > 0);
+}
+/*---------------------------------------------------------------------------*/
+static clock_time_t
+benchmark(const char *path)
+{
+  clock_time_t start;
+  int i;
+
+  start = clock_time();
+  for(i = 0; i < TRANSFERS; i++) {
+    start_fetch(path);
+    run_fetch();
+    if(received != FILE_SIZE) {
+      errors++;
+    }
+  }
+  return clock_time() - start;
+}
+/*---------------------------------------------------------------------------*/
+static int
+create_file(uint8_t s)
+{
+  static uint8_t buf[256];
+  uint32_t pos;
+  int fd;
+  int i;
+
+  salt = s;
+  cfs_remove(FILE_NAME);
+  fd = cfs_open(FILE_NAME, CFS_WRITE);
+  if(fd < 0) {
+    return 0;
+  }
+  for(pos = 0; pos < FILE_SIZE; pos += sizeof(buf)) {
+    for(i = 0; i < sizeof(buf); i++) {
+      buf[i] = file_byte(pos + i);
+    }
+    if(cfs_write(fd, buf, sizeof(buf)) != sizeof(buf)) {
+      cfs_close(fd);
+      return 0;
+    }
+  }
+  cfs_close(fd);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_transfer, "Block2 transfer of a 100 KB file");
+UNIT_TEST(test_transfer)
+{
+  UNIT_TEST_BEGIN();
+
+  errors = 0;
+  start_fetch("test/file");
+  run_fetch();
+
+  UNIT_TEST_ASSERT(done);
+  UNIT_TEST_ASSERT(errors == 0);
+  UNIT_TEST_ASSERT(received == FILE_SIZE);
+  UNIT_TEST_ASSERT(blocks == FILE_SIZE / COAP_MAX_BLOCK_SIZE);
+  UNIT_TEST_ASSERT(size2 == FILE_SIZE);
+  UNIT_TEST_ASSERT(etag_len == 4);
+  UNIT_TEST_ASSERT(dropped_packets == 0);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_validation, "ETag validation and errors");
+UNIT_TEST(test_validation)
+{
+  uint8_t old_etag[4];
+
+  UNIT_TEST_BEGIN();
+
+  errors = 0;
+  memcpy(old_etag, etag, sizeof(old_etag));
+
+  /* the current ETag is answered with 2.03 */
+  start_fetch("test/file");
+  coap_set_header_etag(request, old_etag, sizeof(old_etag));
+  run_fetch();
+  UNIT_TEST_ASSERT(last_code == VALID_2_03);
+  UNIT_TEST_ASSERT(received == 0);
+
+  /* a block beyond the end of the file */
+  start_fetch("test/file");
+  coap_set_header_block2(request, FILE_SIZE / COAP_MAX_BLOCK_SIZE, 0,
+                         COAP_MAX_BLOCK_SIZE);
+  run_fetch();
+  UNIT_TEST_ASSERT(last_code == BAD_OPTION_4_02);
+
+  start_fetch("test/missing");
+  run_fetch();
+  UNIT_TEST_ASSERT(last_code == NOT_FOUND_4_04);
+
+  /* a rewritten file gets a new ETag */
+  coap_block2_cfs_changed(FILE_NAME);
+  UNIT_TEST_ASSERT(create_file(0));
+  start_fetch("test/file");
+  coap_set_header_etag(request, old_etag, sizeof(old_etag));
+  run_fetch();
+  UNIT_TEST_ASSERT(last_code == CONTENT_2_05);
+  UNIT_TEST_ASSERT(received == FILE_SIZE);
+  UNIT_TEST_ASSERT(memcmp(etag, old_etag, sizeof(old_etag)) != 0);
+  UNIT_TEST_ASSERT(errors == 0);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_benchmark, "Transfer time, streamed and naive");
+UNIT_TEST(test_benchmark)
+{
+  clock_time_t streamed;
+  clock_time_t naive;
+
+  UNIT_TEST_BEGIN();
+
+  errors = 0;
+  streamed = benchmark("test/file");
+  naive = benchmark("test/naive");
+
+  printf("%u x %lu bytes: streamed %lu ms, naive %lu ms\n",
+         TRANSFERS, (unsigned long)FILE_SIZE,
+         (unsigned long)(streamed * 1000 / CLOCK_SECOND),
+         (unsigned long)(naive * 1000 / CLOCK_SECOND));
+  printf("streamed %lu KB/s\n",
+         (unsigned long)(TRANSFERS * FILE_SIZE / 1024 * CLOCK_SECOND /
+                         MAX(streamed, 1)));
+
+  UNIT_TEST_ASSERT(errors == 0);
+  UNIT_TEST_ASSERT(dropped_packets == 0);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(test_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  uip_ip6addr(&client_ep.ipaddr, 0xfd00, 0, 0, 0, 0, 0, 0, 0x100);
+  client_ep.port = UIP_HTONS(COAP_DEFAULT_PORT);
+  uip_ip6addr(&server_ep.ipaddr, 0xfd00, 0, 0, 0, 0, 0, 0, 1);
+  server_ep.port = UIP_HTONS(COAP_DEFAULT_PORT);
+
+  coap_engine_init();
+  coap_activate_resource(&res_file, "test/file");
+  coap_activate_resource(&res_missing, "test/missing");
+  coap_activate_resource(&res_naive, "test/naive");
+
+  if(!create_file(0x5a)) {
+    printf("cannot create %s\n", FILE_NAME);
+  }
+
+  UNIT_TEST_RUN(test_transfer);
+  UNIT_TEST_RUN(test_validation);
+  UNIT_TEST_RUN(test_benchmark);
+
+  cfs_remove(FILE_NAME);
+
+  if(!UNIT_TEST_PASSED(test_transfer) ||
+     !UNIT_TEST_PASSED(test_validation) ||
+     !UNIT_TEST_PASSED(test_benchmark)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,46 @@
+#!/bin/bash
+source ../utils.sh
+
+# Contiki directory
+CONTIKI=../..
+# Test basename
+BASENAME=$(basename $0 .sh)
+
+# Starting the reference broker before the node connects to it
+echo "Starting MQTT reference broker"
+python3 $BASENAME/mqtt-inflight-broker.py > broker.log 2>&1 &
+BPID=$!
+sleep 1
+
+# Starting Contiki-NG native node
+echo "Starting native node - MQTT inflight client"
+sudo $BASENAME/build/native/mqtt-inflight-client.native > node.log 2>&1 &
+CPID=$!
+
+COUNTER=12
+while [ $COUNTER -gt 0 ]; do
+    sleep 5
+    if grep -q 'reference broker: ' broker.log ; then
+        break
+    fi
+    let COUNTER-=1
+done
+
+echo "Closing native node"
+kill_bg $CPID
+
+echo "Closing reference broker"
+kill_bg $BPID
+
+if grep -q 'inflight client: OK' node.log && grep -q 'reference broker: OK' broker.log ; then
+  cp node.log $BASENAME.testlog;
+  printf "%-32s TEST OK\n" "$BASENAME" | tee $BASENAME.testlog;
+else
+  echo "==== node.log ====" ; cat node.log;
+  echo "==== broker.log ====" ; cat broker.log;
+  printf "%-32s TEST FAIL\n" "$BASENAME" | tee $BASENAME.testlog;
+  rm -f node.log broker.log
+  exit 1
+fi
+
+rm -f node.log broker.log
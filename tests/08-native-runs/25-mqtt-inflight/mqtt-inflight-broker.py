@@ -0,0 +1,241 @@
+#!/usr/bin/env python3
+#
+# Minimal MQTT v5 reference broker for the mqtt-inflight-client test node.
+# It advertises a Receive Maximum, answers each batch of packets with its
+# acknowledgements in reverse order, and checks that the node stays within
+# the window and that every message arrives once, in order and intact. While
+# the last phase is in flight it drops the connection and then expects the
+# unacknowledged messages to be resent with DUP set when the session resumes.
+# The node also subscribes during the pipelined QoS 1 phase, which must carry
+# its Subscription Identifier. Only the standard library is used.
+
+import asyncio
+import struct
+import sys
+
+RECEIVE_MAX = 4
+ACK_DELAY = 0.002
+
+CONNECT, CONNACK, PUBLISH, PUBACK = 0x10, 0x20, 0x30, 0x40
+PUBREC, PUBREL, PUBCOMP = 0x50, 0x60, 0x70
+SUBSCRIBE, SUBACK = 0x80, 0x90
+PINGREQ, PINGRESP, DISCONNECT = 0xc0, 0xd0, 0xe0
+PROP_SUB_ID, PROP_RECEIVE_MAX, PROP_TOPIC_ALIAS_MAX = 0x0b, 0x21, 0x22
+
+# Topic: (QoS, number of messages), must match the node
+PHASES = {
+    "inflight/1": (1, 200),
+    "inflight/2": (1, 200),
+    "inflight/3": (2, 100),
+    "inflight/4": (2, 100),
+    "inflight/5": (1, 2 * RECEIVE_MAX),
+}
+RESUME_TOPIC = "inflight/5"
+# Must match the node
+SUB_TOPIC, SUB_ID = "inflight/sub", 7
+
+state = {
+    "connections": 0,
+    "received": {topic: [] for topic in PHASES},
+    "inflight": {},
+    "max_inflight": 0,
+    "reordered": 0,
+    "held": [],
+    "resent": [],
+    "subscribed": 0,
+    "errors": [],
+    "done": False,
+}
+
+
+def error(msg):
+    print("error: %s" % msg)
+    state["errors"].append(msg)
+
+
+def encode_vbi(n):
+    out = b""
+    while True:
+        byte = n % 128
+        n //= 128
+        out += bytes([byte | (0x80 if n else 0)])
+        if not n:
+            return out
+
+
+def packet(fhdr, body=b""):
+    return bytes([fhdr]) + encode_vbi(len(body)) + body
+
+
+def split_packets(buf):
+    # Returns the complete packets in buf and the bytes left over
+    packets = []
+    while len(buf) >= 2:
+        length = 0
+        shift = 0
+        i = 1
+        while i < len(buf) and buf[i] & 0x80:
+            length += (buf[i] & 0x7f) << shift
+            shift += 7
+            i += 1
+        if i >= len(buf):
+            break
+        length += buf[i] << shift
+        i += 1
+        if len(buf) < i + length:
+            break
+        packets.append((buf[0], buf[i:i + length]))
+        buf = buf[i + length:]
+    return packets, buf
+
+
+def parse_publish(fhdr, body):
+    qos = (fhdr >> 1) & 3
+    dup = bool(fhdr & 0x08)
+    n = struct.unpack("!H", body[:2])[0]
+    topic = body[2:2 + n].decode()
+    i = 2 + n
+    mid = None
+    if qos:
+        mid = struct.unpack("!H", body[i:i + 2])[0]
+        i += 2
+    # Skip the properties
+    length = 0
+    shift = 0
+    while True:
+        byte = body[i]
+        i += 1
+        length += (byte & 0x7f) << shift
+        shift += 7
+        if not byte & 0x80:
+            break
+    return topic, qos, dup, mid, body[i + length:]
+
+
+def handle_publish(fhdr, body, acks, conn):
+    topic, qos, dup, mid, payload = parse_publish(fhdr, body)
+    inflight = state["inflight"]
+    if topic not in PHASES or PHASES[topic][0] != qos:
+        error("unexpected PUBLISH %s QoS %d" % (topic, qos))
+        return
+    if dup:
+        if mid not in inflight or inflight[mid] != (topic, payload):
+            error("DUP PUBLISH %s for unknown mid %d" % (topic, mid))
+        else:
+            state["resent"].append(mid)
+    else:
+        if mid in inflight:
+            error("mid %d reused while in flight" % mid)
+        inflight[mid] = (topic, payload)
+        state["received"][topic].append(payload)
+        state["max_inflight"] = max(state["max_inflight"], len(inflight))
+        if len(inflight) > RECEIVE_MAX:
+            error("%d messages in flight" % len(inflight))
+    if topic == RESUME_TOPIC and conn["first"]:
+        # Hold back the acks of the last phase until the window is full
+        state["held"].append(mid)
+        if len(inflight) == RECEIVE_MAX:
+            conn["drop"] = True
+        return
+    acks.append((PUBACK if qos == 1 else PUBREC, mid))
+
+
+def handle_subscribe(body, writer):
+    mid = struct.unpack("!H", body[:2])[0]
+    # Only a single-byte property length and Subscription Identifier
+    length = body[2]
+    props = body[3:3 + length]
+    n = struct.unpack("!H", body[3 + length:5 + length])[0]
+    topic = body[5 + length:5 + length + n].decode()
+    if topic != SUB_TOPIC or props != bytes([PROP_SUB_ID, SUB_ID]):
+        error("SUBSCRIBE %s with properties %s" % (topic, props.hex()))
+    else:
+        state["subscribed"] += 1
+    writer.write(packet(SUBACK, struct.pack("!H", mid) + bytes([0, 0])))
+
+
+def handle_connect(writer, conn):
+    props = (bytes([PROP_TOPIC_ALIAS_MAX]) + struct.pack("!H", 0) +
+             bytes([PROP_RECEIVE_MAX]) + struct.pack("!H", RECEIVE_MAX))
+    session_present = 0 if conn["first"] else 1
+    writer.write(packet(CONNACK, bytes([session_present, 0]) +
+                        encode_vbi(len(props)) + props))
+
+
+async def client(reader, writer):
+    state["connections"] += 1
+    conn = {"first": state["connections"] == 1, "drop": False}
+    buf = b""
+    try:
+        while not conn["drop"]:
+            data = await reader.read(65536)
+            if not data:
+                break
+            packets, buf = split_packets(buf + data)
+            # Everything that arrived together is answered as one batch
+            acks = []
+            for fhdr, body in packets:
+                kind = fhdr & 0xf0
+                if kind == CONNECT:
+                    handle_connect(writer, conn)
+                elif kind == PUBLISH:
+                    handle_publish(fhdr, body, acks, conn)
+                elif kind == SUBSCRIBE:
+                    handle_subscribe(body, writer)
+                elif kind == PUBREL:
+                    acks.append((PUBCOMP, struct.unpack("!H", body[:2])[0]))
+                elif kind == PINGREQ:
+                    writer.write(packet(PINGRESP))
+                elif kind == DISCONNECT:
+                    state["done"] = True
+                else:
+                    error("unexpected packet type 0x%02x" % fhdr)
+            if conn["drop"]:
+                print("dropping the connection with %d messages in flight" %
+                      len(state["inflight"]))
+                break
+            if len(acks) > 1:
+                state["reordered"] += 1
+            await asyncio.sleep(ACK_DELAY)
+            for kind, mid in reversed(acks):
+                if kind in (PUBACK, PUBCOMP):
+                    state["inflight"].pop(mid, None)
+                writer.write(packet(kind, struct.pack("!H", mid)))
+    except ConnectionError:
+        pass
+    writer.close()
+
+
+def check():
+    ok = not state["errors"]
+    for topic, (qos, count) in PHASES.items():
+        expected = [str(i).encode() for i in range(count)]
+        if state["received"][topic] != expected:
+            print("%s: %d messages out of order or missing" %
+                  (topic, len(state["received"][topic])))
+            ok = False
+    print("connections %d, max in flight %d, reordered batches %d, resent %d, "
+          "subscribed %d" %
+          (state["connections"], state["max_inflight"], state["reordered"],
+           len(state["resent"]), state["subscribed"]))
+    return (ok and state["done"] and state["connections"] == 2 and
+            state["subscribed"] == 1 and
+            state["max_inflight"] == RECEIVE_MAX and state["reordered"] > 0 and
+            len(state["held"]) == RECEIVE_MAX and
+            state["resent"] == state["held"] and not state["inflight"])
+
+
+async def main():
+    server = await asyncio.start_server(client, "::", 1883)
+    for i in range(60):
+        await asyncio.sleep(1)
+        if state["done"]:
+            break
+    server.close()
+    ok = check()
+    print("MQTT reference broker: %s" % ("OK" if ok else "FAILED"))
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(asyncio.run(main()))
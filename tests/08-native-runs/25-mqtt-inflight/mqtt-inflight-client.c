@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden AB
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *      Publishes QoS 1 and QoS 2 messages to the MQTT reference broker, first
+ *      one at a time and then with the full inflight window, and reports the
+ *      message rate of each phase. A subscription with a Subscription
+ *      Identifier is made while the pipelined QoS 1 messages are in flight.
+ */
+
+#include "contiki.h"
+#include "mqtt.h"
+#include "mqtt-prop.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define BROKER_IP       "fd00::1"
+#define BROKER_PORT     1883
+#define CLIENT_ID       "inflight-test"
+#define MAX_SEGMENT     512
+
+/* Must match the reference broker */
+#define RECEIVE_MAX     4
+
+#define MAX_COUNT       200
+#define PAYLOAD_LEN     8
+/* Must match the reference broker */
+#define SUB_TOPIC       "inflight/sub"
+#define SUB_ID          7
+#define TEST_TIMEOUT    (60 * CLOCK_SECOND)
+
+PROCESS(mqtt_inflight_client, "MQTT inflight client");
+AUTOSTART_PROCESSES(&mqtt_inflight_client);
+
+struct phase {
+  const char *name;
+  char *topic;
+  mqtt_qos_level_t qos;
+  uint16_t window;
+  uint16_t count;
+  uint8_t subscribe;
+};
+
+static const struct phase phases[] = {
+  { "qos1 stop-and-wait", "inflight/1", MQTT_QOS_LEVEL_1, 1, MAX_COUNT, 0 },
+  /* The SUBSCRIBE waits for the messages in flight to be sent */
+  { "qos1 pipelined", "inflight/2", MQTT_QOS_LEVEL_1, MQTT_MAX_INFLIGHT, MAX_COUNT, 1 },
+  { "qos2 stop-and-wait", "inflight/3", MQTT_QOS_LEVEL_2, 1, MAX_COUNT / 2, 0 },
+  { "qos2 pipelined", "inflight/4", MQTT_QOS_LEVEL_2, MQTT_MAX_INFLIGHT, MAX_COUNT / 2, 0 },
+  /* The broker drops the connection while these are in flight */
+  { "qos1 resumed", "inflight/5", MQTT_QOS_LEVEL_1, MQTT_MAX_INFLIGHT, 2 * RECEIVE_MAX, 0 },
+};
+
+static struct mqtt_connection conn;
+static struct mqtt_prop_list *sub_props;
+static const struct phase *phase;
+static char payload[MAX_COUNT][PAYLOAD_LEN];
+static uint16_t mids[MAX_COUNT];
+static uint8_t acked[MAX_COUNT];
+static uint16_t sent;
+static uint16_t acks;
+static uint16_t bad_acks;
+static uint8_t connected;
+static uint8_t connections;
+static uint8_t subacks;
+/*---------------------------------------------------------------------------*/
+static void
+handle_ack(uint16_t mid)
+{
+  uint16_t i;
+
+  for(i = 0; i < sent; i++) {
+    if(mids[i] == mid && !acked[i]) {
+      acked[i] = 1;
+      acks++;
+      return;
+    }
+  }
+  printf("Unexpected ack for mid %u\n", mid);
+  bad_acks++;
+}
+/*---------------------------------------------------------------------------*/
+static void
+mqtt_event(struct mqtt_connection *m, mqtt_event_t event, void *data)
+{
+  switch(event) {
+  case MQTT_EVENT_CONNECTED:
+    connected = 1;
+    connections++;
+    printf("Connected, window %u\n", conn.inflight_max);
+    break;
+  case MQTT_EVENT_DISCONNECTED:
+    connected = 0;
+    printf("Disconnected\n");
+    break;
+  case MQTT_EVENT_PUBACK:
+    handle_ack(*(uint16_t *)data);
+    break;
+  case MQTT_EVENT_SUBACK:
+    subacks++;
+    break;
+  default:
+    break;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+publish_more(void)
+{
+  while(sent < phase->count && sent - acks < phase->window &&
+        mqtt_publish(&conn, &mids[sent], phase->topic,
+                     (uint8_t *)payload[sent], strlen(payload[sent]),
+                     phase->qos, MQTT_RETAIN_OFF, 0, MQTT_TOPIC_ALIAS_OFF,
+                     MQTT_PROP_LIST_NONE) == MQTT_STATUS_OK) {
+    sent++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(mqtt_inflight_client, ev, data)
+{
+  static struct etimer et;
+  static clock_time_t start;
+  static unsigned long elapsed;
+  static uint8_t p;
+  static uint8_t ok;
+  uint16_t i;
+
+  PROCESS_BEGIN();
+
+  /* Give the host side of the tun interface time to come up */
+  etimer_set(&et, 2 * CLOCK_SECOND);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+
+  mqtt_prop_create_list(&sub_props);
+  mqtt_prop_register(&sub_props, NULL, MQTT_FHDR_MSG_TYPE_SUBSCRIBE,
+                     MQTT_VHDR_PROP_SUB_ID, SUB_ID);
+
+  mqtt_register(&conn, &mqtt_inflight_client, CLIENT_ID, mqtt_event,
+                MAX_SEGMENT);
+  mqtt_connect(&conn, BROKER_IP, BROKER_PORT, 60, MQTT_CLEAN_SESSION_OFF,
+               MQTT_PROP_LIST_NONE);
+
+  etimer_set(&et, TEST_TIMEOUT);
+  PROCESS_WAIT_EVENT_UNTIL(connected || etimer_expired(&et));
+
+  ok = connected && conn.inflight_max == RECEIVE_MAX;
+
+  for(p = 0; ok && p < sizeof(phases) / sizeof(phases[0]); p++) {
+    phase = &phases[p];
+    for(i = 0; i < phase->count; i++) {
+      snprintf(payload[i], PAYLOAD_LEN, "%u", i);
+    }
+    memset(acked, 0, sizeof(acked));
+    sent = acks = 0;
+
+    start = clock_time();
+    if(phase->subscribe) {
+      /* Queue a window first, so that the buffer is in flight */
+      publish_more();
+      mqtt_subscribe(&conn, NULL, SUB_TOPIC, MQTT_QOS_LEVEL_0, MQTT_NL_OFF,
+                     MQTT_RAP_OFF, MQTT_RET_H_SEND_ALL, sub_props);
+    }
+    while((acks < phase->count || subacks < phase->subscribe) &&
+          !etimer_expired(&et)) {
+      publish_more();
+      PROCESS_WAIT_EVENT_UNTIL(ev == mqtt_update_event || etimer_expired(&et));
+    }
+    elapsed = (unsigned long)(clock_time() - start) * 1000 / CLOCK_SECOND;
+
+    printf("%s: %u messages in %lu ms, %lu msgs/s\n", phase->name,
+           acks, elapsed, acks * 1000UL / (elapsed ? elapsed : 1));
+    ok = acks == phase->count && bad_acks == 0 && subacks == phase->subscribe;
+    subacks = 0;
+  }
+
+  mqtt_disconnect(&conn, MQTT_PROP_LIST_NONE);
+
+  printf("MQTT inflight client: %s (%u connections)\n",
+         ok && connections == 2 ? "OK" : "FAILED", connections);
+
+  PROCESS_END();
+}
@@ -0,0 +1,314 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden AB
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Tests for the topic filter registry of the MQTT engine
+ */
+
+#include "contiki.h"
+#include "mqtt.h"
+#include "mqtt-sub.h"
+#if MQTT_5
+#include "mqtt-prop.h"
+#endif
+#include "unit-test.h"
+#include <stdio.h>
+#include <string.h>
+
+PROCESS(test_process, "test");
+AUTOSTART_PROCESSES(&test_process);
+
+static struct mqtt_connection conn;
+static struct mqtt_sub subs[MQTT_MAX_SUBSCRIPTIONS];
+static int calls;
+/*---------------------------------------------------------------------------*/
+static void
+topic_callback(struct mqtt_connection *m, struct mqtt_message *msg)
+{
+  calls++;
+}
+/*---------------------------------------------------------------------------*/
+static void
+event_callback(struct mqtt_connection *m, mqtt_event_t event, void *data)
+{
+}
+/*---------------------------------------------------------------------------*/
+static mqtt_status_t
+add(int i, const char *filter)
+{
+  return mqtt_sub_add(&conn, &subs[i], filter, topic_callback);
+}
+/*---------------------------------------------------------------------------*/
+/* Passes a PUBLISH to the registry and returns the matching subscriptions */
+static uint32_t
+publish(const char *topic, int first_chunk)
+{
+  struct mqtt_sub *sub;
+  uint32_t matches;
+  int count;
+
+  strcpy(conn.in_publish_msg.topic, topic);
+  conn.in_publish_msg.first_chunk = first_chunk;
+  calls = 0;
+  count = mqtt_sub_dispatch(&conn, &conn.in_publish_msg);
+
+  matches = 0;
+  for(sub = conn.sub_matches; sub != NULL; sub = sub->next_match) {
+    matches |= 1 << (sub - subs);
+  }
+  if(count != calls) {
+    return 0xffffffff;
+  }
+  return matches;
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_all(void)
+{
+  int i;
+
+  for(i = 0; i < MQTT_MAX_SUBSCRIPTIONS; i++) {
+    mqtt_sub_remove(&conn, &subs[i]);
+  }
+}
+/*---------------------------------------------------------------------------*/
+#define BIT(i) (1UL << (i))
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_wildcards, "Wildcard matching");
+UNIT_TEST(test_wildcards)
+{
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(add(0, "sensors/temp") == MQTT_STATUS_OK);
+  UNIT_TEST_ASSERT(add(1, "sensors/+") == MQTT_STATUS_OK);
+  UNIT_TEST_ASSERT(add(2, "sensors/#") == MQTT_STATUS_OK);
+  UNIT_TEST_ASSERT(add(3, "+/+/status") == MQTT_STATUS_OK);
+  UNIT_TEST_ASSERT(add(4, "#") == MQTT_STATUS_OK);
+  UNIT_TEST_ASSERT(add(5, "sensors/temp/#") == MQTT_STATUS_OK);
+  UNIT_TEST_ASSERT(add(6, "$SYS/#") == MQTT_STATUS_OK);
+  UNIT_TEST_ASSERT(add(7, "+/temp") == MQTT_STATUS_OK);
+
+  UNIT_TEST_ASSERT(publish("sensors/temp", 1) ==
+                   (BIT(0) | BIT(1) | BIT(2) | BIT(4) | BIT(5) | BIT(7)));
+  UNIT_TEST_ASSERT(publish("sensors/hum", 1) == (BIT(1) | BIT(2) | BIT(4)));
+  UNIT_TEST_ASSERT(publish("sensors/temp/status", 1) ==
+                   (BIT(2) | BIT(3) | BIT(4) | BIT(5)));
+  UNIT_TEST_ASSERT(publish("sensors", 1) == (BIT(2) | BIT(4)));
+  UNIT_TEST_ASSERT(publish("a/b/status", 1) == (BIT(3) | BIT(4)));
+  UNIT_TEST_ASSERT(publish("a/b/status/x", 1) == BIT(4));
+  UNIT_TEST_ASSERT(publish("sensors//x", 1) == (BIT(2) | BIT(4)));
+
+  /* Wildcards in the first level do not match $ topics */
+  UNIT_TEST_ASSERT(publish("$SYS/broker/load", 1) == BIT(6));
+  UNIT_TEST_ASSERT(publish("$SYS", 1) == BIT(6));
+  UNIT_TEST_ASSERT(publish("$other/temp", 1) == 0);
+
+  /* Later chunks of a message go to the filters of the first chunk */
+  UNIT_TEST_ASSERT(publish("sensors/hum", 1) == (BIT(1) | BIT(2) | BIT(4)));
+  UNIT_TEST_ASSERT(publish("ignored", 0) == (BIT(1) | BIT(2) | BIT(4)));
+  UNIT_TEST_ASSERT(calls == 3);
+
+  /* Messages matching no filter are left to MQTT_EVENT_PUBLISH */
+  mqtt_sub_remove(&conn, &subs[4]);
+  UNIT_TEST_ASSERT(publish("other", 1) == 0);
+  UNIT_TEST_ASSERT(calls == 0);
+  UNIT_TEST_ASSERT(publish("sensors/temp", 1) ==
+                   (BIT(0) | BIT(1) | BIT(2) | BIT(5) | BIT(7)));
+
+  remove_all();
+  UNIT_TEST_ASSERT(conn.sub_root == NULL);
+  UNIT_TEST_ASSERT(publish("sensors/temp", 1) == 0);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_invalid, "Invalid filters and full registry");
+UNIT_TEST(test_invalid)
+{
+  char filter[MQTT_TOPIC_MAX_LENGTH + 2];
+  struct mqtt_sub extra;
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(add(0, "") == MQTT_STATUS_INVALID_ARGS_ERROR);
+  UNIT_TEST_ASSERT(add(0, "a/b#") == MQTT_STATUS_INVALID_ARGS_ERROR);
+  UNIT_TEST_ASSERT(add(0, "a/#/b") == MQTT_STATUS_INVALID_ARGS_ERROR);
+  UNIT_TEST_ASSERT(add(0, "a+/b") == MQTT_STATUS_INVALID_ARGS_ERROR);
+  memset(filter, 'x', sizeof(filter) - 1);
+  filter[sizeof(filter) - 1] = '\0';
+  UNIT_TEST_ASSERT(add(0, filter) == MQTT_STATUS_INVALID_ARGS_ERROR);
+  UNIT_TEST_ASSERT(conn.sub_root == NULL);
+
+  UNIT_TEST_ASSERT(add(0, "a") == MQTT_STATUS_OK);
+  UNIT_TEST_ASSERT(add(0, "b") == MQTT_STATUS_INVALID_ARGS_ERROR);
+
+  /* The same filter may be registered more than once */
+  for(i = 1; i < MQTT_MAX_SUBSCRIPTIONS; i++) {
+    UNIT_TEST_ASSERT(add(i, "a") == MQTT_STATUS_OK);
+  }
+  UNIT_TEST_ASSERT(publish("a", 1) == BIT(MQTT_MAX_SUBSCRIPTIONS) - 1);
+  UNIT_TEST_ASSERT(mqtt_sub_add(&conn, &extra, "c", topic_callback) ==
+                   MQTT_STATUS_ERROR);
+
+  remove_all();
+  UNIT_TEST_ASSERT(conn.sub_root == NULL);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_shared_levels, "Shared levels and node pool");
+UNIT_TEST(test_shared_levels)
+{
+  char filter[2 * MQTT_SUB_MAX_NODES + 2];
+  char first[16];
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  /* Removing a filter keeps the levels it shares with others readable */
+  strcpy(first, "x/y/z");
+  UNIT_TEST_ASSERT(add(0, first) == MQTT_STATUS_OK);
+  UNIT_TEST_ASSERT(add(1, "x/y") == MQTT_STATUS_OK);
+  UNIT_TEST_ASSERT(add(2, "x/+/z") == MQTT_STATUS_OK);
+  mqtt_sub_remove(&conn, &subs[0]);
+  memset(first, '?', sizeof(first) - 1);
+  UNIT_TEST_ASSERT(publish("x/y", 1) == BIT(1));
+  UNIT_TEST_ASSERT(publish("x/y/z", 1) == BIT(2));
+  UNIT_TEST_ASSERT(add(0, "x/y/w") == MQTT_STATUS_OK);
+  UNIT_TEST_ASSERT(publish("x/y/w", 1) == BIT(0));
+  remove_all();
+  UNIT_TEST_ASSERT(conn.sub_root == NULL);
+
+  /* One level more than there are nodes is rolled back */
+  for(i = 0; i <= MQTT_SUB_MAX_NODES; i++) {
+    filter[2 * i] = 'a' + i;
+    filter[2 * i + 1] = '/';
+  }
+  filter[2 * MQTT_SUB_MAX_NODES + 1] = '\0';
+  UNIT_TEST_ASSERT(add(0, filter) == MQTT_STATUS_ERROR);
+  UNIT_TEST_ASSERT(conn.sub_root == NULL);
+  filter[2 * MQTT_SUB_MAX_NODES - 1] = '\0';
+  UNIT_TEST_ASSERT(add(0, filter) == MQTT_STATUS_OK);
+  UNIT_TEST_ASSERT(publish(filter, 1) == BIT(0));
+  UNIT_TEST_ASSERT(add(1, "b") == MQTT_STATUS_ERROR);
+  remove_all();
+  UNIT_TEST_ASSERT(conn.sub_root == NULL);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+#if MQTT_5
+/* Sets up the PUBLISH properties with the given Subscription Identifier */
+static void
+set_sub_id(uint8_t id)
+{
+  memset(&conn.in_packet, 0, sizeof(conn.in_packet));
+  conn.in_packet.fhdr = MQTT_FHDR_MSG_TYPE_PUBLISH;
+  conn.in_packet.payload[0] = 4;
+  conn.in_packet.payload[1] = MQTT_VHDR_PROP_PAYLOAD_FMT_IND;
+  conn.in_packet.payload[2] = 1;
+  conn.in_packet.payload[3] = MQTT_VHDR_PROP_SUB_ID;
+  conn.in_packet.payload[4] = id;
+  conn.in_packet.remaining_length = 5;
+  conn.in_packet.payload_start = conn.in_packet.payload;
+  mqtt_prop_decode_input_props(&conn);
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_sub_ids, "Subscription Identifiers");
+UNIT_TEST(test_sub_ids)
+{
+  uint8_t *props_pos;
+
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(add(0, "a/+") == MQTT_STATUS_OK);
+  UNIT_TEST_ASSERT(add(1, "a/b") == MQTT_STATUS_OK);
+  UNIT_TEST_ASSERT(subs[0].id == 1 && subs[1].id == 2);
+
+  /* Filters the broker left out are still matched, each one once */
+  set_sub_id(subs[0].id);
+  props_pos = conn.in_packet.curr_props_pos;
+  UNIT_TEST_ASSERT(publish("a/b", 1) == (BIT(0) | BIT(1)));
+  UNIT_TEST_ASSERT(conn.in_packet.curr_props_pos == props_pos);
+
+  set_sub_id(subs[1].id);
+  UNIT_TEST_ASSERT(publish("a/b", 1) == (BIT(1) | BIT(0)));
+
+  /* Unknown identifiers are ignored */
+  set_sub_id(MQTT_MAX_SUBSCRIPTIONS);
+  UNIT_TEST_ASSERT(publish("a/b", 1) == (BIT(0) | BIT(1)));
+
+  memset(&conn.in_packet, 0, sizeof(conn.in_packet));
+  UNIT_TEST_ASSERT(publish("a/c", 1) == BIT(0));
+
+  remove_all();
+
+  UNIT_TEST_END();
+}
+#endif
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(test_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  mqtt_register(&conn, &test_process, "test", event_callback, 128);
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  UNIT_TEST_RUN(test_wildcards);
+  UNIT_TEST_RUN(test_invalid);
+  UNIT_TEST_RUN(test_shared_levels);
+#if MQTT_5
+  UNIT_TEST_RUN(test_sub_ids);
+#endif
+
+  if(!UNIT_TEST_PASSED(test_wildcards)
+      || !UNIT_TEST_PASSED(test_invalid)
+      || !UNIT_TEST_PASSED(test_shared_levels)
+#if MQTT_5
+      || !UNIT_TEST_PASSED(test_sub_ids)
+#endif
+      ) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
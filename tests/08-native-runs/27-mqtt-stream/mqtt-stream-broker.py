@@ -0,0 +1,199 @@
+#!/usr/bin/env python3
+#
+# Minimal MQTT v5 reference broker for the mqtt-stream-client test node. It
+# checks the multi-megabyte payloads as they arrive, without buffering them,
+# acknowledges them and expects the last one to be cut short when the node's
+# payload reader fails. Only the standard library is used.
+
+import asyncio
+import socket
+import struct
+import sys
+
+CONNECT, CONNACK, PUBLISH, PUBACK = 0x10, 0x20, 0x30, 0x40
+PUBREC, PUBREL, PUBCOMP = 0x50, 0x60, 0x70
+PINGREQ, PINGRESP, DISCONNECT = 0xc0, 0xd0, 0xe0
+
+# Topic: (QoS, payload size), must match the node
+PHASES = {
+    "stream/gen": (1, 4 << 20),
+    "stream/cfs": (2, 1 << 20),
+    "stream/ram": (1, 128 << 10),
+    "stream/fail": (0, 4 << 20),
+}
+FAIL_TOPIC = "stream/fail"
+
+PATTERN = bytes((i ^ (i >> 8) ^ (i >> 16)) & 0xff for i in range(4 << 20))
+
+state = {
+    "received": {},
+    "errors": [],
+    "done": False,
+}
+
+
+def error(msg):
+    print("error: %s" % msg)
+    state["errors"].append(msg)
+
+
+def encode_vbi(n):
+    out = b""
+    while True:
+        byte = n % 128
+        n //= 128
+        out += bytes([byte | (0x80 if n else 0)])
+        if not n:
+            return out
+
+
+def packet(fhdr, body=b""):
+    return bytes([fhdr]) + encode_vbi(len(body)) + body
+
+
+def decode_vbi(buf, i):
+    # Returns the value and the index after it, or None if incomplete
+    value = 0
+    shift = 0
+    while i < len(buf):
+        value += (buf[i] & 0x7f) << shift
+        shift += 7
+        i += 1
+        if not buf[i - 1] & 0x80:
+            return value, i
+    return None
+
+
+class Broker(asyncio.Protocol):
+    def connection_made(self, transport):
+        self.transport = transport
+        self.buf = bytearray()
+        self.publish = None
+        sock = transport.get_extra_info("socket")
+        self.sock = sock
+        self.quickack()
+
+    def quickack(self):
+        # The node has one segment in flight, so do not delay the ACKs
+        try:
+            self.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_QUICKACK, 1)
+        except (AttributeError, OSError):
+            pass
+
+    def data_received(self, data):
+        self.quickack()
+        self.buf += data
+        while self.parse():
+            pass
+
+    def parse(self):
+        if self.publish is not None:
+            return self.payload()
+        if len(self.buf) < 2:
+            return False
+        r = decode_vbi(self.buf, 1)
+        if r is None:
+            return False
+        length, i = r
+        fhdr = self.buf[0]
+        if fhdr & 0xf0 == PUBLISH:
+            # Only the headers are needed, the payload is checked as it comes
+            if len(self.buf) < i + min(length, 64):
+                return False
+            self.start_publish(fhdr, length, i)
+            return True
+        if len(self.buf) < i + length:
+            return False
+        body = bytes(self.buf[i:i + length])
+        del self.buf[:i + length]
+        self.handle(fhdr, body)
+        return True
+
+    def start_publish(self, fhdr, length, i):
+        qos = (fhdr >> 1) & 3
+        start = i
+        n = struct.unpack("!H", self.buf[i:i + 2])[0]
+        topic = self.buf[i + 2:i + 2 + n].decode()
+        i += 2 + n
+        mid = None
+        if qos:
+            mid = struct.unpack("!H", self.buf[i:i + 2])[0]
+            i += 2
+        props, i = decode_vbi(self.buf, i)
+        i += props
+        size = length - (i - start)
+        del self.buf[:i]
+        if topic not in PHASES or PHASES[topic] != (qos, size):
+            error("unexpected PUBLISH %s QoS %d, %d bytes" % (topic, qos, size))
+        self.publish = {"topic": topic, "qos": qos, "mid": mid,
+                        "size": size, "offset": 0, "intact": True}
+
+    def payload(self):
+        p = self.publish
+        n = min(len(self.buf), p["size"] - p["offset"])
+        if n:
+            if self.buf[:n] != PATTERN[p["offset"]:p["offset"] + n]:
+                p["intact"] = False
+            del self.buf[:n]
+            p["offset"] += n
+        if p["offset"] < p["size"]:
+            return False
+        self.publish = None
+        state["received"][p["topic"]] = (p["offset"], p["intact"])
+        print("%s: %d bytes, %s" % (p["topic"], p["offset"],
+                                    "intact" if p["intact"] else "corrupted"))
+        if p["qos"] == 1:
+            self.transport.write(packet(PUBACK, struct.pack("!H", p["mid"])))
+        elif p["qos"] == 2:
+            self.transport.write(packet(PUBREC, struct.pack("!H", p["mid"])))
+        return True
+
+    def handle(self, fhdr, body):
+        kind = fhdr & 0xf0
+        if kind == CONNECT:
+            self.transport.write(packet(CONNACK, bytes([0, 0, 0])))
+        elif kind == PUBREL:
+            self.transport.write(packet(PUBCOMP, body[:2]))
+        elif kind == PINGREQ:
+            self.transport.write(packet(PINGRESP))
+        elif kind == DISCONNECT:
+            error("unexpected DISCONNECT")
+        else:
+            error("unexpected packet type 0x%02x" % fhdr)
+
+    def connection_lost(self, exc):
+        p = self.publish
+        if p is not None:
+            state["received"][p["topic"]] = (p["offset"], p["intact"])
+            print("%s: cut short after %d bytes" % (p["topic"], p["offset"]))
+        state["done"] = True
+
+
+def check():
+    ok = not state["errors"]
+    for topic, (qos, size) in PHASES.items():
+        received, intact = state["received"].get(topic, (0, False))
+        if not intact:
+            ok = False
+        elif topic == FAIL_TOPIC:
+            ok = ok and 0 < received < size
+        else:
+            ok = ok and received == size
+    return ok and state["done"]
+
+
+async def main():
+    loop = asyncio.get_running_loop()
+    server = await loop.create_server(Broker, "::", 1883)
+    for i in range(120):
+        await asyncio.sleep(1)
+        if state["done"]:
+            break
+    server.close()
+    ok = check()
+    print("MQTT reference broker: %s" % ("OK" if ok else "FAILED"))
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(asyncio.run(main()))
@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden AB
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *      Publishes multi-megabyte payloads to the MQTT reference broker with
+ *      mqtt_publish_stream(), from a generator and from a CFS file, and
+ *      reports the throughput of each.
+ */
+
+#include "contiki.h"
+#include "mqtt.h"
+#include "mqtt-prop.h"
+#include "cfs/cfs.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define BROKER_IP       "fd00::1"
+#define BROKER_PORT     1883
+#define CLIENT_ID       "stream-test"
+#define MAX_SEGMENT     MQTT_TCP_OUTPUT_BUFF_SIZE
+
+/* Must match the reference broker */
+#define GEN_SIZE        (4UL << 20)
+#define FILE_SIZE       (1UL << 20)
+#define RAM_SIZE        (128UL << 10)
+#define FAIL_OFFSET     (64UL << 10)
+
+#define FILE_NAME       "mqtt-stream.bin"
+#define TEST_TIMEOUT    (120 * CLOCK_SECOND)
+
+PROCESS(mqtt_stream_client, "MQTT stream client");
+AUTOSTART_PROCESSES(&mqtt_stream_client);
+
+static struct mqtt_connection conn;
+static uint8_t ram_payload[RAM_SIZE];
+static uint16_t mid;
+static uint8_t acked;
+static uint8_t connected;
+static uint8_t errors;
+static int fd = -1;
+/*---------------------------------------------------------------------------*/
+static uint8_t
+pattern(uint32_t offset)
+{
+  return (uint8_t)(offset ^ (offset >> 8) ^ (offset >> 16));
+}
+/*---------------------------------------------------------------------------*/
+static int
+gen_reader(struct mqtt_connection *m, void *ptr, uint32_t offset,
+           uint8_t *buf, uint16_t len)
+{
+  uint16_t i;
+
+  for(i = 0; i < len; i++) {
+    buf[i] = pattern(offset + i);
+  }
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+static int
+fail_reader(struct mqtt_connection *m, void *ptr, uint32_t offset,
+            uint8_t *buf, uint16_t len)
+{
+  if(offset + len > FAIL_OFFSET) {
+    return -1;
+  }
+  return gen_reader(m, ptr, offset, buf, len);
+}
+/*---------------------------------------------------------------------------*/
+static int
+write_file(void)
+{
+  static uint8_t chunk[1024];
+  uint32_t offset;
+  uint16_t i;
+  int f;
+
+  cfs_remove(FILE_NAME);
+  f = cfs_open(FILE_NAME, CFS_WRITE);
+  if(f < 0) {
+    return -1;
+  }
+  for(offset = 0; offset < FILE_SIZE; offset += sizeof(chunk)) {
+    for(i = 0; i < sizeof(chunk); i++) {
+      chunk[i] = pattern(offset + i);
+    }
+    if(cfs_write(f, chunk, sizeof(chunk)) != sizeof(chunk)) {
+      cfs_close(f);
+      return -1;
+    }
+  }
+  cfs_close(f);
+  return cfs_open(FILE_NAME, CFS_READ);
+}
+/*---------------------------------------------------------------------------*/
+static void
+mqtt_event(struct mqtt_connection *m, mqtt_event_t event, void *data)
+{
+  switch(event) {
+  case MQTT_EVENT_CONNECTED:
+    connected = 1;
+    printf("Connected\n");
+    break;
+  case MQTT_EVENT_DISCONNECTED:
+    connected = 0;
+    printf("Disconnected\n");
+    break;
+  case MQTT_EVENT_PUBACK:
+    acked = *(uint16_t *)data == mid;
+    break;
+  case MQTT_EVENT_ERROR:
+    errors++;
+    printf("Error\n");
+    break;
+  default:
+    break;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+report(const char *name, uint32_t size, clock_time_t start)
+{
+  unsigned long elapsed;
+
+  elapsed = (unsigned long)(clock_time() - start) * 1000 / CLOCK_SECOND;
+  printf("%s: %lu bytes in %lu ms, %lu KiB/s\n", name, (unsigned long)size,
+         elapsed, (unsigned long)(size / (elapsed ? elapsed : 1)) * 1000 / 1024);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(mqtt_stream_client, ev, data)
+{
+  static struct etimer et;
+  static clock_time_t start;
+  static uint8_t ok;
+  uint32_t i;
+
+  PROCESS_BEGIN();
+
+  for(i = 0; i < RAM_SIZE; i++) {
+    ram_payload[i] = pattern(i);
+  }
+  fd = write_file();
+
+  /* Give the host side of the tun interface time to come up */
+  etimer_set(&et, 2 * CLOCK_SECOND);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+
+  mqtt_register(&conn, &mqtt_stream_client, CLIENT_ID, mqtt_event,
+                MAX_SEGMENT);
+  mqtt_connect(&conn, BROKER_IP, BROKER_PORT, 60, MQTT_CLEAN_SESSION_ON,
+               MQTT_PROP_LIST_NONE);
+
+  etimer_set(&et, TEST_TIMEOUT);
+  PROCESS_WAIT_EVENT_UNTIL(connected || etimer_expired(&et));
+  ok = connected && fd >= 0;
+
+  /* A generated payload, acknowledged with QoS 1 */
+  if(ok) {
+    acked = 0;
+    start = clock_time();
+    ok = mqtt_publish_stream(&conn, &mid, "stream/gen", gen_reader, NULL,
+                             GEN_SIZE, MQTT_QOS_LEVEL_1, MQTT_RETAIN_OFF, 0,
+                             MQTT_TOPIC_ALIAS_OFF,
+                             MQTT_PROP_LIST_NONE) == MQTT_STATUS_OK;
+    while(ok && !acked && connected && !etimer_expired(&et)) {
+      PROCESS_WAIT_EVENT();
+    }
+    ok = ok && acked;
+    report("generated, qos 1", GEN_SIZE, start);
+  }
+
+  /* A CFS file, acknowledged with QoS 2 */
+  if(ok) {
+    acked = 0;
+    start = clock_time();
+    ok = mqtt_publish_stream(&conn, &mid, "stream/cfs", mqtt_cfs_reader, &fd,
+                             FILE_SIZE, MQTT_QOS_LEVEL_2, MQTT_RETAIN_OFF, 0,
+                             MQTT_TOPIC_ALIAS_OFF,
+                             MQTT_PROP_LIST_NONE) == MQTT_STATUS_OK;
+    while(ok && !acked && connected && !etimer_expired(&et)) {
+      PROCESS_WAIT_EVENT();
+    }
+    ok = ok && acked;
+    report("cfs file, qos 2", FILE_SIZE, start);
+  }
+
+  /* A payload in RAM, over 64 KiB, for comparison */
+  if(ok) {
+    acked = 0;
+    start = clock_time();
+    ok = mqtt_publish(&conn, &mid, "stream/ram", ram_payload, RAM_SIZE,
+                      MQTT_QOS_LEVEL_1, MQTT_RETAIN_OFF, 0,
+                      MQTT_TOPIC_ALIAS_OFF,
+                      MQTT_PROP_LIST_NONE) == MQTT_STATUS_OK;
+    while(ok && !acked && connected && !etimer_expired(&et)) {
+      PROCESS_WAIT_EVENT();
+    }
+    ok = ok && acked;
+    report("ram, qos 1", RAM_SIZE, start);
+  }
+
+  /* A reader that fails half way aborts the connection */
+  if(ok) {
+    ok = mqtt_publish_stream(&conn, &mid, "stream/fail", fail_reader, NULL,
+                             GEN_SIZE, MQTT_QOS_LEVEL_0, MQTT_RETAIN_OFF, 0,
+                             MQTT_TOPIC_ALIAS_OFF,
+                             MQTT_PROP_LIST_NONE) == MQTT_STATUS_OK;
+    while(ok && errors == 0 && !etimer_expired(&et)) {
+      PROCESS_WAIT_EVENT();
+    }
+    ok = ok && errors == 1 && !mqtt_connected(&conn);
+  }
+
+  if(fd >= 0) {
+    cfs_close(fd);
+  }
+  cfs_remove(FILE_NAME);
+
+  printf("MQTT stream client: %s\n", ok ? "OK" : "FAILED");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
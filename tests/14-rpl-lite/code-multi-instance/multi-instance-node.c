@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden AB
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Two roots, node 1 and node 2, each run their own RPL instance with its
+ * own prefix. All other nodes join both instances and periodically send
+ * to the root address returned by the routing driver, i.e. the root of
+ * their primary instance.
+ */
+
+#include "contiki.h"
+#include "net/routing/routing.h"
+#include "net/routing/rpl-lite/rpl.h"
+#include "net/ipv6/simple-udp.h"
+#include "sys/node-id.h"
+
+#include <stdio.h>
+
+#include "sys/log.h"
+#define LOG_MODULE "App"
+#define LOG_LEVEL LOG_LEVEL_INFO
+
+#define UDP_PORT        1234
+#define SEND_INTERVAL   (10 * CLOCK_SECOND)
+#define SECOND_INSTANCE (RPL_DEFAULT_INSTANCE + 1)
+
+static struct simple_udp_connection udp_conn;
+
+/*---------------------------------------------------------------------------*/
+PROCESS(multi_instance_process, "Multi-instance node");
+AUTOSTART_PROCESSES(&multi_instance_process);
+/*---------------------------------------------------------------------------*/
+static void
+udp_rx_callback(struct simple_udp_connection *c,
+                const uip_ipaddr_t *sender_addr,
+                uint16_t sender_port,
+                const uip_ipaddr_t *receiver_addr,
+                uint16_t receiver_port,
+                const uint8_t *data,
+                uint16_t datalen)
+{
+  LOG_INFO("Data received from node %u\n", datalen > 0 ? data[0] : 0);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(multi_instance_process, ev, data)
+{
+  static struct etimer periodic_timer;
+  uip_ipaddr_t prefix;
+  uip_ipaddr_t dest_ipaddr;
+  uint8_t payload;
+
+  PROCESS_BEGIN();
+
+  simple_udp_register(&udp_conn, UDP_PORT, NULL, UDP_PORT, udp_rx_callback);
+
+  if(node_id == 1) {
+    NETSTACK_ROUTING.root_start();
+  } else if(node_id == 2) {
+    uip_ip6addr(&prefix, 0xfd01, 0, 0, 0, 0, 0, 0, 0);
+    NETSTACK_ROUTING.root_set_prefix(&prefix, NULL);
+    rpl_dag_root_start_instance(SECOND_INSTANCE);
+  } else {
+    etimer_set(&periodic_timer, SEND_INTERVAL);
+    while(1) {
+      PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&periodic_timer));
+      etimer_reset(&periodic_timer);
+
+      if(NETSTACK_ROUTING.node_is_reachable()
+         && NETSTACK_ROUTING.get_root_ipaddr(&dest_ipaddr)) {
+        LOG_INFO("Sending to ");
+        LOG_INFO_6ADDR(&dest_ipaddr);
+        LOG_INFO_("\n");
+        payload = node_id;
+        simple_udp_sendto(&udp_conn, &payload, sizeof(payload), &dest_ipaddr);
+      }
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
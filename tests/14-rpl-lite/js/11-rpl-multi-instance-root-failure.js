@@ -0,0 +1,55 @@
+// Nodes 3 and 4 join the DODAGs of both roots (node 1, instance 0 and
+// node 2, instance 1) and send to the root of their primary instance.
+// Once root 1 has heard from both, it is removed. The senders must fail
+// over to instance 1 well before the DAG of instance 0 would time out.
+var first_root = 1;
+var second_root = 2;
+var senders = [3, 4];
+var max_recovery_time = 120; // s
+
+var received_first = {};
+var received_second = {};
+var failure_time = -1;
+
+function all_received(received) {
+  for(var i = 0; i < senders.length; i++) {
+    if(!received[senders[i]]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+TIMEOUT(900000, log.testFailed()); // ms
+
+while(true) {
+  YIELD();
+
+  log.log(time + " node-" + id + " " + msg + "\n");
+
+  var m = msg.match(/Data received from node (\d+)/);
+  if(m == null) {
+    continue;
+  }
+
+  if(failure_time < 0 && id == first_root) {
+    received_first[m[1]] = true;
+    if(all_received(received_first)) {
+      sim.removeMote(sim.getMoteWithID(first_root));
+      failure_time = time;
+      log.log("Removed root " + first_root + "\n");
+    }
+  } else if(failure_time >= 0 && id == second_root) {
+    received_second[m[1]] = true;
+    if(all_received(received_second)) {
+      var recovery = (time - failure_time) / 1000000;
+      log.log("Recovered through root " + second_root + " after " + recovery + " s\n");
+      if(recovery <= max_recovery_time) {
+        log.testOK();
+      } else {
+        log.testFailed();
+      }
+      break;
+    }
+  }
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden AB
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *      RPL node, and root if its node ID is 1, that reports its DAO
+ *      aggregation statistics and its number of downward routes once a
+ *      minute. Needs RPL_CONF_STATS.
+ */
+
+#include "contiki.h"
+#include "sys/node-id.h"
+#include "net/ipv6/uip-ds6-route.h"
+#include "net/routing/routing.h"
+#include "net/routing/rpl-classic/rpl-private.h"
+
+#include <stdio.h>
+
+#define REPORT_INTERVAL (60 * CLOCK_SECOND)
+
+PROCESS(dao_aggregation_node_process, "DAO aggregation node");
+AUTOSTART_PROCESSES(&dao_aggregation_node_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(dao_aggregation_node_process, ev, data)
+{
+  static struct etimer periodic_timer;
+
+  PROCESS_BEGIN();
+
+  if(node_id == 1) {
+    NETSTACK_ROUTING.root_start();
+  }
+
+  etimer_set(&periodic_timer, REPORT_INTERVAL);
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&periodic_timer));
+    etimer_reset(&periodic_timer);
+
+    printf("DAO stats: in %u targets %u merged %u routes %u\n",
+           rpl_stats.dao_in, rpl_stats.dao_targets_in,
+           rpl_stats.dao_targets_merged, uip_ds6_route_num_routes());
+  }
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
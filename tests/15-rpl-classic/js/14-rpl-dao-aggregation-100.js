@@ -0,0 +1,39 @@
+// With DAO aggregation, the root of a 100 node DODAG is to learn a route
+// to every other node from fewer DAOs than targets, and the nodes on the
+// way up are to refresh some targets while they wait in their queues.
+var node_id_of_root = 1;
+var expected_num_of_routes = 99;
+var merged = {};
+var last = null;
+
+TIMEOUT(2400000, log.log("last root report: " + last + "\n"); log.testFailed()); // ms
+
+while(true) {
+  YIELD();
+
+  if(!msg.startsWith("DAO stats:")) {
+    continue;
+  }
+
+  // DAO stats: in <n> targets <n> merged <n> routes <n>
+  var fields = msg.split(" ");
+  merged[id] = parseInt(fields[7]);
+
+  if(id == node_id_of_root) {
+    var dao_in = parseInt(fields[3]);
+    var targets_in = parseInt(fields[5]);
+    var routes = parseInt(fields[9]);
+    var total_merged = 0;
+    for(var n in merged) {
+      total_merged += merged[n];
+    }
+    last = msg + ", merged in the DODAG " + total_merged;
+    log.log(time + " " + last + "\n");
+
+    if(routes == expected_num_of_routes && targets_in > dao_in &&
+       total_merged > 0) {
+      log.testOK();
+      break;
+    }
+  }
+}
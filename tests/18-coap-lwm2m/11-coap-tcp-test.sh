@@ -0,0 +1,48 @@
+#!/bin/bash
+source ../utils.sh
+
+# Contiki directory
+CONTIKI=../..
+# Test basename
+BASENAME=11-coap-tcp-test
+
+IPADDR=fd00::302:304:506:708
+
+# Starting the reference server before the node connects to it
+echo "Starting CoAP over TCP reference server"
+python3 coap-tcp-server.py $IPADDR >server.log 2>&1 &
+SPID=$!
+sleep 1
+
+# Starting Contiki-NG native node
+echo "Starting native node - CoAP over TCP client"
+sudo $CONTIKI/tests/18-coap-lwm2m/coap-tcp-client/build/native/coap-tcp-client.native >node.log 2>&1 &
+CPID=$!
+
+COUNTER=12
+while [ $COUNTER -gt 0 ]; do
+    sleep 5
+    if grep -q 'reference server: ' server.log ; then
+        break
+    fi
+    let COUNTER-=1
+done
+
+echo "Closing native node"
+kill_bg $CPID
+
+echo "Closing reference server"
+kill_bg $SPID
+
+if grep -q 'client: OK' node.log && grep -q 'reference server: OK' server.log ; then
+  cp server.log $BASENAME.testlog;
+  printf "%-32s TEST OK\n" "$BASENAME" | tee $BASENAME.testlog;
+else
+  echo "==== node.log ====" ; cat node.log;
+  echo "==== server.log ====" ; cat server.log;
+  printf "%-32s TEST FAIL\n" "$BASENAME" | tee $BASENAME.testlog;
+  rm -f node.log server.log
+  exit 1
+fi
+
+rm -f node.log server.log
@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2026, RISE Research Institutes of Sweden AB
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         CoAP over TCP and WebSocket interoperability test client. Fetches
+ *         a large resource with BERT blocks from the reference server and
+ *         serves the same resource to it.
+ */
+
+#include "contiki.h"
+#include "coap-engine.h"
+#include "coap-blocking-api.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Log configuration */
+#include "coap-log.h"
+#define LOG_MODULE "App"
+#define LOG_LEVEL  LOG_LEVEL_INFO
+
+#define SERVER_TCP_EP "coap+tcp://[fd00::1]"
+#define SERVER_WS_EP  "coap+ws://[fd00::1]:8080"
+
+/* Must match the reference server */
+#define LARGE_SIZE    10000
+
+PROCESS(coap_tcp_client, "CoAP over TCP client");
+AUTOSTART_PROCESSES(&coap_tcp_client);
+
+static struct etimer et;
+static uint32_t received;
+static uint8_t data_ok;
+/*---------------------------------------------------------------------------*/
+static void
+res_large_get_handler(coap_message_t *request, coap_message_t *response,
+                      uint8_t *buffer, uint16_t preferred_size,
+                      int32_t *offset)
+{
+  int32_t len;
+  int32_t i;
+
+  if(*offset >= LARGE_SIZE) {
+    coap_set_status_code(response, BAD_OPTION_4_02);
+    return;
+  }
+
+  len = MIN(preferred_size, LARGE_SIZE - *offset);
+  for(i = 0; i < len; i++) {
+    buffer[i] = (*offset + i) % 251;
+  }
+  coap_set_header_content_format(response, APPLICATION_OCTET_STREAM);
+  coap_set_payload(response, buffer, len);
+
+  *offset += len;
+  if(*offset >= LARGE_SIZE) {
+    *offset = -1;
+  }
+}
+RESOURCE(res_large, "title=\"Large\"", res_large_get_handler, NULL, NULL,
+         NULL);
+/*---------------------------------------------------------------------------*/
+static void
+large_handler(coap_message_t *response)
+{
+  const uint8_t *chunk;
+  int len;
+  int i;
+
+  if(response == NULL) {
+    printf("Request timed out\n");
+    data_ok = 0;
+    return;
+  }
+
+  len = coap_get_payload(response, &chunk);
+  for(i = 0; i < len; i++) {
+    if(chunk[i] != (received + i) % 251) {
+      data_ok = 0;
+    }
+  }
+  received += len;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(coap_tcp_client, ev, data)
+{
+  static const char *const urls[] = { SERVER_TCP_EP, SERVER_WS_EP };
+  static coap_endpoint_t server_ep;
+  static coap_message_t request[1];
+  static clock_time_t start;
+  static uint8_t passed;
+  static int i;
+  static int wait;
+
+  PROCESS_BEGIN();
+
+  coap_activate_resource(&res_large, "large");
+
+  /* let the interface come up */
+  etimer_set(&et, CLOCK_SECOND * 2);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+
+  passed = 0;
+  for(i = 0; i < 2; i++) {
+    coap_endpoint_parse(urls[i], strlen(urls[i]), &server_ep);
+    if(!coap_endpoint_connect(&server_ep)) {
+      printf("Could not connect to %s\n", urls[i]);
+      continue;
+    }
+
+    for(wait = 0; wait < 100 && !coap_endpoint_is_connected(&server_ep);
+        wait++) {
+      etimer_set(&et, CLOCK_SECOND / 10);
+      PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+    }
+    if(!coap_endpoint_is_connected(&server_ep)) {
+      printf("Connection to %s timed out\n", urls[i]);
+      continue;
+    }
+
+    coap_init_message(request, COAP_TYPE_CON, COAP_GET, 0);
+    coap_set_header_uri_path(request, "large");
+
+    received = 0;
+    data_ok = 1;
+    start = clock_time();
+    COAP_BLOCKING_REQUEST(&server_ep, request, large_handler);
+
+    printf("%s: %lu bytes in %lu ms\n", urls[i], (unsigned long)received,
+           (unsigned long)((clock_time() - start) * 1000 / CLOCK_SECOND));
+    if(received == LARGE_SIZE && data_ok) {
+      passed++;
+    }
+
+    coap_endpoint_disconnect(&server_ep);
+  }
+
+  printf("CoAP over TCP client: %s\n", passed == 2 ? "OK" : "FAILED");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,299 @@
+#!/usr/bin/env python3
+#
+# Minimal CoAP over TCP and WebSockets (RFC 8323) reference peer for the
+# coap-tcp-client test node. It serves /large with BERT blocks on TCP port
+# 5683 and WebSocket port 8080, pings every client, and then fetches /large
+# from the node over TCP. Only the standard library is used.
+
+import asyncio
+import base64
+import hashlib
+import struct
+import sys
+
+LARGE_SIZE = 10000
+LARGE = bytes(i % 251 for i in range(LARGE_SIZE))
+
+CSM, PING, PONG, RELEASE, ABORT = 0xe1, 0xe2, 0xe3, 0xe4, 0xe5
+GET, CONTENT, NOT_FOUND, BAD_OPTION = 0x01, 0x45, 0x84, 0x82
+OPT_URI_PATH, OPT_BLOCK2 = 11, 23
+CSM_MAX_MESSAGE_SIZE, CSM_BLOCK_WISE_TRANSFER = 2, 4
+BERT_UNITS = 3
+MAX_MESSAGE_SIZE = 8192
+
+WS_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+results = {"tcp": False, "ws": False, "ping": 0, "node": False}
+
+
+def encode_options(options):
+    out = b""
+    last = 0
+    for number, value in sorted(options, key=lambda o: o[0]):
+        delta = number - last
+        last = number
+        ext = b""
+        fields = []
+        for n in (delta, len(value)):
+            if n < 13:
+                fields.append(n)
+            elif n < 269:
+                fields.append(13)
+                ext += bytes([n - 13])
+            else:
+                fields.append(14)
+                ext += struct.pack("!H", n - 269)
+        out += bytes([(fields[0] << 4) | fields[1]]) + ext + value
+    return out
+
+
+def decode_options(data):
+    options = []
+    number = 0
+    i = 0
+    while i < len(data) and data[i] != 0xff:
+        delta, length = data[i] >> 4, data[i] & 0x0f
+        i += 1
+        vals = []
+        for n in (delta, length):
+            if n == 13:
+                n = data[i] + 13
+                i += 1
+            elif n == 14:
+                n = struct.unpack("!H", data[i:i + 2])[0] + 269
+                i += 2
+            vals.append(n)
+        number += vals[0]
+        options.append((number, data[i:i + vals[1]]))
+        i += vals[1]
+    payload = data[i + 1:] if i < len(data) else b""
+    return options, payload
+
+
+def uint(value):
+    return value.to_bytes((value.bit_length() + 7) // 8, "big")
+
+
+def encode_tcp(code, token=b"", options=(), payload=b""):
+    body = encode_options(options) + (b"\xff" + payload if payload else b"")
+    n = len(body)
+    if n < 13:
+        head = bytes([(n << 4) | len(token)])
+    elif n < 269:
+        head = bytes([(13 << 4) | len(token), n - 13])
+    elif n < 65805:
+        head = bytes([(14 << 4) | len(token)]) + struct.pack("!H", n - 269)
+    else:
+        head = bytes([(15 << 4) | len(token)]) + struct.pack("!I", n - 65805)
+    return head + bytes([code]) + token + body
+
+
+async def read_tcp(reader):
+    first = (await reader.readexactly(1))[0]
+    n, tkl = first >> 4, first & 0x0f
+    if n == 13:
+        n = (await reader.readexactly(1))[0] + 13
+    elif n == 14:
+        n = struct.unpack("!H", await reader.readexactly(2))[0] + 269
+    elif n == 15:
+        n = struct.unpack("!I", await reader.readexactly(4))[0] + 65805
+    code = (await reader.readexactly(1))[0]
+    token = await reader.readexactly(tkl)
+    options, payload = decode_options(await reader.readexactly(n))
+    return code, token, options, payload
+
+
+class TcpFraming:
+    def __init__(self, reader, writer):
+        self.reader, self.writer = reader, writer
+
+    async def recv(self):
+        return await read_tcp(self.reader)
+
+    def send(self, code, token=b"", options=(), payload=b""):
+        self.writer.write(encode_tcp(code, token, options, payload))
+
+
+class WsFraming:
+    # One CoAP message per binary frame, with a zero length nibble
+    def __init__(self, reader, writer):
+        self.reader, self.writer = reader, writer
+
+    async def recv(self):
+        while True:
+            head = await self.reader.readexactly(2)
+            opcode, n = head[0] & 0x0f, head[1] & 0x7f
+            if n == 126:
+                n = struct.unpack("!H", await self.reader.readexactly(2))[0]
+            elif n == 127:
+                n = struct.unpack("!Q", await self.reader.readexactly(8))[0]
+            mask = await self.reader.readexactly(4) if head[1] & 0x80 else b"\0" * 4
+            data = bytes(b ^ mask[i % 4] for i, b in enumerate(
+                await self.reader.readexactly(n)))
+            if opcode == 8:
+                raise asyncio.IncompleteReadError(b"", None)
+            if opcode == 2:
+                break
+        tkl = data[0] & 0x0f
+        options, payload = decode_options(data[2 + tkl:])
+        return data[1], data[2:2 + tkl], options, payload
+
+    def send(self, code, token=b"", options=(), payload=b""):
+        body = encode_options(options) + (b"\xff" + payload if payload else b"")
+        data = bytes([len(token), code]) + token + body
+        if len(data) < 126:
+            head = bytes([0x82, len(data)])
+        elif len(data) < 65536:
+            head = bytes([0x82, 126]) + struct.pack("!H", len(data))
+        else:
+            head = bytes([0x82, 127]) + struct.pack("!Q", len(data))
+        self.writer.write(head + data)
+
+
+def option(options, number):
+    for n, v in options:
+        if n == number:
+            return v
+    return None
+
+
+def block2(options):
+    value = option(options, OPT_BLOCK2)
+    if value is None:
+        return None
+    v = int.from_bytes(value, "big")
+    return v >> 4, (v >> 3) & 1, v & 7
+
+
+def handle_request(framing, peer, token, options):
+    path = "/".join(v.decode() for n, v in options if n == OPT_URI_PATH)
+    if path != "large":
+        framing.send(NOT_FOUND, token)
+        return False
+    num, szx = 0, 6
+    b = block2(options)
+    if b is not None:
+        num, _, szx = b
+    if szx == 7 and peer["bert"]:
+        offset, size = num * 1024, BERT_UNITS * 1024
+    elif szx == 7:
+        framing.send(BAD_OPTION, token)
+        return False
+    else:
+        size = 16 << szx
+        offset = num * size
+    chunk = LARGE[offset:offset + size]
+    more = offset + len(chunk) < LARGE_SIZE
+    framing.send(CONTENT, token,
+                 [(OPT_BLOCK2, uint((num << 4) | (more << 3) | szx))], chunk)
+    return not more
+
+
+async def serve(framing, name):
+    peer = {"bert": False, "max": 1152}
+    framing.send(CSM, options=[(CSM_MAX_MESSAGE_SIZE, uint(MAX_MESSAGE_SIZE)),
+                               (CSM_BLOCK_WISE_TRANSFER, b"")])
+    try:
+        while True:
+            code, token, options, payload = await framing.recv()
+            if code == CSM:
+                peer["bert"] = option(options, CSM_BLOCK_WISE_TRANSFER) is not None
+                mms = option(options, CSM_MAX_MESSAGE_SIZE)
+                if mms is not None:
+                    peer["max"] = int.from_bytes(mms, "big")
+                print("%s: CSM max %d bert %s" % (name, peer["max"], peer["bert"]))
+                framing.send(PING, b"\x42")
+            elif code == PONG:
+                results["ping"] += 1
+            elif code == PING:
+                framing.send(PONG, token)
+            elif code in (RELEASE, ABORT):
+                break
+            elif code == GET:
+                if handle_request(framing, peer, token, options):
+                    results[name] = True
+                    print("%s: served /large" % name)
+    except (asyncio.IncompleteReadError, ConnectionError):
+        pass
+    framing.writer.close()
+
+
+async def tcp_client(reader, writer):
+    await serve(TcpFraming(reader, writer), "tcp")
+
+
+async def ws_client(reader, writer):
+    request = b""
+    while b"\r\n\r\n" not in request:
+        request += await reader.read(1024)
+    headers = {}
+    for line in request.decode().split("\r\n")[1:]:
+        if ":" in line:
+            k, v = line.split(":", 1)
+            headers[k.strip().lower()] = v.strip()
+    accept = base64.b64encode(hashlib.sha1(
+        (headers["sec-websocket-key"] + WS_GUID).encode()).digest()).decode()
+    writer.write(("HTTP/1.1 101 Switching Protocols\r\n"
+                  "Upgrade: websocket\r\nConnection: Upgrade\r\n"
+                  "Sec-WebSocket-Accept: %s\r\n"
+                  "Sec-WebSocket-Protocol: coap\r\n\r\n" % accept).encode())
+    await serve(WsFraming(reader, writer), "ws")
+
+
+async def fetch_from_node(address):
+    reader, writer = await asyncio.open_connection(address, 5683)
+    framing = TcpFraming(reader, writer)
+    framing.send(CSM, options=[(CSM_MAX_MESSAGE_SIZE, uint(MAX_MESSAGE_SIZE)),
+                               (CSM_BLOCK_WISE_TRANSFER, b"")])
+    framing.send(PING, b"\x17")
+    data = b""
+    num = 0
+    blocks = 0
+    pong = False
+    framing.send(GET, b"\x01", [(OPT_URI_PATH, b"large"), (OPT_BLOCK2, uint(7))])
+    while True:
+        code, token, options, payload = await asyncio.wait_for(framing.recv(), 10)
+        if code == PONG and token == b"\x17":
+            pong = True
+        elif code == CONTENT:
+            b = block2(options)
+            if b is None or b[0] != num or b[2] != 7:
+                print("node: unexpected block %s" % (b,))
+                break
+            data += payload
+            blocks += 1
+            if not b[1]:
+                break
+            num += max(len(payload) // 1024, 1)
+            framing.send(GET, b"\x01", [(OPT_URI_PATH, b"large"),
+                                        (OPT_BLOCK2, uint((num << 4) | 7))])
+        elif code != CSM:
+            print("node: unexpected code %d" % code)
+            break
+    framing.send(RELEASE)
+    writer.close()
+    print("node: %d bytes in %d blocks, pong %s" % (len(data), blocks, pong))
+    results["node"] = data == LARGE and pong
+
+
+async def main():
+    node = sys.argv[1] if len(sys.argv) > 1 else "fd00::302:304:506:708"
+    tcp = await asyncio.start_server(tcp_client, "::", 5683)
+    ws = await asyncio.start_server(ws_client, "::", 8080)
+    for i in range(60):
+        await asyncio.sleep(1)
+        if results["tcp"] and results["ws"]:
+            break
+    try:
+        await fetch_from_node(node)
+    except (OSError, asyncio.TimeoutError, asyncio.IncompleteReadError) as e:
+        print("node: %s" % e)
+    tcp.close()
+    ws.close()
+    ok = results["tcp"] and results["ws"] and results["ping"] == 2 and results["node"]
+    print("CoAP over TCP reference server: %s" % ("OK" if ok else "FAILED"))
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(asyncio.run(main()))
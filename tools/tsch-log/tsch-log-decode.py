@@ -0,0 +1,179 @@
+#!/usr/bin/env python3
+"""Decode binary TSCH per-slot logs (TSCH_LOG_CONF_BINARY=1).
+
+Reads the raw serial output of a node from a file or stdin. Text output is
+passed through unchanged; binary log records are turned back into the usual
+"[INFO: TSCH-LOG  ]" text lines, or into CSV rows with --csv.
+
+Usage:
+    tsch-log-decode.py [--csv] [file]
+"""
+
+import argparse
+import csv
+import struct
+import sys
+
+END = 0xc0
+ESC = 0xdb
+ESC_END = 0xdc
+ESC_ESC = 0xdd
+
+VERSION = 1
+ADDR_LEN = 8
+# See TSCH_LOG_BINARY_* in os/net/mac/tsch/tsch-log.h
+RECORD = struct.Struct('<BBBIHHBHBBBBBBbBhhB%ds%ds' % (ADDR_LEN, ADDR_LEN))
+RECORD_LEN = RECORD.size + 2
+
+FLAG_UNICAST = 0x01
+FLAG_DATA = 0x02
+FLAG_DRIFT_USED = 0x04
+
+TYPES = {0: 'tx', 1: 'rx'}
+
+CSV_FIELDS = ['asn', 'type', 'slotframe', 'slotframe_size', 'burst', 'timeslot',
+              'channel_offset', 'channel', 'unicast', 'data', 'sec_level',
+              'src', 'dst', 'len', 'seq', 'status', 'num_tx', 'drift',
+              'estimated_drift']
+
+
+def crc16(data):
+    """CRC-16 as computed by crc16_data() in os/lib/crc16.c"""
+    acc = 0
+    for b in data:
+        acc ^= b
+        acc = ((acc >> 8) | (acc << 8)) & 0xffff
+        acc ^= ((acc & 0xff00) << 4) & 0xffff
+        acc ^= (acc >> 8) >> 4
+        acc ^= (acc & 0xff00) >> 5
+    return acc
+
+
+def addr_compact(addr, addr_len):
+    """Same format as log_lladdr_compact()"""
+    addr = addr[:addr_len]
+    if not any(addr):
+        return 'LL-NULL'
+    return 'LL-%04x' % ((addr[-2] << 8) | addr[-1])
+
+
+def parse_record(payload):
+    """Returns a dict for a valid record, None otherwise"""
+    if len(payload) != RECORD_LEN:
+        return None
+    (crc,) = struct.unpack_from('<H', payload, RECORD.size)
+    if crc != crc16(payload[:RECORD.size]):
+        return None
+    (version, rtype, asn_ms1b, asn_ls4b, sf_handle, sf_size, burst, timeslot,
+     channel_offset, channel, flags, sec_level, datalen, seqno, status, num_tx,
+     drift, estimated_drift, addr_len, src, dst) = RECORD.unpack_from(payload)
+    if version != VERSION or rtype not in TYPES:
+        return None
+    return {
+        'asn': '%02x.%08x' % (asn_ms1b, asn_ls4b),
+        'type': TYPES[rtype],
+        'has_link': sf_handle != 0xffff,
+        'slotframe': sf_handle,
+        'slotframe_size': sf_size,
+        'burst': burst,
+        'timeslot': timeslot,
+        'channel_offset': channel_offset,
+        'channel': channel,
+        'unicast': 1 if flags & FLAG_UNICAST else 0,
+        'data': 1 if flags & FLAG_DATA else 0,
+        'drift_used': bool(flags & FLAG_DRIFT_USED),
+        'sec_level': sec_level,
+        'src': addr_compact(src, addr_len),
+        'dst': addr_compact(dst, addr_len),
+        'len': datalen,
+        'seq': seqno,
+        'status': status,
+        'num_tx': num_tx,
+        'drift': drift,
+        'estimated_drift': estimated_drift,
+    }
+
+
+def format_record(r):
+    """Reproduces the text output of tsch_log_process_pending()"""
+    if r['has_link']:
+        line = '[INFO: TSCH-LOG  ] {asn %s link %2u %3u %3u %2u %2u ch %2u} ' % (
+            r['asn'], r['slotframe'], r['slotframe_size'], r['burst'],
+            r['timeslot'], r['channel_offset'], r['channel'])
+    else:
+        line = '[INFO: TSCH-LOG  ] {asn %s link-NULL} ' % r['asn']
+    line += '%s-%u-%u %s %s->%s, len %3u, seq %3u' % (
+        'uc' if r['unicast'] else 'bc', r['data'], r['sec_level'], r['type'],
+        r['src'], r['dst'], r['len'], r['seq'])
+    if r['type'] == 'tx':
+        line += ', st %d %2d' % (r['status'], r['num_tx'])
+        if r['drift_used']:
+            line += ', dr %3d' % r['drift']
+    else:
+        line += ', edr %3d' % r['estimated_drift']
+        if r['drift_used']:
+            line += ', dr %3d' % r['drift']
+    return line + '\n'
+
+
+def unescape(frame):
+    out = bytearray()
+    escaped = False
+    for b in frame:
+        if escaped:
+            out.append(END if b == ESC_END else ESC if b == ESC_ESC else b)
+            escaped = False
+        elif b == ESC:
+            escaped = True
+        else:
+            out.append(b)
+    return bytes(out)
+
+
+def decode(stream, on_text, on_record):
+    """Splits a byte stream into text and binary records"""
+    data = stream.read()
+    pos = 0
+    while pos < len(data):
+        start = data.find(bytes([END]), pos)
+        if start < 0:
+            on_text(data[pos:])
+            break
+        on_text(data[pos:start])
+        stop = data.find(bytes([END]), start + 1)
+        if stop < 0:
+            on_text(data[start + 1:])
+            break
+        record = parse_record(unescape(data[start + 1:stop]))
+        if record is None:
+            # Not a valid record: we may have lost sync, consider the
+            # closing delimiter as the opening of the next record
+            on_text(data[start + 1:stop])
+            pos = stop
+        else:
+            on_record(record)
+            pos = stop + 1
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode binary TSCH logs')
+    parser.add_argument('--csv', action='store_true',
+                        help='output binary records as CSV, drop text output')
+    parser.add_argument('file', nargs='?', help='input file (default: stdin)')
+    args = parser.parse_args()
+
+    stream = open(args.file, 'rb') if args.file else sys.stdin.buffer
+    out = sys.stdout
+
+    if args.csv:
+        writer = csv.DictWriter(out, fieldnames=CSV_FIELDS, extrasaction='ignore')
+        writer.writeheader()
+        decode(stream, lambda text: None, writer.writerow)
+    else:
+        decode(stream,
+               lambda text: out.write(text.decode('utf-8', errors='replace')),
+               lambda record: out.write(format_record(record)))
+
+
+if __name__ == '__main__':
+    main()